@@ -32,23 +32,6 @@ void closeLogFile(void)
    fclose(log_file);
 }
 
-FILE *trace_file = NULL;
-
-void openTraceFile(string trace_file_name)
-{
-   trace_file = fopen(trace_file_name, "w");
-   if(trace_file == NULL)
-   { 
-      perror("gp2.trace");
-      exit(1);
-   }
-}
-
-void closeTraceFile(void)
-{
-   fclose(trace_file);
-}
-
 /* Invariants on graphs:
  * (1) For 0 <= i <= graph->nodes.size, if graph->nodes.items[i].index is -1,
  *     then i is in the holes array.
@@ -62,8 +45,41 @@ void closeTraceFile(void)
  *     graph->number_of_edges.
  * (7) Source and target consistency: For all edges E, if S is E's source and
  *     T is E's target, then E is in S's outedge list and E is in T's inedge list. 
+ * (8) For each mark, the number of non-dummy nodes (edges) with that mark is
+ *     equal to graph->nodes_by_mark (graph->edges_by_mark) at that mark, and
+ *     the number of root nodes is equal to graph->number_of_roots.
+ * (9) Each field of a node's neighbourhood signature that is less than 7 is
+ *     equal to the count of incident items it summarises (see graph.h).
+ * (10) The node columns agree with the node array: every non-dummy node has
+ *      its mark, root status and saturated degrees at its index, and every
+ *      dummy node has a zero status.
  */
 
+/* Computes the exact counts summarised by a node's signature. */
+static void countNeighbourhood(Graph *graph, Node *node, int *counts)
+{
+   int field, counter;
+   for(field = 0; field < 16; field++) counts[field] = 0;
+   for(counter = 0; counter < node->out_edges.size + 2; counter++)
+   {
+      Edge *edge = getNthOutEdge(graph, node, counter);
+      if(edge == NULL) continue;
+      Node *target = getNode(graph, edge->target);
+      if(edge->label.mark != NONE) counts[SIGNATURE_OUT_EDGE(edge->label.mark)]++;
+      if(target->label.mark < DASHED) counts[SIGNATURE_NEIGHBOUR(target->label.mark)]++;
+      if(target->root) counts[SIGNATURE_ROOT_NEIGHBOUR]++;
+   }
+   for(counter = 0; counter < node->in_edges.size + 2; counter++)
+   {
+      Edge *edge = getNthInEdge(graph, node, counter);
+      if(edge == NULL) continue;
+      Node *source = getNode(graph, edge->source);
+      if(edge->label.mark != NONE) counts[SIGNATURE_IN_EDGE(edge->label.mark)]++;
+      if(source->label.mark < DASHED) counts[SIGNATURE_NEIGHBOUR(source->label.mark)]++;
+      if(source->root) counts[SIGNATURE_ROOT_NEIGHBOUR]++;
+   }
+}
+
 bool validGraph(Graph *graph)
 {
    if(graph == NULL || (graph->number_of_edges == 0 && graph->number_of_nodes == 0)) 
@@ -232,6 +248,89 @@ bool validGraph(Graph *graph)
               "edges in the edge array (%d).\n", graph->number_of_edges, edge_count);
       valid_graph = false;
    }     
+
+   /* Invariant (8) */
+   int node_marks[NUMBER_OF_MARKS] = {0}, edge_marks[NUMBER_OF_MARKS] = {0};
+   int root_count = 0, mark;
+   for(node_index = 0; node_index < graph->nodes.size; node_index++)
+   {
+      Node *node = getNode(graph, node_index);
+      if(node->index == -1) continue;
+      node_marks[node->label.mark]++;
+      if(node->root) root_count++;
+   }
+   for(edge_index = 0; edge_index < graph->edges.size; edge_index++)
+   {
+      Edge *edge = getEdge(graph, edge_index);
+      if(edge->index != -1) edge_marks[edge->label.mark]++;
+   }
+   for(mark = 0; mark < NUMBER_OF_MARKS; mark++)
+   {
+      if(node_marks[mark] != graph->nodes_by_mark[mark] ||
+         edge_marks[mark] != graph->edges_by_mark[mark])
+      {
+         fprintf(stderr, "(8) Mark %d: %d nodes and %d edges in the arrays, but "
+                 "the counts are %d and %d.\n", mark, node_marks[mark],
+                 edge_marks[mark], graph->nodes_by_mark[mark],
+                 graph->edges_by_mark[mark]);
+         valid_graph = false;
+      }
+   }
+   if(root_count != graph->number_of_roots)
+   {
+      fprintf(stderr, "(8) graph->number_of_roots (%d) is not equal to the number "
+              "of root nodes in the node array (%d).\n", graph->number_of_roots,
+              root_count);
+      valid_graph = false;
+   }
+
+   /* Invariant (9) */
+   for(node_index = 0; node_index < graph->nodes.size; node_index++)
+   {
+      Node *node = getNode(graph, node_index);
+      if(node->index == -1) continue;
+      int counts[16], field;
+      countNeighbourhood(graph, node, counts);
+      for(field = 0; field < 16; field++)
+      {
+         int value = (node->signature >> (4 * field)) & 15;
+         if(value > 7 || (value < 7 && value != counts[field]))
+         {
+            fprintf(stderr, "(9) Field %d of node %d's signature is %d, but it "
+                    "summarises %d items.\n", field, node->index, value,
+                    counts[field]);
+            valid_graph = false;
+         }
+      }
+   }
+
+   /* Invariant (10) */
+   for(node_index = 0; node_index < graph->nodes.size; node_index++)
+   {
+      Node *node = getNode(graph, node_index);
+      if(node->index == -1)
+      {
+         if(graph->node_status[node_index] != 0)
+         {
+            fprintf(stderr, "(10) Dummy node at array index %d has a non-zero "
+                    "column status.\n", node_index);
+            valid_graph = false;
+         }
+         continue;
+      }
+      int status = node->root ? NODE_PRESENT | NODE_ROOT : NODE_PRESENT;
+      int indegree = node->indegree > 255 ? 255 : node->indegree;
+      int outdegree = node->outdegree > 255 ? 255 : node->outdegree;
+      if(graph->node_marks[node_index] != node->label.mark ||
+         graph->node_status[node_index] != status ||
+         graph->node_indegrees[node_index] != indegree ||
+         graph->node_outdegrees[node_index] != outdegree)
+      {
+         fprintf(stderr, "(10) The node columns at index %d do not agree with "
+                 "node %d.\n", node_index, node->index);
+         valid_graph = false;
+      }
+   }
     
    if(valid_graph) fprintf(stderr, "Graph satisfies all the data invariants!\n");
    printf("\n");
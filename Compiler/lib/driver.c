@@ -0,0 +1,603 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "driver.h"
+#include "debug.h"
+#include "graphStacks.h"
+#include "probes.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* The host graph of the generated main module. */
+extern Graph *host;
+
+typedef enum {HOST_SUCCESS = 0, HOST_FAILURE, HOST_ERROR} HostStatus;
+
+static const string status_names[] = {"success", "fail", "error"};
+
+/* The result of running the program on one host graph. Workers send these
+ * records to the parent process through a pipe. */
+typedef struct HostResult {
+   int index;
+   HostStatus status;
+   double seconds;
+} HostResult;
+
+typedef struct HostFiles {
+   string *names;
+   int count, capacity;
+   /* shared_names[i] is true if another host graph has the same base name as
+    * host graph i. */
+   bool *shared_names;
+} HostFiles;
+
+static double currentTime(void)
+{
+   struct timespec time;
+   clock_gettime(CLOCK_MONOTONIC, &time);
+   return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void addHostFile(HostFiles *files, string name)
+{
+   if(files->count == files->capacity)
+   {
+      files->capacity = files->capacity == 0 ? 64 : 2 * files->capacity;
+      files->names = realloc(files->names, files->capacity * sizeof(string));
+      if(files->names == NULL)
+      {
+         print_to_log("Error (addHostFile): malloc failure.\n");
+         exit(1);
+      }
+   }
+   files->names[files->count] = strdup(name);
+   if(files->names[files->count] == NULL)
+   {
+      print_to_log("Error (addHostFile): malloc failure.\n");
+      exit(1);
+   }
+   files->count++;
+}
+
+static void freeHostFiles(HostFiles *files)
+{
+   int index;
+   for(index = 0; index < files->count; index++) free(files->names[index]);
+   free(files->names);
+   free(files->shared_names);
+}
+
+static string baseName(string file_name)
+{
+   string name = strrchr(file_name, '/');
+   return name == NULL ? file_name : name + 1;
+}
+
+typedef struct NamedEntry {
+   string name;
+   int index;
+} NamedEntry;
+
+static int compareBaseNames(const void *first, const void *second)
+{
+   const NamedEntry *left = first, *right = second;
+   return strcmp(left->name, right->name);
+}
+
+/* Marks the host graphs whose base names are not unique, so that their output
+ * files do not overwrite each other. */
+static void findSharedNames(HostFiles *files)
+{
+   files->shared_names = calloc(files->count + 1, sizeof(bool));
+   NamedEntry *entries = malloc((files->count + 1) * sizeof(NamedEntry));
+   if(files->shared_names == NULL || entries == NULL)
+   {
+      print_to_log("Error (findSharedNames): malloc failure.\n");
+      exit(1);
+   }
+   int index;
+   for(index = 0; index < files->count; index++)
+   {
+      entries[index].name = baseName(files->names[index]);
+      entries[index].index = index;
+   }
+   qsort(entries, files->count, sizeof(NamedEntry), compareBaseNames);
+   for(index = 1; index < files->count; index++)
+   {
+      if(strcmp(entries[index - 1].name, entries[index].name) != 0) continue;
+      files->shared_names[entries[index - 1].index] = true;
+      files->shared_names[entries[index].index] = true;
+   }
+   free(entries);
+}
+
+static bool readManifest(string manifest, HostFiles *files)
+{
+   FILE *file = fopen(manifest, "r");
+   if(file == NULL)
+   {
+      perror(manifest);
+      return false;
+   }
+   char *line = NULL;
+   size_t size = 0;
+   while(getline(&line, &size, file) != -1)
+   {
+      /* Strip surrounding whitespace, including the newline. */
+      char *start = line, *end = line + strlen(line);
+      while(*start == ' ' || *start == '\t') start++;
+      while(end > start && (end[-1] == '\n' || end[-1] == '\r' ||
+                            end[-1] == ' ' || end[-1] == '\t')) end--;
+      *end = '\0';
+      if(*start == '\0' || *start == '#') continue;
+      /* Relative paths are relative to the directory of the manifest. */
+      string slash = strrchr(manifest, '/');
+      if(start[0] == '/' || slash == NULL) addHostFile(files, start);
+      else
+      {
+         int dir_length = slash - manifest + 1;
+         char path[dir_length + strlen(start) + 1];
+         memcpy(path, manifest, dir_length);
+         strcpy(path + dir_length, start);
+         addHostFile(files, path);
+      }
+   }
+   free(line);
+   fclose(file);
+   return true;
+}
+
+static int compareNames(const void *name1, const void *name2)
+{
+   return strcmp(*(const string *)name1, *(const string *)name2);
+}
+
+static bool readDirectory(string directory, HostFiles *files)
+{
+   DIR *dir = opendir(directory);
+   if(dir == NULL)
+   {
+      perror(directory);
+      return false;
+   }
+   struct dirent *entry;
+   while((entry = readdir(dir)) != NULL)
+   {
+      if(entry->d_name[0] == '.') continue;
+      char path[strlen(directory) + strlen(entry->d_name) + 2];
+      sprintf(path, "%s/%s", directory, entry->d_name);
+      struct stat status;
+      if(stat(path, &status) == 0 && S_ISREG(status.st_mode)) addHostFile(files, path);
+   }
+   closedir(dir);
+   qsort(files->names, files->count, sizeof(string), compareNames);
+   return true;
+}
+
+/* Runs the program on the global host graph, which is NULL if the host graph
+ * could not be parsed, and writes the output graph or the failure message to
+ * output_file. The host graph is freed afterwards, but the change stack and
+ * graph stack are only emptied so that their memory is reused by the next
+ * host graph. */
+static HostStatus runOnHost(FILE *output_file, RunProgramFunction run_program)
+{
+   HostStatus status;
+   if(host == NULL)
+   {
+      fprintf(output_file, "Error parsing host graph file.\n");
+      status = HOST_ERROR;
+   }
+   else if(run_program(output_file))
+   {
+      GP2_PROBE2(output_write_start, host->number_of_nodes, host->number_of_edges);
+      printGraph(host, output_file);
+      GP2_PROBE(output_write_end);
+      status = HOST_SUCCESS;
+   }
+   else status = HOST_FAILURE;
+   freeGraph(host);
+   host = NULL;
+   discardChanges(0);
+   discardGraphs(0);
+   return status;
+}
+
+/* Runs the program on one host graph and writes <output_dir>/<name>.output, or
+ * <output_dir>/<name>.<position>.output if another host graph of the batch has
+ * the same name. */
+static HostResult runHost(int index, HostFiles *files, string output_dir,
+                          BuildHostFunction build_host, RunProgramFunction run_program)
+{
+   HostResult result = {index, HOST_ERROR, 0.0};
+   double start = currentTime();
+   string host_file = files->names[index];
+   string name = baseName(host_file);
+   char output_name[strlen(output_dir) + strlen(name) + 21];
+   if(files->shared_names[index])
+      sprintf(output_name, "%s/%s.%d.output", output_dir, name, index + 1);
+   else sprintf(output_name, "%s/%s.output", output_dir, name);
+   FILE *output_file = fopen(output_name, "w");
+   if(output_file == NULL)
+   {
+      perror(output_name);
+      return result;
+   }
+   host = build_host(host_file);
+   result.status = runOnHost(output_file, run_program);
+   fclose(output_file);
+   result.seconds = currentTime() - start;
+   return result;
+}
+
+/* Worker w of n runs the program on host graphs w, w + n, w + 2n, ... If
+ * results is NULL the results are written to the pipe file descriptor. */
+static void runWorker(int worker, int workers, HostFiles *files, string output_dir,
+                      BuildHostFunction build_host, RunProgramFunction run_program,
+                      HostResult *results, int pipe_fd)
+{
+   int index;
+   for(index = worker; index < files->count; index += workers)
+   {
+      HostResult result = runHost(index, files, output_dir, build_host, run_program);
+      if(results != NULL) results[index] = result;
+      else if(write(pipe_fd, &result, sizeof(HostResult)) != sizeof(HostResult))
+      {
+         perror("write");
+         _exit(1);
+      }
+   }
+}
+
+/* Forks the worker processes and collects their results. Host graphs whose
+ * result never arrives, because a worker crashed, keep the error status. */
+static void runWorkers(int workers, HostFiles *files, string output_dir,
+                       BuildHostFunction build_host, RunProgramFunction run_program,
+                       HostResult *results)
+{
+   int pipes[workers], worker;
+   pid_t pids[workers];
+   for(worker = 0; worker < workers; worker++)
+   {
+      int fds[2];
+      if(pipe(fds) != 0)
+      {
+         perror("pipe");
+         exit(1);
+      }
+      /* Flush the parent's buffers so that the child does not repeat them. */
+      fflush(NULL);
+      pids[worker] = fork();
+      if(pids[worker] < 0)
+      {
+         perror("fork");
+         exit(1);
+      }
+      if(pids[worker] == 0)
+      {
+         close(fds[0]);
+         srand(time(NULL) ^ getpid());
+         runWorker(worker, workers, files, output_dir, build_host, run_program,
+                   NULL, fds[1]);
+         close(fds[1]);
+         fflush(NULL);
+         _exit(0);
+      }
+      close(fds[1]);
+      pipes[worker] = fds[0];
+   }
+   for(worker = 0; worker < workers; worker++)
+   {
+      HostResult result;
+      while(read(pipes[worker], &result, sizeof(HostResult)) == sizeof(HostResult))
+      {
+         if(result.index >= 0 && result.index < files->count)
+            results[result.index] = result;
+      }
+      close(pipes[worker]);
+      int status;
+      waitpid(pids[worker], &status, 0);
+      if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+         fprintf(stderr, "Error: batch worker %d exited abnormally.\n", worker);
+   }
+}
+
+static void printSummary(HostFiles *files, HostResult *results, string output_dir,
+                         int workers, double wall_time)
+{
+   int counts[3] = {0, 0, 0}, index;
+   double total = 0.0, max = 0.0;
+   char summary_name[strlen(output_dir) + 14];
+   sprintf(summary_name, "%s/gp2.summary", output_dir);
+   FILE *summary_file = fopen(summary_name, "w");
+   if(summary_file == NULL) perror(summary_name);
+   for(index = 0; index < files->count; index++)
+   {
+      counts[results[index].status]++;
+      total += results[index].seconds;
+      if(results[index].seconds > max) max = results[index].seconds;
+      if(summary_file != NULL)
+         fprintf(summary_file, "%-7s %10.3f ms  %s\n", status_names[results[index].status],
+                 results[index].seconds * 1000, files->names[index]);
+   }
+   double mean = files->count == 0 ? 0.0 : total / files->count;
+   FILE *streams[2] = {stdout, summary_file};
+   int stream;
+   for(stream = 0; stream < 2; stream++)
+   {
+      FILE *out = streams[stream];
+      if(out == NULL) continue;
+      if(out == summary_file) fprintf(out, "\n");
+      fprintf(out, "Processed %d host graphs with %d worker%s in %.3f s.\n",
+              files->count, workers, workers == 1 ? "" : "s", wall_time);
+      fprintf(out, "Output graphs: %d. Failures: %d. Errors: %d.\n",
+              counts[HOST_SUCCESS], counts[HOST_FAILURE], counts[HOST_ERROR]);
+      fprintf(out, "Run time per host graph: mean %.3f ms, max %.3f ms.\n",
+              mean * 1000, max * 1000);
+   }
+   if(summary_file != NULL)
+   {
+      fclose(summary_file);
+      printf("Batch summary saved to file %s\n", summary_name);
+   }
+}
+
+int runBatch(int argc, char **argv, BuildHostFunction build_host,
+             RunProgramFunction run_program)
+{
+   string const usage = "Usage: gp2run --batch <manifest | directory> "
+                        "[-j <workers>] [-o <output_dir>]\n";
+   string input = NULL, output_dir = ".";
+   int workers = 1, index;
+   for(index = 0; index < argc; index++)
+   {
+      if(strcmp(argv[index], "-j") == 0 && index + 1 < argc)
+      {
+         char *end = NULL;
+         workers = (int)strtol(argv[++index], &end, 10);
+         if(*end != '\0' || workers < 1)
+         {
+            fprintf(stderr, "Error: invalid number of workers \"%s\".\n", argv[index]);
+            return 1;
+         }
+      }
+      else if(strcmp(argv[index], "-o") == 0 && index + 1 < argc)
+         output_dir = argv[++index];
+      else if(argv[index][0] != '-' && input == NULL) input = argv[index];
+      else
+      {
+         fprintf(stderr, "%s", usage);
+         return 1;
+      }
+   }
+   if(input == NULL)
+   {
+      fprintf(stderr, "%s", usage);
+      return 1;
+   }
+
+   HostFiles files = {NULL, 0, 0, NULL};
+   struct stat status;
+   bool valid_input;
+   if(stat(input, &status) == 0 && S_ISDIR(status.st_mode))
+      valid_input = readDirectory(input, &files);
+   else valid_input = readManifest(input, &files);
+   if(!valid_input) return 1;
+   findSharedNames(&files);
+   mkdir(output_dir, S_IRWXU | S_IRWXG | S_IRWXO);
+
+   HostResult *results = calloc(files.count + 1, sizeof(HostResult));
+   if(results == NULL)
+   {
+      print_to_log("Error (runBatch): malloc failure.\n");
+      exit(1);
+   }
+   for(index = 0; index < files.count; index++)
+   {
+      results[index].index = index;
+      results[index].status = HOST_ERROR;
+   }
+   if(workers > files.count) workers = files.count > 0 ? files.count : 1;
+
+   double start = currentTime();
+   if(workers == 1)
+      runWorker(0, 1, &files, output_dir, build_host, run_program, results, -1);
+   else runWorkers(workers, &files, output_dir, build_host, run_program, results);
+   printSummary(&files, results, output_dir, workers, currentTime() - start);
+
+   bool errors = false;
+   for(index = 0; index < files.count; index++)
+      if(results[index].status == HOST_ERROR) errors = true;
+   free(results);
+   freeHostFiles(&files);
+   return errors ? 1 : 0;
+}
+
+static bool writeResponse(FILE *output, HostStatus status, char *body, size_t length)
+{
+   fprintf(output, "%s %zu\n", status_names[status], length);
+   if(length > 0 && fwrite(body, 1, length, output) != length) return false;
+   return fflush(output) == 0;
+}
+
+/* Reads and discards length bytes from input. Returns false if the input
+ * ends first. */
+static bool skipBytes(FILE *input, unsigned long long length)
+{
+   char buffer[4096];
+   while(length > 0)
+   {
+      size_t size = length < sizeof(buffer) ? length : sizeof(buffer);
+      if(fread(buffer, 1, size, input) != size) return false;
+      length -= size;
+   }
+   return true;
+}
+
+/* Serves requests from input until the end of the stream or a malformed
+ * request. Returns false if a response could not be written. */
+static bool serveStream(FILE *input, FILE *output, ParseHostFunction parse_host,
+                        RunProgramFunction run_program)
+{
+   char header[32];
+   while(fgets(header, sizeof(header), input) != NULL)
+   {
+      char *end = NULL;
+      unsigned long long length = strtoull(header, &end, 10);
+      if(!isdigit((unsigned char)header[0]) || (*end != '\n' && *end != '\r'))
+      {
+         string message = "Malformed request header.\n";
+         writeResponse(output, HOST_ERROR, message, strlen(message));
+         return true;
+      }
+      char *request = length > MAX_REQUEST_SIZE ? NULL : malloc(length + 1);
+      if(request == NULL)
+      {
+         /* The body is skipped so that the next request can be read. */
+         string message = length > MAX_REQUEST_SIZE ?
+                          "Request too large.\n" : "Out of memory.\n";
+         if(!writeResponse(output, HOST_ERROR, message, strlen(message)))
+            return false;
+         if(!skipBytes(input, length)) return true;
+         continue;
+      }
+      if(fread(request, 1, length, input) != length)
+      {
+         free(request);
+         return true;
+      }
+      request[length] = '\0';
+
+      /* The response is assembled in memory because its length is sent
+       * before its body. */
+      char *response = NULL;
+      size_t response_length = 0;
+      FILE *response_file = open_memstream(&response, &response_length);
+      FILE *host_file = length > 0 ? fmemopen(request, length, "r") : NULL;
+      if(response_file == NULL)
+      {
+         perror("open_memstream");
+         exit(1);
+      }
+      host = host_file == NULL ? NULL : parse_host(host_file);
+      HostStatus status = runOnHost(response_file, run_program);
+      if(host_file != NULL) fclose(host_file);
+      fclose(response_file);
+      free(request);
+      bool written = writeResponse(output, status, response, response_length);
+      free(response);
+      if(!written) return false;
+   }
+   return true;
+}
+
+static volatile sig_atomic_t stop_server = 0;
+
+static void stopServer(int signal_number)
+{
+   (void)signal_number;
+   stop_server = 1;
+}
+
+static int serveSocket(string socket_path, ParseHostFunction parse_host,
+                       RunProgramFunction run_program)
+{
+   struct sockaddr_un address;
+   if(strlen(socket_path) >= sizeof(address.sun_path))
+   {
+      fprintf(stderr, "Error: socket path \"%s\" is too long.\n", socket_path);
+      return 1;
+   }
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, socket_path);
+
+   int server = socket(AF_UNIX, SOCK_STREAM, 0);
+   if(server < 0)
+   {
+      perror("socket");
+      return 1;
+   }
+   unlink(socket_path);
+   if(bind(server, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(server, 16) != 0)
+   {
+      perror(socket_path);
+      close(server);
+      return 1;
+   }
+   /* Without SA_RESTART, accept is interrupted when the server is stopped. */
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = stopServer;
+   sigemptyset(&action.sa_mask);
+   sigaction(SIGINT, &action, NULL);
+   sigaction(SIGTERM, &action, NULL);
+   printf("Serving on %s\n", socket_path);
+   fflush(stdout);
+
+   while(!stop_server)
+   {
+      int connection = accept(server, NULL, NULL);
+      if(connection < 0)
+      {
+         if(errno == EINTR) continue;
+         perror("accept");
+         break;
+      }
+      FILE *input = fdopen(connection, "r");
+      int output_fd = dup(connection);
+      FILE *output = output_fd < 0 ? NULL : fdopen(output_fd, "w");
+      if(input == NULL || output == NULL)
+      {
+         perror("fdopen");
+         if(input != NULL) fclose(input);
+         else close(connection);
+         if(output != NULL) fclose(output);
+         else if(output_fd >= 0) close(output_fd);
+         continue;
+      }
+      serveStream(input, output, parse_host, run_program);
+      fclose(input);
+      fclose(output);
+   }
+   close(server);
+   unlink(socket_path);
+   return 0;
+}
+
+int runServer(int argc, char **argv, ParseHostFunction parse_host,
+              RunProgramFunction run_program)
+{
+   if(argc > 1)
+   {
+      fprintf(stderr, "Usage: gp2run --serve [<socket_path>]\n");
+      return 1;
+   }
+   /* A client that disconnects early must not terminate the server. */
+   signal(SIGPIPE, SIG_IGN);
+   if(argc == 1) return serveSocket(argv[0], parse_host, run_program);
+   return serveStream(stdin, stdout, parse_host, run_program) ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  =====================
+  Runtime Driver Module
+  =====================
+
+  Alternative ways of running a compiled GP 2 program (gp2run) on host graphs.
+  By default gp2run executes the program once on the host graph named on the
+  command line. The drivers in this module instead execute the program on
+  many host graphs in one process, keeping the morphisms, the host list store
+  and the graph change stack allocated between host graphs.
+
+  The drivers call back into the generated main module, which supplies the
+  function that parses a host graph file into the global host graph and the
+  function that executes the program on it.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_DRIVER_H
+#define INC_DRIVER_H
+
+#include "common.h"
+#include "graph.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* The largest host graph text, in bytes, accepted by the server mode. */
+#define MAX_REQUEST_SIZE (1ULL << 30)
+
+/* Parses a host graph file, assigns the graph to the global host and returns
+ * it. Returns NULL if the file cannot be opened or parsed. */
+typedef Graph *(*BuildHostFunction)(char *host_file);
+
+/* Parses a host graph from an open stream, assigns the graph to the global
+ * host and returns it. Returns NULL if the graph cannot be parsed. */
+typedef Graph *(*ParseHostFunction)(FILE *host_file);
+
+/* Executes the GP 2 program on the global host graph. Returns true if the
+ * program produces an output graph. Otherwise the failure message is written
+ * to output_file and false is returned. */
+typedef bool (*RunProgramFunction)(FILE *output_file);
+
+/* Batch mode: gp2run --batch <manifest | directory> [-j <workers>] [-o <dir>]
+ *
+ * Runs the program on every host graph listed in the manifest file (one path
+ * per line, relative to the manifest's directory; blank lines and lines
+ * starting with '#' are ignored) or on every file in the directory, in name
+ * order. The output graph or failure message for host graph <name> is written
+ * to <dir>/<name>.output, where <dir> is the working directory by default. If
+ * several host graphs have the same name, the n-th entry is written to
+ * <dir>/<name>.<n>.output instead.
+ *
+ * With -j, the host graphs are shared between that many worker processes,
+ * each with its own graph state. A summary with the status and run time of
+ * each host graph is written to <dir>/gp2.summary, and the totals are printed
+ * to stdout. argc and argv are the arguments following --batch. Returns the
+ * exit status for gp2run: 0 if every host graph was processed, whether or not
+ * the program failed on it, and 1 otherwise. */
+int runBatch(int argc, char **argv, BuildHostFunction build_host,
+             RunProgramFunction run_program);
+
+/* Server mode: gp2run --serve [<socket_path>]
+ *
+ * Keeps the program resident and runs it on each host graph it receives,
+ * either on stdin (responses on stdout) or, if a socket path is given, on the
+ * connections to a Unix domain socket created at that path. Connections are
+ * served one at a time, and each may carry any number of requests. Every
+ * request and response is a header line followed by a body of exactly the
+ * given number of bytes:
+ *
+ * Request:  <length>\n<host graph text>
+ * Response: success <length>\n<output graph text>
+ *         | fail <length>\n<failure message>
+ *         | error <length>\n<error message>
+ *
+ * A malformed request header gets an error response and ends the connection.
+ * A request longer than MAX_REQUEST_SIZE bytes gets an error response and its
+ * body is skipped.
+ * The server stops at the end of stdin, or on SIGINT or SIGTERM in socket
+ * mode, when the socket file is removed. Returns the exit status for gp2run. */
+int runServer(int argc, char **argv, ParseHostFunction parse_host,
+              RunProgramFunction run_program);
+
+#endif /* INC_DRIVER_H */
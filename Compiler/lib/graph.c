@@ -14,19 +14,28 @@
   along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
 
 #include "graph.h"
+#include "memoryAccounting.h"
+#include "trace.h"
 
-Node dummy_node = {-1, false, {NONE, 0, NULL}, 0, 0, -1, -1, -1, -1, 
+#include <string.h>
+#if defined __AVX2__ || defined __SSE2__
+   #include <immintrin.h>
+#endif
+
+Node dummy_node = {-1, false, {NONE, 0, NULL}, 0, 0, 0, -1, -1, -1, -1, 
                    {0, 0, NULL}, {0, 0, NULL}, false};
 Edge dummy_edge = {-1, {NONE, 0, NULL}, -1, -1, false};
 
-IntArray makeIntArray(int initial_capacity)
+/* The holes arrays of the node and edge arrays are counted with the nodes and
+ * edges, other integer arrays as incidence arrays. */
+static IntArray makeCountedIntArray(MemoryCategory category, int initial_capacity)
 {
    IntArray array;
    array.capacity = initial_capacity;
    array.size = 0;
    if(initial_capacity > 0)
    {
-      array.items = calloc(initial_capacity, sizeof(int));
+      array.items = allocateMemory(category, initial_capacity * sizeof(int));
       if(array.items == NULL)
       {
          print_to_log("Error (makeIntArray): malloc failure.\n");
@@ -39,6 +48,11 @@ IntArray makeIntArray(int initial_capacity)
    return array;
 }
 
+IntArray makeIntArray(int initial_capacity)
+{
+   return makeCountedIntArray(MEMORY_INCIDENCE, initial_capacity);
+}
+
 static void growIntArray(IntArray *array)
 {
    int old_capacity = array->capacity;
@@ -46,7 +60,8 @@ static void growIntArray(IntArray *array)
     * allocation, they are allocated space for 4 integers. In all other cases,
     * the old capacity is doubled. */
    array->capacity = old_capacity == 0 ? 4 : 2*old_capacity;
-   array->items = realloc(array->items, array->capacity * sizeof(int));
+   array->items = reallocateMemory(MEMORY_INCIDENCE, array->items,
+                                   array->capacity * sizeof(int));
    if(array->items == NULL)
    {
       print_to_log("Error (doubleCapacity): malloc failure.\n");
@@ -92,20 +107,21 @@ static NodeArray makeNodeArray(int initial_capacity)
    NodeArray array;
    array.capacity = initial_capacity;
    array.size = 0;
-   array.items = calloc(initial_capacity, sizeof(Node));
+   array.items = allocateZeroedMemory(MEMORY_NODES, initial_capacity, sizeof(Node));
    if(array.items == NULL)
    {
       print_to_log("Error (makeNodeArray): malloc failure.\n");
       exit(1);
    }
-   array.holes = makeIntArray(16);
+   array.holes = makeCountedIntArray(MEMORY_NODES, 16);
    return array;
 }
 
 static void doubleNodeArray(NodeArray *array)
 {
    array->capacity *= 2;
-   array->items = realloc(array->items, array->capacity * sizeof(Node));
+   array->items = reallocateMemory(MEMORY_NODES, array->items,
+                                   array->capacity * sizeof(Node));
    if(array->items == NULL)
    {
       print_to_log("Error (doubleCapacity): malloc failure.\n");
@@ -149,13 +165,13 @@ static EdgeArray makeEdgeArray(int initial_capacity)
    EdgeArray array;
    array.capacity = initial_capacity;
    array.size = 0;
-   array.items = calloc(initial_capacity, sizeof(Edge));
+   array.items = allocateZeroedMemory(MEMORY_EDGES, initial_capacity, sizeof(Edge));
    if(array.items == NULL)
    {
       print_to_log("Error (makeEdgeArray): malloc failure.\n");
       exit(1);
    }
-   array.holes = makeIntArray(16);
+   array.holes = makeCountedIntArray(MEMORY_EDGES, 16);
    return array;
 }
 
@@ -163,7 +179,8 @@ static EdgeArray makeEdgeArray(int initial_capacity)
 static void doubleEdgeArray(EdgeArray *array)
 {
    array->capacity *= 2;
-   array->items = realloc(array->items, array->capacity * sizeof(Edge));
+   array->items = reallocateMemory(MEMORY_EDGES, array->items,
+                                   array->capacity * sizeof(Edge));
    if(array->items == NULL)
    {
       print_to_log("Error (doubleCapacity): malloc failure.\n");
@@ -205,12 +222,215 @@ static void removeFromEdgeArray(EdgeArray *array, int index)
 }
 
 
+/* ========================
+ * Neighbourhood Signatures
+ * ======================== */
+static void updateSignatureField(Node *node, int field, int change)
+{
+   int shift = 4 * field;
+   uint64_t count = (node->signature >> shift) & 7;
+   /* Saturated counts are sticky (see graph.h). */
+   if(count == 7) return;
+   if(change > 0) node->signature += (uint64_t)1 << shift;
+   else
+   {
+      assert(count > 0);
+      node->signature -= (uint64_t)1 << shift;
+   }
+}
+
+/* Updates the fields of node describing its neighbour at the other end of
+ * one edge. */
+static void updateNeighbourFields(Node *node, Node *neighbour, int change)
+{
+   if(neighbour->label.mark < DASHED)
+      updateSignatureField(node, SIGNATURE_NEIGHBOUR(neighbour->label.mark), change);
+   if(neighbour->root) updateSignatureField(node, SIGNATURE_ROOT_NEIGHBOUR, change);
+}
+
+void updateEdgeSignatures(Graph *graph, Edge *edge, int change)
+{
+   Node *source = getNode(graph, edge->source);
+   Node *target = getNode(graph, edge->target);
+   if(edge->label.mark != NONE)
+   {
+      updateSignatureField(source, SIGNATURE_OUT_EDGE(edge->label.mark), change);
+      updateSignatureField(target, SIGNATURE_IN_EDGE(edge->label.mark), change);
+   }
+   updateNeighbourFields(source, target, change);
+   updateNeighbourFields(target, source, change);
+}
+
+/* Updates the signatures of the neighbours of node. Called with change -1
+ * before the node's mark or root status is changed and with change 1 after. */
+static void updateNeighbourSignatures(Graph *graph, Node *node, int change)
+{
+   int counter;
+   for(counter = 0; counter < node->out_edges.size + 2; counter++)
+   {
+      Edge *edge = getNthOutEdge(graph, node, counter);
+      if(edge != NULL) updateNeighbourFields(getNode(graph, edge->target), node, change);
+   }
+   for(counter = 0; counter < node->in_edges.size + 2; counter++)
+   {
+      Edge *edge = getNthInEdge(graph, node, counter);
+      if(edge != NULL) updateNeighbourFields(getNode(graph, edge->source), node, change);
+   }
+}
+
+/* Updates the edge-mark fields of the endpoints of edge. Called with change -1
+ * before the edge's mark is changed and with change 1 after. */
+static void updateEdgeMarkFields(Graph *graph, Edge *edge, int change)
+{
+   if(edge->label.mark == NONE) return;
+   updateSignatureField(getNode(graph, edge->source),
+                        SIGNATURE_OUT_EDGE(edge->label.mark), change);
+   updateSignatureField(getNode(graph, edge->target),
+                        SIGNATURE_IN_EDGE(edge->label.mark), change);
+}
+
+/* ============
+ * Node Columns
+ * ============ */
+/* Column capacities are multiples of the scan width, so that the vector loads
+ * of scanNodes stay within the columns. */
+#define COLUMN_BLOCK 32
+
+static uint8_t *growColumn(uint8_t *column, int old_capacity, int capacity)
+{
+   column = reallocateMemory(MEMORY_NODES, column, capacity);
+   if(column == NULL)
+   {
+      print_to_log("Error (growColumn): malloc failure.\n");
+      exit(1);
+   }
+   memset(column + old_capacity, 0, capacity - old_capacity);
+   return column;
+}
+
+void updateNodeColumns(Graph *graph, int index)
+{
+   if(index >= graph->column_capacity)
+   {
+      int capacity = graph->nodes.capacity;
+      if(capacity <= index) capacity = index + 1;
+      capacity = (capacity + COLUMN_BLOCK - 1) / COLUMN_BLOCK * COLUMN_BLOCK;
+      int old = graph->column_capacity;
+      graph->node_marks = growColumn(graph->node_marks, old, capacity);
+      graph->node_status = growColumn(graph->node_status, old, capacity);
+      graph->node_indegrees = growColumn(graph->node_indegrees, old, capacity);
+      graph->node_outdegrees = growColumn(graph->node_outdegrees, old, capacity);
+      graph->column_capacity = capacity;
+   }
+   Node *node = &(graph->nodes.items[index]);
+   if(node->index == -1)
+   {
+      graph->node_marks[index] = 0;
+      graph->node_status[index] = 0;
+      graph->node_indegrees[index] = 0;
+      graph->node_outdegrees[index] = 0;
+      return;
+   }
+   graph->node_marks[index] = node->label.mark;
+   graph->node_status[index] = node->root ? NODE_PRESENT | NODE_ROOT : NODE_PRESENT;
+   graph->node_indegrees[index] = node->indegree > 255 ? 255 : node->indegree;
+   graph->node_outdegrees[index] = node->outdegree > 255 ? 255 : node->outdegree;
+}
+
+/* Returns a bit mask of the candidates among the nodes at index to 
+ * index + SCAN_WIDTH - 1, bit i standing for node index + i. */
+#if defined __AVX2__
+#define SCAN_WIDTH 32
+static uint32_t filterNodes(Graph *graph, NodeScan *scan, int index)
+{
+   __m256i marks = _mm256_loadu_si256((const __m256i *)(graph->node_marks + index));
+   __m256i status = _mm256_loadu_si256((const __m256i *)(graph->node_status + index));
+   __m256i indegrees = _mm256_loadu_si256((const __m256i *)(graph->node_indegrees + index));
+   __m256i outdegrees = _mm256_loadu_si256((const __m256i *)(graph->node_outdegrees + index));
+   __m256i required = _mm256_set1_epi8((char)scan->status);
+   __m256i match = _mm256_cmpeq_epi8(_mm256_and_si256(status, required), required);
+   __m256i unmarked = _mm256_cmpeq_epi8(marks, _mm256_set1_epi8((char)scan->mark));
+   if(scan->any_mark) match = _mm256_andnot_si256(unmarked, match);
+   else match = _mm256_and_si256(match, unmarked);
+   /* Unsigned x >= y if and only if max(x, y) == x. */
+   __m256i in = _mm256_set1_epi8((char)scan->indegree);
+   __m256i out = _mm256_set1_epi8((char)scan->outdegree);
+   match = _mm256_and_si256(match, _mm256_cmpeq_epi8(_mm256_max_epu8(indegrees, in), indegrees));
+   match = _mm256_and_si256(match, _mm256_cmpeq_epi8(_mm256_max_epu8(outdegrees, out), outdegrees));
+   return (uint32_t)_mm256_movemask_epi8(match);
+}
+#elif defined __SSE2__
+#define SCAN_WIDTH 16
+static uint32_t filterNodes(Graph *graph, NodeScan *scan, int index)
+{
+   __m128i marks = _mm_loadu_si128((const __m128i *)(graph->node_marks + index));
+   __m128i status = _mm_loadu_si128((const __m128i *)(graph->node_status + index));
+   __m128i indegrees = _mm_loadu_si128((const __m128i *)(graph->node_indegrees + index));
+   __m128i outdegrees = _mm_loadu_si128((const __m128i *)(graph->node_outdegrees + index));
+   __m128i required = _mm_set1_epi8((char)scan->status);
+   __m128i match = _mm_cmpeq_epi8(_mm_and_si128(status, required), required);
+   /* When the mark is ANY, scan->mark is 0, so this selects unmarked nodes. */
+   __m128i unmarked = _mm_cmpeq_epi8(marks, _mm_set1_epi8((char)scan->mark));
+   if(scan->any_mark) match = _mm_andnot_si128(unmarked, match);
+   else match = _mm_and_si128(match, unmarked);
+   /* Unsigned x >= y if and only if max(x, y) == x. */
+   __m128i in = _mm_set1_epi8((char)scan->indegree);
+   __m128i out = _mm_set1_epi8((char)scan->outdegree);
+   match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_max_epu8(indegrees, in), indegrees));
+   match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_max_epu8(outdegrees, out), outdegrees));
+   return (uint32_t)_mm_movemask_epi8(match);
+}
+#else
+#define SCAN_WIDTH 16
+static uint32_t filterNodes(Graph *graph, NodeScan *scan, int index)
+{
+   uint32_t mask = 0;
+   int offset;
+   for(offset = 0; offset < SCAN_WIDTH; offset++)
+   {
+      int node = index + offset;
+      if((graph->node_status[node] & scan->status) != scan->status) continue;
+      if(scan->any_mark ? graph->node_marks[node] == 0
+                        : graph->node_marks[node] != scan->mark) continue;
+      if(graph->node_indegrees[node] < scan->indegree) continue;
+      if(graph->node_outdegrees[node] < scan->outdegree) continue;
+      mask |= (uint32_t)1 << offset;
+   }
+   return mask;
+}
+#endif
+
+bool node_scans_cancelled = false;
+
+int scanNodes(Graph *graph, NodeScan *scan)
+{
+   scan->position = 0;
+   scan->count = 0;
+   if(__atomic_load_n(&node_scans_cancelled, __ATOMIC_RELAXED)) return 0;
+   int size = graph->nodes.size;
+   /* Every entry of the node array has been written to the columns. */
+   assert(size <= graph->column_capacity);
+   while(scan->next < size && scan->count + SCAN_WIDTH <= NODE_SCAN_BATCH)
+   {
+      uint32_t mask = filterNodes(graph, scan, scan->next);
+      while(mask != 0)
+      {
+         int offset = __builtin_ctz(mask);
+         if(scan->next + offset >= size) break;
+         scan->batch[scan->count++] = scan->next + offset;
+         mask &= mask - 1;
+      }
+      scan->next += SCAN_WIDTH;
+   }
+   return scan->count;
+}
+
 /* ===============
  * Graph Functions
  * =============== */
 Graph *newGraph(int nodes, int edges) 
 {
-   Graph *graph = malloc(sizeof(Graph));
+   Graph *graph = allocateMemory(MEMORY_NODES, sizeof(Graph));
    if(graph == NULL) 
    {
       print_to_log("Error (newGraph): malloc failure.\n");
@@ -221,7 +441,19 @@ Graph *newGraph(int nodes, int edges)
 
    graph->number_of_nodes = 0;
    graph->number_of_edges = 0;
+   int mark;
+   for(mark = 0; mark < NUMBER_OF_MARKS; mark++)
+   {
+      graph->nodes_by_mark[mark] = 0;
+      graph->edges_by_mark[mark] = 0;
+   }
+   graph->number_of_roots = 0;
    graph->root_nodes = NULL;
+   graph->node_marks = NULL;
+   graph->node_status = NULL;
+   graph->node_indegrees = NULL;
+   graph->node_outdegrees = NULL;
+   graph->column_capacity = 0;
    return graph;
 }
 
@@ -238,17 +470,21 @@ int addNode(Graph *graph, bool root, HostLabel label)
    node.in_edges = makeIntArray(0);
    node.outdegree = 0;
    node.indegree = 0;
+   node.signature = 0;
    node.matched = false;
 
    int index = addToNodeArray(&(graph->nodes), node);
+   updateNodeColumns(graph, index);
    if(root) addRootNode(graph, index);
    graph->number_of_nodes++;
+   graph->nodes_by_mark[label.mark]++;
+   if(graph == traced_graph) traceNodeChange(TRACE_NODE_ADDED, graph, index);
    return index; 
 }
 
 void addRootNode(Graph *graph, int index)
 {
-   RootNodes *root_node = malloc(sizeof(RootNodes));
+   RootNodes *root_node = allocateMemory(MEMORY_NODES, sizeof(RootNodes));
    if(root_node == NULL)
    {
       print_to_log("Error (addRootNode): malloc failure.\n");
@@ -257,6 +493,7 @@ void addRootNode(Graph *graph, int index)
    root_node->index = index;
    root_node->next = graph->root_nodes;
    graph->root_nodes = root_node;
+   graph->number_of_roots++;
 }
 
 int addEdge(Graph *graph, HostLabel label, int source_index, int target_index) 
@@ -282,8 +519,13 @@ int addEdge(Graph *graph, HostLabel label, int source_index, int target_index)
    else if(target->second_in_edge == -1) target->second_in_edge = index;
    else addToIntArray(&(target->in_edges), index);
    target->indegree++;
+   updateEdgeSignatures(graph, getEdge(graph, index), 1);
+   updateNodeColumns(graph, source_index);
+   updateNodeColumns(graph, target_index);
 
    graph->number_of_edges++;
+   graph->edges_by_mark[label.mark]++;
+   if(graph == traced_graph) traceEdgeChange(TRACE_EDGE_ADDED, graph, index);
    return index; 
 }
 
@@ -291,13 +533,16 @@ void removeNode(Graph *graph, int index)
 {   
    Node *node = getNode(graph, index);  
    assert(node->indegree == 0 && node->outdegree == 0);
-   if(node->out_edges.items != NULL) free(node->out_edges.items);
-   if(node->in_edges.items != NULL) free(node->in_edges.items); 
+   if(graph == traced_graph) traceNodeChange(TRACE_NODE_REMOVED, graph, index);
+   if(node->out_edges.items != NULL) freeMemory(node->out_edges.items);
+   if(node->in_edges.items != NULL) freeMemory(node->in_edges.items); 
    if(node->root) removeRootNode(graph, index);
 
    removeHostList(node->label.list);
+   graph->nodes_by_mark[node->label.mark]--;
    
    removeFromNodeArray(&(graph->nodes), index);
+   updateNodeColumns(graph, index);
    graph->number_of_nodes--;
 }
 
@@ -310,7 +555,8 @@ void removeRootNode(Graph *graph, int index)
       {
          if(previous == NULL) graph->root_nodes = current->next;
          else previous->next = current->next;
-         free(current);
+         freeMemory(current);
+         graph->number_of_roots--;
          break;
       }
       previous = current;
@@ -320,6 +566,8 @@ void removeRootNode(Graph *graph, int index)
 
 void removeEdge(Graph *graph, int index) 
 {
+   if(graph == traced_graph) traceEdgeChange(TRACE_EDGE_REMOVED, graph, index);
+   updateEdgeSignatures(graph, getEdge(graph, index), -1);
    Node *source = getNode(graph, graph->edges.items[index].source);
    if(source->first_out_edge == index) source->first_out_edge = -1;
    else if(source->second_out_edge == index) source->second_out_edge = -1;
@@ -333,28 +581,52 @@ void removeEdge(Graph *graph, int index)
    target->indegree--;
 
    removeHostList(graph->edges.items[index].label.list);
+   graph->edges_by_mark[graph->edges.items[index].label.mark]--;
 
    removeFromEdgeArray(&(graph->edges), index);
+   updateNodeColumns(graph, source->index);
+   updateNodeColumns(graph, target->index);
    graph->number_of_edges--;
 }
 
 void relabelNode(Graph *graph, int index, HostLabel new_label) 
 {
-   removeHostList(graph->nodes.items[index].label.list);
-   graph->nodes.items[index].label = new_label;
+   Node *node = getNode(graph, index);
+   removeHostList(node->label.list);
+   graph->nodes_by_mark[node->label.mark]--;
+   graph->nodes_by_mark[new_label.mark]++;
+   bool remarked = node->label.mark != new_label.mark;
+   if(remarked) updateNeighbourSignatures(graph, node, -1);
+   node->label = new_label;
+   if(remarked) updateNeighbourSignatures(graph, node, 1);
+   updateNodeColumns(graph, index);
+   if(graph == traced_graph) traceNodeChange(TRACE_NODE_RELABELLED, graph, index);
 }
 
 void changeNodeMark(Graph *graph, int index, MarkType new_mark)
 {
-   graph->nodes.items[index].label.mark = new_mark;
+   Node *node = getNode(graph, index);
+   if(node->label.mark == new_mark) return;
+   graph->nodes_by_mark[node->label.mark]--;
+   graph->nodes_by_mark[new_mark]++;
+   updateNeighbourSignatures(graph, node, -1);
+   node->label.mark = new_mark;
+   updateNeighbourSignatures(graph, node, 1);
+   updateNodeColumns(graph, index);
+   if(graph == traced_graph) traceNodeChange(TRACE_NODE_MARKED, graph, index);
 }
 
 void changeRoot(Graph *graph, int index)
 {
-   bool is_root = graph->nodes.items[index].root;
+   Node *node = getNode(graph, index);
+   bool is_root = node->root;
    if(is_root) removeRootNode(graph, index);
    else addRootNode(graph, index);
-   graph->nodes.items[index].root = !is_root;
+   updateNeighbourSignatures(graph, node, -1);
+   node->root = !is_root;
+   updateNeighbourSignatures(graph, node, 1);
+   updateNodeColumns(graph, index);
+   if(graph == traced_graph) traceNodeChange(TRACE_NODE_ROOT, graph, index);
 }
 
 void resetMatchedNodeFlag(Graph *graph, int index)
@@ -364,13 +636,25 @@ void resetMatchedNodeFlag(Graph *graph, int index)
 
 void relabelEdge(Graph *graph, int index, HostLabel new_label)
 {	
-   removeHostList(graph->edges.items[index].label.list);
-   graph->edges.items[index].label = new_label;
+   Edge *edge = getEdge(graph, index);
+   removeHostList(edge->label.list);
+   graph->edges_by_mark[edge->label.mark]--;
+   graph->edges_by_mark[new_label.mark]++;
+   updateEdgeMarkFields(graph, edge, -1);
+   edge->label = new_label;
+   updateEdgeMarkFields(graph, edge, 1);
+   if(graph == traced_graph) traceEdgeChange(TRACE_EDGE_RELABELLED, graph, index);
 }
 
 void changeEdgeMark(Graph *graph, int index, MarkType new_mark)
 {
-   graph->edges.items[index].label.mark = new_mark;
+   Edge *edge = getEdge(graph, index);
+   graph->edges_by_mark[edge->label.mark]--;
+   graph->edges_by_mark[new_mark]++;
+   updateEdgeMarkFields(graph, edge, -1);
+   edge->label.mark = new_mark;
+   updateEdgeMarkFields(graph, edge, 1);
+   if(graph == traced_graph) traceEdgeChange(TRACE_EDGE_MARKED, graph, index);
 }
 
 void resetMatchedEdgeFlag(Graph *graph, int index)
@@ -381,149 +665,26 @@ void resetMatchedEdgeFlag(Graph *graph, int index)
 /* ========================
  * Graph Querying Functions 
  * ======================== */
-Node *getNode(Graph *graph, int index)
-{
-   assert(index < graph->nodes.size);
-   if(index == -1) return NULL;
-   else return &(graph->nodes.items[index]);
-}
-
-Edge *getEdge(Graph *graph, int index)
-{
-   assert(index < graph->edges.size);
-   if(index == -1) return NULL;
-   else return &(graph->edges.items[index]);
-}
-
 RootNodes *getRootNodeList(Graph *graph)
 {
    return graph->root_nodes;
 }
 
-Edge *getNthOutEdge(Graph *graph, Node *node, int n)
-{
-   assert(n >= 0);
-   if(n == 0) return getEdge(graph, node->first_out_edge);
-   else if(n == 1) return getEdge(graph, node->second_out_edge);
-   else
-   {
-      assert(n - 2 < node->out_edges.size);
-      return getEdge(graph, node->out_edges.items[n - 2]);
-   }
-}
-
-Edge *getNthInEdge(Graph *graph, Node *node, int n)
-{
-   assert(n >= 0);
-   if(n == 0) return getEdge(graph, node->first_in_edge);
-   else if(n == 1) return getEdge(graph, node->second_in_edge);
-   else
-   {
-      assert(n - 2 < node->in_edges.size);
-      return getEdge(graph, node->in_edges.items[n - 2]);
-   }
-}
-
-Node *getSource(Graph *graph, Edge *edge) 
-{
-   return getNode(graph, edge->source);
-}
-
-Node *getTarget(Graph *graph, Edge *edge) 
-{
-   return getNode(graph, edge->target);
-}
-
-HostLabel getNodeLabel(Graph *graph, int index) 
-{
-   Node *node = getNode(graph, index);
-   return node->label;
-}
-
-HostLabel getEdgeLabel(Graph *graph, int index) 
-{
-   Edge *edge = getEdge(graph, index);
-   return edge->label;
-}
-
-int getIndegree(Graph *graph, int index) 
-{
-   Node *node = getNode(graph, index);
-   return node->indegree;
-}
-
-int getOutdegree(Graph *graph, int index) 
-{
-   Node *node = getNode(graph, index);
-   return node->outdegree;
-}
-
-void printGraph(Graph *graph, FILE *file) 
-{
-   /* The node and edge counts are used in the IDs of the printed graph. The item's 
-    * index in the graph is not suitable for this purpose because there may be holes
-    * in the graph's node array. The counts are also used to control the number of
-    * nodes and edges printed per line. */
-   int index, node_count = 0, edge_count = 0;
-   if(graph == NULL || graph->number_of_nodes == 0) 
-   {
-      PTF("[ | ]\n\n");
-      return;
-   }
-   PTF("[ ");
-   /* Maps a node's graph-index to the ID it is printed with (node_count). */
-   int output_indices[graph->nodes.size];
-   for(index = 0; index < graph->nodes.size; index++)
-   {
-      Node *node = getNode(graph, index);
-      if(node->index == -1) 
-      {
-         output_indices[index] = -1;
-         continue; 
-      }
-      /* Five nodes per line */
-      if(node_count != 0 && node_count % 5 == 0) PTF("\n  ");
-      output_indices[index] = node_count;
-      if(node->root) PTF("(%d(R), ", node_count++);
-      else PTF("(%d, ", node_count++);
-      printHostLabel(node->label, file);
-      PTF(") ");
-   }
-   if(graph->number_of_edges == 0)
-   {
-      PTF("| ]\n\n");
-      return;
-   }
-   PTF("|\n  ");
-   for(index = 0; index < graph->edges.size; index++)
-   {
-      Edge *edge = getEdge(graph, index);
-      if(edge->index == -1) continue; 
-
-      /* Three edges per line */
-      if(edge_count != 0 && edge_count % 3 == 0) PTF("\n  ");
-      PTF("(%d, ", edge_count++);
-      PTF("%d, %d, ", output_indices[edge->source], output_indices[edge->target]);
-      printHostLabel(edge->label, file);
-      PTF(") ");
-   }
-   PTF("]\n\n");
-}
-
 void freeGraph(Graph *graph) 
 {
    if(graph == NULL) return;
+   if(graph == traced_graph) traced_graph = NULL;
    int index;
    for(index = 0; index < graph->nodes.size; index++)
    {
       Node *node = getNode(graph, index);
       if(node == NULL) continue;
-      if(node->out_edges.items != NULL) free(node->out_edges.items);
-      if(node->in_edges.items != NULL) free(node->in_edges.items);
+      if(node->out_edges.items != NULL) freeMemory(node->out_edges.items);
+      if(node->in_edges.items != NULL) freeMemory(node->in_edges.items);
       removeHostList(node->label.list);
    }
-   if(graph->nodes.holes.items) free(graph->nodes.holes.items);
-   if(graph->nodes.items) free(graph->nodes.items);
+   if(graph->nodes.holes.items) freeMemory(graph->nodes.holes.items);
+   if(graph->nodes.items) freeMemory(graph->nodes.items);
 
    for(index = 0; index < graph->edges.size; index++)
    {
@@ -531,8 +692,12 @@ void freeGraph(Graph *graph)
       if(edge == NULL) continue;
       removeHostList(edge->label.list);
    }
-   if(graph->edges.holes.items) free(graph->edges.holes.items);
-   if(graph->edges.items) free(graph->edges.items);
+   if(graph->edges.holes.items) freeMemory(graph->edges.holes.items);
+   if(graph->edges.items) freeMemory(graph->edges.items);
+   freeMemory(graph->node_marks);
+   freeMemory(graph->node_status);
+   freeMemory(graph->node_indegrees);
+   freeMemory(graph->node_outdegrees);
    if(graph->root_nodes != NULL) 
    {
       RootNodes *iterator = graph->root_nodes;
@@ -540,9 +705,9 @@ void freeGraph(Graph *graph)
       {
          RootNodes *temp = iterator;
          iterator = iterator->next;
-         free(temp);
+         freeMemory(temp);
       }
    }
-   free(graph);
+   freeMemory(graph);
 }
 
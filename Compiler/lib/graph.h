@@ -29,9 +29,11 @@
 
 #include "common.h"
 #include "label.h"
+#include "signature.h"
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h> 
 #include <stdio.h> 
 
@@ -80,6 +82,21 @@ typedef struct Graph
     * In words, each of the first nodes.size items of the node array is either
     * a dummy node (a hole created by the removal of a node), or a valid node. */
    int number_of_nodes, number_of_edges;
+
+   /* The number of nodes and edges with each mark, indexed by MarkType, and the
+    * number of root nodes. They are maintained by the functions below so that
+    * generated matching code can estimate the number of candidates for a rule
+    * item in constant time. */
+   int nodes_by_mark[NUMBER_OF_MARKS], edges_by_mark[NUMBER_OF_MARKS];
+   int number_of_roots;
+
+   /* Packed columns describing the first column_capacity entries of the node
+    * array, one byte per node: its mark, its status (NODE_PRESENT, NODE_ROOT),
+    * and its indegree and outdegree saturated at 255. Entries beyond the node
+    * array's size are zero. They are kept in step with the node array by
+    * updateNodeColumns and scanned by scanNodes. */
+   uint8_t *node_marks, *node_status, *node_indegrees, *node_outdegrees;
+   int column_capacity;
    
    /* Root nodes referenced in a linked list for fast access. */
    struct RootNodes *root_nodes;
@@ -106,6 +123,19 @@ void relabelEdge(Graph *graph, int index, HostLabel new_label);
 void changeEdgeMark(Graph *graph, int index, MarkType new_mark);
 void resetMatchedEdgeFlag(Graph *graph, int index);
 
+/* Adds (change 1) or removes (change -1) the contribution of edge to the
+ * neighbourhood signatures of its endpoints. Called by addEdge and removeEdge,
+ * and when graph changes are undone. */
+void updateEdgeSignatures(Graph *graph, struct Edge *edge, int change);
+
+/* Copies the mark, root status and degrees of the node at the given index of
+ * the node array, which may be a dummy node, to the graph's node columns.
+ * Called by the functions above whenever they change one of these, and when
+ * graph changes are undone. */
+#define NODE_PRESENT 1
+#define NODE_ROOT 2
+void updateNodeColumns(Graph *graph, int index);
+
 /* =========================
  * Node and Edge Definitions
  * ========================= */
@@ -114,6 +144,8 @@ typedef struct Node {
    bool root;
    HostLabel label;
    int outdegree, indegree;
+   /* Summary of the node's neighbourhood, see signature.h. */
+   uint64_t signature;
    int first_out_edge, second_out_edge;
    int first_in_edge, second_in_edge;
    /* Dynamic integer arrays for the node's outgoing and incoming edges. */
@@ -140,10 +172,73 @@ extern struct Edge dummy_edge;
 /* ========================
  * Graph Querying Functions
  * ======================== */
-Node *getNode(Graph *graph, int index);
-Edge *getEdge(Graph *graph, int index);
+/* Candidate node scans. A scan yields, in index order, the nodes of the host
+ * graph with a given mark (any non-zero mark if the mark is ANY), at least the
+ * given indegree and outdegree, and root status if root is true. scanNodes
+ * refills the scan's batch of candidates by filtering the graph's node columns
+ * many nodes at a time, with AVX2 or SSE2 instructions if the library is
+ * compiled for them. Usage:
+ *
+ * NodeScan scan;
+ * startNodeScan(&scan, mark, root, indegree, outdegree);
+ * while((index = nextNodeCandidate(graph, &scan)) >= 0) ...
+ *
+ * The graph must not change during a scan. While node_scans_cancelled is set,
+ * scans yield no further batches. The rule set module (ruleSet.h) sets it to
+ * unwind the searches that lost a parallel rule set call. */
+#define NODE_SCAN_BATCH 64
+
+extern bool node_scans_cancelled;
+
+typedef struct NodeScan {
+   uint8_t mark, status, indegree, outdegree;
+   bool any_mark;
+   /* The index of the next node to filter, and the candidates found but not
+    * yet returned: batch[position] to batch[count - 1]. */
+   int next, position, count;
+   int batch[NODE_SCAN_BATCH];
+} NodeScan;
+
+int scanNodes(Graph *graph, NodeScan *scan);
+
+static inline void startNodeScan(NodeScan *scan, MarkType mark, bool root,
+                                 int indegree, int outdegree)
+{
+   scan->mark = mark == ANY ? 0 : mark;
+   scan->any_mark = mark == ANY;
+   scan->status = root ? NODE_PRESENT | NODE_ROOT : NODE_PRESENT;
+   scan->indegree = indegree > 255 ? 255 : indegree;
+   scan->outdegree = outdegree > 255 ? 255 : outdegree;
+   scan->next = 0;
+   scan->position = 0;
+   scan->count = 0;
+}
+
+/* Returns the index of the next candidate node, or -1 if there are none. */
+static inline int nextNodeCandidate(Graph *graph, NodeScan *scan)
+{
+   if(scan->position == scan->count && scanNodes(graph, scan) == 0) return -1;
+   return scan->batch[scan->position++];
+}
+
 RootNodes *getRootNodeList(Graph *graph);
 
+/* The querying functions are defined here so that they can be inlined into the
+ * generated matchers. */
+static inline Node *getNode(Graph *graph, int index)
+{
+   assert(index < graph->nodes.size);
+   if(index == -1) return NULL;
+   else return &(graph->nodes.items[index]);
+}
+
+static inline Edge *getEdge(Graph *graph, int index)
+{
+   assert(index < graph->edges.size);
+   if(index == -1) return NULL;
+   else return &(graph->edges.items[index]);
+}
+
 /* Called with a positive integer n. The node structures store two outedge indices
  * and two inedge indices. More incident edges are placed in a dynamic array.
  * Pass n = 0 to get the node's first incident edge.
@@ -152,15 +247,61 @@ RootNodes *getRootNodeList(Graph *graph);
  * Designed for iteration e.g. 
  * for(i = 0; i < n->out_edges.size + 2; i++) getNthOutEdge(g, n, i); 
  * I'm sure there's a nicer way to do this... */
-Edge *getNthOutEdge(Graph *graph, Node *node, int n);
-Edge *getNthInEdge(Graph *graph, Node *node, int n);
-Node *getSource(Graph *graph, Edge *edge); 
-Node *getTarget(Graph *graph, Edge *edge);
-HostLabel getNodeLabel(Graph *graph, int index);
-HostLabel getEdgeLabel(Graph *graph, int index); 
-int getIndegree(Graph *graph, int index);
-int getOutdegree(Graph *graph, int index);
+static inline Edge *getNthOutEdge(Graph *graph, Node *node, int n)
+{
+   assert(n >= 0);
+   if(n == 0) return getEdge(graph, node->first_out_edge);
+   else if(n == 1) return getEdge(graph, node->second_out_edge);
+   else
+   {
+      assert(n - 2 < node->out_edges.size);
+      return getEdge(graph, node->out_edges.items[n - 2]);
+   }
+}
+
+static inline Edge *getNthInEdge(Graph *graph, Node *node, int n)
+{
+   assert(n >= 0);
+   if(n == 0) return getEdge(graph, node->first_in_edge);
+   else if(n == 1) return getEdge(graph, node->second_in_edge);
+   else
+   {
+      assert(n - 2 < node->in_edges.size);
+      return getEdge(graph, node->in_edges.items[n - 2]);
+   }
+}
+
+static inline Node *getSource(Graph *graph, Edge *edge)
+{
+   return getNode(graph, edge->source);
+}
+
+static inline Node *getTarget(Graph *graph, Edge *edge)
+{
+   return getNode(graph, edge->target);
+}
+
+static inline HostLabel getNodeLabel(Graph *graph, int index)
+{
+   return getNode(graph, index)->label;
+}
+
+static inline HostLabel getEdgeLabel(Graph *graph, int index)
+{
+   return getEdge(graph, index)->label;
+}
+
+static inline int getIndegree(Graph *graph, int index)
+{
+   return getNode(graph, index)->indegree;
+}
+
+static inline int getOutdegree(Graph *graph, int index)
+{
+   return getNode(graph, index)->outdegree;
+}
 
+/* Defined in graphWriter.c. */
 void printGraph(Graph *graph, FILE *file);
 void freeGraph(Graph *graph);
 
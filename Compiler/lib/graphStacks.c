@@ -14,6 +14,9 @@
   along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
 
 #include "graphStacks.h"
+#include "memoryAccounting.h"
+#include "probes.h"
+#include "trace.h"
 
 typedef struct GraphChangeStack {
    int size;
@@ -26,7 +29,7 @@ int graph_change_count = 0;
 
 static void makeGraphChangeStack(int initial_capacity)
 {
-   GraphChangeStack *stack = malloc(sizeof(GraphChangeStack));
+   GraphChangeStack *stack = allocateMemory(MEMORY_CHANGE_STACK, sizeof(GraphChangeStack));
    if(stack == NULL)
    {
       print_to_log("Error (makeGraphChangeStack): malloc failure.\n");
@@ -34,7 +37,8 @@ static void makeGraphChangeStack(int initial_capacity)
    }
    stack->size = 0;
    stack->capacity = initial_capacity;
-   stack->stack = calloc(initial_capacity, sizeof(GraphChange)); 
+   stack->stack = allocateZeroedMemory(MEMORY_CHANGE_STACK, initial_capacity,
+                                       sizeof(GraphChange));
    if(stack->stack == NULL)
    {
       print_to_log("Error (makeGraphChangeStack): malloc failure.\n");
@@ -46,8 +50,8 @@ static void makeGraphChangeStack(int initial_capacity)
 static void growGraphChangeStack(void)
 {
    graph_change_stack->capacity *= 2;
-   graph_change_stack->stack = realloc(graph_change_stack->stack,
-                                       graph_change_stack->capacity * sizeof(GraphChange)); 
+   graph_change_stack->stack = reallocateMemory(MEMORY_CHANGE_STACK, graph_change_stack->stack,
+                                                graph_change_stack->capacity * sizeof(GraphChange));
    if(graph_change_stack->stack == NULL)
    {
       print_to_log("Error (growGraphChangeStack): malloc failure.\n");
@@ -197,6 +201,7 @@ void undoChanges(Graph *graph, int restore_point)
 {
    if(graph_change_stack == NULL) return;
    assert(restore_point >= 0);
+   GP2_PROBE2(undo, restore_point, graph_change_stack->size - restore_point);
    while(graph_change_stack->size > restore_point)
    { 
       GraphChange change = pullGraphChange();
@@ -206,17 +211,20 @@ void undoChanges(Graph *graph, int restore_point)
          {
               int index = change.added_node.index;
               Node *node = getNode(graph, index);  
+              if(graph == traced_graph) traceNodeChange(TRACE_NODE_REMOVED, graph, index);
 
-              if(node->out_edges.items != NULL) free(node->out_edges.items);
-              if(node->in_edges.items != NULL) free(node->in_edges.items); 
+              if(node->out_edges.items != NULL) freeMemory(node->out_edges.items);
+              if(node->in_edges.items != NULL) freeMemory(node->in_edges.items); 
               if(node->root) removeRootNode(graph, index);
               removeHostList(node->label.list);
+              graph->nodes_by_mark[node->label.mark]--;
 
               if(change.added_node.hole_filled) 
                  graph->nodes.holes.items[graph->nodes.holes.size++] = index;
               else graph->nodes.size--;
 
               graph->nodes.items[index] = dummy_node;
+              updateNodeColumns(graph, index);
               graph->number_of_nodes--;
               break;
          }
@@ -225,6 +233,8 @@ void undoChanges(Graph *graph, int restore_point)
          {
               int index = change.added_edge.index;
               Edge *edge = getEdge(graph, index);
+              if(graph == traced_graph) traceEdgeChange(TRACE_EDGE_REMOVED, graph, index);
+              updateEdgeSignatures(graph, edge, -1);
 
               Node *source = getNode(graph, edge->source);
               if(source->first_out_edge == index) source->first_out_edge = -1;
@@ -237,7 +247,10 @@ void undoChanges(Graph *graph, int restore_point)
               else if(target->second_in_edge == index) target->second_in_edge = -1;
               else removeFromIntArray(&(target->in_edges), index);
               target->indegree--;
+              updateNodeColumns(graph, source->index);
+              updateNodeColumns(graph, target->index);
               removeHostList(edge->label.list);
+              graph->edges_by_mark[edge->label.mark]--;
 
               if(change.added_edge.hole_filled)
                  graph->edges.holes.items[graph->edges.holes.size++] = index;
@@ -261,6 +274,7 @@ void undoChanges(Graph *graph, int restore_point)
               node.in_edges = makeIntArray(0);
               node.outdegree = 0;
               node.indegree = 0;
+              node.signature = 0;
 	      node.matched = false;
 
               graph->nodes.items[change.removed_node.index] = node;
@@ -273,7 +287,11 @@ void undoChanges(Graph *graph, int restore_point)
               }
               else graph->nodes.size++;
               if(node.root) addRootNode(graph, change.removed_node.index);
+              updateNodeColumns(graph, change.removed_node.index);
               graph->number_of_nodes++;
+              graph->nodes_by_mark[node.label.mark]++;
+              if(graph == traced_graph)
+                 traceNodeChange(TRACE_NODE_ADDED, graph, change.removed_node.index);
               break;
          }
          case REMOVED_EDGE:
@@ -300,6 +318,9 @@ void undoChanges(Graph *graph, int restore_point)
               else if(target->second_in_edge == -1) target->second_in_edge = edge.index;
               else addToIntArray(&(target->in_edges), edge.index);
               target->indegree++;
+              updateEdgeSignatures(graph, &edge, 1);
+              updateNodeColumns(graph, source->index);
+              updateNodeColumns(graph, target->index);
               /* If the removal of the edge created a hole, manually remove it from
                * the holes array. */
               if(change.removed_edge.hole_created)
@@ -309,6 +330,9 @@ void undoChanges(Graph *graph, int restore_point)
               }
               else graph->edges.size++;
               graph->number_of_edges++;
+              graph->edges_by_mark[edge.label.mark]++;
+              if(graph == traced_graph)
+                 traceEdgeChange(TRACE_EDGE_ADDED, graph, change.removed_edge.index);
               break;
          }
          case RELABELLED_NODE:
@@ -387,8 +411,8 @@ void freeGraphChangeStack(void)
    #ifndef LIST_HASHING
       discardChanges(0);
    #endif
-   free(graph_change_stack->stack);
-   free(graph_change_stack);
+   freeMemory(graph_change_stack->stack);
+   freeMemory(graph_change_stack);
 }
 
 
@@ -404,12 +428,16 @@ void copyGraph(Graph *graph)
       print_to_log("Error: copyGraph called with a full graph stack.\n");
       return;
    }
-   if(graph_stack == NULL) graph_stack = calloc(GRAPH_STACK_SIZE, sizeof(Graph*));
+   if(graph_stack == NULL)
+      graph_stack = allocateZeroedMemory(MEMORY_GRAPH_COPIES, GRAPH_STACK_SIZE, sizeof(Graph*));
    if(graph_stack == NULL)
    {
       print_to_log("Error (copyGraph): malloc failure.\n");
       exit(1);
    }
+   GP2_PROBE2(graph_copy, graph->number_of_nodes, graph->number_of_edges);
+   /* The labels of the copy are counted as host lists. */
+   countAsGraphCopy(true);
    Graph *graph_copy = newGraph(graph->nodes.capacity, graph->edges.capacity); 
 
    graph_copy->nodes.size = graph->nodes.size;
@@ -424,8 +452,9 @@ void copyGraph(Graph *graph)
     * then the holes array in the original graph. */
    if(graph_copy->nodes.holes.capacity < graph->nodes.holes.capacity)
    {
-      free(graph_copy->nodes.holes.items);
-      graph_copy->nodes.holes.items = calloc(graph->nodes.holes.capacity, sizeof(int));
+      freeMemory(graph_copy->nodes.holes.items);
+      graph_copy->nodes.holes.items = allocateZeroedMemory(MEMORY_GRAPH_COPIES,
+                                                          graph->nodes.holes.capacity, sizeof(int));
       if(graph_copy->nodes.holes.items == NULL)
       {
          print_to_log("Error (copyGraph): malloc failure.\n");
@@ -439,8 +468,9 @@ void copyGraph(Graph *graph)
 
    if(graph_copy->edges.holes.capacity < graph->edges.holes.capacity)
    {
-      free(graph_copy->edges.holes.items);
-      graph_copy->edges.holes.items = calloc(graph->edges.holes.capacity, sizeof(int));
+      freeMemory(graph_copy->edges.holes.items);
+      graph_copy->edges.holes.items = allocateZeroedMemory(MEMORY_GRAPH_COPIES,
+                                                          graph->edges.holes.capacity, sizeof(int));
       if(graph_copy->edges.holes.items == NULL)
       {
          print_to_log("Error (copyGraph): malloc failure.\n");
@@ -454,12 +484,16 @@ void copyGraph(Graph *graph)
    
    graph_copy->number_of_nodes = graph->number_of_nodes;
    graph_copy->number_of_edges = graph->number_of_edges;
+   memcpy(graph_copy->nodes_by_mark, graph->nodes_by_mark, sizeof(graph->nodes_by_mark));
+   memcpy(graph_copy->edges_by_mark, graph->edges_by_mark, sizeof(graph->edges_by_mark));
+   /* newGraph sets number_of_roots to 0. It is counted by addRootNode below. */
    graph_copy->root_nodes = NULL;
  
    int index;
    for(index = 0; index < graph_copy->nodes.size; index++)
    {
       Node *node_copy = getNode(graph_copy, index);
+      updateNodeColumns(graph_copy, index);
       /* The entry in the node array may be a dummy node, in which case nothing
        * needs to be done. This is tested by checking the node's index. */
       if(node_copy->index >= 0)
@@ -468,7 +502,8 @@ void copyGraph(Graph *graph)
          /* If necessary, copy the edges arrays of the original node. */
          if(node->out_edges.items != NULL)
          {
-            node_copy->out_edges.items = calloc(node_copy->out_edges.size, sizeof(int));
+            node_copy->out_edges.items = allocateZeroedMemory(MEMORY_GRAPH_COPIES,
+                                                              node_copy->out_edges.size, sizeof(int));
             if(node_copy->out_edges.items == NULL)
             {
                print_to_log("Error: (copyGraph): malloc failure.\n");
@@ -479,7 +514,8 @@ void copyGraph(Graph *graph)
          }
          if(node->in_edges.items != NULL)
          {
-            node_copy->in_edges.items = calloc(node_copy->in_edges.size, sizeof(int));
+            node_copy->in_edges.items = allocateZeroedMemory(MEMORY_GRAPH_COPIES,
+                                                             node_copy->in_edges.size, sizeof(int));
             if(node_copy->in_edges.items == NULL)
             {
                print_to_log("Error: (copyGraph): malloc failure.\n");
@@ -510,6 +546,7 @@ void copyGraph(Graph *graph)
          #endif
       }
    }
+   countAsGraphCopy(false);
    graph_stack[graph_stack_index++] = graph_copy;
    graph_copy_count++;
 }
@@ -519,6 +556,7 @@ Graph *revertGraph(Graph *current_graph, int restore_point)
    printf("Popping copy of host graph.\n");
    if(graph_stack == NULL) return NULL;
    assert(graph_stack_index >= restore_point);
+   GP2_PROBE1(graph_revert, restore_point);
    if(graph_stack_index == restore_point) return current_graph;
    else freeGraph(current_graph);
 
@@ -542,6 +580,6 @@ void freeGraphStack(void)
 {
    if(graph_stack == NULL) return;
    discardGraphs(0);
-   free(graph_stack);
+   freeMemory(graph_stack);
 }
 
@@ -0,0 +1,411 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "graphWriter.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+typedef struct OutputBuffer {
+   char *text;
+   size_t length;
+   size_t capacity;
+   /* The text is written to fd whenever it exceeds OUTPUT_FLUSH_SIZE. If fd
+    * is -1, the text is kept until the whole graph is formatted. */
+   int fd;
+} OutputBuffer;
+
+typedef struct CachedList {
+   HostList *list;
+   size_t offset;
+   size_t length;
+} CachedList;
+
+/* Each thread formats one chunk of the node array and one chunk of the edge
+ * array. With a single thread, both chunks are written to the same buffer. */
+typedef struct GraphWriter {
+   Graph *graph;
+   int *output_indices;
+   int first_node, last_node, first_node_id;
+   int first_edge, last_edge, first_edge_id;
+   OutputBuffer nodes;
+   OutputBuffer edges;
+   OutputBuffer *node_output;
+   OutputBuffer *edge_output;
+   /* An open addressing table from host lists to their text in list_text. */
+   CachedList *cache;
+   int cache_size;
+   int cached;
+   OutputBuffer list_text;
+} GraphWriter;
+
+static const char *mark_suffixes[] = {"", " # red", " # green", " # blue", " # grey",
+                                      " # dashed", ""};
+
+static bool writeAll(int fd, const char *text, size_t length)
+{
+   while(length > 0)
+   {
+      ssize_t written = write(fd, text, length);
+      if(written < 0)
+      {
+         if(errno == EINTR) continue;
+         print_to_log("Error (printGraph): %s.\n", strerror(errno));
+         return false;
+      }
+      text += written;
+      length -= written;
+   }
+   return true;
+}
+
+static void reserveOutput(OutputBuffer *buffer, size_t extra)
+{
+   if(buffer->length + extra <= buffer->capacity) return;
+   size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+   while(buffer->length + extra > capacity) capacity *= 2;
+   buffer->text = realloc(buffer->text, capacity);
+   if(buffer->text == NULL)
+   {
+      print_to_log("Error (printGraph): malloc failure.\n");
+      exit(1);
+   }
+   buffer->capacity = capacity;
+}
+
+static void flushOutput(OutputBuffer *buffer)
+{
+   if(buffer->fd < 0 || buffer->length < OUTPUT_FLUSH_SIZE) return;
+   writeAll(buffer->fd, buffer->text, buffer->length);
+   buffer->length = 0;
+}
+
+static void appendText(OutputBuffer *buffer, const char *text, size_t length)
+{
+   reserveOutput(buffer, length);
+   memcpy(buffer->text + buffer->length, text, length);
+   buffer->length += length;
+}
+
+static void appendInt(OutputBuffer *buffer, int value)
+{
+   reserveOutput(buffer, 12);
+   char digits[12], *text = buffer->text + buffer->length;
+   unsigned int magnitude = value < 0 ? -(unsigned int)value : (unsigned int)value;
+   int count = 0;
+   if(value < 0) *text++ = '-';
+   do
+   {
+      digits[count++] = '0' + magnitude % 10;
+      magnitude /= 10;
+   } while(magnitude > 0);
+   while(count > 0) *text++ = digits[--count];
+   buffer->length = text - buffer->text;
+}
+
+static void appendHostList(OutputBuffer *buffer, HostListItem *item)
+{
+   while(item != NULL)
+   {
+      if(item->atom.type == 'i') appendInt(buffer, item->atom.num);
+      else
+      {
+         size_t length = strlen(item->atom.str);
+         reserveOutput(buffer, length + 2);
+         buffer->text[buffer->length++] = '"';
+         memcpy(buffer->text + buffer->length, item->atom.str, length);
+         buffer->length += length;
+         buffer->text[buffer->length++] = '"';
+      }
+      if(item->next != NULL) appendText(buffer, " : ", 3);
+      item = item->next;
+   }
+}
+
+#ifdef LIST_HASHING
+static size_t hashList(HostList *list, int size)
+{
+   return ((uintptr_t)list >> 4) * 2654435761u & (size - 1);
+}
+
+static void growCache(GraphWriter *writer)
+{
+   CachedList *old_cache = writer->cache;
+   int index, old_size = writer->cache_size;
+   writer->cache_size = old_size == 0 ? 1024 : 2 * old_size;
+   writer->cache = calloc(writer->cache_size, sizeof(CachedList));
+   if(writer->cache == NULL)
+   {
+      print_to_log("Error (printGraph): malloc failure.\n");
+      exit(1);
+   }
+   for(index = 0; index < old_size; index++)
+   {
+      if(old_cache[index].list == NULL) continue;
+      size_t slot = hashList(old_cache[index].list, writer->cache_size);
+      while(writer->cache[slot].list != NULL) slot = (slot + 1) & (writer->cache_size - 1);
+      writer->cache[slot] = old_cache[index];
+   }
+   free(old_cache);
+}
+
+/* Copies the cached text of the list to the buffer, formatting and caching it
+ * first if needed. */
+static void appendCachedList(GraphWriter *writer, OutputBuffer *buffer, HostList *list)
+{
+   if(2 * writer->cached >= writer->cache_size)
+   {
+      if(writer->cached >= MAX_CACHED_LISTS)
+      {
+         appendHostList(buffer, list->first);
+         return;
+      }
+      growCache(writer);
+   }
+   size_t slot = hashList(list, writer->cache_size);
+   while(writer->cache[slot].list != NULL && writer->cache[slot].list != list)
+      slot = (slot + 1) & (writer->cache_size - 1);
+   CachedList *entry = &(writer->cache[slot]);
+   if(entry->list == NULL)
+   {
+      entry->list = list;
+      entry->offset = writer->list_text.length;
+      appendHostList(&(writer->list_text), list->first);
+      entry->length = writer->list_text.length - entry->offset;
+      writer->cached++;
+   }
+   appendText(buffer, writer->list_text.text + entry->offset, entry->length);
+}
+#endif
+
+static void appendLabel(GraphWriter *writer, OutputBuffer *buffer, HostLabel label)
+{
+   if(label.length == 0) appendText(buffer, "empty", 5);
+   else
+   {
+      #ifdef LIST_HASHING
+         appendCachedList(writer, buffer, label.list);
+      #else
+         (void)writer;
+         appendHostList(buffer, label.list->first);
+      #endif
+   }
+   const char *suffix = mark_suffixes[label.mark];
+   if(suffix[0] != '\0') appendText(buffer, suffix, strlen(suffix));
+}
+
+/* Five nodes and three edges are printed per line. */
+static void formatNodes(GraphWriter *writer)
+{
+   Graph *graph = writer->graph;
+   OutputBuffer *output = writer->node_output;
+   int index, id = writer->first_node_id;
+   for(index = writer->first_node; index < writer->last_node; index++)
+   {
+      Node *node = getNode(graph, index);
+      if(node->index == -1) continue;
+      if(id != 0 && id % 5 == 0) appendText(output, "\n  ", 3);
+      appendText(output, "(", 1);
+      appendInt(output, id++);
+      if(node->root) appendText(output, "(R), ", 5);
+      else appendText(output, ", ", 2);
+      appendLabel(writer, output, node->label);
+      appendText(output, ") ", 2);
+      flushOutput(output);
+   }
+}
+
+static void formatEdges(GraphWriter *writer)
+{
+   Graph *graph = writer->graph;
+   OutputBuffer *output = writer->edge_output;
+   int index, id = writer->first_edge_id;
+   for(index = writer->first_edge; index < writer->last_edge; index++)
+   {
+      Edge *edge = getEdge(graph, index);
+      if(edge->index == -1) continue;
+      if(id != 0 && id % 3 == 0) appendText(output, "\n  ", 3);
+      appendText(output, "(", 1);
+      appendInt(output, id++);
+      appendText(output, ", ", 2);
+      appendInt(output, writer->output_indices[edge->source]);
+      appendText(output, ", ", 2);
+      appendInt(output, writer->output_indices[edge->target]);
+      appendText(output, ", ", 2);
+      appendLabel(writer, output, edge->label);
+      appendText(output, ") ", 2);
+      flushOutput(output);
+   }
+}
+
+static void *formatChunks(void *argument)
+{
+   formatNodes(argument);
+   formatEdges(argument);
+   return NULL;
+}
+
+/* Writes the pieces in order, with writev if the file has a descriptor. */
+static void writePieces(FILE *file, int fd, struct iovec *pieces, int count)
+{
+   if(fd < 0)
+   {
+      int piece;
+      for(piece = 0; piece < count; piece++)
+         fwrite(pieces[piece].iov_base, 1, pieces[piece].iov_len, file);
+      return;
+   }
+   while(count > 0)
+   {
+      ssize_t written = writev(fd, pieces, count < IOV_MAX ? count : IOV_MAX);
+      if(written < 0)
+      {
+         if(errno == EINTR) continue;
+         print_to_log("Error (printGraph): %s.\n", strerror(errno));
+         return;
+      }
+      /* Skip the pieces that were written and move into a partly written one. */
+      while(count > 0 && (size_t)written >= pieces->iov_len)
+      {
+         written -= pieces->iov_len;
+         pieces++;
+         count--;
+      }
+      if(count > 0)
+      {
+         pieces->iov_base = (char *)pieces->iov_base + written;
+         pieces->iov_len -= written;
+      }
+   }
+}
+
+static int outputThreads(Graph *graph)
+{
+   if(graph->number_of_nodes + graph->number_of_edges < OUTPUT_THREAD_ITEMS) return 1;
+   long processors = sysconf(_SC_NPROCESSORS_ONLN);
+   if(processors < 1) return 1;
+   return processors > MAX_OUTPUT_THREADS ? MAX_OUTPUT_THREADS : (int)processors;
+}
+
+static void freeWriter(GraphWriter *writer)
+{
+   free(writer->nodes.text);
+   free(writer->edges.text);
+   free(writer->list_text.text);
+   free(writer->cache);
+}
+
+void printGraph(Graph *graph, FILE *file)
+{
+   /* The node and edge counts are used in the IDs of the printed graph. The
+    * item's index in the graph is not suitable for this purpose because there
+    * may be holes in the graph's node array. */
+   if(graph == NULL || graph->number_of_nodes == 0)
+   {
+      PTF("[ | ]\n\n");
+      return;
+   }
+   fflush(file);
+   int fd = fileno(file);
+   int threads = outputThreads(graph);
+   GraphWriter writers[MAX_OUTPUT_THREADS];
+   memset(writers, 0, sizeof(writers));
+
+   /* Maps a node's graph-index to the ID it is printed with. The IDs of the
+    * first node and edge of each chunk are counted at the same time. */
+   int *output_indices = malloc(graph->nodes.size * sizeof(int));
+   if(output_indices == NULL)
+   {
+      print_to_log("Error (printGraph): malloc failure.\n");
+      exit(1);
+   }
+   int thread, index, count = 0;
+   for(thread = 0; thread < threads; thread++)
+   {
+      GraphWriter *writer = &writers[thread];
+      writer->graph = graph;
+      writer->output_indices = output_indices;
+      writer->first_node = (long long)graph->nodes.size * thread / threads;
+      writer->last_node = (long long)graph->nodes.size * (thread + 1) / threads;
+      writer->first_node_id = count;
+      for(index = writer->first_node; index < writer->last_node; index++)
+         output_indices[index] = getNode(graph, index)->index == -1 ? -1 : count++;
+   }
+   for(count = 0, thread = 0; thread < threads; thread++)
+   {
+      GraphWriter *writer = &writers[thread];
+      writer->first_edge = (long long)graph->edges.size * thread / threads;
+      writer->last_edge = (long long)graph->edges.size * (thread + 1) / threads;
+      writer->first_edge_id = count;
+      if(thread + 1 < threads)
+         for(index = writer->first_edge; index < writer->last_edge; index++)
+            if(getEdge(graph, index)->index != -1) count++;
+      writer->nodes.fd = threads == 1 ? fd : -1;
+      writer->edges.fd = -1;
+      writer->list_text.fd = -1;
+      writer->node_output = &writer->nodes;
+      writer->edge_output = threads == 1 ? &writer->nodes : &writer->edges;
+   }
+
+   const char *middle = graph->number_of_edges == 0 ? "| ]\n\n" : "|\n  ";
+   const char *end = graph->number_of_edges == 0 ? "" : "]\n\n";
+   struct iovec pieces[2 * MAX_OUTPUT_THREADS + 3];
+   int piece = 0;
+   if(threads == 1)
+   {
+      /* The whole graph goes through one buffer, which streams to the file. */
+      OutputBuffer *output = &writers[0].nodes;
+      appendText(output, "[ ", 2);
+      formatNodes(&writers[0]);
+      appendText(output, middle, strlen(middle));
+      formatEdges(&writers[0]);
+      appendText(output, end, strlen(end));
+      pieces[piece++] = (struct iovec){output->text, output->length};
+   }
+   else
+   {
+      pthread_t workers[MAX_OUTPUT_THREADS];
+      bool started[MAX_OUTPUT_THREADS] = {false};
+      for(thread = 1; thread < threads; thread++)
+         started[thread] = pthread_create(&workers[thread], NULL, formatChunks,
+                                          &writers[thread]) == 0;
+      formatChunks(&writers[0]);
+      for(thread = 1; thread < threads; thread++)
+      {
+         /* A chunk whose thread could not be started is formatted here. */
+         if(started[thread]) pthread_join(workers[thread], NULL);
+         else formatChunks(&writers[thread]);
+      }
+      pieces[piece++] = (struct iovec){"[ ", 2};
+      for(thread = 0; thread < threads; thread++)
+         pieces[piece++] = (struct iovec){writers[thread].nodes.text, writers[thread].nodes.length};
+      pieces[piece++] = (struct iovec){(char *)middle, strlen(middle)};
+      for(thread = 0; thread < threads; thread++)
+         pieces[piece++] = (struct iovec){writers[thread].edges.text, writers[thread].edges.length};
+      pieces[piece++] = (struct iovec){(char *)end, strlen(end)};
+   }
+   writePieces(file, fd, pieces, piece);
+   for(thread = 0; thread < threads; thread++) freeWriter(&writers[thread]);
+   free(output_indices);
+}
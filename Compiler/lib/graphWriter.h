@@ -0,0 +1,55 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ===================
+  Graph Writer Module
+  ===================
+
+  Writes host graphs in host graph syntax. printGraph (declared in graph.h)
+  formats the graph into large buffers instead of calling fprintf for every
+  item and atom, and writes them straight to the file descriptor of the
+  passed file with writev. Integers are formatted by hand, and the text of
+  each host list is formatted once and then copied for every label that
+  shares the list (see LIST_HASHING in common.h).
+
+  Graphs with at least OUTPUT_THREAD_ITEMS nodes and edges are split into
+  chunks of the node and edge arrays, which are formatted on one thread per
+  processor, up to MAX_OUTPUT_THREADS. The chunks are kept in memory until
+  they are all formatted. Smaller graphs are formatted on the calling thread
+  and streamed to the file every OUTPUT_FLUSH_SIZE bytes. Every program that
+  links the library therefore needs -lpthread, which the Makefiles generated
+  by the compiler always pass.
+
+  The output is the same as that of printHostLabel and printHostList.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_GRAPH_WRITER_H
+#define INC_GRAPH_WRITER_H
+
+#include "common.h"
+#include "graph.h"
+
+#define OUTPUT_THREAD_ITEMS 100000
+#define MAX_OUTPUT_THREADS 8
+#define OUTPUT_FLUSH_SIZE (1 << 20)
+
+/* At most this many host lists are cached by each thread. Graphs with more
+ * distinct labels format the remaining labels directly. */
+#define MAX_CACHED_LISTS (1 << 16)
+
+#endif /* INC_GRAPH_WRITER_H */
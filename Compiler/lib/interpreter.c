@@ -0,0 +1,1801 @@
+/* ////////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  =========================
+  GP 2 Bytecode Interpreter
+  =========================
+
+  Usage: gp2vm <bytecode_file> <host_file>
+
+  Executes a GP 2 program written by the compiler's -b option (gp2.gpb) on a
+  host graph, without generating or compiling any C code. The results are
+  reported in the same way as a compiled gp2run: the output graph or the
+  failure message is written to gp2.output in the working directory, and
+  errors are logged to gp2.log.
+
+  The bytecode is a text file, described in genBytecode.h in the compiler
+  source. At load time each rule is assembled into a searchplan array and
+  integer code for its label patterns, condition, predicates and RHS, and the
+  main program is assembled into a command tree. Rules are then matched and
+  applied against the library's Graph and Morphism structures exactly as the
+  generated C code does: the searchplan is executed depth-first with
+  backtracking, and host graph changes are recorded on the graph change stack
+  whenever an enclosing branch condition or loop body may need to undo them.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#include "common.h"
+#include "debug.h"
+#include "graph.h"
+#include "graphStacks.h"
+#include "label.h"
+#include "memoryAccounting.h"
+#include "morphism.h"
+#include "parser.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Variables are matched by comparing list pointers. This is only sound when
+ * every distinct list is stored exactly once. */
+#ifndef LIST_HASHING
+#error "The bytecode interpreter requires LIST_HASHING."
+#endif
+
+/* Globals expected by the host graph parser. */
+Graph *host = NULL;
+int *node_map = NULL;
+
+extern void yyrestart(FILE *input_file);
+
+/* Opcodes of the assembled code. The loader translates each mnemonic of the
+ * bytecode file according to its context, since some mnemonics ("int") name
+ * both a pattern atom and a predicate. */
+typedef enum {
+   /* Pattern atoms and expressions. */
+   OP_INT = 0, OP_STR, OP_VAR, OP_CONCAT, OP_LENGTH, OP_INDEG, OP_OUTDEG,
+   OP_NEG, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_CAT,
+   /* Conditions. */
+   OP_PRED, OP_NOT, OP_AND, OP_OR,
+   /* Predicates. */
+   OP_INT_CHECK, OP_CHAR_CHECK, OP_STRING_CHECK, OP_ATOM_CHECK, OP_EDGE,
+   OP_EQ, OP_NE, OP_GT, OP_GE, OP_LT, OP_LE,
+   /* Rule application. */
+   OP_DELE, OP_RELE, OP_REME, OP_DELN, OP_RELN, OP_REMN, OP_ROOT, OP_UNROOT,
+   OP_ADDN, OP_ADDE, OP_END
+} Opcode;
+
+typedef struct Mnemonic {
+   string name;
+   int opcode;
+} Mnemonic;
+
+static const Mnemonic expressions[] = {
+   {"int", OP_INT}, {"str", OP_STR}, {"var", OP_VAR}, {"length", OP_LENGTH},
+   {"indeg", OP_INDEG}, {"outdeg", OP_OUTDEG}, {"neg", OP_NEG}, {"add", OP_ADD},
+   {"sub", OP_SUB}, {"mul", OP_MUL}, {"div", OP_DIV}, {"cat", OP_CAT}, {NULL, -1}
+};
+
+static const Mnemonic tests[] = {
+   {"int", OP_INT_CHECK}, {"char", OP_CHAR_CHECK}, {"string", OP_STRING_CHECK},
+   {"atom", OP_ATOM_CHECK}, {"edge", OP_EDGE}, {"eq", OP_EQ}, {"ne", OP_NE},
+   {"gt", OP_GT}, {"ge", OP_GE}, {"lt", OP_LT}, {"le", OP_LE}, {NULL, -1}
+};
+
+static const Mnemonic updates[] = {
+   {"dele", OP_DELE}, {"rele", OP_RELE}, {"reme", OP_REME}, {"deln", OP_DELN},
+   {"reln", OP_RELN}, {"remn", OP_REMN}, {"root", OP_ROOT}, {"unroot", OP_UNROOT},
+   {"addn", OP_ADDN}, {"adde", OP_ADDE}, {"end", OP_END}, {NULL, -1}
+};
+
+/* One searchplan operation. The node fields are used by the operations 'n',
+ * 'r', 'i', 'o' and 'b', the edge fields by 'e', 's', 't' and 'l'. */
+typedef struct Operation {
+   char type;
+   int index;
+   MarkType mark;
+   bool root, dangling, has_predicates;
+   int indegree, outdegree, bidegree;
+   int source, target;
+   bool bidirectional;
+   /* Offset of the LHS label pattern in the code array. */
+   int pattern;
+} Operation;
+
+/* variable_types holds 'i', 'c', 's', 'a' or 'l' for each variable, and
+ * variable_predicates flags the variables that occur in the condition.
+ * predicates holds the code offset of each predicate, condition is the code
+ * offset of the condition (-1 if there is none) and apply is the code offset
+ * of the RHS update sequence. */
+typedef struct Rule {
+   string name;
+   int lhs_nodes, lhs_edges, rhs_nodes, variables, predicate_count;
+   char *variable_types;
+   bool *variable_predicates;
+   Operation *plan;
+   int plan_length;
+   int condition;
+   int *predicates;
+   int apply;
+   bool is_predicate;
+   Morphism *morphism;
+   /* Host indices of added nodes, and degrees of matched nodes before the
+    * rule is applied. */
+   int *rhs_node_map, *indegrees, *outdegrees;
+} Rule;
+
+typedef enum {SEQUENCE = 0, RULE_CALL, RULE_SET_CALL, IF_STATEMENT, TRY_STATEMENT,
+              LOOP_STATEMENT, OR_STATEMENT, SKIP_STATEMENT, FAIL_STATEMENT,
+              BREAK_STATEMENT} CommandType;
+
+/* A node of the main program. Procedure calls are inlined by the compiler.
+ * restore is set for branch statements and loops that record graph changes
+ * in their condition or body. */
+typedef struct Command {
+   CommandType type;
+   int count;
+   Rule **rules;
+   struct Command **commands;
+   bool restore;
+} Command;
+
+typedef enum {SUCCESS = 0, FAILURE, BREAK} Result;
+
+/* The assembled code and the string table. Strings point into the buffer
+ * holding the bytecode file, which lives as long as the program. */
+static int *code = NULL;
+static int code_size = 0, code_capacity = 0;
+static string *strings = NULL;
+static int string_count = 0, string_capacity = 0;
+
+static Rule *rules = NULL;
+static int rule_count = 0;
+static Command *main_program = NULL;
+
+static long max_nodes = 128, max_edges = 128;
+
+/* ===========
+ * Memory Help
+ * =========== */
+static void *checkedMalloc(size_t size)
+{
+   void *pointer = malloc(size > 0 ? size : 1);
+   if(pointer == NULL)
+   {
+      print_to_log("Error (gp2vm): malloc failure.\n");
+      exit(1);
+   }
+   return pointer;
+}
+
+static void *checkedRealloc(void *pointer, size_t size)
+{
+   pointer = realloc(pointer, size > 0 ? size : 1);
+   if(pointer == NULL)
+   {
+      print_to_log("Error (gp2vm): malloc failure.\n");
+      exit(1);
+   }
+   return pointer;
+}
+
+/* A growable array of host atoms used to build labels and lists. Strings
+ * created by concatenation are kept in the scratch array and freed once the
+ * list has been hashed or compared. */
+typedef struct AtomList {
+   HostAtom *atoms;
+   int length, capacity;
+} AtomList;
+
+static AtomList left_atoms = {NULL, 0, 0}, right_atoms = {NULL, 0, 0};
+static string *scratch = NULL;
+static int scratch_count = 0, scratch_capacity = 0;
+
+static void appendAtom(AtomList *list, HostAtom atom)
+{
+   if(list->length == list->capacity)
+   {
+      list->capacity = list->capacity == 0 ? 16 : 2 * list->capacity;
+      list->atoms = checkedRealloc(list->atoms, list->capacity * sizeof(HostAtom));
+   }
+   list->atoms[list->length++] = atom;
+}
+
+static string scratchString(size_t length)
+{
+   if(scratch_count == scratch_capacity)
+   {
+      scratch_capacity = scratch_capacity == 0 ? 8 : 2 * scratch_capacity;
+      scratch = checkedRealloc(scratch, scratch_capacity * sizeof(string));
+   }
+   scratch[scratch_count] = checkedMalloc(length + 1);
+   return scratch[scratch_count++];
+}
+
+static void freeScratch(void)
+{
+   int index;
+   for(index = 0; index < scratch_count; index++) free(scratch[index]);
+   scratch_count = 0;
+}
+
+/* ========================
+ * Loading the Bytecode File
+ * ======================== */
+static char *buffer = NULL, *cursor = NULL;
+
+static void loadError(string message, string token)
+{
+   fprintf(stderr, "Error (gp2vm): malformed bytecode: %s", message);
+   if(token != NULL) fprintf(stderr, " at \"%s\"", token);
+   fprintf(stderr, ".\n");
+   exit(1);
+}
+
+/* Returns the next token, or NULL at the end of the file. Double-quoted
+ * strings are returned without their quotes. */
+static string nextToken(void)
+{
+   while(*cursor != '\0' && isspace((unsigned char)*cursor)) cursor++;
+   if(*cursor == '\0') return NULL;
+   string token;
+   if(*cursor == '"')
+   {
+      token = ++cursor;
+      while(*cursor != '\0' && *cursor != '"') cursor++;
+      if(*cursor == '\0') loadError("unterminated string", token);
+   }
+   else
+   {
+      token = cursor;
+      while(*cursor != '\0' && !isspace((unsigned char)*cursor)) cursor++;
+   }
+   if(*cursor != '\0') *cursor++ = '\0';
+   return token;
+}
+
+static string expectToken(void)
+{
+   string token = nextToken();
+   if(token == NULL) loadError("unexpected end of file", NULL);
+   return token;
+}
+
+static void expectKeyword(string keyword)
+{
+   string token = expectToken();
+   if(strcmp(token, keyword) != 0) loadError("expected a keyword", token);
+}
+
+static int expectInt(void)
+{
+   string token = expectToken();
+   char *end = NULL;
+   long value = strtol(token, &end, 10);
+   if(end == token || *end != '\0') loadError("expected an integer", token);
+   return (int)value;
+}
+
+static int lookup(string token, const Mnemonic *table)
+{
+   int index;
+   for(index = 0; table[index].name != NULL; index++)
+      if(strcmp(token, table[index].name) == 0) return table[index].opcode;
+   loadError("unknown mnemonic", token);
+   return -1;
+}
+
+static void emit(int value)
+{
+   if(code_size == code_capacity)
+   {
+      code_capacity = code_capacity == 0 ? 1024 : 2 * code_capacity;
+      code = checkedRealloc(code, code_capacity * sizeof(int));
+   }
+   code[code_size++] = value;
+}
+
+static int addString(string value)
+{
+   if(string_count == string_capacity)
+   {
+      string_capacity = string_capacity == 0 ? 64 : 2 * string_capacity;
+      strings = checkedRealloc(strings, string_capacity * sizeof(string));
+   }
+   strings[string_count] = value;
+   return string_count++;
+}
+
+static void checkVariable(Rule *rule, int id)
+{
+   if(id < 0 || id >= rule->variables) loadError("variable out of range", NULL);
+}
+
+static void checkNode(Rule *rule, int index)
+{
+   if(index < 0 || index >= rule->lhs_nodes) loadError("node out of range", NULL);
+}
+
+/* Pattern layout: length, position of the list variable (-1 if none), the
+ * code offset of each atom, then the atoms. */
+static int loadPattern(Rule *rule)
+{
+   int start = code_size;
+   int length = expectInt();
+   emit(length);
+   emit(-1);
+   int index;
+   for(index = 0; index < length; index++) emit(0);
+   for(index = 0; index < length; index++)
+   {
+      code[start + 2 + index] = code_size;
+      string token = expectToken();
+      if(strcmp(token, "int") == 0)
+      {
+         emit(OP_INT);
+         emit(expectInt());
+      }
+      else if(strcmp(token, "str") == 0)
+      {
+         emit(OP_STR);
+         emit(addString(expectToken()));
+      }
+      else if(strcmp(token, "var") == 0)
+      {
+         int id = expectInt();
+         checkVariable(rule, id);
+         emit(OP_VAR);
+         emit(id);
+         if(rule->variable_types[id] == 'l') code[start + 1] = index;
+      }
+      else if(strcmp(token, "concat") == 0)
+      {
+         int count = expectInt(), piece;
+         emit(OP_CONCAT);
+         emit(count);
+         for(piece = 0; piece < count; piece++)
+         {
+            token = expectToken();
+            if(strcmp(token, "str") == 0)
+            {
+               emit(OP_STR);
+               emit(addString(expectToken()));
+            }
+            else if(strcmp(token, "var") == 0)
+            {
+               int id = expectInt();
+               checkVariable(rule, id);
+               emit(OP_VAR);
+               emit(id);
+            }
+            else loadError("unexpected concatenated atom", token);
+         }
+      }
+      else loadError("unexpected pattern atom", token);
+   }
+   return start;
+}
+
+static void loadExpression(Rule *rule)
+{
+   int opcode = lookup(expectToken(), expressions);
+   emit(opcode);
+   switch(opcode)
+   {
+      case OP_INT:
+           emit(expectInt());
+           break;
+
+      case OP_STR:
+           emit(addString(expectToken()));
+           break;
+
+      case OP_VAR:
+      case OP_LENGTH:
+      {
+           int id = expectInt();
+           checkVariable(rule, id);
+           emit(id);
+           break;
+      }
+      case OP_INDEG:
+      case OP_OUTDEG:
+      {
+           int node = expectInt();
+           checkNode(rule, node);
+           emit(node);
+           break;
+      }
+      case OP_NEG:
+           loadExpression(rule);
+           break;
+
+      default:
+           loadExpression(rule);
+           loadExpression(rule);
+           break;
+   }
+}
+
+static void loadList(Rule *rule)
+{
+   int length = expectInt(), index;
+   emit(length);
+   for(index = 0; index < length; index++) loadExpression(rule);
+}
+
+static void loadLabel(Rule *rule)
+{
+   emit(expectInt());
+   loadList(rule);
+}
+
+static void loadCondition(Rule *rule)
+{
+   string token = expectToken();
+   if(strcmp(token, "pred") == 0)
+   {
+      int id = expectInt();
+      if(id < 0 || id >= rule->predicate_count) loadError("predicate out of range", token);
+      emit(OP_PRED);
+      emit(id);
+   }
+   else if(strcmp(token, "not") == 0)
+   {
+      emit(OP_NOT);
+      loadCondition(rule);
+   }
+   else if(strcmp(token, "and") == 0 || strcmp(token, "or") == 0)
+   {
+      emit(token[0] == 'a' ? OP_AND : OP_OR);
+      loadCondition(rule);
+      loadCondition(rule);
+   }
+   else loadError("unexpected condition", token);
+}
+
+/* Predicate layout: negated flag, the nodes and the variables on which the
+ * predicate depends (each list preceded by its length), then the test. */
+static int loadPredicate(Rule *rule)
+{
+   int start = code_size, count, index;
+   expectKeyword("predicate");
+   emit(expectInt());
+   for(count = expectInt(), emit(count), index = 0; index < count; index++)
+   {
+      int node = expectInt();
+      checkNode(rule, node);
+      emit(node);
+   }
+   for(count = expectInt(), emit(count), index = 0; index < count; index++)
+   {
+      int id = expectInt();
+      checkVariable(rule, id);
+      emit(id);
+   }
+   int opcode = lookup(expectToken(), tests);
+   emit(opcode);
+   switch(opcode)
+   {
+      case OP_INT_CHECK:
+      case OP_CHAR_CHECK:
+      case OP_STRING_CHECK:
+      case OP_ATOM_CHECK:
+      {
+           int id = expectInt();
+           checkVariable(rule, id);
+           emit(id);
+           break;
+      }
+      case OP_EDGE:
+      {
+           int source = expectInt(), target = expectInt();
+           checkNode(rule, source);
+           checkNode(rule, target);
+           emit(source);
+           emit(target);
+           int has_label = expectInt();
+           emit(has_label);
+           if(has_label) loadLabel(rule);
+           break;
+      }
+      case OP_EQ:
+      case OP_NE:
+           loadList(rule);
+           loadList(rule);
+           break;
+
+      default:
+           loadExpression(rule);
+           loadExpression(rule);
+           break;
+   }
+   return start;
+}
+
+static void loadApplication(Rule *rule)
+{
+   rule->apply = code_size;
+   while(true)
+   {
+      int opcode = lookup(expectToken(), updates);
+      emit(opcode);
+      switch(opcode)
+      {
+         case OP_END:
+              return;
+
+         case OP_DELE:
+         case OP_DELN:
+         case OP_ROOT:
+         case OP_UNROOT:
+              emit(expectInt());
+              break;
+
+         case OP_REME:
+         case OP_REMN:
+              emit(expectInt());
+              emit(expectInt());
+              break;
+
+         case OP_RELE:
+         case OP_RELN:
+              emit(expectInt());
+              loadLabel(rule);
+              break;
+
+         case OP_ADDN:
+              emit(expectInt());
+              emit(expectInt());
+              loadLabel(rule);
+              break;
+
+         case OP_ADDE:
+         {
+              int end;
+              for(end = 0; end < 2; end++)
+              {
+                 string side = expectToken();
+                 if(strcmp(side, "l") != 0 && strcmp(side, "r") != 0)
+                    loadError("unexpected edge end", side);
+                 emit(side[0] == 'l');
+                 emit(expectInt());
+              }
+              loadLabel(rule);
+              break;
+         }
+      }
+   }
+}
+
+static void loadRule(Rule *rule)
+{
+   rule->name = expectToken();
+   rule->lhs_nodes = expectInt();
+   rule->lhs_edges = expectInt();
+   rule->rhs_nodes = expectInt();
+   rule->variables = expectInt();
+   rule->predicate_count = expectInt();
+   rule->variable_types = checkedMalloc(rule->variables);
+   rule->variable_predicates = checkedMalloc(rule->variables * sizeof(bool));
+
+   int index, count;
+   for(index = 0; index < rule->variables; index++)
+   {
+      expectKeyword("var");
+      string type = expectToken();
+      if(strcmp(type, "int") == 0) rule->variable_types[index] = 'i';
+      else if(strcmp(type, "char") == 0) rule->variable_types[index] = 'c';
+      else if(strcmp(type, "string") == 0) rule->variable_types[index] = 's';
+      else if(strcmp(type, "atom") == 0) rule->variable_types[index] = 'a';
+      else if(strcmp(type, "list") == 0) rule->variable_types[index] = 'l';
+      else loadError("unknown variable type", type);
+      count = expectInt();
+      rule->variable_predicates[index] = count > 0;
+      while(count-- > 0) expectInt();
+   }
+
+   expectKeyword("plan");
+   int capacity = rule->lhs_nodes + rule->lhs_edges;
+   rule->plan = checkedMalloc(capacity * sizeof(Operation));
+   rule->plan_length = 0;
+   while(true)
+   {
+      string token = expectToken();
+      if(strcmp(token, "end") == 0) break;
+      if(rule->plan_length == capacity || strlen(token) != 1 ||
+         strchr("nriobestl", token[0]) == NULL)
+         loadError("unexpected searchplan operation", token);
+      Operation *op = &(rule->plan[rule->plan_length++]);
+      memset(op, 0, sizeof(Operation));
+      op->type = token[0];
+      op->index = expectInt();
+      op->mark = expectInt();
+      if(strchr("nriob", op->type) != NULL)
+      {
+         checkNode(rule, op->index);
+         op->root = expectInt();
+         op->indegree = expectInt();
+         op->outdegree = expectInt();
+         op->bidegree = expectInt();
+         op->dangling = expectInt();
+         count = expectInt();
+         op->has_predicates = count > 0;
+         while(count-- > 0) expectInt();
+      }
+      else
+      {
+         if(op->index < 0 || op->index >= rule->lhs_edges)
+            loadError("edge out of range", token);
+         op->source = expectInt();
+         op->target = expectInt();
+         checkNode(rule, op->source);
+         checkNode(rule, op->target);
+         op->bidirectional = expectInt();
+      }
+      op->pattern = loadPattern(rule);
+   }
+
+   expectKeyword("cond");
+   rule->condition = -1;
+   if(expectInt())
+   {
+      rule->condition = code_size;
+      loadCondition(rule);
+   }
+   rule->predicates = checkedMalloc(rule->predicate_count * sizeof(int));
+   for(index = 0; index < rule->predicate_count; index++)
+      rule->predicates[index] = loadPredicate(rule);
+
+   expectKeyword("apply");
+   loadApplication(rule);
+   rule->is_predicate = code[rule->apply] == OP_END;
+
+   rule->morphism = makeMorphism(rule->lhs_nodes, rule->lhs_edges, rule->variables);
+   rule->rhs_node_map = checkedMalloc(rule->rhs_nodes * sizeof(int));
+   rule->indegrees = checkedMalloc(rule->lhs_nodes * sizeof(int));
+   rule->outdegrees = checkedMalloc(rule->lhs_nodes * sizeof(int));
+}
+
+static Rule *findRule(string name)
+{
+   int index;
+   for(index = 0; index < rule_count; index++)
+      if(strcmp(rules[index].name, name) == 0) return &(rules[index]);
+   loadError("call to an undefined rule", name);
+   return NULL;
+}
+
+static Command *loadCommand(void)
+{
+   Command *command = checkedMalloc(sizeof(Command));
+   memset(command, 0, sizeof(Command));
+   string token = expectToken();
+   int index;
+   if(strcmp(token, "seq") == 0)
+   {
+      command->type = SEQUENCE;
+      command->count = expectInt();
+      command->commands = checkedMalloc(command->count * sizeof(Command *));
+      for(index = 0; index < command->count; index++)
+         command->commands[index] = loadCommand();
+   }
+   else if(strcmp(token, "call") == 0 || strcmp(token, "set") == 0)
+   {
+      command->type = token[0] == 'c' ? RULE_CALL : RULE_SET_CALL;
+      command->count = command->type == RULE_CALL ? 1 : expectInt();
+      command->rules = checkedMalloc(command->count * sizeof(Rule *));
+      for(index = 0; index < command->count; index++)
+         command->rules[index] = findRule(expectToken());
+   }
+   else if(strcmp(token, "if") == 0 || strcmp(token, "try") == 0)
+   {
+      command->type = token[0] == 'i' ? IF_STATEMENT : TRY_STATEMENT;
+      command->restore = expectInt();
+      command->count = 3;
+      command->commands = checkedMalloc(3 * sizeof(Command *));
+      for(index = 0; index < 3; index++) command->commands[index] = loadCommand();
+   }
+   else if(strcmp(token, "loop") == 0)
+   {
+      command->type = LOOP_STATEMENT;
+      command->restore = expectInt();
+      command->count = 1;
+      command->commands = checkedMalloc(sizeof(Command *));
+      command->commands[0] = loadCommand();
+   }
+   else if(strcmp(token, "or") == 0)
+   {
+      command->type = OR_STATEMENT;
+      command->count = 2;
+      command->commands = checkedMalloc(2 * sizeof(Command *));
+      for(index = 0; index < 2; index++) command->commands[index] = loadCommand();
+   }
+   else if(strcmp(token, "skip") == 0) command->type = SKIP_STATEMENT;
+   else if(strcmp(token, "fail") == 0) command->type = FAIL_STATEMENT;
+   else if(strcmp(token, "break") == 0) command->type = BREAK_STATEMENT;
+   else loadError("unexpected command", token);
+   return command;
+}
+
+static void loadBytecode(string bytecode_file)
+{
+   FILE *input = fopen(bytecode_file, "r");
+   if(input == NULL)
+   {
+      perror(bytecode_file);
+      exit(1);
+   }
+   fseek(input, 0, SEEK_END);
+   long size = ftell(input);
+   rewind(input);
+   buffer = checkedMalloc(size + 1);
+   if(fread(buffer, 1, size, input) != (size_t)size)
+   {
+      perror(bytecode_file);
+      exit(1);
+   }
+   buffer[size] = '\0';
+   fclose(input);
+   cursor = buffer;
+
+   expectKeyword("gp2b");
+   max_nodes = expectInt();
+   max_edges = expectInt();
+   int capacity = 0;
+   while(true)
+   {
+      string token = expectToken();
+      if(strcmp(token, "main") == 0) break;
+      if(strcmp(token, "rule") != 0) loadError("expected a rule", token);
+      if(rule_count == capacity)
+      {
+         capacity = capacity == 0 ? 16 : 2 * capacity;
+         rules = checkedRealloc(rules, capacity * sizeof(Rule));
+      }
+      loadRule(&(rules[rule_count++]));
+   }
+   main_program = loadCommand();
+}
+
+/* ==================
+ * Expression Helpers
+ * ================== */
+
+/* Set while a rule is applied: degree operators then refer to the degrees of
+ * the matched nodes before the application, as in the generated code. */
+static bool applying = false;
+
+static int degree(Rule *rule, int node, bool in)
+{
+   if(applying) return in ? rule->indegrees[node] : rule->outdegrees[node];
+   int host_index = lookupNode(rule->morphism, node);
+   return in ? getIndegree(host, host_index) : getOutdegree(host, host_index);
+}
+
+static int evaluateInteger(Rule *rule, const int **pc)
+{
+   int opcode = *(*pc)++;
+   switch(opcode)
+   {
+      case OP_INT:
+           return *(*pc)++;
+
+      case OP_VAR:
+           return getAssignment(rule->morphism, *(*pc)++).num;
+
+      case OP_LENGTH:
+      {
+           int id = *(*pc)++;
+           Assignment assignment = getAssignment(rule->morphism, id);
+           if(rule->variable_types[id] == 'l') return getAssignmentLength(assignment);
+           if(assignment.type == 's') return (int)strlen(assignment.str);
+           return 1;
+      }
+      case OP_INDEG:
+           return degree(rule, *(*pc)++, true);
+
+      case OP_OUTDEG:
+           return degree(rule, *(*pc)++, false);
+
+      case OP_NEG:
+           return -evaluateInteger(rule, pc);
+
+      case OP_ADD:
+      case OP_SUB:
+      case OP_MUL:
+      case OP_DIV:
+      {
+           int left = evaluateInteger(rule, pc);
+           int right = evaluateInteger(rule, pc);
+           if(opcode == OP_ADD) return left + right;
+           if(opcode == OP_SUB) return left - right;
+           if(opcode == OP_MUL) return left * right;
+           if(right == 0)
+           {
+              print_to_log("Error (gp2vm): division by zero in rule %s.\n", rule->name);
+              return 0;
+           }
+           return left / right;
+      }
+      default:
+           print_to_log("Error (evaluateInteger): Unexpected opcode %d.\n", opcode);
+           return 0;
+   }
+}
+
+static string evaluateString(Rule *rule, const int **pc)
+{
+   int opcode = *(*pc)++;
+   switch(opcode)
+   {
+      case OP_STR:
+           return strings[*(*pc)++];
+
+      case OP_VAR:
+           return getAssignment(rule->morphism, *(*pc)++).str;
+
+      case OP_CAT:
+      {
+           string left = evaluateString(rule, pc);
+           string right = evaluateString(rule, pc);
+           size_t left_length = strlen(left);
+           string result = scratchString(left_length + strlen(right));
+           strcpy(result, left);
+           strcpy(result + left_length, right);
+           return result;
+      }
+      default:
+           print_to_log("Error (evaluateString): Unexpected opcode %d.\n", opcode);
+           return "";
+   }
+}
+
+/* Appends the atoms denoted by one RHS list expression. A list variable
+ * contributes all the atoms of its value. */
+static void appendExpression(Rule *rule, const int **pc, AtomList *list)
+{
+   HostAtom atom;
+   int opcode = **pc;
+   if(opcode == OP_STR || opcode == OP_CAT)
+   {
+      atom.type = 's';
+      atom.str = evaluateString(rule, pc);
+      appendAtom(list, atom);
+      return;
+   }
+   if(opcode == OP_VAR)
+   {
+      int id = (*pc)[1];
+      char type = rule->variable_types[id];
+      if(type != 'i')
+      {
+         *pc += 2;
+         Assignment assignment = getAssignment(rule->morphism, id);
+         if(assignment.type == 'l')
+         {
+            HostListItem *item = assignment.list == NULL ? NULL : assignment.list->first;
+            for(; item != NULL; item = item->next) appendAtom(list, item->atom);
+         }
+         else
+         {
+            atom.type = assignment.type;
+            if(assignment.type == 'i') atom.num = assignment.num;
+            else atom.str = assignment.str;
+            appendAtom(list, atom);
+         }
+         return;
+      }
+   }
+   atom.type = 'i';
+   atom.num = evaluateInteger(rule, pc);
+   appendAtom(list, atom);
+}
+
+static void evaluateList(Rule *rule, const int **pc, AtomList *list)
+{
+   int length = *(*pc)++, index;
+   list->length = 0;
+   for(index = 0; index < length; index++) appendExpression(rule, pc, list);
+}
+
+/* Builds a host label from a RHS label. The ANY mark keeps the mark of the
+ * host item being relabelled. The returned list holds a reference in the
+ * list store. */
+static HostLabel evaluateLabel(Rule *rule, const int **pc, MarkType host_mark)
+{
+   MarkType mark = *(*pc)++;
+   if(mark == ANY) mark = host_mark;
+   evaluateList(rule, pc, &left_atoms);
+   HostLabel label;
+   if(left_atoms.length == 0) label = makeEmptyLabel(mark);
+   else label = makeHostLabel(mark, left_atoms.length,
+                              makeHostList(left_atoms.atoms, left_atoms.length, false));
+   freeScratch();
+   return label;
+}
+
+/* ==========
+ * Conditions
+ * ========== */
+
+/* A predicate whose nodes and variables are not all matched yet takes its
+ * default value, true unless the predicate is negated, so that it cannot
+ * falsify the condition before it can be evaluated. */
+static bool evaluatePredicate(Rule *rule, int id)
+{
+   Morphism *morphism = rule->morphism;
+   const int *pc = code + rule->predicates[id];
+   bool negated = *pc++;
+   int count = *pc++;
+   for(; count > 0; count--)
+      if(lookupNode(morphism, *pc++) < 0) return !negated;
+   count = *pc++;
+   for(; count > 0; count--)
+      if(getAssignment(morphism, *pc++).type == 'n') return !negated;
+
+   int opcode = *pc++;
+   switch(opcode)
+   {
+      case OP_INT_CHECK:
+           return getAssignment(morphism, *pc).type == 'i';
+
+      case OP_CHAR_CHECK:
+      {
+           Assignment assignment = getAssignment(morphism, *pc);
+           return assignment.type == 's' && strlen(assignment.str) == 1;
+      }
+      case OP_STRING_CHECK:
+           return getAssignment(morphism, *pc).type == 's';
+
+      case OP_ATOM_CHECK:
+           return getAssignment(morphism, *pc).type != 'l';
+
+      case OP_EDGE:
+      {
+           Node *source = getNode(host, lookupNode(morphism, pc[0]));
+           int target = lookupNode(morphism, pc[1]);
+           bool has_label = pc[2];
+           pc += 3;
+           HostLabel label = blank_label;
+           if(has_label) label = evaluateLabel(rule, &pc, NONE);
+           bool found = false;
+           int counter;
+           for(counter = 0; counter < source->out_edges.size + 2; counter++)
+           {
+              Edge *edge = getNthOutEdge(host, source, counter);
+              if(edge == NULL || edge->target != target) continue;
+              if(has_label && !equalHostLabels(label, edge->label)) continue;
+              found = true;
+              break;
+           }
+           if(has_label) removeHostList(label.list);
+           return found;
+      }
+      case OP_EQ:
+      case OP_NE:
+      {
+           evaluateList(rule, &pc, &left_atoms);
+           evaluateList(rule, &pc, &right_atoms);
+           bool equal = equalHostLists(left_atoms.atoms, right_atoms.atoms,
+                                       left_atoms.length, right_atoms.length);
+           freeScratch();
+           return opcode == OP_EQ ? equal : !equal;
+      }
+      default:
+      {
+           int left = evaluateInteger(rule, &pc);
+           int right = evaluateInteger(rule, &pc);
+           if(opcode == OP_GT) return left > right;
+           if(opcode == OP_GE) return left >= right;
+           if(opcode == OP_LT) return left < right;
+           return left <= right;
+      }
+   }
+}
+
+static bool evaluateCondition(Rule *rule, const int **pc)
+{
+   int opcode = *(*pc)++;
+   switch(opcode)
+   {
+      case OP_PRED:
+           return evaluatePredicate(rule, *(*pc)++);
+
+      case OP_NOT:
+           return !evaluateCondition(rule, pc);
+
+      default:
+      {
+           /* Both operands are evaluated to move past them in the code. */
+           bool left = evaluateCondition(rule, pc);
+           bool right = evaluateCondition(rule, pc);
+           return opcode == OP_AND ? left && right : left || right;
+      }
+   }
+}
+
+static bool conditionHolds(Rule *rule)
+{
+   if(rule->condition < 0) return true;
+   const int *pc = code + rule->condition;
+   return evaluateCondition(rule, &pc);
+}
+
+/* True if a variable assigned since the given position of the morphism's
+ * assignment stack occurs in the condition. */
+static bool newPredicateVariables(Rule *rule, int first_variable)
+{
+   Morphism *morphism = rule->morphism;
+   int index;
+   for(index = first_variable; index < morphism->variable_index; index++)
+      if(rule->variable_predicates[morphism->assigned_variables[index]]) return true;
+   return false;
+}
+
+/* =============
+ * Label Matching
+ * ============= */
+
+/* Records a variable-value assignment. Returns false if the variable already
+ * has a different value, and otherwise adds the number of new assignments to
+ * the counter. */
+static bool assignAtom(Morphism *morphism, int id, HostAtom atom, int *new_assignments)
+{
+   int result;
+   if(atom.type == 'i') result = addIntegerAssignment(morphism, id, atom.num);
+   else result = addStringAssignment(morphism, id, atom.str);
+   if(result < 0) return false;
+   *new_assignments += result;
+   return true;
+}
+
+static bool assignString(Morphism *morphism, int id, string value, int *new_assignments)
+{
+   int result = addStringAssignment(morphism, id, value);
+   if(result < 0) return false;
+   *new_assignments += result;
+   return true;
+}
+
+/* Matches a concatenation of string constants and character variables around
+ * at most one string variable. The atoms before the string variable are
+ * matched from the start of the host string, those after it from the end, and
+ * the string variable is assigned whatever lies between. */
+static bool matchConcat(Rule *rule, const int *pc, string host_string, int *new_assignments)
+{
+   Morphism *morphism = rule->morphism;
+   int count = *pc++, index, string_variable = -1;
+   const int *pieces = pc;
+   for(index = 0; index < count; index++)
+      if(pieces[2 * index] == OP_VAR && rule->variable_types[pieces[2 * index + 1]] == 's')
+      {
+         string_variable = index;
+         break;
+      }
+   int start = 0, end = (int)strlen(host_string);
+   char character[2] = {'\0', '\0'};
+   int last = string_variable < 0 ? count : string_variable;
+   for(index = 0; index < last; index++)
+   {
+      int value = pieces[2 * index + 1];
+      if(pieces[2 * index] == OP_STR)
+      {
+         int length = (int)strlen(strings[value]);
+         if(end - start < length) return false;
+         if(strncmp(host_string + start, strings[value], length) != 0) return false;
+         start += length;
+      }
+      else
+      {
+         if(start >= end) return false;
+         character[0] = host_string[start++];
+         if(!assignString(morphism, value, character, new_assignments)) return false;
+      }
+   }
+   if(string_variable < 0) return start == end;
+   for(index = count - 1; index > string_variable; index--)
+   {
+      int value = pieces[2 * index + 1];
+      if(pieces[2 * index] == OP_STR)
+      {
+         int length = (int)strlen(strings[value]);
+         if(end - start < length) return false;
+         if(strncmp(host_string + end - length, strings[value], length) != 0) return false;
+         end -= length;
+      }
+      else
+      {
+         if(start >= end) return false;
+         character[0] = host_string[--end];
+         if(!assignString(morphism, value, character, new_assignments)) return false;
+      }
+   }
+   char saved = host_string[end];
+   host_string[end] = '\0';
+   bool result = assignString(morphism, pieces[2 * string_variable + 1],
+                              host_string + start, new_assignments);
+   host_string[end] = saved;
+   return result;
+}
+
+static bool matchAtom(Rule *rule, const int *pc, HostAtom atom, int *new_assignments)
+{
+   switch(pc[0])
+   {
+      case OP_INT:
+           return atom.type == 'i' && atom.num == pc[1];
+
+      case OP_STR:
+           return atom.type == 's' && strcmp(atom.str, strings[pc[1]]) == 0;
+
+      case OP_VAR:
+           switch(rule->variable_types[pc[1]])
+           {
+              case 'i':
+                   if(atom.type != 'i') return false;
+                   break;
+
+              case 'c':
+                   if(atom.type != 's' || strlen(atom.str) != 1) return false;
+                   break;
+
+              case 's':
+                   if(atom.type != 's') return false;
+                   break;
+
+              default:
+                   break;
+           }
+           return assignAtom(rule->morphism, pc[1], atom, new_assignments);
+
+      case OP_CONCAT:
+           if(atom.type != 's') return false;
+           return matchConcat(rule, pc + 1, atom.str, new_assignments);
+
+      default:
+           return false;
+   }
+}
+
+/* Matches a host label against a LHS pattern, adding any new assignments to
+ * the morphism. On failure the caller removes the assignments counted in
+ * new_assignments. */
+static bool matchLabel(Rule *rule, int pattern, HostLabel label, int *new_assignments)
+{
+   const int *pc = code + pattern;
+   int length = pc[0], list_position = pc[1];
+   const int *atoms = pc + 2;
+   HostListItem *item = label.list == NULL ? NULL : label.list->first;
+   int index;
+   if(list_position < 0)
+   {
+      if(label.length != length) return false;
+      for(index = 0; index < length; index++, item = item->next)
+         if(!matchAtom(rule, code + atoms[index], item->atom, new_assignments)) return false;
+      return true;
+   }
+   int list_variable = code[atoms[list_position] + 1];
+   Morphism *morphism = rule->morphism;
+   if(label.length < length - 1) return false;
+   for(index = 0; index < list_position; index++, item = item->next)
+      if(!matchAtom(rule, code + atoms[index], item->atom, new_assignments)) return false;
+   HostListItem *start = item;
+   item = label.list == NULL ? NULL : label.list->last;
+   for(index = length - 1; index > list_position; index--, item = item->prev)
+      if(!matchAtom(rule, code + atoms[index], item->atom, new_assignments)) return false;
+
+   /* The list variable is assigned the remaining host atoms. A single atom is
+    * assigned as an atom, so that it compares equal to atoms matched by other
+    * occurrences of the variable. */
+   int remaining = label.length - (length - 1), result;
+   if(remaining == 0) result = addListAssignment(morphism, list_variable, NULL);
+   else if(remaining == 1)
+   {
+      if(start->atom.type == 'i')
+         result = addIntegerAssignment(morphism, list_variable, start->atom.num);
+      else result = addStringAssignment(morphism, list_variable, start->atom.str);
+   }
+   else if(remaining == label.length)
+      result = addListAssignment(morphism, list_variable, label.list);
+   else
+   {
+      left_atoms.length = 0;
+      for(index = 0; index < remaining; index++, start = start->next)
+         appendAtom(&left_atoms, start->atom);
+      HostList *list = makeHostList(left_atoms.atoms, remaining, false);
+      result = addListAssignment(morphism, list_variable, list);
+      /* Drop the reference taken by makeHostList. The morphism holds its own. */
+      removeHostList(list);
+   }
+   if(result < 0) return false;
+   *new_assignments += result;
+   return true;
+}
+
+/* ========
+ * Matching
+ * ======== */
+static bool matchOperation(Rule *rule, int position, Edge *host_edge);
+
+static bool nodeCandidate(Operation *op, Node *node)
+{
+   if(node->matched) return false;
+   if(op->root && !node->root) return false;
+   if(op->mark == ANY) { if(node->label.mark == NONE) return false; }
+   else if(node->label.mark != op->mark) return false;
+   if(node->indegree < op->indegree || node->outdegree < op->outdegree) return false;
+   int excess = node->outdegree + node->indegree - op->outdegree - op->indegree - op->bidegree;
+   return op->dangling ? excess == 0 : excess >= 0;
+}
+
+static bool edgeCandidate(Operation *op, Edge *edge)
+{
+   if(edge->matched) return false;
+   if(op->mark == ANY) return edge->label.mark != NONE;
+   return edge->label.mark == op->mark;
+}
+
+static bool tryNode(Rule *rule, int position, Node *node)
+{
+   Operation *op = &(rule->plan[position]);
+   Morphism *morphism = rule->morphism;
+   int first_variable = morphism->variable_index, new_assignments = 0;
+   if(!matchLabel(rule, op->pattern, node->label, &new_assignments))
+   {
+      removeAssignments(morphism, new_assignments);
+      return false;
+   }
+   addNodeMap(morphism, op->index, node->index, new_assignments);
+   node->matched = true;
+   bool check = op->has_predicates || newPredicateVariables(rule, first_variable);
+   if((!check || conditionHolds(rule)) && matchOperation(rule, position + 1, NULL))
+      return true;
+   removeNodeMap(morphism, op->index);
+   node->matched = false;
+   return false;
+}
+
+static bool tryEdge(Rule *rule, int position, Edge *edge)
+{
+   Operation *op = &(rule->plan[position]);
+   Morphism *morphism = rule->morphism;
+   int first_variable = morphism->variable_index, new_assignments = 0;
+   if(!matchLabel(rule, op->pattern, edge->label, &new_assignments))
+   {
+      removeAssignments(morphism, new_assignments);
+      return false;
+   }
+   addEdgeMap(morphism, op->index, edge->index, new_assignments);
+   edge->matched = true;
+   bool check = newPredicateVariables(rule, first_variable);
+   if((!check || conditionHolds(rule)) && matchOperation(rule, position + 1, edge))
+      return true;
+   removeEdgeMap(morphism, op->index);
+   edge->matched = false;
+   return false;
+}
+
+/* Tries the incident edges of a matched node: out-edges if outgoing is set,
+ * in-edges otherwise. end_index is the image of the LHS edge's other end, or
+ * -1 if that node is unmatched. */
+static bool tryIncidentEdges(Rule *rule, int position, Node *node, bool outgoing,
+                             int end_index)
+{
+   Operation *op = &(rule->plan[position]);
+   int size = outgoing ? node->out_edges.size : node->in_edges.size, counter;
+   for(counter = 0; counter < size + 2; counter++)
+   {
+      Edge *edge = outgoing ? getNthOutEdge(host, node, counter)
+                            : getNthInEdge(host, node, counter);
+      if(edge == NULL || edge->source == edge->target) continue;
+      if(!edgeCandidate(op, edge)) continue;
+      int end = outgoing ? edge->target : edge->source;
+      if(end_index >= 0) { if(end != end_index) continue; }
+      else if(getNode(host, end)->matched) continue;
+      if(tryEdge(rule, position, edge)) return true;
+   }
+   return false;
+}
+
+static bool matchOperation(Rule *rule, int position, Edge *host_edge)
+{
+   if(position == rule->plan_length) return conditionHolds(rule);
+   Operation *op = &(rule->plan[position]);
+   Morphism *morphism = rule->morphism;
+   switch(op->type)
+   {
+      case 'n':
+      {
+           int index;
+           for(index = 0; index < host->nodes.size; index++)
+           {
+              Node *node = getNode(host, index);
+              if(node == NULL || node->index == -1) continue;
+              if(nodeCandidate(op, node) && tryNode(rule, position, node)) return true;
+           }
+           return false;
+      }
+      case 'r':
+      {
+           RootNodes *nodes;
+           for(nodes = getRootNodeList(host); nodes != NULL; nodes = nodes->next)
+           {
+              Node *node = getNode(host, nodes->index);
+              if(node == NULL) continue;
+              if(nodeCandidate(op, node) && tryNode(rule, position, node)) return true;
+           }
+           return false;
+      }
+      case 'i':
+      case 'o':
+      case 'b':
+      {
+           Node *node = op->type == 'o' ? getSource(host, host_edge)
+                                        : getTarget(host, host_edge);
+           if(nodeCandidate(op, node) && tryNode(rule, position, node)) return true;
+           if(op->type != 'b' || host_edge->source == host_edge->target) return false;
+           /* A bidirectional edge may have been matched in either direction. */
+           node = getSource(host, host_edge);
+           return nodeCandidate(op, node) && tryNode(rule, position, node);
+      }
+      case 'e':
+      {
+           int source = lookupNode(morphism, op->source);
+           int target = lookupNode(morphism, op->target);
+           int index;
+           for(index = 0; index < host->edges.size; index++)
+           {
+              Edge *edge = getEdge(host, index);
+              if(edge == NULL || edge->index == -1) continue;
+              if(!edgeCandidate(op, edge)) continue;
+              if(source >= 0 && edge->source != source) continue;
+              if(target >= 0 && edge->target != target) continue;
+              if(tryEdge(rule, position, edge)) return true;
+           }
+           return false;
+      }
+      case 's':
+      case 't':
+      {
+           bool from_source = op->type == 's';
+           int start = lookupNode(morphism, from_source ? op->source : op->target);
+           int end = lookupNode(morphism, from_source ? op->target : op->source);
+           if(start < 0) return false;
+           Node *node = getNode(host, start);
+           if(tryIncidentEdges(rule, position, node, from_source, end)) return true;
+           if(!op->bidirectional) return false;
+           return tryIncidentEdges(rule, position, node, !from_source, end);
+      }
+      case 'l':
+      {
+           int node_index = lookupNode(morphism, op->source);
+           if(node_index < 0) return false;
+           Node *node = getNode(host, node_index);
+           int counter;
+           for(counter = 0; counter < node->out_edges.size + 2; counter++)
+           {
+              Edge *edge = getNthOutEdge(host, node, counter);
+              if(edge == NULL || edge->source != edge->target) continue;
+              if(edgeCandidate(op, edge) && tryEdge(rule, position, edge)) return true;
+           }
+           return false;
+      }
+      default:
+           return false;
+   }
+}
+
+static bool matchRule(Rule *rule)
+{
+   if(rule->lhs_nodes > host->number_of_nodes ||
+      rule->lhs_edges > host->number_of_edges) return false;
+   if(matchOperation(rule, 0, NULL)) return true;
+   initialiseMorphism(rule->morphism, host);
+   return false;
+}
+
+/* ================
+ * Rule Application
+ * ================ */
+static void applyRule(Rule *rule, bool record_changes)
+{
+   Morphism *morphism = rule->morphism;
+   int index;
+   for(index = 0; index < rule->lhs_nodes; index++)
+   {
+      int host_index = lookupNode(morphism, index);
+      rule->indegrees[index] = getIndegree(host, host_index);
+      rule->outdegrees[index] = getOutdegree(host, host_index);
+   }
+   applying = true;
+   const int *pc = code + rule->apply;
+   while(*pc != OP_END)
+   {
+      int opcode = *pc++;
+      switch(opcode)
+      {
+         case OP_DELE:
+         {
+              int host_index = lookupEdge(morphism, *pc++);
+              if(record_changes)
+              {
+                 Edge *edge = getEdge(host, host_index);
+                 pushRemovedEdge(edge->label, edge->source, edge->target, edge->index,
+                                 edge->index < host->edges.size - 1);
+              }
+              removeEdge(host, host_index);
+              break;
+         }
+         case OP_RELE:
+         {
+              int host_index = lookupEdge(morphism, *pc++);
+              HostLabel old_label = getEdgeLabel(host, host_index);
+              HostLabel label = evaluateLabel(rule, &pc, old_label.mark);
+              if(equalHostLabels(old_label, label)) removeHostList(label.list);
+              else
+              {
+                 if(record_changes) pushRelabelledEdge(host_index, old_label);
+                 relabelEdge(host, host_index, label);
+              }
+              break;
+         }
+         case OP_REME:
+         {
+              int host_index = lookupEdge(morphism, pc[0]);
+              MarkType mark = pc[1];
+              pc += 2;
+              if(mark == ANY) break;
+              if(record_changes)
+                 pushRemarkedEdge(host_index, getEdgeLabel(host, host_index).mark);
+              changeEdgeMark(host, host_index, mark);
+              break;
+         }
+         case OP_DELN:
+         {
+              int host_index = lookupNode(morphism, *pc++);
+              if(record_changes)
+              {
+                 Node *node = getNode(host, host_index);
+                 pushRemovedNode(node->root, node->label, node->index,
+                                 node->index < host->nodes.size - 1);
+              }
+              removeNode(host, host_index);
+              break;
+         }
+         case OP_RELN:
+         {
+              int host_index = lookupNode(morphism, *pc++);
+              HostLabel old_label = getNodeLabel(host, host_index);
+              HostLabel label = evaluateLabel(rule, &pc, old_label.mark);
+              if(equalHostLabels(old_label, label)) removeHostList(label.list);
+              else
+              {
+                 if(record_changes) pushRelabelledNode(host_index, old_label);
+                 relabelNode(host, host_index, label);
+              }
+              break;
+         }
+         case OP_REMN:
+         {
+              int host_index = lookupNode(morphism, pc[0]);
+              MarkType mark = pc[1];
+              pc += 2;
+              if(mark == ANY) break;
+              if(record_changes)
+                 pushRemarkedNode(host_index, getNodeLabel(host, host_index).mark);
+              changeNodeMark(host, host_index, mark);
+              break;
+         }
+         case OP_ROOT:
+         case OP_UNROOT:
+         {
+              int host_index = lookupNode(morphism, *pc++);
+              if(opcode == OP_ROOT && getNode(host, host_index)->root) break;
+              if(record_changes) pushChangedRootNode(host_index);
+              changeRoot(host, host_index);
+              break;
+         }
+         case OP_ADDN:
+         {
+              int rhs_index = pc[0];
+              bool root = pc[1];
+              pc += 2;
+              HostLabel label = evaluateLabel(rule, &pc, NONE);
+              int size = host->nodes.size;
+              int host_index = addNode(host, root, label);
+              rule->rhs_node_map[rhs_index] = host_index;
+              /* If the node array did not grow, the node filled a hole. */
+              if(record_changes) pushAddedNode(host_index, size == host->nodes.size);
+              break;
+         }
+         case OP_ADDE:
+         {
+              int source = pc[0] ? lookupNode(morphism, pc[1]) : rule->rhs_node_map[pc[1]];
+              int target = pc[2] ? lookupNode(morphism, pc[3]) : rule->rhs_node_map[pc[3]];
+              pc += 4;
+              HostLabel label = evaluateLabel(rule, &pc, NONE);
+              int size = host->edges.size;
+              int host_index = addEdge(host, label, source, target);
+              if(record_changes) pushAddedEdge(host_index, size == host->edges.size);
+              break;
+         }
+         default:
+              print_to_log("Error (applyRule): Unexpected opcode %d.\n", opcode);
+              exit(1);
+      }
+   }
+   applying = false;
+   initialiseMorphism(morphism, host);
+}
+
+/* =================
+ * Program Execution
+ * ================= */
+
+/* The number of enclosing branch conditions and loop bodies that record graph
+ * changes. Rule applications are recorded when it is positive. */
+static int restore_depth = 0;
+/* Set inside the condition of an if statement without a restore point: the
+ * rules in the condition are matched but not applied. */
+static bool match_only = false;
+/* The rule whose failure ended the program, or NULL for the fail statement. */
+static string failed_rule = NULL;
+
+static int restorePoint(void)
+{
+   return graph_change_stack == NULL ? 0 : topOfGraphChangeStack();
+}
+
+/* Changes made after a restore point are kept. They are discarded from the
+ * change stack unless an enclosing construct may still need to undo them. */
+static void keepChanges(int restore_point)
+{
+   if(restore_depth == 0) discardChanges(restore_point);
+}
+
+static bool callRule(Rule *rule)
+{
+   if(rule->lhs_nodes == 0)
+   {
+      if(!match_only && !rule->is_predicate && conditionHolds(rule))
+         applyRule(rule, restore_depth > 0);
+      return true;
+   }
+   if(!matchRule(rule)) return false;
+   if(match_only || rule->is_predicate) initialiseMorphism(rule->morphism, host);
+   else applyRule(rule, restore_depth > 0);
+   return true;
+}
+
+static Result execute(Command *command)
+{
+   int index;
+   switch(command->type)
+   {
+      case SEQUENCE:
+           for(index = 0; index < command->count; index++)
+           {
+              Result result = execute(command->commands[index]);
+              if(result != SUCCESS) return result;
+           }
+           return SUCCESS;
+
+      case RULE_CALL:
+      case RULE_SET_CALL:
+           for(index = 0; index < command->count; index++)
+              if(callRule(command->rules[index])) return SUCCESS;
+           failed_rule = command->rules[command->count - 1]->name;
+           return FAILURE;
+
+      case IF_STATEMENT:
+      case TRY_STATEMENT:
+      {
+           bool old_match_only = match_only;
+           int restore_point = 0;
+           if(command->restore)
+           {
+              restore_point = restorePoint();
+              restore_depth++;
+              match_only = false;
+           }
+           else if(command->type == IF_STATEMENT) match_only = true;
+           Result result = execute(command->commands[0]);
+           if(command->restore) restore_depth--;
+           match_only = old_match_only;
+
+           if(command->restore)
+           {
+              if(command->type == IF_STATEMENT || result == FAILURE)
+                 undoChanges(host, restore_point);
+              else keepChanges(restore_point);
+           }
+           if(result == BREAK) return BREAK;
+           if(result == SUCCESS) return execute(command->commands[1]);
+           else return execute(command->commands[2]);
+      }
+      case LOOP_STATEMENT:
+           while(true)
+           {
+              int restore_point = 0;
+              if(command->restore)
+              {
+                 restore_point = restorePoint();
+                 restore_depth++;
+              }
+              Result result = execute(command->commands[0]);
+              if(command->restore)
+              {
+                 restore_depth--;
+                 if(result == FAILURE) undoChanges(host, restore_point);
+                 else keepChanges(restore_point);
+              }
+              if(result != SUCCESS) return SUCCESS;
+           }
+
+      case OR_STATEMENT:
+           return execute(command->commands[rand() % 2]);
+
+      case SKIP_STATEMENT:
+           return SUCCESS;
+
+      case FAIL_STATEMENT:
+           failed_rule = NULL;
+           return FAILURE;
+
+      case BREAK_STATEMENT:
+           return BREAK;
+   }
+   return FAILURE;
+}
+
+/* ===================
+ * Host Graph Loading
+ * =================== */
+
+/* Largest integer directly following a '(' outside of strings and comments.
+ * This bounds the node IDs in a host graph file, which the parser uses as
+ * indices into node_map. The file is rewound afterwards. */
+static int maxNodeID(FILE *file)
+{
+   int c, max = 0;
+   bool in_string = false, after_paren = false;
+   while((c = fgetc(file)) != EOF)
+   {
+      if(in_string)
+      {
+         if(c == '"') in_string = false;
+         continue;
+      }
+      if(c == '"')
+      {
+         in_string = true;
+         after_paren = false;
+      }
+      else if(c == '/')
+      {
+         int next = fgetc(file);
+         if(next == '/') while(next != '\n' && next != EOF) next = fgetc(file);
+         else if(next != EOF) ungetc(next, file);
+         after_paren = false;
+      }
+      else if(c == '(') after_paren = true;
+      else if(after_paren && isdigit(c))
+      {
+         long id = 0;
+         while(c != EOF && isdigit(c))
+         {
+            if(id <= INT_MAX) id = 10 * id + (c - '0');
+            c = fgetc(file);
+         }
+         if(c != EOF) ungetc(c, file);
+         if(id > INT_MAX - 1) id = INT_MAX - 1;
+         if(id > max) max = (int)id;
+         after_paren = false;
+      }
+      else if(!isspace(c)) after_paren = false;
+   }
+   rewind(file);
+   return max;
+}
+
+static Graph *buildHostGraph(string host_file)
+{
+   yyin = fopen(host_file, "r");
+   if(yyin == NULL)
+   {
+      perror(host_file);
+      return NULL;
+   }
+   int max_id = maxNodeID(yyin);
+   node_map = calloc((size_t)max_id + 1, sizeof(int));
+   if(node_map == NULL)
+   {
+      print_to_log("Error (buildHostGraph): malloc failure.\n");
+      fclose(yyin);
+      return NULL;
+   }
+   host = newGraph(max_nodes, max_edges);
+   yyrestart(yyin);
+   int result = yyparse();
+   free(node_map);
+   node_map = NULL;
+   fclose(yyin);
+   yyin = NULL;
+   if(result == 0) return host;
+   else
+   {
+      freeGraph(host);
+      return NULL;
+   }
+}
+
+static void garbageCollect(void)
+{
+   int index;
+   printMemoryUsage(log_file);
+   freeGraph(host);
+   for(index = 0; index < rule_count; index++) freeMorphism(rules[index].morphism);
+   freeHostListStore();
+   freeGraphChangeStack();
+   closeLogFile();
+}
+
+int main(int argc, char **argv)
+{
+   srand(time(NULL));
+   startMemoryAccounting();
+   openLogFile("gp2.log");
+   if(argc != 3)
+   {
+      fprintf(stderr, "Usage: gp2vm <bytecode_file> <host_file>\n");
+      return 0;
+   }
+   loadBytecode(argv[1]);
+   host = buildHostGraph(argv[2]);
+   if(host == NULL)
+   {
+      fprintf(stderr, "Error parsing host graph file.\n");
+      return 0;
+   }
+   FILE *output_file = fopen("gp2.output", "w");
+   if(output_file == NULL)
+   {
+      perror("gp2.output");
+      exit(1);
+   }
+   if(execute(main_program) == FAILURE)
+   {
+      if(failed_rule != NULL)
+         fprintf(output_file, "No output graph: rule %s not applicable.\n", failed_rule);
+      else fprintf(output_file, "No output graph: Fail statement invoked\n");
+      printf("Output information saved to file gp2.output\n");
+   }
+   else
+   {
+      printGraph(host, output_file);
+      printf("Output graph saved to file gp2.output\n");
+   }
+   garbageCollect();
+   fclose(output_file);
+   return 0;
+}
@@ -0,0 +1,701 @@
+/* ////////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ==============================
+  Host Graph Isomorphism Checker
+  ==============================
+
+  Usage: gp2iso <graph1> <graph2>
+
+  Reads two host graph files with the host graph parser and reports whether
+  the graphs are isomorphic. Exits with 0 if they are, 1 if they are not, and
+  2 if either file cannot be parsed. Node and edge IDs may also be written as
+  n<number> and e<number>, as in the output of the OILR engine.
+
+  The graphs are first coloured by colour refinement, run jointly over both
+  graphs so that colours are comparable. A node's initial colour combines its
+  label, mark, root flag and degrees; each round adds the labels and colours of
+  its neighbours. Graphs with different colour histograms are rejected at this
+  point. Otherwise a VF2-style backtracking search maps the nodes of the first
+  graph in breadth-first order, trying only unmapped nodes of the same colour
+  adjacent to the image of an already mapped neighbour, and checking the edges
+  to mapped nodes at every step.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#include "common.h"
+#include "debug.h"
+#include "graph.h"
+#include "label.h"
+#include "parser.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Labels are compared by their list pointers. This is only sound when every
+ * distinct list is stored exactly once. */
+#ifndef LIST_HASHING
+#error "The isomorphism checker requires LIST_HASHING."
+#endif
+
+/* Refinement stops when a round does not split any colour class, or after this
+ * many rounds. Further rounds only prune the search, so the cap bounds the
+ * refinement cost on long paths and grids. */
+#define MAX_REFINEMENT_ROUNDS 16
+
+/* Globals expected by the host graph parser. */
+Graph *host = NULL;
+int *node_map = NULL;
+
+extern void yyrestart(FILE *input_file);
+
+/* A compact copy of a host graph. Nodes are numbered contiguously and the
+ * incident edges of node v occupy the positions out_start[v] to
+ * out_start[v+1] - 1 (resp. in_start) of the edge arrays, which record the
+ * node at the other end of the edge and the edge's label key. */
+typedef struct IsoGraph {
+   int nodes, edges;
+   int *out_start, *out_node;
+   int *in_start, *in_node;
+   uintptr_t *out_label, *in_label;
+   uint64_t *colour;
+} IsoGraph;
+
+typedef struct ColouredNode {
+   uint64_t colour;
+   int node;
+} ColouredNode;
+
+typedef struct LabelledEnd {
+   int node;
+   uintptr_t label;
+} LabelledEnd;
+
+/* Largest integer directly following a '(' outside of strings and comments.
+ * This bounds the node IDs in a host graph file, which the parser uses as
+ * indices into node_map. The file is rewound afterwards. */
+static int maxNodeID(FILE *file)
+{
+   int c, max = 0;
+   bool in_string = false, after_paren = false;
+   while((c = fgetc(file)) != EOF)
+   {
+      if(in_string)
+      {
+         if(c == '"') in_string = false;
+         continue;
+      }
+      if(c == '"')
+      {
+         in_string = true;
+         after_paren = false;
+      }
+      else if(c == '/')
+      {
+         int next = fgetc(file);
+         if(next == '/') while(next != '\n' && next != EOF) next = fgetc(file);
+         else if(next != EOF) ungetc(next, file);
+         after_paren = false;
+      }
+      else if(c == '(') after_paren = true;
+      else if(after_paren && isdigit(c))
+      {
+         long id = 0;
+         while(c != EOF && isdigit(c))
+         {
+            if(id <= INT_MAX) id = 10 * id + (c - '0');
+            c = fgetc(file);
+         }
+         if(c != EOF) ungetc(c, file);
+         if(id > INT_MAX - 1) id = INT_MAX - 1;
+         if(id > max) max = (int)id;
+         after_paren = false;
+      }
+      else if(!isspace(c)) after_paren = false;
+   }
+   rewind(file);
+   return max;
+}
+
+/* The OILR engine writes node and edge IDs as n<number> and e<number>. This
+ * copies the file to a temporary file with those prefixes removed, so that
+ * the host graph parser accepts both formats. A prefix is only removed
+ * directly after a '(' or ',' outside of strings and comments, where a host
+ * graph cannot contain a letter. The original file is closed. */
+static FILE *removeIDPrefixes(FILE *file)
+{
+   FILE *copy = tmpfile();
+   if(copy == NULL)
+   {
+      perror("tmpfile");
+      fclose(file);
+      return NULL;
+   }
+   int c;
+   bool in_string = false, id_position = false;
+   while((c = fgetc(file)) != EOF)
+   {
+      if(in_string)
+      {
+         if(c == '"') in_string = false;
+         fputc(c, copy);
+         continue;
+      }
+      if(id_position && (c == 'n' || c == 'e'))
+      {
+         int next = fgetc(file);
+         if(next != EOF) ungetc(next, file);
+         id_position = false;
+         if(isdigit(next)) continue;
+      }
+      else if(c == '"') in_string = true;
+      else if(c == '/')
+      {
+         int next = fgetc(file);
+         if(next == '/')
+         {
+            fputc(c, copy);
+            while(next != '\n' && next != EOF)
+            {
+               fputc(next, copy);
+               next = fgetc(file);
+            }
+            c = next;
+            if(c == EOF) break;
+         }
+         else if(next != EOF) ungetc(next, file);
+      }
+      if(c == '(' || c == ',') id_position = true;
+      else if(!isspace(c)) id_position = false;
+      fputc(c, copy);
+   }
+   fclose(file);
+   rewind(copy);
+   return copy;
+}
+
+static Graph *readHostGraph(string host_file)
+{
+   FILE *file = fopen(host_file, "r");
+   if(file == NULL)
+   {
+      perror(host_file);
+      return NULL;
+   }
+   yyin = removeIDPrefixes(file);
+   if(yyin == NULL) return NULL;
+   int max_id = maxNodeID(yyin);
+   node_map = calloc((size_t)max_id + 1, sizeof(int));
+   if(node_map == NULL)
+   {
+      fprintf(stderr, "Error (readHostGraph): malloc failure.\n");
+      fclose(yyin);
+      return NULL;
+   }
+   host = newGraph(128, 128);
+   yyrestart(yyin);
+   int result = yyparse();
+   free(node_map);
+   node_map = NULL;
+   fclose(yyin);
+   yyin = NULL;
+   if(result == 0) return host;
+   else
+   {
+      freeGraph(host);
+      return NULL;
+   }
+}
+
+static void *checkedMalloc(size_t size)
+{
+   void *pointer = malloc(size > 0 ? size : 1);
+   if(pointer == NULL)
+   {
+      fprintf(stderr, "Error (isoChecker): malloc failure.\n");
+      exit(2);
+   }
+   return pointer;
+}
+
+/* Stateless 64-bit mixing function (the splitmix64 finaliser). */
+static uint64_t mix(uint64_t x)
+{
+   x += 0x9e3779b97f4a7c15ULL;
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+   return x ^ (x >> 31);
+}
+
+/* Lists are 8-byte aligned, which leaves the low bits free for the mark. Two
+ * labels are equal if and only if their keys are equal. */
+static uintptr_t labelKey(HostLabel label)
+{
+   assert(((uintptr_t)label.list & 7) == 0);
+   return (uintptr_t)label.list | (uintptr_t)label.mark;
+}
+
+static void makeIsoGraph(Graph *graph, IsoGraph *iso)
+{
+   int index, node_count = 0;
+   /* Maps graph indices to contiguous node numbers, skipping holes. */
+   int *number = checkedMalloc(graph->nodes.size * sizeof(int));
+   for(index = 0; index < graph->nodes.size; index++)
+   {
+      if(graph->nodes.items[index].index == -1) number[index] = -1;
+      else number[index] = node_count++;
+   }
+   iso->nodes = node_count;
+   iso->edges = graph->number_of_edges;
+   iso->out_start = calloc(node_count + 1, sizeof(int));
+   iso->in_start = calloc(node_count + 1, sizeof(int));
+   if(iso->out_start == NULL || iso->in_start == NULL)
+   {
+      fprintf(stderr, "Error (makeIsoGraph): malloc failure.\n");
+      exit(2);
+   }
+   iso->out_node = checkedMalloc(iso->edges * sizeof(int));
+   iso->in_node = checkedMalloc(iso->edges * sizeof(int));
+   iso->out_label = checkedMalloc(iso->edges * sizeof(uintptr_t));
+   iso->in_label = checkedMalloc(iso->edges * sizeof(uintptr_t));
+   iso->colour = checkedMalloc(node_count * sizeof(uint64_t));
+
+   for(index = 0; index < graph->edges.size; index++)
+   {
+      Edge *edge = getEdge(graph, index);
+      if(edge->index == -1) continue;
+      iso->out_start[number[edge->source] + 1]++;
+      iso->in_start[number[edge->target] + 1]++;
+   }
+   int node;
+   for(node = 0; node < node_count; node++)
+   {
+      iso->out_start[node + 1] += iso->out_start[node];
+      iso->in_start[node + 1] += iso->in_start[node];
+   }
+   int *out_fill = checkedMalloc(node_count * sizeof(int));
+   int *in_fill = checkedMalloc(node_count * sizeof(int));
+   memcpy(out_fill, iso->out_start, node_count * sizeof(int));
+   memcpy(in_fill, iso->in_start, node_count * sizeof(int));
+   for(index = 0; index < graph->edges.size; index++)
+   {
+      Edge *edge = getEdge(graph, index);
+      if(edge->index == -1) continue;
+      int source = number[edge->source], target = number[edge->target];
+      uintptr_t key = labelKey(edge->label);
+      iso->out_node[out_fill[source]] = target;
+      iso->out_label[out_fill[source]++] = key;
+      iso->in_node[in_fill[target]] = source;
+      iso->in_label[in_fill[target]++] = key;
+   }
+   free(out_fill);
+   free(in_fill);
+
+   for(index = 0; index < graph->nodes.size; index++)
+   {
+      if(number[index] == -1) continue;
+      Node *host_node = getNode(graph, index);
+      uint64_t colour = mix(labelKey(host_node->label) ^ (host_node->root ? 1ULL << 63 : 0));
+      colour = mix(colour ^ (uint64_t)host_node->outdegree);
+      colour = mix(colour ^ ((uint64_t)host_node->indegree << 32));
+      iso->colour[number[index]] = colour;
+   }
+   free(number);
+}
+
+static void freeIsoGraph(IsoGraph *iso)
+{
+   free(iso->out_start);
+   free(iso->out_node);
+   free(iso->out_label);
+   free(iso->in_start);
+   free(iso->in_node);
+   free(iso->in_label);
+   free(iso->colour);
+}
+
+/* Recolours every node from its colour and the multiset of (edge label,
+ * neighbour colour) pairs on its outgoing and incoming edges. The pairs are
+ * combined by addition so that no sorting is needed. Hash collisions can only
+ * merge colour classes, which weakens pruning but not the final answer, since
+ * the search checks every edge exactly. */
+static void refineColours(IsoGraph *iso, uint64_t *next)
+{
+   int node, edge;
+   for(node = 0; node < iso->nodes; node++)
+   {
+      uint64_t out = 0, in = 0;
+      for(edge = iso->out_start[node]; edge < iso->out_start[node + 1]; edge++)
+         out += mix((uint64_t)iso->out_label[edge] * 31 + iso->colour[iso->out_node[edge]]);
+      for(edge = iso->in_start[node]; edge < iso->in_start[node + 1]; edge++)
+         in += mix((uint64_t)iso->in_label[edge] * 37 + iso->colour[iso->in_node[edge]]);
+      next[node] = mix(iso->colour[node] ^ mix(out) ^ mix(in ^ 0x5bd1e995ULL));
+   }
+}
+
+static int compareColours(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+   return (x > y) - (x < y);
+}
+
+static int compareColouredNodes(const void *a, const void *b)
+{
+   const ColouredNode *x = a, *y = b;
+   if(x->colour != y->colour) return (x->colour > y->colour) - (x->colour < y->colour);
+   return x->node - y->node;
+}
+
+static int compareLabelledEnds(const void *a, const void *b)
+{
+   const LabelledEnd *x = a, *y = b;
+   if(x->node != y->node) return x->node - y->node;
+   return (x->label > y->label) - (x->label < y->label);
+}
+
+/* Writes the sorted colours of both graphs to buffer and returns the number
+ * of distinct colours. */
+static int countColourClasses(IsoGraph *iso1, IsoGraph *iso2, uint64_t *buffer)
+{
+   memcpy(buffer, iso1->colour, iso1->nodes * sizeof(uint64_t));
+   memcpy(buffer + iso1->nodes, iso2->colour, iso2->nodes * sizeof(uint64_t));
+   int total = iso1->nodes + iso2->nodes, index, classes = 0;
+   qsort(buffer, total, sizeof(uint64_t), compareColours);
+   for(index = 0; index < total; index++)
+      if(index == 0 || buffer[index] != buffer[index - 1]) classes++;
+   return classes;
+}
+
+static void refine(IsoGraph *iso1, IsoGraph *iso2)
+{
+   uint64_t *next1 = checkedMalloc(iso1->nodes * sizeof(uint64_t));
+   uint64_t *next2 = checkedMalloc(iso2->nodes * sizeof(uint64_t));
+   uint64_t *buffer = checkedMalloc((iso1->nodes + iso2->nodes) * sizeof(uint64_t));
+   int classes = countColourClasses(iso1, iso2, buffer), round;
+   for(round = 0; round < MAX_REFINEMENT_ROUNDS; round++)
+   {
+      refineColours(iso1, next1);
+      refineColours(iso2, next2);
+      uint64_t *swap = iso1->colour; iso1->colour = next1; next1 = swap;
+      swap = iso2->colour; iso2->colour = next2; next2 = swap;
+      int new_classes = countColourClasses(iso1, iso2, buffer);
+      if(new_classes == classes) break;
+      classes = new_classes;
+   }
+   free(next1);
+   free(next2);
+   free(buffer);
+}
+
+static bool sameColourHistogram(IsoGraph *iso1, IsoGraph *iso2)
+{
+   int nodes = iso1->nodes;
+   uint64_t *sorted1 = checkedMalloc(nodes * sizeof(uint64_t));
+   uint64_t *sorted2 = checkedMalloc(nodes * sizeof(uint64_t));
+   memcpy(sorted1, iso1->colour, nodes * sizeof(uint64_t));
+   memcpy(sorted2, iso2->colour, nodes * sizeof(uint64_t));
+   qsort(sorted1, nodes, sizeof(uint64_t), compareColours);
+   qsort(sorted2, nodes, sizeof(uint64_t), compareColours);
+   bool same = memcmp(sorted1, sorted2, nodes * sizeof(uint64_t)) == 0;
+   free(sorted1);
+   free(sorted2);
+   return same;
+}
+
+/* State of the backtracking search. map12 and map21 hold the partial
+ * isomorphism and its inverse (-1 if unmapped). The nodes of the first graph
+ * are mapped in the order given by order; parent[v] is a neighbour of v mapped
+ * before it, or -1 if v starts a new connected component. by_colour lists the
+ * nodes of the second graph sorted by colour; class_start[v] and class_end[v]
+ * delimit the nodes with the colour of v. */
+typedef struct Search {
+   IsoGraph *iso1, *iso2;
+   int *map12, *map21;
+   int *order, *parent;
+   ColouredNode *by_colour;
+   int *class_start, *class_end;
+   LabelledEnd *ends1, *ends2;
+} Search;
+
+/* The nth candidate image for node, or -1 if there are no more. */
+static int candidate(Search *search, int node, int n)
+{
+   int parent = search->parent[node];
+   if(parent == -1)
+   {
+      int position = search->class_start[node] + n;
+      return position < search->class_end[node] ? search->by_colour[position].node : -1;
+   }
+   IsoGraph *iso2 = search->iso2;
+   int image = search->map12[parent];
+   int outdegree = iso2->out_start[image + 1] - iso2->out_start[image];
+   if(n < outdegree) return iso2->out_node[iso2->out_start[image] + n];
+   n -= outdegree;
+   if(n < iso2->in_start[image + 1] - iso2->in_start[image])
+      return iso2->in_node[iso2->in_start[image] + n];
+   return -1;
+}
+
+/* Checks that the edges between node1 and the mapped nodes of the first graph
+ * (including loops on node1) correspond exactly to the edges between node2 and
+ * their images, assuming node1 is mapped to node2. Called once for outgoing
+ * and once for incoming edges. */
+static bool sameMappedEnds(Search *search, int node1, int node2,
+                           int *start1, int *end_node1, uintptr_t *label1,
+                           int *start2, int *end_node2, uintptr_t *label2)
+{
+   int count1 = 0, count2 = 0, edge;
+   for(edge = start1[node1]; edge < start1[node1 + 1]; edge++)
+   {
+      int end = end_node1[edge];
+      int image = end == node1 ? node2 : search->map12[end];
+      if(image == -1) continue;
+      search->ends1[count1].node = image;
+      search->ends1[count1++].label = label1[edge];
+   }
+   for(edge = start2[node2]; edge < start2[node2 + 1]; edge++)
+   {
+      int end = end_node2[edge];
+      if(end != node2 && search->map21[end] == -1) continue;
+      search->ends2[count2].node = end;
+      search->ends2[count2++].label = label2[edge];
+   }
+   if(count1 != count2) return false;
+   if(count1 == 0) return true;
+   if(count1 > 1)
+   {
+      qsort(search->ends1, count1, sizeof(LabelledEnd), compareLabelledEnds);
+      qsort(search->ends2, count2, sizeof(LabelledEnd), compareLabelledEnds);
+   }
+   int index;
+   for(index = 0; index < count1; index++)
+      if(search->ends1[index].node != search->ends2[index].node ||
+         search->ends1[index].label != search->ends2[index].label) return false;
+   return true;
+}
+
+static bool feasible(Search *search, int node1, int node2)
+{
+   IsoGraph *iso1 = search->iso1, *iso2 = search->iso2;
+   if(search->map21[node2] != -1) return false;
+   if(iso1->colour[node1] != iso2->colour[node2]) return false;
+   return sameMappedEnds(search, node1, node2,
+                         iso1->out_start, iso1->out_node, iso1->out_label,
+                         iso2->out_start, iso2->out_node, iso2->out_label) &&
+          sameMappedEnds(search, node1, node2,
+                         iso1->in_start, iso1->in_node, iso1->in_label,
+                         iso2->in_start, iso2->in_node, iso2->in_label);
+}
+
+/* Computes the matching order: components of the first graph are entered at
+ * their node with the smallest colour class and traversed breadth-first
+ * (ignoring edge direction), so that every later node has a mapped parent. */
+static void orderNodes(Search *search, ColouredNode *seeds)
+{
+   IsoGraph *iso1 = search->iso1;
+   int nodes = iso1->nodes, head = 0, tail = 0, index, edge;
+   bool *visited = calloc(nodes, sizeof(bool));
+   if(visited == NULL && nodes > 0)
+   {
+      fprintf(stderr, "Error (orderNodes): malloc failure.\n");
+      exit(2);
+   }
+   for(index = 0; index < nodes; index++)
+   {
+      int seed = seeds[index].node;
+      if(visited[seed]) continue;
+      visited[seed] = true;
+      search->parent[seed] = -1;
+      search->order[tail++] = seed;
+      while(head < tail)
+      {
+         int node = search->order[head++];
+         for(edge = iso1->out_start[node]; edge < iso1->out_start[node + 1]; edge++)
+         {
+            int next = iso1->out_node[edge];
+            if(visited[next]) continue;
+            visited[next] = true;
+            search->parent[next] = node;
+            search->order[tail++] = next;
+         }
+         for(edge = iso1->in_start[node]; edge < iso1->in_start[node + 1]; edge++)
+         {
+            int next = iso1->in_node[edge];
+            if(visited[next]) continue;
+            visited[next] = true;
+            search->parent[next] = node;
+            search->order[tail++] = next;
+         }
+      }
+   }
+   free(visited);
+}
+
+static bool findIsomorphism(IsoGraph *iso1, IsoGraph *iso2)
+{
+   int nodes = iso1->nodes, index, max_degree = 0;
+   if(nodes == 0) return true;
+   Search search;
+   search.iso1 = iso1;
+   search.iso2 = iso2;
+   search.map12 = checkedMalloc(nodes * sizeof(int));
+   search.map21 = checkedMalloc(nodes * sizeof(int));
+   search.order = checkedMalloc(nodes * sizeof(int));
+   search.parent = checkedMalloc(nodes * sizeof(int));
+   search.by_colour = checkedMalloc(nodes * sizeof(ColouredNode));
+   search.class_start = checkedMalloc(nodes * sizeof(int));
+   search.class_end = checkedMalloc(nodes * sizeof(int));
+   for(index = 0; index < nodes; index++)
+   {
+      search.map12[index] = -1;
+      search.map21[index] = -1;
+      search.by_colour[index].colour = iso2->colour[index];
+      search.by_colour[index].node = index;
+      /* Colour collisions may pair nodes of different degrees, so the edge
+       * buffers are sized for both graphs. */
+      int degrees[4] = {iso1->out_start[index + 1] - iso1->out_start[index],
+                        iso1->in_start[index + 1] - iso1->in_start[index],
+                        iso2->out_start[index + 1] - iso2->out_start[index],
+                        iso2->in_start[index + 1] - iso2->in_start[index]};
+      int degree;
+      for(degree = 0; degree < 4; degree++)
+         if(degrees[degree] > max_degree) max_degree = degrees[degree];
+   }
+   qsort(search.by_colour, nodes, sizeof(ColouredNode), compareColouredNodes);
+   search.ends1 = checkedMalloc(max_degree * sizeof(LabelledEnd));
+   search.ends2 = checkedMalloc(max_degree * sizeof(LabelledEnd));
+
+   /* Locate each first-graph node's colour class among the second graph's
+    * nodes, and use the class sizes to choose component entry points. */
+   ColouredNode *seeds = checkedMalloc(nodes * sizeof(ColouredNode));
+   for(index = 0; index < nodes; index++)
+   {
+      uint64_t colour = iso1->colour[index];
+      int low = 0, high = nodes;
+      while(low < high)
+      {
+         int middle = low + (high - low) / 2;
+         if(search.by_colour[middle].colour < colour) low = middle + 1;
+         else high = middle;
+      }
+      search.class_start[index] = low;
+      high = nodes;
+      while(low < high)
+      {
+         int middle = low + (high - low) / 2;
+         if(search.by_colour[middle].colour <= colour) low = middle + 1;
+         else high = middle;
+      }
+      search.class_end[index] = low;
+      seeds[index].colour = (uint64_t)(search.class_end[index] - search.class_start[index]);
+      seeds[index].node = index;
+   }
+   qsort(seeds, nodes, sizeof(ColouredNode), compareColouredNodes);
+   orderNodes(&search, seeds);
+   free(seeds);
+
+   /* Iterative backtracking: cursor[depth] is the number of candidates tried
+    * for the node at that depth. */
+   int *cursor = checkedMalloc(nodes * sizeof(int));
+   int depth = 0;
+   cursor[0] = 0;
+   while(depth >= 0 && depth < nodes)
+   {
+      int node = search.order[depth];
+      if(search.map12[node] != -1)
+      {
+         search.map21[search.map12[node]] = -1;
+         search.map12[node] = -1;
+      }
+      bool mapped = false;
+      int image;
+      while((image = candidate(&search, node, cursor[depth]++)) != -1)
+      {
+         if(!feasible(&search, node, image)) continue;
+         search.map12[node] = image;
+         search.map21[image] = node;
+         mapped = true;
+         break;
+      }
+      if(mapped)
+      {
+         depth++;
+         if(depth < nodes) cursor[depth] = 0;
+      }
+      else depth--;
+   }
+   free(cursor);
+   free(search.map12);
+   free(search.map21);
+   free(search.order);
+   free(search.parent);
+   free(search.by_colour);
+   free(search.class_start);
+   free(search.class_end);
+   free(search.ends1);
+   free(search.ends2);
+   return depth == nodes;
+}
+
+static bool isomorphic(Graph *graph1, Graph *graph2)
+{
+   if(graph1->number_of_nodes != graph2->number_of_nodes) return false;
+   if(graph1->number_of_edges != graph2->number_of_edges) return false;
+   IsoGraph iso1, iso2;
+   makeIsoGraph(graph1, &iso1);
+   makeIsoGraph(graph2, &iso2);
+   refine(&iso1, &iso2);
+   bool result = sameColourHistogram(&iso1, &iso2) && findIsomorphism(&iso1, &iso2);
+   freeIsoGraph(&iso1);
+   freeIsoGraph(&iso2);
+   return result;
+}
+
+int main(int argc, char **argv)
+{
+   if(argc != 3)
+   {
+      fprintf(stderr, "Usage: gp2iso <graph1> <graph2>\n");
+      return 2;
+   }
+   /* The parser reports lexical errors to the log file. */
+   log_file = stderr;
+   Graph *graph1 = readHostGraph(argv[1]);
+   if(graph1 == NULL)
+   {
+      fprintf(stderr, "Error parsing host graph file %s.\n", argv[1]);
+      return 2;
+   }
+   Graph *graph2 = readHostGraph(argv[2]);
+   if(graph2 == NULL)
+   {
+      fprintf(stderr, "Error parsing host graph file %s.\n", argv[2]);
+      freeGraph(graph1);
+      return 2;
+   }
+   bool result = isomorphic(graph1, graph2);
+   printf("%s: %s and %s\n", result ? "ISOMORPHIC" : "NON-ISOMORPHIC", argv[1], argv[2]);
+   freeGraph(graph1);
+   freeGraph(graph2);
+   freeHostListStore();
+   return result ? 0 : 1;
+}
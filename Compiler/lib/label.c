@@ -14,9 +14,31 @@
   along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
 
 #include "label.h"
+#include "memoryAccounting.h"
+#include "probes.h"
 
 HostLabel blank_label = {NONE, 0, NULL};
 
+bool list_store_shared = false;
+
+#ifdef LIST_HASHING
+/* A spinlock: the list store is held only briefly, by searches that assign
+ * list variables. */
+static int list_store_lock = 0;
+
+static void lockListStore(void)
+{
+   if(!list_store_shared) return;
+   while(__atomic_exchange_n(&list_store_lock, 1, __ATOMIC_ACQUIRE))
+      while(__atomic_load_n(&list_store_lock, __ATOMIC_RELAXED)) continue;
+}
+
+static void unlockListStore(void)
+{
+   if(list_store_shared) __atomic_store_n(&list_store_lock, 0, __ATOMIC_RELEASE);
+}
+#endif
+
 #ifdef LIST_HASHING
 Bucket **list_store = NULL;
 
@@ -44,7 +66,7 @@ static unsigned hashHostList(HostAtom *list, int length)
 
 static HostList *appendHostAtom(HostList *list, HostAtom atom, bool free_strings)
 {
-   HostListItem *new_item = malloc(sizeof(HostListItem));
+   HostListItem *new_item = allocateSizedMemory(MEMORY_LISTS, sizeof(HostListItem));
    if(new_item == NULL)
    {
       print_to_log("Error (appendAtom): malloc failure.\n");
@@ -55,13 +77,14 @@ static HostList *appendHostAtom(HostList *list, HostAtom atom, bool free_strings
    {
       if(free_strings) new_item->atom.str = atom.str;
       else new_item->atom.str = strdup(atom.str);
+      countMemory(MEMORY_LISTS, strlen(atom.str) + 1);
    }
    new_item->next = NULL;
 
    if(list == NULL)
    {
       new_item->prev = NULL;
-      HostList *new_list = malloc(sizeof(HostList));
+      HostList *new_list = allocateSizedMemory(MEMORY_LISTS, sizeof(HostList));
       if(new_list == NULL)
       {
          print_to_log("Error (appendAtom): malloc failure.\n");
@@ -86,12 +109,13 @@ static HostList *appendHostAtom(HostList *list, HostAtom atom, bool free_strings
  * point the bucket to that list. */
 static Bucket *makeBucket(HostAtom *array, int length, bool free_strings)
 {
-   Bucket *bucket = malloc(sizeof(Bucket));
+   Bucket *bucket = allocateSizedMemory(MEMORY_LISTS, sizeof(Bucket));
    if(bucket == NULL)
    {
       print_to_log("Error (makeBucket): malloc failure.\n");
       exit(1);
    }
+   GP2_PROBE1(list_create, length);
    HostList *list = NULL;
    int index;
    for(index = 0; index < length; index++) 
@@ -117,9 +141,10 @@ static Bucket *makeBucket(HostAtom *array, int length, bool free_strings)
 HostList *makeHostList(HostAtom *array, int length, bool free_strings)
 {
    #ifdef LIST_HASHING
+      lockListStore();
       if(list_store == NULL)
       {
-         list_store = calloc(LIST_TABLE_SIZE, sizeof(Bucket*));
+         list_store = allocateZeroedMemory(MEMORY_LISTS, LIST_TABLE_SIZE, sizeof(Bucket*));
          if(list_store == NULL)
          {
             print_to_log("Error(addListToStore): malloc failure.\n");
@@ -132,6 +157,7 @@ HostList *makeHostList(HostAtom *array, int length, bool free_strings)
          Bucket *bucket = makeBucket(array, length, free_strings);
          list_store[hash] = bucket;
          bucket->list->hash = hash;
+         unlockListStore();
          return bucket->list;
       }
       /* Check each list in the bucket for equality with the list represented
@@ -183,6 +209,7 @@ HostList *makeHostList(HostAtom *array, int length, bool free_strings)
             bucket->next = new_bucket;
             new_bucket->prev = bucket;
             new_bucket->list->hash = hash;
+            unlockListStore();
             return new_bucket->list;
          }
          else 
@@ -193,10 +220,12 @@ HostList *makeHostList(HostAtom *array, int length, bool free_strings)
                for(index = 0; index < length; index++) 
                   if(array[index].type == 's') free(array[index].str);
             }
+            unlockListStore();
             return bucket->list;
          }
       }
    #else
+      GP2_PROBE1(list_create, length);
       HostList *list = NULL;
       int index;
       for(index = 0; index < length; index++) 
@@ -222,10 +251,12 @@ static Bucket *getBucket(HostList *list)
 void addHostList(HostList *list)
 {
    if(list == NULL) return;
+   lockListStore();
    Bucket *bucket = getBucket(list); 
    /* The passed list is expected to exist in the host table. */
    assert(bucket != NULL);
    bucket->reference_count++;
+   unlockListStore();
 }
 #endif
 
@@ -233,6 +264,7 @@ void removeHostList(HostList *list)
 {
    if(list == NULL) return;
    #ifdef LIST_HASHING
+      lockListStore();
       Bucket *bucket = getBucket(list); 
       /* The passed list is expected to exist in the host table. */
       assert(bucket != NULL);
@@ -244,8 +276,9 @@ void removeHostList(HostList *list)
          else bucket->prev->next = bucket->next;
          if(bucket->next != NULL) bucket->next->prev = bucket->prev;
          freeHostList(list);
-         free(bucket);
+         freeSizedMemory(MEMORY_LISTS, bucket, sizeof(Bucket));
       }
+      unlockListStore();
    #else
       freeHostList(list);
    #endif
@@ -263,14 +296,6 @@ HostLabel makeHostLabel(MarkType mark, int length, HostList *list)
    return label;
 }
 
-bool equalHostLabels(HostLabel label1, HostLabel label2)
-{
-   if(label1.mark != label2.mark) return false;
-   if(label1.length != label2.length) return false;
-   if(label1.list != label2.list) return false;
-   return true;
-}
-
 bool equalHostLists(HostAtom *left_list, HostAtom *right_list,
                     int left_length, int right_length)
 { 
@@ -329,16 +354,20 @@ void printHostList(HostListItem *item, FILE *file)
 static void freeHostListItems(HostListItem *item)
 {
    if(item == NULL) return;
-   if(item->atom.type == 's') free(item->atom.str);
+   if(item->atom.type == 's')
+   {
+      countMemory(MEMORY_LISTS, -(long)(strlen(item->atom.str) + 1));
+      free(item->atom.str);
+   }
    freeHostListItems(item->next);
-   free(item);
+   freeSizedMemory(MEMORY_LISTS, item, sizeof(HostListItem));
 }
 
 void freeHostList(HostList *list)
 {
    if(list == NULL) return;
    freeHostListItems(list->first);
-   free(list);
+   freeSizedMemory(MEMORY_LISTS, list, sizeof(HostList));
 }
 
 
@@ -348,7 +377,7 @@ static void freeBuckets(Bucket *bucket)
    if(bucket == NULL) return; 
    freeHostList(bucket->list);
    freeBuckets(bucket->next);
-   free(bucket);
+   freeSizedMemory(MEMORY_LISTS, bucket, sizeof(Bucket));
 }
 
 void freeHostListStore(void)
@@ -356,6 +385,6 @@ void freeHostListStore(void)
    if(list_store == NULL) return;
    int index;
    for(index = 0; index < LIST_TABLE_SIZE; index++) freeBuckets(list_store[index]);
-   free(list_store);
+   freeMemory(list_store);
 }
 #endif
@@ -83,6 +83,10 @@ typedef struct Bucket {
  * exactly once and has a single point of reference. */
 extern Bucket **list_store;
 
+/* Set while several threads may use the list store at once (see ruleSet.h).
+ * The functions below then serialise their access to the hash table. */
+extern bool list_store_shared;
+
 /* If list hashing is enabled, makeHostList returns a pointer to the HostList represented 
  * by the passed array from the hash table (list_store). If not, the function returns a
  * pointer to a newly-allocated HostList. */
@@ -101,7 +105,13 @@ HostLabel makeHostLabel(MarkType mark, int length, HostList *list);
 
 /* Used to determine whether a node or edge needs relabelling, and to evaluate
  * the edge predicate if a label argument is provided. */
-bool equalHostLabels(HostLabel label1, HostLabel label2);
+static inline bool equalHostLabels(HostLabel label1, HostLabel label2)
+{
+   if(label1.mark != label2.mark) return false;
+   if(label1.length != label2.length) return false;
+   if(label1.list != label2.list) return false;
+   return true;
+}
 /* Used to evaluate list comparison predicates. */
 bool equalHostLists(HostAtom *left_list, HostAtom *right_list,
                     int left_length, int right_length);
@@ -0,0 +1,268 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "memoryAccounting.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The header keeps blocks 16-byte aligned, which is enough for every type the
+ * library stores in them. */
+typedef struct BlockHeader {
+   _Alignas(16) size_t size;
+   MemoryCategory category;
+} BlockHeader;
+
+_Static_assert(sizeof(BlockHeader) == MEMORY_HEADER_SIZE,
+               "MEMORY_HEADER_SIZE does not match the block header");
+
+static const char *category_names[MEMORY_CATEGORIES] =
+   {"nodes", "edges", "incidence arrays", "host lists", "change stack",
+    "graph copies", "morphisms"};
+
+/* The counters are updated atomically, as rule set threads allocate
+ * morphisms and labels concurrently. Index MEMORY_CATEGORIES holds the
+ * total. */
+static size_t live_bytes[MEMORY_CATEGORIES + 1];
+static size_t peak_bytes[MEMORY_CATEGORIES + 1];
+static size_t memory_budget = 0;
+static bool graph_copy = false;
+
+static void raisePeak(int index, size_t live)
+{
+   size_t peak = __atomic_load_n(&peak_bytes[index], __ATOMIC_RELAXED);
+   while(live > peak &&
+         !__atomic_compare_exchange_n(&peak_bytes[index], &peak, live, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static void addBytes(MemoryCategory category, size_t bytes)
+{
+   raisePeak(category, __atomic_add_fetch(&live_bytes[category], bytes, __ATOMIC_RELAXED));
+   raisePeak(MEMORY_CATEGORIES,
+             __atomic_add_fetch(&live_bytes[MEMORY_CATEGORIES], bytes, __ATOMIC_RELAXED));
+}
+
+static void subtractBytes(MemoryCategory category, size_t bytes)
+{
+   __atomic_sub_fetch(&live_bytes[category], bytes, __ATOMIC_RELAXED);
+   __atomic_sub_fetch(&live_bytes[MEMORY_CATEGORIES], bytes, __ATOMIC_RELAXED);
+}
+
+static MemoryCategory blockCategory(MemoryCategory category)
+{
+   if(graph_copy && (category == MEMORY_NODES || category == MEMORY_EDGES ||
+                     category == MEMORY_INCIDENCE))
+      return MEMORY_GRAPH_COPIES;
+   return category;
+}
+
+/* Appends the text or the decimal number to the buffer. Used instead of
+ * snprintf so that the SIGUSR1 handler is async-signal-safe. */
+static size_t appendText(char *buffer, size_t length, size_t size, const char *text)
+{
+   while(*text != '\0' && length + 1 < size) buffer[length++] = *text++;
+   buffer[length] = '\0';
+   return length;
+}
+
+static size_t appendNumber(char *buffer, size_t length, size_t size, size_t number)
+{
+   char digits[24];
+   int count = 0;
+   do
+   {
+      digits[count++] = '0' + number % 10;
+      number /= 10;
+   } while(number > 0);
+   while(count > 0 && length + 1 < size) buffer[length++] = digits[--count];
+   buffer[length] = '\0';
+   return length;
+}
+
+static size_t formatMemoryUsage(char *buffer, size_t size)
+{
+   size_t length = appendText(buffer, 0, size, "Memory usage (live bytes, peak bytes):\n");
+   int index;
+   for(index = 0; index <= MEMORY_CATEGORIES; index++)
+   {
+      length = appendText(buffer, length, size, "  ");
+      length = appendText(buffer, length, size,
+                          index < MEMORY_CATEGORIES ? category_names[index] : "total");
+      length = appendText(buffer, length, size, ": ");
+      length = appendNumber(buffer, length, size,
+                            __atomic_load_n(&live_bytes[index], __ATOMIC_RELAXED));
+      length = appendText(buffer, length, size, ", ");
+      length = appendNumber(buffer, length, size,
+                            __atomic_load_n(&peak_bytes[index], __ATOMIC_RELAXED));
+      length = appendText(buffer, length, size, "\n");
+   }
+   if(memory_budget > 0)
+   {
+      length = appendText(buffer, length, size, "  budget: ");
+      length = appendNumber(buffer, length, size, memory_budget);
+      length = appendText(buffer, length, size, "\n");
+   }
+   return length;
+}
+
+static bool withinBudget(MemoryCategory category, size_t new_bytes, size_t old_bytes)
+{
+   if(memory_budget == 0 || new_bytes <= old_bytes) return true;
+   size_t live = __atomic_load_n(&live_bytes[MEMORY_CATEGORIES], __ATOMIC_RELAXED);
+   if(live + new_bytes - old_bytes <= memory_budget) return true;
+   fprintf(stderr, "Error: allocating %zu bytes of %s exceeds the memory budget of "
+           "%zu bytes.\n", new_bytes, category_names[category], memory_budget);
+   printMemoryUsage(stderr);
+   return false;
+}
+
+void *allocateMemory(MemoryCategory category, size_t size)
+{
+   category = blockCategory(category);
+   if(!withinBudget(category, size, 0)) return NULL;
+   BlockHeader *header = malloc(sizeof(BlockHeader) + size);
+   if(header == NULL) return NULL;
+   header->size = size;
+   header->category = category;
+   addBytes(category, size);
+   return header + 1;
+}
+
+void *allocateZeroedMemory(MemoryCategory category, size_t count, size_t size)
+{
+   if(size > 0 && count > ((size_t)-1 - sizeof(BlockHeader)) / size) return NULL;
+   void *pointer = allocateMemory(category, count * size);
+   if(pointer != NULL) memset(pointer, 0, count * size);
+   return pointer;
+}
+
+void *reallocateMemory(MemoryCategory category, void *pointer, size_t size)
+{
+   if(pointer == NULL) return allocateMemory(category, size);
+   BlockHeader *header = (BlockHeader *)pointer - 1;
+   category = header->category;
+   size_t old_size = header->size;
+   if(!withinBudget(category, size, old_size)) return NULL;
+   header = realloc(header, sizeof(BlockHeader) + size);
+   if(header == NULL) return NULL;
+   header->size = size;
+   if(size > old_size) addBytes(category, size - old_size);
+   else subtractBytes(category, old_size - size);
+   return header + 1;
+}
+
+void freeMemory(void *pointer)
+{
+   if(pointer == NULL) return;
+   BlockHeader *header = (BlockHeader *)pointer - 1;
+   subtractBytes(header->category, header->size);
+   free(header);
+}
+
+void *allocateSizedMemory(MemoryCategory category, size_t size)
+{
+   if(!withinBudget(category, size, 0)) return NULL;
+   void *pointer = malloc(size);
+   if(pointer != NULL) addBytes(category, size);
+   return pointer;
+}
+
+void freeSizedMemory(MemoryCategory category, void *pointer, size_t size)
+{
+   if(pointer == NULL) return;
+   subtractBytes(category, size);
+   free(pointer);
+}
+
+void countMemory(MemoryCategory category, long bytes)
+{
+   if(bytes >= 0) addBytes(category, bytes);
+   else subtractBytes(category, -bytes);
+}
+
+void countAsGraphCopy(bool copying)
+{
+   graph_copy = copying;
+}
+
+MemoryUsage getMemoryUsage(MemoryCategory category)
+{
+   MemoryUsage usage = {__atomic_load_n(&live_bytes[category], __ATOMIC_RELAXED),
+                        __atomic_load_n(&peak_bytes[category], __ATOMIC_RELAXED)};
+   return usage;
+}
+
+MemoryUsage getTotalMemoryUsage(void)
+{
+   return getMemoryUsage(MEMORY_CATEGORIES);
+}
+
+void setMemoryBudget(size_t bytes)
+{
+   memory_budget = bytes;
+}
+
+static void memorySignal(int signal)
+{
+   (void)signal;
+   char buffer[1024];
+   size_t length = formatMemoryUsage(buffer, sizeof(buffer));
+   ssize_t result = write(STDERR_FILENO, buffer, length);
+   (void)result;
+}
+
+void startMemoryAccounting(void)
+{
+   string budget = getenv("GP2_MEMORY_BUDGET");
+   if(budget != NULL && budget[0] != '\0')
+   {
+      char *end;
+      errno = 0;
+      unsigned long long bytes = strtoull(budget, &end, 10);
+      bool valid = isdigit((unsigned char)budget[0]) && errno != ERANGE;
+      int shift = 0;
+      if(valid)
+      {
+         if(*end == 'K' || *end == 'k') shift = 10;
+         else if(*end == 'M' || *end == 'm') shift = 20;
+         else if(*end == 'G' || *end == 'g') shift = 30;
+      }
+      if(shift > 0) end++;
+      /* The budget must fit in a size_t once the suffix is applied. */
+      if(*end != '\0' || bytes > SIZE_MAX >> shift) valid = false;
+      if(!valid)
+         fprintf(stderr, "Warning: ignoring invalid GP2_MEMORY_BUDGET \"%s\".\n", budget);
+      else setMemoryBudget(bytes << shift);
+   }
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = memorySignal;
+   sigemptyset(&action.sa_mask);
+   action.sa_flags = SA_RESTART;
+   sigaction(SIGUSR1, &action, NULL);
+}
+
+void printMemoryUsage(FILE *file)
+{
+   char buffer[1024];
+   formatMemoryUsage(buffer, sizeof(buffer));
+   fputs(buffer, file);
+}
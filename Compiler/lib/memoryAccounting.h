@@ -0,0 +1,106 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ========================
+  Memory Accounting Module
+  ========================
+
+  Accounting of the memory allocated by the library for host graphs, labels,
+  the graph change stack, graph copies and morphisms. The library allocates
+  this memory with the functions below, which keep the live and peak byte
+  counts of each category.
+
+  Each block starts with a MEMORY_HEADER_SIZE (16) byte header that records
+  its size and category, so a block is freed with freeMemory whatever its
+  category. The header is not counted in the byte counts. The small blocks of
+  the host list store (list items, lists and buckets) are allocated without a
+  header by allocateSizedMemory, as they are the most numerous and their size
+  and category are known where they are freed. Memory allocated by these
+  functions must not be passed to free or realloc, and vice versa.
+
+  A memory budget can be set with the environment variable GP2_MEMORY_BUDGET,
+  in bytes with an optional K, M or G suffix. An allocation that would exceed
+  the budget writes the memory usage to stderr and fails, and the library
+  exits through its usual malloc failure path. Programs that call
+  startMemoryAccounting also write the memory usage to stderr when they
+  receive SIGUSR1.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_MEMORY_ACCOUNTING_H
+#define INC_MEMORY_ACCOUNTING_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define MEMORY_HEADER_SIZE 16
+
+typedef enum {MEMORY_NODES = 0, MEMORY_EDGES, MEMORY_INCIDENCE, MEMORY_LISTS,
+              MEMORY_CHANGE_STACK, MEMORY_GRAPH_COPIES, MEMORY_MORPHISMS,
+              MEMORY_CATEGORIES} MemoryCategory;
+
+/* MEMORY_NODES: node arrays, node holes, node columns and root node lists.
+ * MEMORY_EDGES: edge arrays and edge holes.
+ * MEMORY_INCIDENCE: the incident edge arrays of nodes.
+ * MEMORY_LISTS: the list store, its buckets, host lists and their items and
+ *               strings.
+ * MEMORY_CHANGE_STACK: the graph change stack.
+ * MEMORY_GRAPH_COPIES: the graph stack and everything allocated by copyGraph.
+ * MEMORY_MORPHISMS: morphisms and their variable assignments. */
+
+typedef struct MemoryUsage {
+   size_t live;
+   size_t peak;
+} MemoryUsage;
+
+/* Return NULL if malloc fails or the memory budget would be exceeded. */
+void *allocateMemory(MemoryCategory category, size_t size);
+void *allocateZeroedMemory(MemoryCategory category, size_t count, size_t size);
+/* A block keeps its category. The category is used if pointer is NULL. */
+void *reallocateMemory(MemoryCategory category, void *pointer, size_t size);
+void freeMemory(void *pointer);
+
+/* Blocks without a header, freed with the category and size they were
+ * allocated with. They are not counted as graph copies by countAsGraphCopy. */
+void *allocateSizedMemory(MemoryCategory category, size_t size);
+void freeSizedMemory(MemoryCategory category, void *pointer, size_t size);
+
+/* Counts memory that was not allocated by this module, such as strings
+ * allocated by the host graph parser, in the category. bytes is negative when
+ * the memory is freed. */
+void countMemory(MemoryCategory category, long bytes);
+
+/* While set, the blocks of the node, edge and incidence categories are
+ * counted as graph copies. Set by copyGraph. */
+void countAsGraphCopy(bool copying);
+
+MemoryUsage getMemoryUsage(MemoryCategory category);
+MemoryUsage getTotalMemoryUsage(void);
+
+/* A budget of 0 means no budget. */
+void setMemoryBudget(size_t bytes);
+
+/* Reads GP2_MEMORY_BUDGET and installs the SIGUSR1 handler. */
+void startMemoryAccounting(void);
+
+/* Writes the live and peak bytes of each category and in total. */
+void printMemoryUsage(FILE *file);
+
+#endif /* INC_MEMORY_ACCOUNTING_H */
@@ -14,10 +14,11 @@
   along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
 
 #include "morphism.h"
+#include "memoryAccounting.h"
 
 Morphism *makeMorphism(int nodes, int edges, int variables)
 {
-   Morphism *morphism = malloc(sizeof(Morphism));
+   Morphism *morphism = allocateMemory(MEMORY_MORPHISMS, sizeof(Morphism));
    if(morphism == NULL)
    {
       print_to_log("Error (makeMorphism): malloc failure.\n");
@@ -26,7 +27,7 @@ Morphism *makeMorphism(int nodes, int edges, int variables)
    morphism->nodes = nodes;
    if(nodes > 0) 
    {
-      morphism->node_map = calloc(nodes, sizeof(Map));
+      morphism->node_map = allocateZeroedMemory(MEMORY_MORPHISMS, nodes, sizeof(Map));
       if(morphism->node_map == NULL)
       {
          print_to_log("Error (makeMorphism): malloc failure.\n");
@@ -38,7 +39,7 @@ Morphism *makeMorphism(int nodes, int edges, int variables)
    morphism->edges = edges;
    if(edges > 0) 
    {
-      morphism->edge_map = calloc(edges, sizeof(Map));
+      morphism->edge_map = allocateZeroedMemory(MEMORY_MORPHISMS, edges, sizeof(Map));
       if(morphism->edge_map == NULL)
       {
          print_to_log("Error (makeMorphism): malloc failure.\n");
@@ -51,13 +52,15 @@ Morphism *makeMorphism(int nodes, int edges, int variables)
    morphism->variable_index = 0;
    if(variables > 0) 
    {
-      morphism->assignment = calloc(variables, sizeof(Assignment));
+      morphism->assignment = allocateZeroedMemory(MEMORY_MORPHISMS, variables,
+                                                  sizeof(Assignment));
       if(morphism->assignment == NULL)
       {
          print_to_log("Error (makeMorphism): malloc failure.\n");
          exit(1);
       }
-      morphism->assigned_variables = calloc(variables, sizeof(int));
+      morphism->assigned_variables = allocateZeroedMemory(MEMORY_MORPHISMS, variables,
+                                                          sizeof(int));
       if(morphism->assigned_variables == NULL)
       {
          print_to_log("Error (makeMorphism): malloc failure.\n");
@@ -108,20 +111,6 @@ void initialiseMorphism(Morphism *morphism, Graph *graph)
    }
 }
 
-void addNodeMap(Morphism *morphism, int left_index, int host_index, int assignments)
-{
-   assert(left_index < morphism->nodes);
-   morphism->node_map[left_index].host_index = host_index;
-   morphism->node_map[left_index].assignments = assignments;
-}
-
-void addEdgeMap(Morphism *morphism, int left_index, int host_index, int assignments)
-{
-   assert(left_index < morphism->edges);
-   morphism->edge_map[left_index].host_index = host_index;
-   morphism->edge_map[left_index].assignments = assignments;
-}
-
 int addListAssignment(Morphism *morphism, int id, HostList *list) 
 {
    /* Search the morphism for an existing assignment to the passed variable. */
@@ -228,16 +217,6 @@ int popVariableId(Morphism *morphism)
    return morphism->assigned_variables[morphism->variable_index];
 }
 
-int lookupNode(Morphism *morphism, int left_index)
-{
-   return morphism->node_map[left_index].host_index;
-}
-
-int lookupEdge(Morphism *morphism, int left_index)
-{
-   return morphism->edge_map[left_index].host_index;
-}
-
 int getIntegerValue(Morphism *morphism, int id)
 {
    assert(id < morphism->variables);
@@ -341,8 +320,8 @@ void printMorphism(Morphism *morphism)
 void freeMorphism(Morphism *morphism)
 {
    if(morphism == NULL) return;
-   if(morphism->node_map != NULL) free(morphism->node_map);
-   if(morphism->edge_map != NULL) free(morphism->edge_map);
+   if(morphism->node_map != NULL) freeMemory(morphism->node_map);
+   if(morphism->edge_map != NULL) freeMemory(morphism->edge_map);
    if(morphism->assignment != NULL)
    {
       int index;
@@ -355,9 +334,9 @@ void freeMorphism(Morphism *morphism)
                removeHostList(morphism->assignment[index].list);
          #endif
       }
-      free(morphism->assignment);
+      freeMemory(morphism->assignment);
    }
-   if(morphism->assigned_variables != NULL) free(morphism->assigned_variables);
-   free(morphism);
+   if(morphism->assigned_variables != NULL) freeMemory(morphism->assigned_variables);
+   freeMemory(morphism);
 }
 
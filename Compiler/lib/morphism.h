@@ -84,9 +84,7 @@ Morphism *makeMorphism(int nodes, int edges, int variables);
  * The host graph is passed as an optional second argument to reset the matched flags
  * of all host graph items matched by the morphism. */
 void initialiseMorphism(Morphism *morphism, Graph *graph);
-void addNodeMap(Morphism *morphism, int left_index, int host_index, int assignments);
 void removeNodeMap(Morphism *morphism, int left_index);
-void addEdgeMap(Morphism *morphism, int left_index, int host_index, int assignments);
 void removeEdgeMap(Morphism *morphism, int left_index);
 
 /* Tests a potential variable-value assignment against the assignments in the
@@ -106,8 +104,50 @@ void removeAssignments(Morphism *morphism, int number);
 void pushVariableId(Morphism *morphism, int id);
 int popVariableId(Morphism *morphism);
 
-int lookupNode(Morphism *morphism, int left_index);
-int lookupEdge(Morphism *morphism, int left_index);
+/* Return true if the host item is the image of an item already matched by the
+ * morphism. Matching code in parallel rule set mode (see ruleSet.h) uses these
+ * tests of injectivity instead of the matched flags of the shared host graph. */
+static inline bool nodeMatched(Morphism *morphism, int host_index)
+{
+   int index;
+   for(index = 0; index < morphism->nodes; index++)
+      if(morphism->node_map[index].host_index == host_index) return true;
+   return false;
+}
+
+static inline bool edgeMatched(Morphism *morphism, int host_index)
+{
+   int index;
+   for(index = 0; index < morphism->edges; index++)
+      if(morphism->edge_map[index].host_index == host_index) return true;
+   return false;
+}
+
+static inline void addNodeMap(Morphism *morphism, int left_index, int host_index,
+                              int assignments)
+{
+   assert(left_index < morphism->nodes);
+   morphism->node_map[left_index].host_index = host_index;
+   morphism->node_map[left_index].assignments = assignments;
+}
+
+static inline void addEdgeMap(Morphism *morphism, int left_index, int host_index,
+                              int assignments)
+{
+   assert(left_index < morphism->edges);
+   morphism->edge_map[left_index].host_index = host_index;
+   morphism->edge_map[left_index].assignments = assignments;
+}
+
+static inline int lookupNode(Morphism *morphism, int left_index)
+{
+   return morphism->node_map[left_index].host_index;
+}
+
+static inline int lookupEdge(Morphism *morphism, int left_index)
+{
+   return morphism->edge_map[left_index].host_index;
+}
 
 /* These functions expect to be passed the id of a variable of the appropriate type. */
 int getIntegerValue(Morphism *morphism, int id);
@@ -0,0 +1,73 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  =============
+  Probes Module
+  =============
+
+  Static probes (USDT) in the library and in generated programs. If
+  <sys/sdt.h> is available when the code is compiled, each probe is a single
+  NOP recorded in an ELF note, which tools such as bpftrace and perf can turn
+  into a breakpoint while they are attached. Otherwise, or if GP2_NO_PROBES is
+  defined, the probes compile to nothing.
+
+  All probes belong to the provider gp2. Rule names are strings, the other
+  arguments are integers.
+
+  match_start(rule)                   Start of a call to match<rule>.
+  match_end(rule, matched)            End of the call; matched is 1 or 0.
+  apply_start(rule)                   Start of a call to apply<rule>.
+  apply_end(rule)                     End of the call.
+  undo(restore_point, changes)        undoChanges is undoing changes down to
+                                      the restore point.
+  graph_copy(nodes, edges)            copyGraph is pushing a copy of the
+                                      host graph (gp2 -c).
+  graph_revert(restore_point)         revertGraph is restoring a copy.
+  list_create(length)                 A new host list is allocated.
+  host_load_start()                   The host graph parser starts.
+  host_load_end(success, nodes, edges)
+                                      The host graph parser finished.
+  output_write_start(nodes, edges)    The output graph is written.
+  output_write_end()
+
+  Sample bpftrace scripts are in Compiler/probes.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_PROBES_H
+#define INC_PROBES_H
+
+#if !defined(GP2_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define GP2_PROBES
+#endif
+#endif
+
+#ifdef GP2_PROBES
+#define GP2_PROBE(name) DTRACE_PROBE(gp2, name)
+#define GP2_PROBE1(name, a) DTRACE_PROBE1(gp2, name, a)
+#define GP2_PROBE2(name, a, b) DTRACE_PROBE2(gp2, name, a, b)
+#define GP2_PROBE3(name, a, b, c) DTRACE_PROBE3(gp2, name, a, b, c)
+#else
+#define GP2_PROBE(name) do {} while(0)
+#define GP2_PROBE1(name, a) do {} while(0)
+#define GP2_PROBE2(name, a, b) do {} while(0)
+#define GP2_PROBE3(name, a, b, c) do {} while(0)
+#endif
+
+#endif /* INC_PROBES_H */
@@ -0,0 +1,209 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "ruleSet.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/* A rule set call as seen by one thread. The threads copy the current call
+ * under the pool lock when they join it. */
+typedef struct RuleSetCall {
+   uint32_t generation;
+   int count;
+   MatchFunction *matchers;
+   Morphism **morphisms;
+   /* matched[i] is set if the search for rule i succeeded. */
+   bool *matched;
+} RuleSetCall;
+
+static pthread_t workers[MAX_RULE_SET_WORKERS];
+/* -1 until the pool is started. */
+static int worker_count = -1;
+static bool stopping = false;
+
+/* The pool lock guards current, stopping and finished_tasks. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t call_started = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t call_finished = PTHREAD_COND_INITIALIZER;
+static RuleSetCall current = {0, 0, NULL, NULL, NULL};
+static int finished_tasks = 0;
+
+/* The generation of the current call in the high 32 bits and the index of the
+ * next unclaimed rule in the low 32 bits. Tagging the index with the generation
+ * stops a worker that wakes late from claiming rules of a later call. */
+static uint64_t next_task = 0;
+/* The index of the rule whose match was found first, or -1. */
+static int winner = -1;
+
+static bool claimTask(RuleSetCall *call, int *task)
+{
+   uint64_t ticket = __atomic_load_n(&next_task, __ATOMIC_RELAXED);
+   do
+   {
+      if((uint32_t)(ticket >> 32) != call->generation) return false;
+      if((int)(uint32_t)ticket >= call->count) return false;
+   } while(!__atomic_compare_exchange_n(&next_task, &ticket, ticket + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+   *task = (int)(uint32_t)ticket;
+   return true;
+}
+
+/* Searches for matches of the unclaimed rules of the call until none remain.
+ * Rules claimed after a match has been found are not searched. */
+static void runMatchTasks(RuleSetCall *call)
+{
+   int task, finished = 0;
+   while(claimTask(call, &task))
+   {
+      finished++;
+      MatchFunction match = call->matchers[task];
+      if(match == NULL || __atomic_load_n(&winner, __ATOMIC_ACQUIRE) >= 0) continue;
+      if(!match(call->morphisms[task])) continue;
+      call->matched[task] = true;
+      int expected = -1;
+      if(__atomic_compare_exchange_n(&winner, &expected, task, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+         __atomic_store_n(&node_scans_cancelled, true, __ATOMIC_RELAXED);
+   }
+   if(finished == 0) return;
+   pthread_mutex_lock(&pool_lock);
+   finished_tasks += finished;
+   if(finished_tasks == call->count) pthread_cond_signal(&call_finished);
+   pthread_mutex_unlock(&pool_lock);
+}
+
+static void *ruleSetWorker(void *argument)
+{
+   (void)argument;
+   pthread_mutex_lock(&pool_lock);
+   uint32_t generation = current.generation;
+   while(true)
+   {
+      while(current.generation == generation && !stopping)
+         pthread_cond_wait(&call_started, &pool_lock);
+      if(stopping) break;
+      RuleSetCall call = current;
+      generation = call.generation;
+      pthread_mutex_unlock(&pool_lock);
+      runMatchTasks(&call);
+      pthread_mutex_lock(&pool_lock);
+   }
+   pthread_mutex_unlock(&pool_lock);
+   return NULL;
+}
+
+/* A fork (see speculation.h) takes the pool lock, so that the child does not
+ * inherit it locked by a worker. The workers do not exist in the child, which
+ * matches rule sets on its own thread with fresh synchronisation objects. */
+static void lockPoolForFork(void)
+{
+   pthread_mutex_lock(&pool_lock);
+}
+
+static void unlockPoolAfterFork(void)
+{
+   pthread_mutex_unlock(&pool_lock);
+}
+
+static void resetPoolInChild(void)
+{
+   pthread_mutex_init(&pool_lock, NULL);
+   pthread_cond_init(&call_started, NULL);
+   pthread_cond_init(&call_finished, NULL);
+   worker_count = 0;
+}
+
+static void startRuleSetWorkers(void)
+{
+   static bool fork_handlers_installed = false;
+   long processors = sysconf(_SC_NPROCESSORS_ONLN);
+   worker_count = processors > 1 ? (int)processors - 1 : 0;
+   if(worker_count > MAX_RULE_SET_WORKERS) worker_count = MAX_RULE_SET_WORKERS;
+   if(worker_count > 0 && !fork_handlers_installed)
+   {
+      pthread_atfork(lockPoolForFork, unlockPoolAfterFork, resetPoolInChild);
+      fork_handlers_installed = true;
+   }
+   /* The workers block all signals, so that the SIGCHLD handler of the
+    * speculation module runs in the thread that waits for the condition. */
+   sigset_t block, old_mask;
+   sigfillset(&block);
+   pthread_sigmask(SIG_BLOCK, &block, &old_mask);
+   int index;
+   for(index = 0; index < worker_count; index++)
+   {
+      if(pthread_create(&workers[index], NULL, ruleSetWorker, NULL) != 0)
+      {
+         /* Run with the workers started so far. */
+         print_to_log("Warning (startRuleSetWorkers): could not start worker %d.\n",
+                      index);
+         worker_count = index;
+         break;
+      }
+   }
+   pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+int matchRuleSet(int count, MatchFunction *matchers, Morphism **morphisms)
+{
+   if(worker_count < 0) startRuleSetWorkers();
+   bool matched[count];
+   memset(matched, 0, sizeof(matched));
+
+   pthread_mutex_lock(&pool_lock);
+   current.generation++;
+   current.count = count;
+   current.matchers = matchers;
+   current.morphisms = morphisms;
+   current.matched = matched;
+   finished_tasks = 0;
+   winner = -1;
+   __atomic_store_n(&next_task, (uint64_t)current.generation << 32, __ATOMIC_RELAXED);
+   list_store_shared = worker_count > 0;
+   RuleSetCall call = current;
+   pthread_cond_broadcast(&call_started);
+   pthread_mutex_unlock(&pool_lock);
+
+   /* The calling thread searches alongside the workers, then waits for the
+    * searches it did not claim. */
+   runMatchTasks(&call);
+   pthread_mutex_lock(&pool_lock);
+   while(finished_tasks < count) pthread_cond_wait(&call_finished, &pool_lock);
+   list_store_shared = false;
+   pthread_mutex_unlock(&pool_lock);
+   node_scans_cancelled = false;
+
+   int index;
+   for(index = 0; index < count; index++)
+      if(matched[index] && index != winner) initialiseMorphism(morphisms[index], NULL);
+   return winner;
+}
+
+void freeRuleSetWorkers(void)
+{
+   if(worker_count <= 0) return;
+   pthread_mutex_lock(&pool_lock);
+   stopping = true;
+   pthread_cond_broadcast(&call_started);
+   pthread_mutex_unlock(&pool_lock);
+   int index;
+   for(index = 0; index < worker_count; index++) pthread_join(workers[index], NULL);
+   worker_count = -1;
+   stopping = false;
+}
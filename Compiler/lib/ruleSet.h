@@ -0,0 +1,62 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ===============
+  Rule Set Module
+  ===============
+
+  Parallel matching of the rules in a rule set call {R1, ..., Rn}. Programs
+  compiled with gp2 -t search for matches of all rules of a set at once on a
+  pool of worker threads, and apply the first match found.
+
+  The searches share the host graph, which they only read: the generated
+  matching code checks injectivity against its own morphism instead of the
+  matched flags of the host graph (see nodeMatched in morphism.h). Each rule
+  has its own morphism and condition variables, and the host list store is
+  locked while the searches run. Once a match is found, the node scans of the
+  other searches are cancelled (see graph.h) and those searches unwind.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_RULE_SET_H
+#define INC_RULE_SET_H
+
+#include "common.h"
+#include "graph.h"
+#include "morphism.h"
+
+#include <stdbool.h>
+
+/* The generated function that matches a rule. */
+typedef bool (*MatchFunction)(Morphism *morphism);
+
+/* The pool has one worker per additional processor, up to this number. With a
+ * single processor, the calling thread searches for each rule in turn. */
+#define MAX_RULE_SET_WORKERS 15
+
+/* Searches for a match of each of the count rules, matchers[i] being the
+ * matching function of rule i and morphisms[i] its morphism. A rule whose
+ * matching function is NULL is skipped. Returns the index of the rule whose
+ * match was found first, whose morphism holds the match, or -1 if no rule
+ * matches. The morphisms of the other rules are reset. The worker pool is
+ * started by the first call. */
+int matchRuleSet(int count, MatchFunction *matchers, Morphism **morphisms);
+
+/* Stops the worker pool. */
+void freeRuleSetWorkers(void);
+
+#endif /* INC_RULE_SET_H */
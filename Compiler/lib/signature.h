@@ -0,0 +1,55 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ========================
+  Neighbourhood Signatures
+  ========================
+
+  A node's signature packs sixteen 4-bit fields. The low three bits of a field
+  count incident items of one kind and the high bit is always 0:
+  Fields 0-4:   Outgoing edges marked red, green, blue, grey, dashed.
+  Fields 5-9:   Incoming edges marked red, green, blue, grey, dashed.
+  Fields 10-14: Edge ends opposite the node whose node is unmarked, red,
+                green, blue or grey. A loop counts twice.
+  Field 15:     Edge ends opposite the node whose node is a root.
+  The graph functions update the signatures of the nodes affected by each
+  change: the endpoints of an added, removed or remarked edge, and the
+  neighbours of a remarked node or a node whose root status changes.
+
+  A count of 7 is sticky: it is not decremented, so it stands for "7 or more
+  at some point". Smaller counts are exact. Hence a rule node with required
+  counts r (each at most 7) can only match a host node with signature s if
+  every field of s is at least the corresponding field of r, which is tested
+  with one subtraction:
+  (((s | SIGNATURE_GUARD) - r) & SIGNATURE_GUARD) == SIGNATURE_GUARD
+
+  The compiler includes this header to compute r from the LHS (see genRule.c)
+  and emits the test into the generated matchers. The field macros take a
+  MarkType value.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_SIGNATURE_H
+#define INC_SIGNATURE_H
+
+#define SIGNATURE_OUT_EDGE(mark) ((mark) - 1)
+#define SIGNATURE_IN_EDGE(mark) ((mark) + 4)
+#define SIGNATURE_NEIGHBOUR(mark) ((mark) + 10)
+#define SIGNATURE_ROOT_NEIGHBOUR 15
+#define SIGNATURE_GUARD 0x8888888888888888ULL
+
+#endif /* INC_SIGNATURE_H */
@@ -0,0 +1,168 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "speculation.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef struct SiteProfile {
+   int speculations;
+   int commits;
+   int aborts;
+} SiteProfile;
+
+/* Indexed by the number of the if statement. */
+static SiteProfile *sites = NULL;
+static int site_capacity = 0;
+
+volatile sig_atomic_t speculation_failed = 0;
+/* The process evaluating the condition of the speculation in progress, or -1,
+ * and its exit status, or -1 while it runs. */
+static volatile pid_t condition_pid = -1;
+static volatile sig_atomic_t condition_status = -1;
+static bool handler_installed = false;
+static long processors = 0;
+
+static SiteProfile *getSiteProfile(int site)
+{
+   if(site >= site_capacity)
+   {
+      int capacity = site_capacity == 0 ? 16 : site_capacity;
+      while(capacity <= site) capacity *= 2;
+      sites = realloc(sites, capacity * sizeof(SiteProfile));
+      if(sites == NULL)
+      {
+         print_to_log("Error (getSiteProfile): malloc failure.\n");
+         exit(1);
+      }
+      memset(sites + site_capacity, 0, (capacity - site_capacity) * sizeof(SiteProfile));
+      site_capacity = capacity;
+   }
+   return &sites[site];
+}
+
+/* The SIGCHLD handler reaps the condition process as soon as it exits, so that
+ * loops in the then branch can stop early if the condition failed. */
+static void conditionExited(int signal)
+{
+   (void)signal;
+   int saved_errno = errno;
+   int status;
+   if(condition_pid > 0 && waitpid(condition_pid, &status, WNOHANG) == condition_pid)
+   {
+      condition_status = WIFEXITED(status) ? WEXITSTATUS(status) : 255;
+      if(condition_status != CONDITION_SUCCEEDED) speculation_failed = 1;
+   }
+   errno = saved_errno;
+}
+
+int startSpeculation(int site)
+{
+   SiteProfile *profile = getSiteProfile(site);
+   if(condition_pid > 0) return -1;
+   if(processors == 0) processors = sysconf(_SC_NPROCESSORS_ONLN);
+   if(processors < 2) return -1;
+   if(profile->speculations >= SPECULATION_TRIALS && profile->aborts > profile->commits)
+      return -1;
+   if(!handler_installed)
+   {
+      struct sigaction action;
+      memset(&action, 0, sizeof(action));
+      action.sa_handler = conditionExited;
+      sigemptyset(&action.sa_mask);
+      action.sa_flags = SA_RESTART;
+      if(sigaction(SIGCHLD, &action, NULL) != 0) return -1;
+      handler_installed = true;
+   }
+   /* SIGCHLD is blocked until condition_pid is set, in case the child exits
+    * before fork returns in the parent. */
+   sigset_t block, old_mask;
+   sigemptyset(&block);
+   sigaddset(&block, SIGCHLD);
+   sigprocmask(SIG_BLOCK, &block, &old_mask);
+   pid_t pid = fork();
+   if(pid > 0)
+   {
+      condition_pid = pid;
+      condition_status = -1;
+      speculation_failed = 0;
+      profile->speculations++;
+   }
+   else if(pid < 0) print_to_log("Warning (startSpeculation): fork failed.\n");
+   sigprocmask(SIG_SETMASK, &old_mask, NULL);
+   if(pid < 0) return -1;
+   return pid;
+}
+
+void exitCondition(bool success)
+{
+   /* _exit leaves the parent's buffered output alone. */
+   _exit(success ? CONDITION_SUCCEEDED : CONDITION_FAILED);
+}
+
+bool finishSpeculation(int site, bool branch_success, bool *condition)
+{
+   sigset_t block, old_mask;
+   sigemptyset(&block);
+   sigaddset(&block, SIGCHLD);
+   sigprocmask(SIG_BLOCK, &block, &old_mask);
+   while(condition_status < 0)
+   {
+      int status;
+      pid_t result = waitpid(condition_pid, &status, 0);
+      if(result == condition_pid)
+         condition_status = WIFEXITED(status) ? WEXITSTATUS(status) : 255;
+      else if(result < 0 && errno != EINTR) condition_status = 255;
+   }
+   int status = condition_status;
+   condition_pid = -1;
+   speculation_failed = 0;
+   sigprocmask(SIG_SETMASK, &old_mask, NULL);
+   if(status != CONDITION_SUCCEEDED && status != CONDITION_FAILED)
+   {
+      print_to_log("Error (finishSpeculation): the condition process of if statement "
+                   "%d failed.\n", site);
+      exit(1);
+   }
+
+   *condition = status == CONDITION_SUCCEEDED;
+   SiteProfile *profile = getSiteProfile(site);
+   if(*condition && branch_success)
+   {
+      profile->commits++;
+      return true;
+   }
+   profile->aborts++;
+   return false;
+}
+
+void printSpeculationProfile(FILE *file)
+{
+   int site;
+   for(site = 0; site < site_capacity; site++)
+   {
+      SiteProfile *profile = &sites[site];
+      if(profile->speculations == 0) continue;
+      fprintf(file, "if statement %d: %d speculations, %d commits (%.1f%%), "
+              "%d aborts (%.1f%%)\n", site, profile->speculations, profile->commits,
+              100.0 * profile->commits / profile->speculations, profile->aborts,
+              100.0 * profile->aborts / profile->speculations);
+   }
+}
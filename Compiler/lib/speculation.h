@@ -0,0 +1,99 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ==================
+  Speculation Module
+  ==================
+
+  Speculative execution of the then branch of if statements, used by programs
+  compiled with gp2 -s. The changes made by the condition of an if statement
+  are undone before the then branch runs, so the then branch can start before
+  the condition is known. A forked child process evaluates the condition on
+  its copy-on-write view of the host graph and reports only whether it
+  succeeded, while the program runs the then branch, recording its changes.
+  The speculation is committed if the condition and the then branch succeed.
+  Otherwise it is aborted: the recorded changes are undone and the statement
+  is executed as usual, without evaluating the condition again. Only the
+  result of the condition is returned by the child, so the rule profile of
+  gp2run --profile does not count its match calls.
+
+  The generated code for if statement number <site> is:
+
+  bool committed = false;
+  int speculation = startSpeculation(<site>);
+  if(speculation > 0)
+  {
+     <then branch, recording graph changes>
+     bool condition = false;
+     committed = finishSpeculation(<site>, success, &condition);
+     <discard the changes if committed, otherwise undo them>
+     success = condition;
+  }
+  else
+  {
+     <condition>
+     if(speculation == 0) exitCondition(success);
+     <undo the changes of the condition>
+  }
+  if(success && !committed) <then branch>
+  else if(!committed) <else branch>
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_SPECULATION_H
+#define INC_SPECULATION_H
+
+#include "common.h"
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* An if statement is no longer speculated once this many speculations of it
+ * have been made and more of them were aborted than committed. */
+#define SPECULATION_TRIALS 16
+
+/* Forks the process that evaluates the condition of if statement <site>.
+ * Returns the process id of the child in the parent, 0 in the child, and -1 if
+ * the statement is not speculated: another speculation is in progress, there
+ * is only one processor, the statement's speculations are mostly aborted, or
+ * the fork failed. */
+int startSpeculation(int site);
+
+/* The exit statuses of the condition process. Any other status, such as the
+ * status 1 of the library's error exits, means the condition process failed
+ * and stops the program. */
+#define CONDITION_SUCCEEDED 0
+#define CONDITION_FAILED 3
+
+/* Called by the child with the result of the condition. Does not return. */
+void exitCondition(bool success);
+
+/* True once the condition of the speculation in progress is known to have
+ * failed. Loops in speculative then branches stop early when it is set. */
+extern volatile sig_atomic_t speculation_failed;
+
+/* Waits for the condition and sets *condition to its result. Returns true if
+ * the speculation is committed, that is, if both the condition and the then
+ * branch succeeded. */
+bool finishSpeculation(int site, bool branch_success, bool *condition);
+
+/* Writes a line for each speculated if statement with the number of
+ * speculations, commits and aborts. */
+void printSpeculationProfile(FILE *file);
+
+#endif /* INC_SPECULATION_H */
@@ -0,0 +1,313 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+
+typedef struct TraceBuffer {
+   TraceRecord records[TRACE_CHUNKS][TRACE_CHUNK_RECORDS];
+   /* filled[i] is the number of records of chunk i waiting to be written, and
+    * 0 while the chunk belongs to the thread. */
+   int filled[TRACE_CHUNKS];
+   /* The chunk being filled by the thread, and the next record in it. */
+   int chunk;
+   int position;
+   /* The next chunk to be written by the writing thread. */
+   int written;
+   uint16_t thread;
+   struct TraceBuffer *next;
+} TraceBuffer;
+
+Graph *traced_graph = NULL;
+
+static FILE *event_trace = NULL;
+static bool tracing = false;
+static uint64_t sequence = 0;
+
+/* The trace lock guards the buffer list, the filled arrays and stopping. */
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t chunk_filled = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t chunk_written = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+static bool stopping = false;
+static TraceBuffer *buffers = NULL;
+static uint16_t thread_count = 0;
+static __thread TraceBuffer *thread_buffer = NULL;
+
+/* Writes the chunks of each buffer in order until closeEventTrace is called
+ * and no chunk is waiting. */
+static void *writeChunks(void *argument)
+{
+   (void)argument;
+   pthread_mutex_lock(&trace_lock);
+   while(true)
+   {
+      bool wrote = false;
+      TraceBuffer *buffer;
+      for(buffer = buffers; buffer != NULL; buffer = buffer->next)
+      {
+         int chunk = buffer->written;
+         int records = buffer->filled[chunk];
+         if(records == 0) continue;
+         pthread_mutex_unlock(&trace_lock);
+         fwrite(buffer->records[chunk], sizeof(TraceRecord), records, event_trace);
+         pthread_mutex_lock(&trace_lock);
+         buffer->filled[chunk] = 0;
+         buffer->written = (chunk + 1) % TRACE_CHUNKS;
+         pthread_cond_broadcast(&chunk_written);
+         wrote = true;
+      }
+      if(wrote) continue;
+      if(stopping) break;
+      pthread_cond_wait(&chunk_filled, &trace_lock);
+   }
+   pthread_mutex_unlock(&trace_lock);
+   return NULL;
+}
+
+/* The process forked to evaluate a speculative condition (see speculation.h)
+ * does not record its events. */
+static void stopTracingInChild(void)
+{
+   tracing = false;
+   traced_graph = NULL;
+}
+
+void openEventTrace(string trace_file_name, int rules, string *rule_names)
+{
+   event_trace = fopen(trace_file_name, "wb");
+   if(event_trace == NULL)
+   {
+      perror(trace_file_name);
+      exit(1);
+   }
+   uint32_t header[3] = {TRACE_VERSION, sizeof(TraceRecord), rules};
+   fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), event_trace);
+   fwrite(header, sizeof(uint32_t), 3, event_trace);
+   int rule;
+   for(rule = 0; rule < rules; rule++)
+   {
+      uint32_t length = strlen(rule_names[rule]);
+      fwrite(&length, sizeof(uint32_t), 1, event_trace);
+      fwrite(rule_names[rule], 1, length, event_trace);
+   }
+   /* The writing thread blocks all signals, so that the SIGCHLD handler of the
+    * speculation module runs in the thread that waits for the condition. */
+   sigset_t block, old_mask;
+   sigfillset(&block);
+   pthread_sigmask(SIG_BLOCK, &block, &old_mask);
+   int result = pthread_create(&writer, NULL, writeChunks, NULL);
+   pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+   if(result != 0)
+   {
+      print_to_log("Error (openEventTrace): could not start the trace writer.\n");
+      exit(1);
+   }
+   pthread_atfork(NULL, NULL, stopTracingInChild);
+   tracing = true;
+}
+
+/* Hands the chunk being filled to the writing thread, and waits until the next
+ * chunk of the ring has been written. */
+static void handOverChunk(TraceBuffer *buffer)
+{
+   pthread_mutex_lock(&trace_lock);
+   buffer->filled[buffer->chunk] = buffer->position;
+   pthread_cond_signal(&chunk_filled);
+   int next = (buffer->chunk + 1) % TRACE_CHUNKS;
+   while(buffer->filled[next] != 0) pthread_cond_wait(&chunk_written, &trace_lock);
+   buffer->chunk = next;
+   buffer->position = 0;
+   pthread_mutex_unlock(&trace_lock);
+}
+
+static TraceBuffer *makeTraceBuffer(void)
+{
+   TraceBuffer *buffer = calloc(1, sizeof(TraceBuffer));
+   if(buffer == NULL)
+   {
+      print_to_log("Error (makeTraceBuffer): malloc failure.\n");
+      exit(1);
+   }
+   pthread_mutex_lock(&trace_lock);
+   buffer->thread = thread_count++;
+   buffer->next = buffers;
+   buffers = buffer;
+   pthread_mutex_unlock(&trace_lock);
+   return buffer;
+}
+
+/* Returns the next record of the calling thread's buffer, stamped with the
+ * type and sequence number. */
+static TraceRecord *nextRecord(uint8_t type, uint64_t event)
+{
+   TraceBuffer *buffer = thread_buffer;
+   if(buffer == NULL) buffer = thread_buffer = makeTraceBuffer();
+   if(buffer->position == TRACE_CHUNK_RECORDS) handOverChunk(buffer);
+   TraceRecord *record = &buffer->records[buffer->chunk][buffer->position++];
+   record->sequence = event;
+   record->thread = buffer->thread;
+   record->type = type;
+   record->flags = 0;
+   return record;
+}
+
+static uint64_t nextEvent(void)
+{
+   return __atomic_fetch_add(&sequence, 1, __ATOMIC_RELAXED);
+}
+
+static void traceLabel(HostLabel label, uint64_t event)
+{
+   if(label.list == NULL) return;
+   HostListItem *item;
+   for(item = label.list->first; item != NULL; item = item->next)
+   {
+      if(item->atom.type == 'i')
+      {
+         TraceRecord *record = nextRecord(TRACE_INT_ATOM, event);
+         record->args[0] = item->atom.num;
+         continue;
+      }
+      /* An empty string still takes a record. */
+      const char *text = item->atom.str;
+      size_t length = strlen(text);
+      do
+      {
+         TraceRecord *record = nextRecord(TRACE_STRING_ATOM, event);
+         size_t chunk = length > sizeof(record->text) ? sizeof(record->text) : length;
+         memcpy(record->text, text, chunk);
+         text += chunk;
+         length -= chunk;
+         record->flags = chunk | (length > 0 ? TRACE_MORE_TEXT : 0);
+      } while(length > 0);
+   }
+}
+
+void closeEventTrace(void)
+{
+   if(!tracing) return;
+   tracing = false;
+   traced_graph = NULL;
+   pthread_mutex_lock(&trace_lock);
+   /* The other threads have no events in progress, so their partial chunks
+    * are handed over as well. The writing thread frees a chunk before it
+    * looks at the next one, so the partial chunks follow the full ones. */
+   TraceBuffer *buffer;
+   for(buffer = buffers; buffer != NULL; buffer = buffer->next)
+      if(buffer->position > 0) buffer->filled[buffer->chunk] = buffer->position;
+   stopping = true;
+   pthread_cond_signal(&chunk_filled);
+   pthread_mutex_unlock(&trace_lock);
+   pthread_join(writer, NULL);
+   while(buffers != NULL)
+   {
+      buffer = buffers;
+      buffers = buffers->next;
+      free(buffer);
+   }
+   thread_buffer = NULL;
+   stopping = false;
+   fclose(event_trace);
+   event_trace = NULL;
+}
+
+void traceGraph(Graph *graph)
+{
+   if(!tracing) return;
+   traced_graph = graph;
+   TraceRecord *record = nextRecord(TRACE_GRAPH, nextEvent());
+   record->args[0] = graph->number_of_nodes;
+   record->args[1] = graph->number_of_edges;
+   int index;
+   for(index = 0; index < graph->nodes.size; index++)
+      if(getNode(graph, index)->index >= 0)
+         traceNodeChange(TRACE_NODE_ADDED, graph, index);
+   for(index = 0; index < graph->edges.size; index++)
+      if(getEdge(graph, index)->index >= 0)
+         traceEdgeChange(TRACE_EDGE_ADDED, graph, index);
+}
+
+void traceEvent(TraceRecordType type, int first, int second)
+{
+   if(!tracing) return;
+   TraceRecord *record = nextRecord(type, nextEvent());
+   record->args[0] = first;
+   record->args[1] = second;
+}
+
+void traceMatch(int rule, Morphism *morphism)
+{
+   if(!tracing) return;
+   uint64_t event = nextEvent();
+   TraceRecord *record = nextRecord(TRACE_MATCH, event);
+   record->args[0] = rule;
+   record->args[1] = morphism->nodes;
+   record->args[2] = morphism->edges;
+   int item, items = morphism->nodes + morphism->edges;
+   for(item = 0; item < items; item++)
+   {
+      if(item % 5 == 0)
+      {
+         record = nextRecord(TRACE_ITEMS, event);
+         memset(record->args, -1, sizeof(record->args));
+      }
+      if(item < morphism->nodes) record->args[item % 5] = morphism->node_map[item].host_index;
+      else record->args[item % 5] = morphism->edge_map[item - morphism->nodes].host_index;
+   }
+}
+
+void traceNodeChange(TraceRecordType type, Graph *graph, int index)
+{
+   if(!tracing) return;
+   uint64_t event = nextEvent();
+   TraceRecord *record = nextRecord(type, event);
+   record->args[0] = index;
+   if(type == TRACE_NODE_REMOVED) return;
+   Node *node = getNode(graph, index);
+   record->flags = node->label.mark;
+   if(type == TRACE_NODE_ADDED || type == TRACE_NODE_ROOT) record->args[1] = node->root;
+   if(type == TRACE_NODE_ADDED || type == TRACE_NODE_RELABELLED)
+   {
+      record->args[type == TRACE_NODE_ADDED ? 2 : 1] = node->label.length;
+      traceLabel(node->label, event);
+   }
+}
+
+void traceEdgeChange(TraceRecordType type, Graph *graph, int index)
+{
+   if(!tracing) return;
+   uint64_t event = nextEvent();
+   TraceRecord *record = nextRecord(type, event);
+   record->args[0] = index;
+   if(type == TRACE_EDGE_REMOVED) return;
+   Edge *edge = getEdge(graph, index);
+   record->flags = edge->label.mark;
+   if(type == TRACE_EDGE_ADDED)
+   {
+      record->args[1] = edge->source;
+      record->args[2] = edge->target;
+      record->args[3] = edge->label.length;
+      traceLabel(edge->label, event);
+   }
+   if(type == TRACE_EDGE_RELABELLED)
+   {
+      record->args[1] = edge->label.length;
+      traceLabel(edge->label, event);
+   }
+}
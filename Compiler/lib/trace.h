@@ -0,0 +1,130 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ============
+  Trace Module
+  ============
+
+  A binary event trace of the execution of a GP 2 program, written by programs
+  compiled with gp2 -e. The trace records rule matches, applications and
+  failures, restore points, undos and discards, and every change to the host
+  graph, so that the decoder (gp2trace) can rebuild the host graph at any point
+  of the execution.
+
+  Events are fixed-size records. Each thread appends its records to its own
+  ring of chunks, and a background thread writes full chunks to the trace
+  file. A thread only waits if all of its chunks are waiting to be written.
+
+  The trace file starts with a header:
+
+  "GP2TRACE" | version | record size | rule count | rule names
+
+  The integers are 32-bit in host byte order, and each rule name is a length
+  followed by the characters of the name. The rule identifiers in the records
+  index the rule names. The records follow the header.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_TRACE_H
+#define INC_TRACE_H
+
+#include "common.h"
+#include "graph.h"
+#include "morphism.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC "GP2TRACE"
+#define TRACE_VERSION 1
+
+/* The records of an event. The arguments of each event are listed after it.
+ * Node and edge indices are indices in the host graph, and the mark of an item
+ * is stored in the flags of its record.
+ *
+ * TRACE_GRAPH - nodes, edges. The host graph given to the program. It is
+ *               followed by the records that add its nodes and edges.
+ * TRACE_MATCH - rule, nodes, edges. Followed by TRACE_ITEMS records holding
+ *               the host indices of the matched nodes and then edges.
+ * TRACE_APPLY - rule. Follows the changes made by the application.
+ * TRACE_FAIL - rule, or -1 for the fail statement.
+ * TRACE_RESTORE_POINT, TRACE_DISCARD - restore point, its position on the
+ *                                      graph change stack.
+ * TRACE_UNDO - restore point, its position. Follows the changes that undo
+ *              the graph.
+ * TRACE_END - 1 if the program succeeded, 0 otherwise.
+ * TRACE_NODE_ADDED - index, root, label length. Followed by the label atoms.
+ * TRACE_NODE_RELABELLED - index, label length. Followed by the label atoms.
+ * TRACE_NODE_REMOVED, TRACE_NODE_MARKED - index.
+ * TRACE_NODE_ROOT - index, root.
+ * TRACE_EDGE_ADDED - index, source, target, label length. Followed by the
+ *                    label atoms.
+ * TRACE_EDGE_RELABELLED - index, label length. Followed by the label atoms.
+ * TRACE_EDGE_REMOVED, TRACE_EDGE_MARKED - index.
+ * TRACE_INT_ATOM - value.
+ * TRACE_STRING_ATOM - Up to 20 characters of a string in text. The flags hold
+ *                     the number of characters, plus TRACE_MORE_TEXT if the
+ *                     string continues in the next record.
+ * TRACE_ITEMS - Up to 5 host indices, unused entries being -1. */
+typedef enum {TRACE_GRAPH = 1, TRACE_MATCH, TRACE_APPLY, TRACE_FAIL,
+              TRACE_RESTORE_POINT, TRACE_UNDO, TRACE_DISCARD, TRACE_END,
+              TRACE_NODE_ADDED, TRACE_NODE_RELABELLED, TRACE_NODE_REMOVED,
+              TRACE_NODE_MARKED, TRACE_NODE_ROOT, TRACE_EDGE_ADDED,
+              TRACE_EDGE_RELABELLED, TRACE_EDGE_REMOVED, TRACE_EDGE_MARKED,
+              TRACE_INT_ATOM, TRACE_STRING_ATOM, TRACE_ITEMS} TraceRecordType;
+
+#define TRACE_MORE_TEXT 0x80
+
+/* The records of an event share its sequence number, which orders the events
+ * of all threads. The records of a thread are written in order. */
+typedef struct TraceRecord {
+   uint64_t sequence;
+   uint16_t thread;
+   uint8_t type;
+   uint8_t flags;
+   union {
+      int32_t args[5];
+      char text[20];
+   };
+} TraceRecord;
+
+/* Each thread has TRACE_CHUNKS chunks of TRACE_CHUNK_RECORDS records. */
+#define TRACE_CHUNKS 4
+#define TRACE_CHUNK_RECORDS 4096
+
+/* The host graph whose changes are recorded, or NULL. */
+extern Graph *traced_graph;
+
+/* Creates the trace file, writes the header, and starts the writing thread.
+ * rule_names[i] is the name of the rule with identifier i. */
+void openEventTrace(string trace_file_name, int rules, string *rule_names);
+/* Writes the remaining records and closes the trace file. */
+void closeEventTrace(void);
+
+/* Records the host graph and starts recording its changes. */
+void traceGraph(Graph *graph);
+/* Records an event without records following it. */
+void traceEvent(TraceRecordType type, int first, int second);
+/* Records a successful match of the rule. */
+void traceMatch(int rule, Morphism *morphism);
+
+/* Called by the graph module after it changes a node or edge of the traced
+ * graph, and before it removes one. */
+void traceNodeChange(TraceRecordType type, Graph *graph, int index);
+void traceEdgeChange(TraceRecordType type, Graph *graph, int index);
+
+#endif /* INC_TRACE_H */
@@ -0,0 +1,718 @@
+/* ////////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  =============
+  Trace Decoder
+  =============
+
+  Usage: gp2trace <trace_file>
+         gp2trace -g <step> <trace_file>
+         gp2trace -d <trace_file>
+
+  Decodes an event trace written by a program compiled with gp2 -e (see
+  trace.h). The first form lists the steps of the execution: the host graph,
+  rule matches, applications and failures, restore points, undos, discards
+  and the end of the program. The graph changes made after each step are
+  listed under it.
+
+  The second form prints the host graph as it was at the given step, in the
+  host graph syntax.
+
+  The third form prints a graph for each step in the format read by
+  Haskell/traceToDot.sh, with the nodes and edges of a match highlighted:
+
+  gp2trace -d gp2.trace | traceToDot.sh <dir>
+
+  The graph is rebuilt by replaying the changes in the trace, so node and edge
+  indices in the output are those of the host graph of the program.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#include "common.h"
+#include "debug.h"
+#include "graph.h"
+#include "label.h"
+#include "trace.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct Trace {
+   int rules;
+   string *rule_names;
+   int records;
+   TraceRecord *record;
+} Trace;
+
+/* A node or edge of the replayed host graph, by its index in the host graph.
+ * Edges use source and target. The replay state owns a reference to each
+ * label's list. */
+typedef struct ReplayItem {
+   bool present;
+   bool root;
+   int source, target;
+   HostLabel label;
+} ReplayItem;
+
+typedef struct Replay {
+   ReplayItem *nodes, *edges;
+   int node_capacity, edge_capacity;
+   /* The items of the last match, as -1 terminated arrays of host indices,
+    * cleared by the next step. */
+   int *matched_nodes, *matched_edges;
+} Replay;
+
+static void *checkedRealloc(void *pointer, size_t size)
+{
+   pointer = realloc(pointer, size > 0 ? size : 1);
+   if(pointer == NULL)
+   {
+      fprintf(stderr, "Error (traceDecoder): malloc failure.\n");
+      exit(1);
+   }
+   return pointer;
+}
+
+/* The counts and indices in the records are checked before they are used, as
+ * a damaged file could otherwise make the decoder read or allocate out of
+ * bounds. */
+static void corruptTrace(void)
+{
+   fprintf(stderr, "Error: the trace is corrupt.\n");
+   exit(1);
+}
+
+static bool readTraceInt(FILE *file, uint32_t *value)
+{
+   return fread(value, sizeof(uint32_t), 1, file) == 1;
+}
+
+/* The position of each record in the file breaks ties between the records of
+ * an event, which are written in order by a single thread. */
+typedef struct SortedRecord {
+   TraceRecord record;
+   int position;
+} SortedRecord;
+
+static int compareRecords(const void *a, const void *b)
+{
+   const SortedRecord *x = a, *y = b;
+   if(x->record.sequence != y->record.sequence)
+      return (x->record.sequence > y->record.sequence) - (x->record.sequence < y->record.sequence);
+   return x->position - y->position;
+}
+
+/* The records of each thread are in order in the file, but the chunks of
+ * different threads may interleave. */
+static void sortRecords(Trace *trace)
+{
+   int index;
+   for(index = 1; index < trace->records; index++)
+      if(trace->record[index].sequence < trace->record[index - 1].sequence) break;
+   if(index >= trace->records) return;
+   SortedRecord *sorted = checkedRealloc(NULL, trace->records * sizeof(SortedRecord));
+   for(index = 0; index < trace->records; index++)
+   {
+      sorted[index].record = trace->record[index];
+      sorted[index].position = index;
+   }
+   qsort(sorted, trace->records, sizeof(SortedRecord), compareRecords);
+   for(index = 0; index < trace->records; index++) trace->record[index] = sorted[index].record;
+   free(sorted);
+}
+
+static bool readTrace(string trace_file, Trace *trace)
+{
+   FILE *file = fopen(trace_file, "rb");
+   if(file == NULL)
+   {
+      perror(trace_file);
+      return false;
+   }
+   char magic[sizeof(TRACE_MAGIC) - 1];
+   uint32_t version, record_size, rules;
+   if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+      memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+      !readTraceInt(file, &version) || !readTraceInt(file, &record_size) ||
+      !readTraceInt(file, &rules))
+   {
+      fprintf(stderr, "Error: %s is not a GP 2 event trace.\n", trace_file);
+      fclose(file);
+      return false;
+   }
+   if(version != TRACE_VERSION || record_size != sizeof(TraceRecord))
+   {
+      fprintf(stderr, "Error: %s was written by an incompatible version of GP 2.\n",
+              trace_file);
+      fclose(file);
+      return false;
+   }
+   trace->rules = rules;
+   trace->rule_names = checkedRealloc(NULL, rules * sizeof(string));
+   uint32_t rule;
+   for(rule = 0; rule < rules; rule++)
+   {
+      uint32_t length;
+      if(!readTraceInt(file, &length))
+      {
+         fprintf(stderr, "Error: the header of %s is truncated.\n", trace_file);
+         fclose(file);
+         return false;
+      }
+      trace->rule_names[rule] = checkedRealloc(NULL, length + 1);
+      if(fread(trace->rule_names[rule], 1, length, file) != length)
+      {
+         fprintf(stderr, "Error: the header of %s is truncated.\n", trace_file);
+         fclose(file);
+         return false;
+      }
+      trace->rule_names[rule][length] = '\0';
+   }
+   int capacity = TRACE_CHUNK_RECORDS;
+   trace->records = 0;
+   trace->record = checkedRealloc(NULL, capacity * sizeof(TraceRecord));
+   size_t read;
+   while((read = fread(trace->record + trace->records, sizeof(TraceRecord),
+                       capacity - trace->records, file)) > 0)
+   {
+      trace->records += read;
+      if(trace->records == capacity)
+      {
+         capacity *= 2;
+         trace->record = checkedRealloc(trace->record, capacity * sizeof(TraceRecord));
+      }
+   }
+   fclose(file);
+   sortRecords(trace);
+   return true;
+}
+
+static void freeTrace(Trace *trace)
+{
+   int rule;
+   for(rule = 0; rule < trace->rules; rule++) free(trace->rule_names[rule]);
+   free(trace->rule_names);
+   free(trace->record);
+}
+
+static string ruleName(Trace *trace, int rule)
+{
+   if(rule < 0 || rule >= trace->rules) return "?";
+   return trace->rule_names[rule];
+}
+
+static bool isChange(uint8_t type)
+{
+   return type >= TRACE_NODE_ADDED && type <= TRACE_EDGE_MARKED;
+}
+
+/* The records of an event other than its first. */
+static bool isContinuation(uint8_t type)
+{
+   return type == TRACE_INT_ATOM || type == TRACE_STRING_ATOM || type == TRACE_ITEMS;
+}
+
+/* Returns the item with the given index, growing the array if necessary. Every
+ * index is introduced by a record that adds the item, so a valid index is less
+ * than the number of records. */
+static ReplayItem *getReplayItem(Trace *trace, ReplayItem **items, int *capacity,
+                                 int index)
+{
+   if(index < 0 || index >= trace->records) corruptTrace();
+   if(index >= *capacity)
+   {
+      int new_capacity = *capacity == 0 ? 128 : *capacity;
+      while(new_capacity <= index) new_capacity *= 2;
+      *items = checkedRealloc(*items, new_capacity * sizeof(ReplayItem));
+      memset(*items + *capacity, 0, (new_capacity - *capacity) * sizeof(ReplayItem));
+      *capacity = new_capacity;
+   }
+   return &(*items)[index];
+}
+
+/* Builds the label of length atoms from the records following *position, and
+ * advances *position past them. */
+static HostLabel readLabel(Trace *trace, int *position, MarkType mark, int length)
+{
+   if(length == 0) return makeHostLabel(mark, 0, NULL);
+   /* Each atom takes at least one record. */
+   if(length < 0 || length > trace->records - *position) corruptTrace();
+   HostAtom array[length];
+   int atom;
+   for(atom = 0; atom < length && *position < trace->records; atom++)
+   {
+      TraceRecord *record = &trace->record[(*position)++];
+      if(record->type == TRACE_INT_ATOM)
+      {
+         array[atom].type = 'i';
+         array[atom].num = record->args[0];
+         continue;
+      }
+      /* Joins the chunks of the string. */
+      string text = NULL;
+      size_t text_length = 0;
+      while(true)
+      {
+         size_t chunk = record->flags & ~TRACE_MORE_TEXT;
+         if(chunk > sizeof(record->text)) corruptTrace();
+         text = checkedRealloc(text, text_length + chunk + 1);
+         memcpy(text + text_length, record->text, chunk);
+         text_length += chunk;
+         if(!(record->flags & TRACE_MORE_TEXT) || *position >= trace->records) break;
+         record = &trace->record[(*position)++];
+      }
+      text[text_length] = '\0';
+      array[atom].type = 's';
+      array[atom].str = text;
+   }
+   /* A truncated trace is padded with empty strings. */
+   for(; atom < length; atom++)
+   {
+      array[atom].type = 's';
+      array[atom].str = strdup("");
+   }
+   return makeHostLabel(mark, length, makeHostList(array, length, true));
+}
+
+static void setLabel(ReplayItem *item, HostLabel label)
+{
+   removeHostList(item->label.list);
+   item->label = label;
+}
+
+/* Applies the graph change at *position to the replay state and advances
+ * *position past its records. */
+static void replayChange(Trace *trace, int *position, Replay *replay)
+{
+   TraceRecord *record = &trace->record[(*position)++];
+   int index = record->args[0];
+   MarkType mark = record->flags;
+   if(mark >= NUMBER_OF_MARKS) corruptTrace();
+   ReplayItem *item;
+   if(record->type >= TRACE_EDGE_ADDED)
+      item = getReplayItem(trace, &replay->edges, &replay->edge_capacity, index);
+   else item = getReplayItem(trace, &replay->nodes, &replay->node_capacity, index);
+   switch(record->type)
+   {
+      case TRACE_NODE_ADDED:
+           item->present = true;
+           item->root = record->args[1];
+           setLabel(item, readLabel(trace, position, mark, record->args[2]));
+           break;
+
+      case TRACE_EDGE_ADDED:
+           if(record->args[1] < 0 || record->args[2] < 0) corruptTrace();
+           item->present = true;
+           item->source = record->args[1];
+           item->target = record->args[2];
+           setLabel(item, readLabel(trace, position, mark, record->args[3]));
+           break;
+
+      case TRACE_NODE_RELABELLED:
+      case TRACE_EDGE_RELABELLED:
+           setLabel(item, readLabel(trace, position, mark, record->args[1]));
+           break;
+
+      case TRACE_NODE_REMOVED:
+      case TRACE_EDGE_REMOVED:
+           item->present = false;
+           setLabel(item, makeHostLabel(NONE, 0, NULL));
+           break;
+
+      case TRACE_NODE_MARKED:
+      case TRACE_EDGE_MARKED:
+           item->label.mark = mark;
+           break;
+
+      case TRACE_NODE_ROOT:
+           item->root = record->args[1];
+           break;
+
+      default:
+           break;
+   }
+}
+
+static void clearReplay(Replay *replay)
+{
+   int index;
+   for(index = 0; index < replay->node_capacity; index++)
+      removeHostList(replay->nodes[index].label.list);
+   for(index = 0; index < replay->edge_capacity; index++)
+      removeHostList(replay->edges[index].label.list);
+   free(replay->nodes);
+   free(replay->edges);
+   free(replay->matched_nodes);
+   free(replay->matched_edges);
+   memset(replay, 0, sizeof(Replay));
+}
+
+/* Reads the items of the match at *position into the replay state. */
+static void readMatch(Trace *trace, int *position, Replay *replay)
+{
+   TraceRecord *match = &trace->record[(*position)++];
+   int nodes = match->args[1], edges = match->args[2], item;
+   /* The items take five to a record. */
+   if(nodes < 0 || edges < 0 || nodes > 5LL * (trace->records - *position) ||
+      edges > 5LL * (trace->records - *position)) corruptTrace();
+   replay->matched_nodes = checkedRealloc(replay->matched_nodes, (nodes + 1) * sizeof(int));
+   replay->matched_edges = checkedRealloc(replay->matched_edges, (edges + 1) * sizeof(int));
+   TraceRecord *record = NULL;
+   for(item = 0; item < nodes + edges; item++)
+   {
+      if(item % 5 == 0)
+      {
+         if(*position >= trace->records || trace->record[*position].type != TRACE_ITEMS) break;
+         record = &trace->record[(*position)++];
+      }
+      if(item < nodes) replay->matched_nodes[item] = record->args[item % 5];
+      else replay->matched_edges[item - nodes] = record->args[item % 5];
+   }
+   for(; item < nodes + edges; item++)
+   {
+      if(item < nodes) replay->matched_nodes[item] = -1;
+      else replay->matched_edges[item - nodes] = -1;
+   }
+   replay->matched_nodes[nodes] = -1;
+   replay->matched_edges[edges] = -1;
+}
+
+static bool matched(int *items, int index)
+{
+   if(items == NULL) return false;
+   for(; *items != -1; items++) if(*items == index) return true;
+   return false;
+}
+
+/* Replays the step at *position and the changes following a TRACE_GRAPH
+ * step, leaving *position at the next record. */
+static void replayStep(Trace *trace, int *position, Replay *replay)
+{
+   TraceRecord *record = &trace->record[*position];
+   if(replay->matched_nodes != NULL)
+   {
+      replay->matched_nodes[0] = -1;
+      replay->matched_edges[0] = -1;
+   }
+   if(record->type == TRACE_MATCH)
+   {
+      readMatch(trace, position, replay);
+      return;
+   }
+   (*position)++;
+   if(record->type != TRACE_GRAPH) return;
+   clearReplay(replay);
+   int items = record->args[0] + record->args[1];
+   while(items-- > 0 && *position < trace->records && isChange(trace->record[*position].type))
+      replayChange(trace, position, replay);
+}
+
+static void printChange(Trace *trace, int position, Replay *replay)
+{
+   TraceRecord *record = &trace->record[position];
+   int index = record->args[0];
+   ReplayItem *item;
+   switch(record->type)
+   {
+      case TRACE_NODE_ADDED:
+      case TRACE_NODE_RELABELLED:
+      case TRACE_NODE_MARKED:
+           item = &replay->nodes[index];
+           if(record->type == TRACE_NODE_ADDED) printf("   add node %d", index);
+           else if(record->type == TRACE_NODE_RELABELLED) printf("   relabel node %d", index);
+           else printf("   mark node %d", index);
+           printf(item->root && record->type == TRACE_NODE_ADDED ? "(R) " : " ");
+           printHostLabel(item->label, stdout);
+           printf("\n");
+           break;
+
+      case TRACE_EDGE_ADDED:
+      case TRACE_EDGE_RELABELLED:
+      case TRACE_EDGE_MARKED:
+           item = &replay->edges[index];
+           if(record->type == TRACE_EDGE_ADDED)
+              printf("   add edge %d (%d -> %d) ", index, item->source, item->target);
+           else if(record->type == TRACE_EDGE_RELABELLED) printf("   relabel edge %d ", index);
+           else printf("   mark edge %d ", index);
+           printHostLabel(item->label, stdout);
+           printf("\n");
+           break;
+
+      case TRACE_NODE_REMOVED:
+           printf("   remove node %d\n", index);
+           break;
+
+      case TRACE_NODE_ROOT:
+           printf("   %s root node %d\n", record->args[1] ? "set" : "unset", index);
+           break;
+
+      case TRACE_EDGE_REMOVED:
+           printf("   remove edge %d\n", index);
+           break;
+
+      default:
+           break;
+   }
+}
+
+/* Advances *position to the next step, replaying the changes before it. When
+ * list is true, the changes are printed as they are replayed. */
+static void replayChanges(Trace *trace, int *position, Replay *replay, bool list)
+{
+   while(*position < trace->records)
+   {
+      uint8_t type = trace->record[*position].type;
+      if(isChange(type))
+      {
+         int change = *position;
+         replayChange(trace, position, replay);
+         if(list) printChange(trace, change, replay);
+      }
+      /* Records of a truncated event are skipped. */
+      else if(isContinuation(type)) (*position)++;
+      else return;
+   }
+}
+
+static void printStep(Trace *trace, int step, TraceRecord *record, Replay *replay)
+{
+   printf("%d ", step);
+   int index;
+   switch(record->type)
+   {
+      case TRACE_GRAPH:
+           printf("host graph: %d nodes, %d edges\n", record->args[0], record->args[1]);
+           break;
+
+      case TRACE_MATCH:
+           /* Traces of older programs have no items for predicate rules. */
+           if(replay->matched_nodes[0] == -1 && replay->matched_edges[0] == -1)
+           {
+              printf("match %s: no items recorded\n", ruleName(trace, record->args[0]));
+              break;
+           }
+           printf("match %s: nodes", ruleName(trace, record->args[0]));
+           for(index = 0; replay->matched_nodes[index] != -1; index++)
+              printf(" %d", replay->matched_nodes[index]);
+           printf(", edges");
+           for(index = 0; replay->matched_edges[index] != -1; index++)
+              printf(" %d", replay->matched_edges[index]);
+           printf("\n");
+           break;
+
+      case TRACE_APPLY:
+           printf("apply %s\n", ruleName(trace, record->args[0]));
+           break;
+
+      case TRACE_FAIL:
+           if(record->args[0] == -1) printf("fail\n");
+           else printf("no match %s\n", ruleName(trace, record->args[0]));
+           break;
+
+      case TRACE_RESTORE_POINT:
+           printf("restore point %d at %d\n", record->args[0], record->args[1]);
+           break;
+
+      case TRACE_UNDO:
+           printf("undo to restore point %d at %d\n", record->args[0], record->args[1]);
+           break;
+
+      case TRACE_DISCARD:
+           printf("discard restore point %d at %d\n", record->args[0], record->args[1]);
+           break;
+
+      case TRACE_END:
+           printf("end: %s\n", record->args[0] ? "success" : "failure");
+           break;
+
+      default:
+           printf("unknown record type %d\n", record->type);
+           break;
+   }
+}
+
+static void listSteps(Trace *trace)
+{
+   Replay replay;
+   memset(&replay, 0, sizeof(Replay));
+   int position = 0, step = 0;
+   replayChanges(trace, &position, &replay, true);
+   while(position < trace->records)
+   {
+      TraceRecord *record = &trace->record[position];
+      replayStep(trace, &position, &replay);
+      printStep(trace, step++, record, &replay);
+      replayChanges(trace, &position, &replay, true);
+   }
+   clearReplay(&replay);
+}
+
+/* Replays the trace up to and including the step, and returns false if the
+ * trace has fewer steps. */
+static bool replayToStep(Trace *trace, int step, Replay *replay)
+{
+   int position = 0, current;
+   replayChanges(trace, &position, replay, false);
+   for(current = 0; position < trace->records; current++)
+   {
+      replayStep(trace, &position, replay);
+      if(current == step) return true;
+      replayChanges(trace, &position, replay, false);
+   }
+   return false;
+}
+
+static void printStepGraph(Replay *replay)
+{
+   Graph *graph = newGraph(replay->node_capacity > 0 ? replay->node_capacity : 1,
+                           replay->edge_capacity > 0 ? replay->edge_capacity : 1);
+   int *graph_index = checkedRealloc(NULL, replay->node_capacity * sizeof(int));
+   int index;
+   for(index = 0; index < replay->node_capacity; index++)
+   {
+      ReplayItem *node = &replay->nodes[index];
+      graph_index[index] = -1;
+      if(!node->present) continue;
+      addHostList(node->label.list);
+      graph_index[index] = addNode(graph, node->root, node->label);
+   }
+   for(index = 0; index < replay->edge_capacity; index++)
+   {
+      ReplayItem *edge = &replay->edges[index];
+      if(!edge->present) continue;
+      if(edge->source >= replay->node_capacity || edge->target >= replay->node_capacity ||
+         graph_index[edge->source] == -1 || graph_index[edge->target] == -1)
+      {
+         fprintf(stderr, "Warning: edge %d has a missing source or target.\n", index);
+         continue;
+      }
+      addHostList(edge->label.list);
+      addEdge(graph, edge->label, graph_index[edge->source], graph_index[edge->target]);
+   }
+   printGraph(graph, stdout);
+   free(graph_index);
+   freeGraph(graph);
+}
+
+/* Prints the graph of the step in the format of Haskell/traceToDot.sh: the
+ * kind of step, a title, and the nodes and edges, with the items of a match
+ * prefixed by '!'. */
+static void printDotStep(Trace *trace, int step, TraceRecord *record, Replay *replay)
+{
+   switch(record->type)
+   {
+      case TRACE_GRAPH:
+           printf("S%d OILR_host\n", step);
+           break;
+
+      case TRACE_MATCH:
+           printf("S%d OILR_match_%s\n", step, ruleName(trace, record->args[0]));
+           break;
+
+      case TRACE_APPLY:
+           printf("S%d OILR_apply_%s\n", step, ruleName(trace, record->args[0]));
+           break;
+
+      case TRACE_FAIL:
+           if(record->args[0] == -1) printf("F%d OILR_fail\n", step);
+           else printf("F%d OILR_fail_%s\n", step, ruleName(trace, record->args[0]));
+           break;
+
+      case TRACE_UNDO:
+           printf("B%d OILR_undo_%d\n", step, record->args[0]);
+           break;
+
+      default:
+           return;
+   }
+   int index;
+   for(index = 0; index < replay->node_capacity; index++)
+   {
+      if(!replay->nodes[index].present) continue;
+      printf("%s%d\n", matched(replay->matched_nodes, index) ? "!" : "", index);
+   }
+   for(index = 0; index < replay->edge_capacity; index++)
+   {
+      ReplayItem *edge = &replay->edges[index];
+      if(!edge->present) continue;
+      printf("%s%d->%d\n", matched(replay->matched_edges, index) ? "!" : "",
+             edge->source, edge->target);
+   }
+}
+
+static void printDotSteps(Trace *trace)
+{
+   Replay replay;
+   memset(&replay, 0, sizeof(Replay));
+   int position = 0, step = 0;
+   replayChanges(trace, &position, &replay, false);
+   while(position < trace->records)
+   {
+      TraceRecord *record = &trace->record[position];
+      replayStep(trace, &position, &replay);
+      printDotStep(trace, step++, record, &replay);
+      replayChanges(trace, &position, &replay, false);
+   }
+   clearReplay(&replay);
+}
+
+int main(int argc, char **argv)
+{
+   string const usage = "Usage: gp2trace [-d | -g <step>] <trace_file>\n";
+   bool dot = argc == 3 && strcmp(argv[1], "-d") == 0;
+   bool graph = argc == 4 && strcmp(argv[1], "-g") == 0;
+   if(argc != 2 && !dot && !graph)
+   {
+      fprintf(stderr, "%s", usage);
+      return 1;
+   }
+   int step = 0;
+   if(graph)
+   {
+      char *end;
+      step = strtol(argv[2], &end, 10);
+      if(*end != '\0' || step < 0)
+      {
+         fprintf(stderr, "%s", usage);
+         return 1;
+      }
+   }
+   log_file = stderr;
+   Trace trace;
+   if(!readTrace(argv[argc - 1], &trace)) return 1;
+   int status = 0;
+   if(dot) printDotSteps(&trace);
+   else if(graph)
+   {
+      Replay replay;
+      memset(&replay, 0, sizeof(Replay));
+      if(replayToStep(&trace, step, &replay)) printStepGraph(&replay);
+      else
+      {
+         fprintf(stderr, "Error: the trace has fewer than %d steps.\n", step + 1);
+         status = 1;
+      }
+      clearReplay(&replay);
+   }
+   else listSteps(&trace);
+   freeTrace(&trace);
+   freeHostListStore();
+   return status;
+}
@@ -14,6 +14,7 @@
   along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
 
 #include "ast.h" 
+#include "rule.h"
 
 List *makeGPList(YYLTYPE location, ListType type)
 {
@@ -526,6 +527,7 @@ GPRule *newASTRule(YYLTYPE location, string name, List *variables,
     rule->predicate_count = 0;
     rule->empty_lhs = false;
     rule->is_predicate = false;
+    rule->transformed_rule = NULL;
     return rule;
 }    
 
@@ -908,6 +910,7 @@ void freeASTRule(GPRule *rule)
    if(rule->rhs) freeASTGraph(rule->rhs);
    if(rule->interface) freeAST(rule->interface);
    if(rule->condition) freeASTCondition(rule->condition);
+   if(rule->transformed_rule) freeRule(rule->transformed_rule);
    free(rule);
 }
 
@@ -288,6 +288,9 @@ typedef struct GPRule {
    int predicate_count;
    bool empty_lhs;
    bool is_predicate;
+   /* The rule structure built from this declaration by the code generator,
+    * kept for the rule-enabling analysis of looped rule sets. */
+   struct Rule *transformed_rule;
 } GPRule;
 
 GPRule *newASTRule(YYLTYPE location, string name, List *variables, 
@@ -56,6 +56,15 @@ typedef char* string;
 
 extern FILE *log_file;
 extern bool graph_copying;
+/* Set by gp2 -t: rule set calls search for matches of their rules in parallel
+ * (see ruleSet.h in the library). */
+extern bool parallel_rule_sets;
+/* Set by gp2 -s: the then branch of an if statement runs while its condition
+ * is evaluated (see speculation.h in the library). */
+extern bool speculative_branches;
+/* Set by gp2 -e: the program records a binary event trace of its execution
+ * (see trace.h in the library). */
+extern bool event_tracing;
 
 /* Bison uses a global variable yylloc of type YYLTYPE to keep track of the 
  * locations of tokens and nonterminals. The scanner will set these values upon
@@ -0,0 +1,671 @@
+/* Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "genBytecode.h"
+
+static FILE *file = NULL;
+
+/* The predicates of the rule currently being written, in the order of their
+ * local identifiers. Predicate bool_ids are numbered across the whole program,
+ * so each predicate is identified by its position in this array instead. */
+static Predicate **predicates = NULL;
+static int predicate_count = 0;
+
+static void generateRuleBytecode(List *declarations);
+static void emitRule(Rule *rule);
+static void emitSearchOp(Rule *rule, SearchOp *operation);
+static void emitPattern(RuleLabel label);
+static void emitConcatPieces(RuleAtom *atom);
+static int countConcatPieces(RuleAtom *atom);
+static void emitApplication(Rule *rule);
+static void emitLabel(RuleLabel label);
+static void emitList(int length, RuleList *list);
+static void emitExpression(RuleAtom *atom);
+static void collectPredicates(Condition *condition);
+static int predicateId(Predicate *predicate);
+static void emitCondition(Condition *condition);
+static void emitPredicate(Rule *rule, Predicate *predicate);
+static void emitCommand(GPCommand *command);
+
+void generateBytecode(List *declarations, string output_dir,
+                      long max_nodes, long max_edges)
+{
+   int length = strlen(output_dir) + 9;
+   char bytecode_file[length];
+   strcpy(bytecode_file, output_dir);
+   strcat(bytecode_file, "/gp2.gpb");
+   file = fopen(bytecode_file, "w");
+   if(file == NULL) {
+     perror(bytecode_file);
+     exit(1);
+   }
+   PTF("gp2b %ld %ld\n", max_nodes, max_edges);
+   /* Rules are written first: transforming them annotates the AST with the
+    * empty_lhs flags used by the loop analysis when writing the main program. */
+   generateRuleBytecode(declarations);
+
+   List *iterator = declarations;
+   while(iterator != NULL)
+   {
+      GPDeclaration *decl = iterator->declaration;
+      if(decl->type == MAIN_DECLARATION)
+      {
+         PTF("main");
+         emitCommand(decl->main_program);
+         PTF("\n");
+      }
+      iterator = iterator->next;
+   }
+   fclose(file);
+}
+
+static void generateRuleBytecode(List *declarations)
+{
+   while(declarations != NULL)
+   {
+      GPDeclaration *decl = declarations->declaration;
+      switch(decl->type)
+      {
+         case MAIN_DECLARATION:
+              break;
+
+         case PROCEDURE_DECLARATION:
+              if(decl->procedure->local_decls != NULL)
+                 generateRuleBytecode(decl->procedure->local_decls);
+              break;
+
+         case RULE_DECLARATION:
+         {
+              Rule *rule = transformRule(decl->rule);
+              decl->rule->empty_lhs = rule->lhs == NULL;
+              decl->rule->is_predicate = isPredicate(rule);
+              emitRule(rule);
+              freeRule(rule);
+              break;
+         }
+         default:
+              print_to_log("Error (generateRuleBytecode): Unexpected declaration "
+                           "type %d at AST node %d\n", decl->type, decl->id);
+              break;
+      }
+      declarations = declarations->next;
+   }
+}
+
+static void emitRule(Rule *rule)
+{
+   predicate_count = 0;
+   if(rule->condition != NULL)
+   {
+      predicates = calloc(rule->predicate_count + 1, sizeof(Predicate *));
+      if(predicates == NULL)
+      {
+         print_to_log("Error (emitRule): malloc failure.\n");
+         exit(1);
+      }
+      collectPredicates(rule->condition);
+   }
+   int lhs_nodes = rule->lhs == NULL ? 0 : rule->lhs->node_index;
+   int lhs_edges = rule->lhs == NULL ? 0 : rule->lhs->edge_index;
+   int rhs_nodes = rule->rhs == NULL ? 0 : rule->rhs->node_index;
+   PTF("rule %s %d %d %d %d %d\n", rule->name, lhs_nodes, lhs_edges, rhs_nodes,
+       rule->variables, predicate_count);
+
+   int index, p;
+   for(index = 0; index < rule->variables; index++)
+   {
+      Variable variable = rule->variable_list[index];
+      string type = "list";
+      switch(variable.type)
+      {
+         case INTEGER_VAR: type = "int"; break;
+         case CHARACTER_VAR: type = "char"; break;
+         case STRING_VAR: type = "string"; break;
+         case ATOM_VAR: type = "atom"; break;
+         default: break;
+      }
+      int count = variable.predicates == NULL ? 0 : variable.predicate_count;
+      PTF("var %s %d", type, count);
+      for(p = 0; p < count; p++) PTF(" %d", predicateId(variable.predicates[p]));
+      PTF("\n");
+   }
+
+   PTF("plan\n");
+   if(rule->lhs != NULL)
+   {
+      Searchplan *searchplan = generateSearchplan(rule->lhs);
+      SearchOp *operation = searchplan->first;
+      while(operation != NULL)
+      {
+         emitSearchOp(rule, operation);
+         operation = operation->next;
+      }
+      freeSearchplan(searchplan);
+   }
+   PTF("end\n");
+
+   if(rule->condition == NULL) PTF("cond 0\n");
+   else
+   {
+      PTF("cond 1");
+      emitCondition(rule->condition);
+      PTF("\n");
+   }
+   for(p = 0; p < predicate_count; p++) emitPredicate(rule, predicates[p]);
+
+   PTF("apply\n");
+   if(!isPredicate(rule)) emitApplication(rule);
+   PTF("end\n");
+
+   if(predicates != NULL) free(predicates);
+   predicates = NULL;
+}
+
+static void emitSearchOp(Rule *rule, SearchOp *operation)
+{
+   if(operation->is_node)
+   {
+      RuleNode *node = getRuleNode(rule->lhs, operation->index);
+      int count = node->predicates == NULL ? 0 : node->predicate_count;
+      PTF("%c %d %d %d %d %d %d %d %d", operation->type, node->index,
+          node->label.mark, node->root, node->indegree, node->outdegree,
+          node->bidegree, node->interface == NULL, count);
+      int p;
+      for(p = 0; p < count; p++) PTF(" %d", predicateId(node->predicates[p]));
+      emitPattern(node->label);
+   }
+   else
+   {
+      RuleEdge *edge = getRuleEdge(rule->lhs, operation->index);
+      PTF("%c %d %d %d %d %d", operation->type, edge->index, edge->label.mark,
+          edge->source->index, edge->target->index, edge->bidirectional);
+      emitPattern(edge->label);
+   }
+   PTF("\n");
+}
+
+/* LHS labels contain only constants, variables, negated integer constants and
+ * concatenations of string constants and character or string variables. */
+static void emitPattern(RuleLabel label)
+{
+   PTF(" %d", label.length);
+   if(label.length == 0) return;
+   RuleListItem *item = label.list->first;
+   while(item != NULL)
+   {
+      RuleAtom *atom = item->atom;
+      switch(atom->type)
+      {
+         case INTEGER_CONSTANT:
+              PTF(" int %d", atom->number);
+              break;
+
+         case STRING_CONSTANT:
+              PTF(" str \"%s\"", atom->string);
+              break;
+
+         case VARIABLE:
+              PTF(" var %d", atom->variable.id);
+              break;
+
+         case NEG:
+              if(atom->neg_exp->type == INTEGER_CONSTANT)
+              {
+                 PTF(" int %d", -(atom->neg_exp->number));
+                 break;
+              }
+              print_to_log("Error (emitPattern): Negation of a non-constant "
+                           "in a LHS label.\n");
+              break;
+
+         case CONCAT:
+              PTF(" concat %d", countConcatPieces(atom));
+              emitConcatPieces(atom);
+              break;
+
+         default:
+              print_to_log("Error (emitPattern): Unexpected atom type %d.\n",
+                           atom->type);
+              break;
+      }
+      item = item->next;
+   }
+}
+
+static int countConcatPieces(RuleAtom *atom)
+{
+   if(atom->type == CONCAT)
+      return countConcatPieces(atom->bin_op.left_exp) +
+             countConcatPieces(atom->bin_op.right_exp);
+   else return 1;
+}
+
+static void emitConcatPieces(RuleAtom *atom)
+{
+   switch(atom->type)
+   {
+      case STRING_CONSTANT:
+           PTF(" str \"%s\"", atom->string);
+           break;
+
+      case VARIABLE:
+           PTF(" var %d", atom->variable.id);
+           break;
+
+      case CONCAT:
+           emitConcatPieces(atom->bin_op.left_exp);
+           emitConcatPieces(atom->bin_op.right_exp);
+           break;
+
+      default:
+           print_to_log("Error (emitConcatPieces): Unexpected atom type %d.\n",
+                        atom->type);
+           break;
+   }
+}
+
+/* Host graph modifications are written in the order used by the C backend:
+ * edges are deleted or relabelled, then nodes are deleted, relabelled or have
+ * their root status changed, then nodes are added, then edges are added. */
+static void emitApplication(Rule *rule)
+{
+   int index;
+   if(rule->lhs != NULL && rule->rhs == NULL)
+   {
+      for(index = 0; index < rule->lhs->edge_index; index++) PTF("dele %d\n", index);
+      for(index = 0; index < rule->lhs->node_index; index++) PTF("deln %d\n", index);
+      return;
+   }
+   if(rule->lhs != NULL)
+   {
+      for(index = 0; index < rule->lhs->edge_index; index++)
+      {
+         RuleEdge *edge = getRuleEdge(rule->lhs, index);
+         if(edge->interface == NULL) PTF("dele %d\n", index);
+         else if(edge->interface->relabelled)
+         {
+            PTF("rele %d", index);
+            emitLabel(edge->interface->label);
+            PTF("\n");
+         }
+         else if(edge->interface->remarked)
+            PTF("reme %d %d\n", index, edge->interface->label.mark);
+      }
+      for(index = 0; index < rule->lhs->node_index; index++)
+      {
+         RuleNode *node = getRuleNode(rule->lhs, index);
+         if(node->interface == NULL)
+         {
+            PTF("deln %d\n", index);
+            continue;
+         }
+         RuleNode *rhs_node = node->interface;
+         if(rhs_node->relabelled)
+         {
+            PTF("reln %d", index);
+            emitLabel(rhs_node->label);
+            PTF("\n");
+         }
+         else if(rhs_node->remarked) PTF("remn %d %d\n", index, rhs_node->label.mark);
+         if(rhs_node->root_changed)
+         {
+            if(node->root && !rhs_node->root) PTF("unroot %d\n", index);
+            if(!node->root && rhs_node->root) PTF("root %d\n", index);
+         }
+      }
+   }
+   for(index = 0; index < rule->rhs->node_index; index++)
+   {
+      RuleNode *node = getRuleNode(rule->rhs, index);
+      if(node->interface != NULL) continue;
+      PTF("addn %d %d", index, node->root);
+      emitLabel(node->label);
+      PTF("\n");
+   }
+   for(index = 0; index < rule->rhs->edge_index; index++)
+   {
+      RuleEdge *edge = getRuleEdge(rule->rhs, index);
+      if(edge->interface != NULL) continue;
+      PTF("adde");
+      if(edge->source->interface != NULL) PTF(" l %d", edge->source->interface->index);
+      else PTF(" r %d", edge->source->index);
+      if(edge->target->interface != NULL) PTF(" l %d", edge->target->interface->index);
+      else PTF(" r %d", edge->target->index);
+      emitLabel(edge->label);
+      PTF("\n");
+   }
+}
+
+static void emitLabel(RuleLabel label)
+{
+   PTF(" %d", label.mark);
+   emitList(label.length, label.list);
+}
+
+static void emitList(int length, RuleList *list)
+{
+   PTF(" %d", length);
+   if(length <= 0 || list == NULL) return;
+   RuleListItem *item = list->first;
+   while(item != NULL)
+   {
+      emitExpression(item->atom);
+      item = item->next;
+   }
+}
+
+static void emitExpression(RuleAtom *atom)
+{
+   switch(atom->type)
+   {
+      case INTEGER_CONSTANT:
+           PTF(" int %d", atom->number);
+           break;
+
+      case STRING_CONSTANT:
+           PTF(" str \"%s\"", atom->string);
+           break;
+
+      case VARIABLE:
+           PTF(" var %d", atom->variable.id);
+           break;
+
+      case LENGTH:
+           PTF(" length %d", atom->variable.id);
+           break;
+
+      case INDEGREE:
+           PTF(" indeg %d", atom->node_id);
+           break;
+
+      case OUTDEGREE:
+           PTF(" outdeg %d", atom->node_id);
+           break;
+
+      case NEG:
+           PTF(" neg");
+           emitExpression(atom->neg_exp);
+           break;
+
+      case ADD:
+      case SUBTRACT:
+      case MULTIPLY:
+      case DIVIDE:
+      case CONCAT:
+           if(atom->type == ADD) PTF(" add");
+           if(atom->type == SUBTRACT) PTF(" sub");
+           if(atom->type == MULTIPLY) PTF(" mul");
+           if(atom->type == DIVIDE) PTF(" div");
+           if(atom->type == CONCAT) PTF(" cat");
+           emitExpression(atom->bin_op.left_exp);
+           emitExpression(atom->bin_op.right_exp);
+           break;
+
+      default:
+           print_to_log("Error (emitExpression): Unexpected atom type %d.\n",
+                        atom->type);
+           break;
+   }
+}
+
+static void collectPredicates(Condition *condition)
+{
+   switch(condition->type)
+   {
+      case 'e':
+           predicates[predicate_count++] = condition->predicate;
+           break;
+
+      case 'n':
+           collectPredicates(condition->neg_condition);
+           break;
+
+      case 'a':
+      case 'o':
+           collectPredicates(condition->left_condition);
+           collectPredicates(condition->right_condition);
+           break;
+
+      default:
+           print_to_log("Error (collectPredicates): Unexpected condition "
+                        "type '%c'.\n", condition->type);
+           break;
+   }
+}
+
+static int predicateId(Predicate *predicate)
+{
+   int index;
+   for(index = 0; index < predicate_count; index++)
+      if(predicates[index] == predicate) return index;
+   print_to_log("Error (predicateId): Predicate %d is not in the condition.\n",
+                predicate->bool_id);
+   return -1;
+}
+
+static void emitCondition(Condition *condition)
+{
+   switch(condition->type)
+   {
+      case 'e':
+           PTF(" pred %d", predicateId(condition->predicate));
+           break;
+
+      case 'n':
+           PTF(" not");
+           emitCondition(condition->neg_condition);
+           break;
+
+      case 'a':
+      case 'o':
+           PTF(condition->type == 'a' ? " and" : " or");
+           emitCondition(condition->left_condition);
+           emitCondition(condition->right_condition);
+           break;
+
+      default:
+           print_to_log("Error (emitCondition): Unexpected condition "
+                        "type '%c'.\n", condition->type);
+           break;
+   }
+}
+
+static void emitPredicate(Rule *rule, Predicate *predicate)
+{
+   int index, p, count = 0;
+   int lhs_nodes = rule->lhs == NULL ? 0 : rule->lhs->node_index;
+   PTF("predicate %d", predicate->negated);
+   /* The nodes and variables that must be matched before the predicate can be
+    * evaluated. Each list is written twice: once to count, once to print. */
+   int pass;
+   for(pass = 0; pass < 2; pass++)
+   {
+      if(pass == 1) PTF(" %d", count);
+      for(index = 0; index < lhs_nodes; index++)
+      {
+         RuleNode *node = getRuleNode(rule->lhs, index);
+         if(node->predicates == NULL) continue;
+         for(p = 0; p < node->predicate_count; p++)
+         {
+            if(node->predicates[p] != predicate) continue;
+            if(pass == 0) count++;
+            else PTF(" %d", index);
+            break;
+         }
+      }
+   }
+   count = 0;
+   for(pass = 0; pass < 2; pass++)
+   {
+      if(pass == 1) PTF(" %d", count);
+      for(index = 0; index < rule->variables; index++)
+      {
+         Variable variable = rule->variable_list[index];
+         if(variable.predicates == NULL) continue;
+         for(p = 0; p < variable.predicate_count; p++)
+         {
+            if(variable.predicates[p] != predicate) continue;
+            if(pass == 0) count++;
+            else PTF(" %d", index);
+            break;
+         }
+      }
+   }
+   switch(predicate->type)
+   {
+      case INT_CHECK:
+           PTF(" int %d", predicate->variable_id);
+           break;
+
+      case CHAR_CHECK:
+           PTF(" char %d", predicate->variable_id);
+           break;
+
+      case STRING_CHECK:
+           PTF(" string %d", predicate->variable_id);
+           break;
+
+      case ATOM_CHECK:
+           PTF(" atom %d", predicate->variable_id);
+           break;
+
+      case EDGE_PRED:
+           PTF(" edge %d %d", predicate->edge_pred.source, predicate->edge_pred.target);
+           if(predicate->edge_pred.label.length < 0) PTF(" 0");
+           else
+           {
+              PTF(" 1");
+              emitLabel(predicate->edge_pred.label);
+           }
+           break;
+
+      case EQUAL:
+      case NOT_EQUAL:
+           PTF(predicate->type == EQUAL ? " eq" : " ne");
+           emitList(predicate->list_comp.left_label.length,
+                    predicate->list_comp.left_label.list);
+           emitList(predicate->list_comp.right_label.length,
+                    predicate->list_comp.right_label.list);
+           break;
+
+      case GREATER:
+      case GREATER_EQUAL:
+      case LESS:
+      case LESS_EQUAL:
+           if(predicate->type == GREATER) PTF(" gt");
+           if(predicate->type == GREATER_EQUAL) PTF(" ge");
+           if(predicate->type == LESS) PTF(" lt");
+           if(predicate->type == LESS_EQUAL) PTF(" le");
+           emitExpression(predicate->atom_comp.left_atom);
+           emitExpression(predicate->atom_comp.right_atom);
+           break;
+
+      default:
+           print_to_log("Error (emitPredicate): Unexpected type %d.\n",
+                        predicate->type);
+           break;
+   }
+   PTF("\n");
+}
+
+/* Writes the command tree on a single line. The restore flags of branch
+ * statements and loops are decided exactly as in generateBranchStatement and
+ * generateLoopStatement in genProgram.c. */
+static void emitCommand(GPCommand *command)
+{
+   switch(command->type)
+   {
+      case COMMAND_SEQUENCE:
+      {
+           int count = 0;
+           List *commands = command->commands;
+           for(; commands != NULL; commands = commands->next) count++;
+           PTF(" seq %d", count);
+           for(commands = command->commands; commands != NULL; commands = commands->next)
+              emitCommand(commands->command);
+           break;
+      }
+      case RULE_CALL:
+           PTF(" call %s", command->rule_call.rule_name);
+           break;
+
+      case RULE_SET_CALL:
+      {
+           int count = 0;
+           List *rules = command->rule_set;
+           for(; rules != NULL; rules = rules->next) count++;
+           PTF(" set %d", count);
+           for(rules = command->rule_set; rules != NULL; rules = rules->next)
+              PTF(" %s", rules->rule_call.rule_name);
+           break;
+      }
+      case PROCEDURE_CALL:
+           emitCommand(command->proc_call.procedure->commands);
+           break;
+
+      case IF_STATEMENT:
+      case TRY_STATEMENT:
+      {
+           GPCommand *condition = command->cond_branch.condition;
+           bool restore;
+           if(command->type == IF_STATEMENT) restore = !singleRule(condition);
+           else restore = !(nullCommand(condition) ||
+                            (singleRule(condition) &&
+                             nullCommand(command->cond_branch.then_command) &&
+                             nullCommand(command->cond_branch.else_command)));
+           PTF(command->type == IF_STATEMENT ? " if %d" : " try %d", restore);
+           emitCommand(condition);
+           emitCommand(command->cond_branch.then_command);
+           emitCommand(command->cond_branch.else_command);
+           break;
+      }
+      case ALAP_STATEMENT:
+      {
+           GPCommand *body = command->loop_stmt.loop_body;
+           if(neverFails(body))
+           {
+             print_error("Error: Nontermination in loop.\n");
+             exit(0);
+           }
+           if(nullCommand(body))
+              print_error("Warning: Possible nontermination in loop.\n");
+           PTF(" loop %d", !singleRule(body));
+           emitCommand(body);
+           break;
+      }
+      case PROGRAM_OR:
+           PTF(" or");
+           emitCommand(command->or_stmt.left_command);
+           emitCommand(command->or_stmt.right_command);
+           break;
+
+      case SKIP_STATEMENT:
+           PTF(" skip");
+           break;
+
+      case FAIL_STATEMENT:
+           PTF(" fail");
+           break;
+
+      case BREAK_STATEMENT:
+           PTF(" break");
+           break;
+
+      default:
+           print_to_log("Error (emitCommand): Unexpected command type %d at AST "
+                        "node %d\n", command->type, command->id);
+           break;
+   }
+}
@@ -0,0 +1,108 @@
+/* ///////////////////////////////////////////////////////////////////////////
+
+  Copyright 2015-2017 Christopher Bak
+
+  This file is part of the GP 2 Compiler. The GP 2 Compiler is free software:
+  you can redistribute it and/or modify it under the terms of the GNU General
+  Public License as published by the Free Software Foundation, either version 3
+  of the License, or (at your option) any later version.
+
+  The GP 2 Compiler is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU General Public License
+  along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>.
+
+  ========================
+  Generate Bytecode Module
+  ========================
+
+  Writes a GP 2 program as a bytecode file for the GP 2 interpreter (gp2vm in
+  the library directory). This is an alternative to generating C code: the
+  bytecode is executed directly, so no C compilation is needed between
+  editing a program and running it.
+
+/////////////////////////////////////////////////////////////////////////// */
+
+#ifndef INC_GEN_BYTECODE_H
+#define INC_GEN_BYTECODE_H
+
+#include "ast.h"
+#include "common.h"
+#include "genProgram.h"
+#include "rule.h"
+#include "searchplan.h"
+#include "transform.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Writes the file <output_dir>/gp2.gpb. The arguments max_nodes and max_edges
+ * are the initial sizes of the host graph's node and edge arrays. */
+void generateBytecode(List *declarations, string output_dir,
+                      long max_nodes, long max_edges);
+
+/* The bytecode is a sequence of whitespace-separated tokens: mnemonics,
+ * integers and double-quoted strings. The interpreter assembles it into
+ * integer arrays when it loads the file. Marks are written as integers
+ * (MarkType), item indices refer to the rule's LHS unless stated otherwise,
+ * and predicates are numbered from 0 within each rule.
+ *
+ * gp2b <max_nodes> <max_edges>
+ * rule <name> <lhs_nodes> <lhs_edges> <rhs_nodes> <variables> <predicates>
+ *    var <type> <count> <predicate>*          type: int char string atom list
+ *    plan
+ *       <op> <node> <mark> <root> <indegree> <outdegree> <bidegree>
+ *            <deleted> <count> <predicate>* <pattern>   op: n r i o b
+ *       <op> <edge> <mark> <source> <target> <bidirectional> <pattern>
+ *                                                        op: e s t l
+ *    end
+ *    cond 0 | cond 1 <condition>
+ *    predicate <negated> <count> <node>* <count> <variable>* <test>
+ *    apply
+ *       dele <edge>  |  rele <edge> <label>  |  reme <edge> <mark>
+ *       deln <node>  |  reln <node> <label>  |  remn <node> <mark>
+ *       root <node>  |  unroot <node>
+ *       addn <rhs_node> <root> <label>
+ *       adde <end> <end> <label>          end: l <lhs_node> | r <rhs_node>
+ *    end
+ * main <command>
+ *
+ * One var line is written for each variable and one predicate line for each
+ * predicate. The searchplan operations are those of searchplan.h, and the
+ * node and variable lists name the predicates to evaluate as soon as the item
+ * is matched. The predicate line lists the nodes and variables that must be
+ * matched before the predicate can be evaluated.
+ *
+ * LHS labels are written as patterns:
+ * <pattern>   ::= <length> <atom>*
+ * <atom>      ::= int <n> | str <s> | var <id> | concat <count> <piece>*
+ * <piece>     ::= str <s> | var <id>
+ *
+ * RHS labels, conditions and predicates use prefix expressions:
+ * <label>     ::= <mark> <length> <exp>*
+ * <exp>       ::= int <n> | str <s> | var <id> | length <id> | indeg <node>
+ *               | outdeg <node> | neg <exp> | add <exp> <exp> | sub <exp> <exp>
+ *               | mul <exp> <exp> | div <exp> <exp> | cat <exp> <exp>
+ * <condition> ::= pred <id> | not <condition> | and <condition> <condition>
+ *               | or <condition> <condition>
+ * <test>      ::= int <id> | char <id> | string <id> | atom <id>
+ *               | edge <node> <node> 0 | edge <node> <node> 1 <label>
+ *               | eq <list> <list> | ne <list> <list>
+ *               | gt <exp> <exp> | ge <exp> <exp> | lt <exp> <exp> | le <exp> <exp>
+ * <list>      ::= <length> <exp>*
+ *
+ * Procedure calls are inlined in the command tree. The restore flag of a
+ * branch or loop is set when its condition or body needs the host graph
+ * changes to be recorded, following the same analysis as the C backend.
+ * <command>   ::= seq <count> <command>* | call <rule> | set <count> <rule>*
+ *               | if <restore> <command> <command> <command>
+ *               | try <restore> <command> <command> <command>
+ *               | loop <restore> <command> | or <command> <command>
+ *               | skip | fail | break */
+
+#endif /* INC_GEN_BYTECODE_H */
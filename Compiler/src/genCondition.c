@@ -52,7 +52,6 @@ void generateConditionVariables(Condition *condition)
  * The tree structure of the condition is used to print the correct expression. */
 void generateConditionEvaluator(Condition *condition, bool nested)
 {
-   static int bool_count = 0;
    if(!nested)
    {
       PTF("static bool evaluateCondition(void)\n");
@@ -62,11 +61,12 @@ void generateConditionEvaluator(Condition *condition, bool nested)
    switch(condition->type)
    {
       case 'e':
-           PTF("b%d", bool_count++);
+           PTF("b%d", condition->predicate->bool_id);
            break;
 
       case 'n':
-           PTF("!b%d", bool_count++);
+           PTF("!");
+           generateConditionEvaluator(condition->neg_condition, true);
            break;
 
       case 'a':
@@ -325,12 +325,34 @@ static void generatePredicateCode(Rule *rule, Predicate *predicate)
    PTF("}\n\n");
 }
 
+bool hasEvaluatedPredicate(Rule *rule, Condition *condition)
+{
+   switch(condition->type)
+   {
+      case 'e':
+           return !isDegreeFilter(rule, condition->predicate);
+
+      case 'n':
+           return hasEvaluatedPredicate(rule, condition->neg_condition);
+
+      case 'a':
+      case 'o':
+           return hasEvaluatedPredicate(rule, condition->left_condition) ||
+                  hasEvaluatedPredicate(rule, condition->right_condition);
+
+      default:
+           return false;
+   }
+}
+
 void generatePredicateEvaluators(Rule *rule, Condition *condition)
 {
    switch(condition->type)
    {
       case 'e':
-           generatePredicateCode(rule, condition->predicate);
+           /* Degree filters are checked inline by the node matchers. */
+           if(!isDegreeFilter(rule, condition->predicate))
+              generatePredicateCode(rule, condition->predicate);
            break;
 
       case 'n':
@@ -350,3 +372,193 @@ void generatePredicateEvaluators(Rule *rule, Condition *condition)
    }
 }
 
+
+/* Checks if the literal of the predicate in the condition must be true for the
+ * condition to be true: the path from the root of the condition to the
+ * predicate passes only through conjunctions, and through at most one negation
+ * directly above the predicate. */
+static bool mandatoryPredicate(Condition *condition, Predicate *predicate)
+{
+   switch(condition->type)
+   {
+      case 'e':
+           return condition->predicate == predicate;
+
+      case 'n':
+           return condition->neg_condition->type == 'e' &&
+                  condition->neg_condition->predicate == predicate;
+
+      case 'a':
+           return mandatoryPredicate(condition->left_condition, predicate) ||
+                  mandatoryPredicate(condition->right_condition, predicate);
+
+      default:
+           return false;
+   }
+}
+
+/* Checks if the atom is an integer expression over constants and the degrees
+ * of at most one node. The index of that node is written to <node> if <node>
+ * is -1, otherwise the degree operators must refer to <node>. Division is
+ * excluded so that moving the evaluation before label matching cannot
+ * introduce a division by zero. */
+static bool degreeExpression(RuleAtom *atom, int *node)
+{
+   switch(atom->type)
+   {
+      case INTEGER_CONSTANT:
+           return true;
+
+      case INDEGREE:
+      case OUTDEGREE:
+           if(*node == -1) *node = atom->node_id;
+           return *node == atom->node_id;
+
+      case NEG:
+           return degreeExpression(atom->neg_exp, node);
+
+      case ADD:
+      case SUBTRACT:
+      case MULTIPLY:
+           return degreeExpression(atom->bin_op.left_exp, node) &&
+                  degreeExpression(atom->bin_op.right_exp, node);
+
+      default:
+           return false;
+   }
+}
+
+bool isDegreeFilter(Rule *rule, Predicate *predicate)
+{
+   if(rule->condition == NULL || !mandatoryPredicate(rule->condition, predicate))
+      return false;
+   int node = -1;
+   switch(predicate->type)
+   {
+      case EQUAL:
+      case NOT_EQUAL:
+      {
+           RuleLabel left_label = predicate->list_comp.left_label;
+           RuleLabel right_label = predicate->list_comp.right_label;
+           if(!labelIsIntegerExpression(left_label) || 
+              !labelIsIntegerExpression(right_label)) return false;
+           if(!degreeExpression(left_label.list->first->atom, &node) ||
+              !degreeExpression(right_label.list->first->atom, &node)) return false;
+           break;
+      }
+      case GREATER:
+      case GREATER_EQUAL:
+      case LESS:
+      case LESS_EQUAL:
+           if(!degreeExpression(predicate->atom_comp.left_atom, &node) ||
+              !degreeExpression(predicate->atom_comp.right_atom, &node)) return false;
+           break;
+
+      default:
+           return false;
+   }
+   return node >= 0;
+}
+
+void generateDegreeFilter(Predicate *predicate)
+{
+   RuleAtom *left_atom = NULL, *right_atom = NULL;
+   string operator = NULL;
+   switch(predicate->type)
+   {
+      case EQUAL:
+      case NOT_EQUAL:
+           left_atom = predicate->list_comp.left_label.list->first->atom;
+           right_atom = predicate->list_comp.right_label.list->first->atom;
+           operator = predicate->type == EQUAL ? " == " : " != ";
+           break;
+
+      case GREATER:
+      case GREATER_EQUAL:
+      case LESS:
+      case LESS_EQUAL:
+           left_atom = predicate->atom_comp.left_atom;
+           right_atom = predicate->atom_comp.right_atom;
+           if(predicate->type == GREATER) operator = " > ";
+           if(predicate->type == GREATER_EQUAL) operator = " >= ";
+           if(predicate->type == LESS) operator = " < ";
+           if(predicate->type == LESS_EQUAL) operator = " <= ";
+           break;
+
+      default:
+           print_to_log("Error (generateDegreeFilter): Unexpected type %d.\n", 
+                        predicate->type);
+           return;
+   }
+   /* The candidate is rejected if the literal of the predicate is false. */
+   PTF("%s", predicate->negated ? "(" : "!(");
+   generateIntExpression(left_atom, 4, false);
+   PTF("%s", operator);
+   generateIntExpression(right_atom, 4, false);
+   PTF(")");
+}
+
+static void bindAtomVariables(Rule *rule, RuleAtom *atom, int position)
+{
+   switch(atom->type)
+   {
+      case VARIABLE:
+      {
+           Variable *variable = &(rule->variable_list[atom->variable.id]);
+           if(variable->binding_op >= 0) break;
+           variable->binding_op = position;
+           int index;
+           for(index = 0; index < variable->predicate_count; index++)
+              variable->predicates[index]->binding_op = position;
+           break;
+      }
+      case NEG:
+           bindAtomVariables(rule, atom->neg_exp, position);
+           break;
+
+      case CONCAT:
+           bindAtomVariables(rule, atom->bin_op.left_exp, position);
+           bindAtomVariables(rule, atom->bin_op.right_exp, position);
+           break;
+
+      default:
+           break;
+   }
+}
+
+static void bindLabelVariables(Rule *rule, RuleLabel label, int position)
+{
+   if(label.list == NULL) return;
+   RuleListItem *item = label.list->first;
+   while(item != NULL)
+   {
+      bindAtomVariables(rule, item->atom, position);
+      item = item->next;
+   }
+}
+
+void schedulePredicates(Rule *rule, Searchplan *searchplan)
+{
+   int index, position = 0;
+   for(index = 0; index < rule->variables; index++)
+      rule->variable_list[index].binding_op = -1;
+   /* The operations are visited in searchplan order, so the position assigned
+    * last to a predicate is that of the operation binding its last argument. */
+   SearchOp *operation;
+   for(operation = searchplan->first; operation != NULL; operation = operation->next)
+   {
+      if(operation->is_node)
+      {
+         RuleNode *node = getRuleNode(rule->lhs, operation->index);
+         bindLabelVariables(rule, node->label, position);
+         for(index = 0; index < node->predicate_count; index++)
+         {
+            Predicate *predicate = node->predicates[index];
+            if(!isDegreeFilter(rule, predicate)) predicate->binding_op = position;
+         }
+      }
+      else bindLabelVariables(rule, getRuleEdge(rule->lhs, operation->index)->label,
+                              position);
+      position++;
+   }
+}
@@ -29,6 +29,7 @@
 #include "common.h"
 #include "genLabel.h"
 #include "rule.h"
+#include "searchplan.h"
 
 #include <stdarg.h>
 #include <stdbool.h>
@@ -77,10 +78,35 @@
  * }
  *
  * The function returns false if the values requires for the condition (node degrees
- * and variable values) have not yet been instantiated by rule matching. */
+ * and variable values) have not yet been instantiated by rule matching.
+ *
+ * evaluateCondition is only called after a predicate is evaluated, so it is
+ * not generated if every predicate is a degree filter (see below).
+ * hasEvaluatedPredicate checks if the condition has a predicate that is not. */
 
 void generateConditionVariables(Condition *condition);
 void generateConditionEvaluator(Condition *condition, bool nested);
+bool hasEvaluatedPredicate(Rule *rule, Condition *condition);
 void generatePredicateEvaluators(Rule *rule, Condition *condition);
 
+/* Condition pushdown. Predicates are classified by the LHS items and variables
+ * they depend on, so that the matcher tests each one as early as possible.
+ *
+ * A degree filter is a predicate that depends only on the degrees of a single
+ * node and whose literal must hold for the condition to hold, for example
+ * indeg(n0) = 0 in "indeg(n0) = 0 and x > 5". It is tested together with the
+ * node's degree check, before label matching, and has no evaluation function:
+ * its boolean keeps the initial value, which is correct for every candidate
+ * that passes the filter. generateDegreeFilter prints the C expression that
+ * is true when a candidate host_node fails the filter.
+ *
+ * schedulePredicates assigns each other predicate the position of the
+ * searchplan operation that binds its last argument (a node or the first
+ * occurrence of a variable). The predicate is evaluated only by the matcher of
+ * that operation, straight after the node is matched or the variable is
+ * assigned. */
+bool isDegreeFilter(Rule *rule, Predicate *predicate);
+void generateDegreeFilter(Predicate *predicate);
+void schedulePredicates(Rule *rule, Searchplan *searchplan);
+
 #endif /* INC_GEN_CONDITION_H */
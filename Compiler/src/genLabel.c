@@ -547,13 +547,21 @@ void generateVariableResultCode(Rule *rule, int id, bool list_variable, int inde
    PTFI("new_assignments += result;\n", indent + 3);
    assert(id < rule->variables);
    Variable variable = rule->variable_list[id];
-   if(variable.predicates != NULL)
+   /* Only the predicates whose last argument is bound by this assignment are
+    * evaluated here. A later occurrence of the variable evaluates nothing. */
+   int index, evaluated = 0;
+   if(variable.binding_op == matching_op)
+   {
+      for(index = 0; index < variable.predicate_count; index++)
+         if(variable.predicates[index]->binding_op == matching_op) evaluated++;
+   }
+   if(evaluated > 0)
    {
       PTFI("/* Update global booleans for the variable's predicates. */\n", indent + 3);
-      int index;
       for(index = 0; index < variable.predicate_count; index++)
-         PTFI("evaluatePredicate%d(morphism);\n", indent + 3, 
-              variable.predicates[index]->bool_id);
+         if(variable.predicates[index]->binding_op == matching_op)
+            PTFI("evaluatePredicate%d(morphism);\n", indent + 3, 
+                 variable.predicates[index]->bool_id);
       PTFI("if(!evaluateCondition())\n", indent + 3);
       PTFI("{\n", indent + 3);
       PTFI("/* Reset the boolean variables in the predicates of this variable. */\n", 
@@ -561,6 +569,7 @@ void generateVariableResultCode(Rule *rule, int id, bool list_variable, int inde
       for(index = 0; index < variable.predicate_count; index++)
       { 
          Predicate *predicate = variable.predicates[index];
+         if(predicate->binding_op != matching_op) continue;
          if(predicate->negated) PTFI("b%d = false;\n", indent + 6, predicate->bool_id);
          else PTFI("b%d = true;\n", indent + 6, predicate->bool_id);
       } 
@@ -568,7 +577,7 @@ void generateVariableResultCode(Rule *rule, int id, bool list_variable, int inde
       PTFI("}\n", indent + 3);
       if(list_variable) PTFI("else match = true;\n", indent + 3);
    }
-   if(list_variable && variable.predicates == NULL) PTFI("match = true;\n", indent + 3);
+   if(list_variable && evaluated == 0) PTFI("match = true;\n", indent + 3);
    PTFI("}\n", indent);
    if(!list_variable) PTFI("else break;\n", indent); 
 }
@@ -857,11 +866,13 @@ void generateIntExpression(RuleAtom *atom, int context, bool nested)
 
       case INDEGREE:
            if(context == 0) PTF("indegree%d", atom->node_id);
+           else if(context == 4) PTF("host_node->indegree");
            else PTF("getIndegree(host, n%d)", atom->node_id);
            break;
 
       case OUTDEGREE:
            if(context == 0) PTF("outdegree%d", atom->node_id);
+           else if(context == 4) PTF("host_node->outdegree");
            else PTF("getOutdegree(host, n%d)", atom->node_id);
            break;
 
@@ -39,6 +39,11 @@
 /* Used by genLabel, genRule and genCondition. Defined in genRule. */
 extern FILE *file;
 
+/* The position in the searchplan of the matching operation whose matcher is
+ * being generated. Predicates are evaluated only by the matcher of the
+ * operation that binds their last argument. Defined in genRule. */
+extern int matching_op;
+
 /* Generates code to match a rule list not containing a list variable to a host graph list. */
 void generateFixedListMatchingCode(Rule *rule, RuleLabel label, int indent);
 
@@ -58,7 +63,10 @@ void generateVariableCode(int id, GPType type);
  * according to the assignment in the morphism. */
 void generateLabelEvaluationCode(RuleLabel label, bool node, int count, int predicate, int indent);
 
-/* Emits C code for the integer expression represented by the passed atom. */
+/* Emits C code for the integer expression represented by the passed atom. 
+ * The context argument is as for generateLabelEvaluationCode, with the extra
+ * context 4 for degree filters (see genCondition.h), in which degree operators
+ * refer to the candidate host node of the matcher. */
 void generateIntExpression(RuleAtom *atom, int context, bool nested);
 
 #endif /* INC_GEN_LABEL_H */
@@ -15,12 +15,13 @@
 
 #include "genProgram.h"
 
-#undef RULE_TRACING
-#undef GRAPH_TRACING
-#undef BACKTRACK_TRACING
-
 static FILE *file = NULL;
 
+/* The names of the rules in the order of their declarations. With gp2 -e, the
+ * generated code identifies a rule in the event trace by its position here. */
+static string *rule_names = NULL;
+static int rule_count = 0;
+
 /* At compile time, the AST is annotated with 'roll back' flags to signal that
  * changes to the host graph are to be recorded while executing a particular
  * program fragment. See the analysis module for the implementation of this
@@ -35,10 +36,20 @@ static FILE *file = NULL;
  * for each restore point. */
 int restore_point_count = 0;
 
+/* Loops whose body is a rule set call keep a runtime flag for each rule in the
+ * set, cleared when the rule fails to match and set again when a rule that may
+ * enable it is applied (see generateLoopStatement). The counter below gives
+ * each such loop a unique identifier for the names of its flags. */
+static int rule_set_count = 0;
+
+/* Each speculated if statement has a number for its runtime profile (see
+ * speculation.h in the library). */
+static int speculation_count = 0;
+
 /* The contexts of a GP2 program determine the code that is generated. In
  * particular, the code generated when a rule match fails is determined by
  * its context. The context also has some impact on graph copying. */
-typedef enum {MAIN_BODY, IF_BODY, TRY_BODY, LOOP_BODY} ContextType;
+typedef enum {MAIN_BODY, IF_BODY, TRY_BODY, LOOP_BODY, SPECULATIVE_BODY} ContextType;
 
 /* Structure containing data to pass between code generation functions.
  * context - The context of the current command.
@@ -53,13 +64,20 @@ typedef enum {MAIN_BODY, IF_BODY, TRY_BODY, LOOP_BODY} ContextType;
  *                 Its value is assigned the value of the global restore_point_count.
  *		   The count is incremented when assigned to ensure unique restore
  *		   point names at runtime.
- * indent - For formatting the printed C code. */
+ * indent - For formatting the printed C code.
+ * rule_set_call - The rule set call in the body of the enclosing loop if it skips
+ *                 rules known to be inapplicable, and NULL otherwise.
+ * rule_set - The identifier of the flags of that loop, or -1.
+ * speculative - Set within the speculative then branch of an if statement. */
  typedef struct CommandData {
    ContextType context;
    int loop_depth;
    bool record_changes;
    int restore_point;
    int indent;
+   GPCommand *rule_set_call;
+   int rule_set;
+   bool speculative;
 } CommandData;
 
 /* Arguments passed to the newGraph function at runtime. */
@@ -67,15 +85,22 @@ typedef enum {MAIN_BODY, IF_BODY, TRY_BODY, LOOP_BODY} ContextType;
 #define HOST_EDGE_SIZE 128
 
 static void generateMorphismCode(List *declarations, char type, bool first_call);
+static void collectRuleNames(List *declarations);
+static int ruleIdentifier(string rule_name);
+static void generateTraceEvent(string event, int restore_point, int indent);
+static void generateProfileCode(List *declarations);
 static void generateProgramCode(GPCommand *command, CommandData data);
 static void generateRuleCall(string rule_name, bool empty_lhs, bool predicate,
-                             bool last_rule, CommandData data);
+                             bool last_rule, List *rule_set, int set_index,
+                             CommandData data);
+static bool parallelRuleSet(GPCommand *command);
+static void generateParallelMatch(List *rule_set, int indent);
+static void generateEnablingCode(string rule_name, List *rule_set, CommandData data);
+static bool speculativeBranch(GPCommand *command, CommandData data);
+static void generateSpeculativeBranch(GPCommand *command, CommandData data, int speculation);
 static void generateBranchStatement(GPCommand *command, CommandData data);
 static void generateLoopStatement(GPCommand *command, CommandData data);
 static void generateFailureCode(string rule_name, CommandData data);
-static bool neverFails(GPCommand *command);
-static bool nullCommand(GPCommand *command);
-static bool singleRule(GPCommand *command);
 
 void generateRuntimeMain(List *declarations, string output_dir,
                          long max_nodes, long max_edges)
@@ -90,47 +115,67 @@ void generateRuntimeMain(List *declarations, string output_dir,
      exit(1);
    }
 
+   PTF("#include <string.h>\n");
    PTF("#include <time.h>\n");
    PTF("#include \"common.h\"\n");
    PTF("#include \"debug.h\"\n");
    PTF("#include \"graph.h\"\n");
    PTF("#include \"graphStacks.h\"\n");
+   PTF("#include \"memoryAccounting.h\"\n");
    PTF("#include \"parser.h\"\n");
-   PTF("#include \"morphism.h\"\n\n");
+   PTF("#include \"morphism.h\"\n");
+   PTF("#include \"driver.h\"\n");
+   PTF("#include \"probes.h\"\n");
+   if(parallel_rule_sets) PTF("#include \"ruleSet.h\"\n");
+   if(speculative_branches) PTF("#include \"speculation.h\"\n");
+   if(event_tracing) PTF("#include \"trace.h\"\n");
+   PTF("\n");
 
    /* Declare the global morphism variables for each rule. */
    generateMorphismCode(declarations, 'd', true);
 
+   if(event_tracing)
+   {
+      collectRuleNames(declarations);
+      if(rule_count > 0)
+      {
+         PTF("static string rule_names[] = {");
+         int rule;
+         for(rule = 0; rule < rule_count; rule++)
+            PTF("%s\"%s\"", rule == 0 ? "" : ", ", rule_names[rule]);
+         PTF("};\n\n");
+      }
+   }
+
    /* Declare the runtime global variables and functions. */
    generateMorphismCode(declarations, 'f', true);
 
    PTF("static void garbageCollect(void)\n");
    PTF("{\n");
+   PTF("   printMemoryUsage(log_file);\n");
    PTF("   freeGraph(host);\n");
    #ifdef LIST_HASHING
       PTF("   freeHostListStore();\n");
    #endif
    PTF("   freeMorphisms();\n");
+   if(parallel_rule_sets) PTF("   freeRuleSetWorkers();\n");
    if(graph_copying) PTF("   freeGraphStack();\n");
    else PTF("   freeGraphChangeStack();\n");
    PTF("   closeLogFile();\n");
-   #if defined GRAPH_TRACING || defined RULE_TRACING || defined BACKTRACK_TRACING
-      PTF("   closeTraceFile();\n");
-   #endif
+   if(event_tracing) PTF("   closeEventTrace();\n");
    PTF("}\n\n");
 
    PTF("Graph *host = NULL;\n");
    PTF("int *node_map = NULL;\n\n");
+   PTF("extern void yyrestart(FILE *input_file);\n\n");
 
-   /* Print the function that builds the host graph via the host graph parser. */
-   PTF("static Graph *buildHostGraph(char *host_file)\n");
+   /* Print the functions that build the host graph via the host graph parser.
+    * parseHostGraph reads an open stream, which server mode uses to parse host
+    * graphs held in memory. */
+   PTF("static Graph *parseHostGraph(FILE *host_file)\n");
    PTF("{\n");
-   PTFI("yyin = fopen(host_file, \"r\");\n", 3);
-   PTFI("if(yyin == NULL)\n", 3);
-   PTFI("{\n", 3);
-   PTFI("perror(host_file);\n", 6);
-   PTFI("return NULL;\n", 6);
-   PTFI("}\n\n", 3);
+   PTFI("GP2_PROBE(host_load_start);\n", 3);
+   PTFI("yyin = host_file;\n", 3);
    PTFI("host = newGraph(%d, %d);\n", 3, max_nodes, max_edges);
    PTFI("node_map = calloc(%d, sizeof(int));\n", 3, max_nodes);
    PTFI("if(node_map == NULL)\n", 3);
@@ -139,10 +184,13 @@ void generateRuntimeMain(List *declarations, string output_dir,
    PTFI("return NULL;\n", 6);
    PTFI("}\n", 3);
    PTFI("/* The parser populates the host graph using node_map to add edges with\n", 3);
-   PTFI(" * the correct source and target indices. */\n", 3);
+   PTFI(" * the correct source and target indices. The lexer is restarted because\n", 3);
+   PTFI(" * batch and server modes parse many host graphs. */\n", 3);
+   PTFI("yyrestart(yyin);\n", 3);
    PTFI("int result = yyparse();\n", 3);
    PTFI("free(node_map);\n", 3);
-   PTFI("fclose(yyin);\n", 3);
+   PTFI("GP2_PROBE3(host_load_end, result == 0, host->number_of_nodes, "
+        "host->number_of_edges);\n", 3);
    PTFI("if(result == 0) return host;\n", 3);
    PTFI("else\n", 3);
    PTFI("{\n", 3);
@@ -150,24 +198,101 @@ void generateRuntimeMain(List *declarations, string output_dir,
    PTFI("return NULL;\n", 6);
    PTFI("}\n", 3);
    PTF("}\n\n");
+
+   PTF("static Graph *buildHostGraph(char *host_file)\n");
+   PTF("{\n");
+   PTFI("FILE *file = fopen(host_file, \"r\");\n", 3);
+   PTFI("if(file == NULL)\n", 3);
+   PTFI("{\n", 3);
+   PTFI("perror(host_file);\n", 6);
+   PTFI("return NULL;\n", 6);
+   PTFI("}\n", 3);
+   PTFI("Graph *graph = parseHostGraph(file);\n", 3);
+   PTFI("fclose(file);\n", 3);
+   PTFI("yyin = NULL;\n", 3);
+   PTFI("return graph;\n", 3);
+   PTF("}\n\n");
    
    PTF("bool success = true;\n\n");
 
+   /* Print the function that writes the matching profile of each rule (see
+    * genRule.h) to gp2.profile. */
+   PTF("static void writeProfile(void)\n");
+   PTF("{\n");
+   PTFI("FILE *profile_file = fopen(\"gp2.profile\", \"w\");\n", 3);
+   PTFI("if(profile_file == NULL)\n", 3);
+   PTFI("{\n", 3);
+   PTFI("perror(\"gp2.profile\");\n", 6);
+   PTFI("return;\n", 6);
+   PTFI("}\n", 3);
+   generateProfileCode(declarations);
+   if(speculative_branches) PTFI("printSpeculationProfile(profile_file);\n", 3);
+   PTFI("fclose(profile_file);\n", 3);
+   PTF("}\n\n");
+
+   /* Print the function that allocates the morphisms. */
+   PTF("static void makeMorphisms(void)\n");
+   PTF("{\n");
+   generateMorphismCode(declarations, 'm', true);
+   PTF("}\n\n");
+
+   /* Print the function that executes the main program on the host graph. It
+    * returns false after writing the failure message to output_file if the
+    * program fails. It is called once per host graph, so success is reset. */
+   PTF("static bool runProgram(FILE *output_file)\n");
+   PTF("{\n");
+   PTFI("success = true;\n", 3);
+   /* output_file is unused if no rule call can fail at the top level. */
+   PTFI("(void)output_file;\n", 3);
+   if(event_tracing) PTFI("traceGraph(host);\n", 3);
+   /* Find the main declaration and generate code from its command sequence. */
+   List *iterator = declarations;
+   while(iterator != NULL)
+   {
+      GPDeclaration *decl = iterator->declaration;
+      if(decl->type == MAIN_DECLARATION)
+      {
+         CommandData initialData = {MAIN_BODY, 0, false, -1, 3, NULL, -1, false}; 
+         generateProgramCode(decl->main_program, initialData);
+      }
+      iterator = iterator->next;
+   }
+   if(event_tracing) PTFI("traceEvent(TRACE_END, 1, 0);\n", 3);
+   PTFI("return true;\n", 3);
+   PTF("}\n\n");
+
    /* Open the runtime's main function and set up the execution environment. */
    PTF("int main(int argc, char **argv)\n");
    PTF("{\n");
    PTFI("srand(time(NULL));\n", 3);
+   PTFI("startMemoryAccounting();\n", 3);
    PTFI("openLogFile(\"gp2.log\");\n\n", 3);
-   PTFI("if(argc != 2)\n", 3);
+   if(event_tracing)
+      PTFI("openEventTrace(\"gp2.trace\", %d, %s);\n", 3, rule_count,
+           rule_count > 0 ? "rule_names" : "NULL");
+   PTFI("if(argc >= 2 && strcmp(argv[1], \"--batch\") == 0)\n", 3);
+   PTFI("{\n", 3);
+   PTFI("makeMorphisms();\n", 6);
+   PTFI("int status = runBatch(argc - 2, argv + 2, buildHostGraph, runProgram);\n", 6);
+   PTFI("garbageCollect();\n", 6);
+   PTFI("return status;\n", 6);
+   PTFI("}\n", 3);
+   PTFI("if(argc >= 2 && strcmp(argv[1], \"--serve\") == 0)\n", 3);
+   PTFI("{\n", 3);
+   PTFI("makeMorphisms();\n", 6);
+   PTFI("int status = runServer(argc - 2, argv + 2, parseHostGraph, runProgram);\n", 6);
+   PTFI("garbageCollect();\n", 6);
+   PTFI("return status;\n", 6);
+   PTFI("}\n", 3);
+   PTFI("/* gp2run --profile <host-file> also writes the rule profiles. */\n", 3);
+   PTFI("bool profile = argc == 3 && strcmp(argv[1], \"--profile\") == 0;\n", 3);
+   PTFI("if(argc != 2 && !profile)\n", 3);
    PTFI("{\n", 3);
    PTFI("fprintf(stderr, \"Error: missing <host-file> argument.\\n\");\n", 6);
    PTFI("return 0;\n", 6);
    PTFI("}\n\n", 3);    
-   #if defined GRAPH_TRACING || defined RULE_TRACING || defined BACKTRACK_TRACING
-      PTFI("openTraceFile(\"gp2.trace\");\n", 3);
-   #endif
 
-   PTFI("host = buildHostGraph(argv[1]);\n", 3);
+   PTFI("host = buildHostGraph(argv[argc - 1]);\n", 3);
    PTFI("if(host == NULL)\n", 3);
    PTFI("{\n", 3);
    PTFI("fprintf(stderr, \"Error parsing host graph file.\\n\");\n", 6);
@@ -180,33 +305,20 @@ void generateRuntimeMain(List *declarations, string output_dir,
    PTFI("perror(\"gp2.output\");\n", 6);
    PTFI("exit(1);\n", 6);
    PTFI("}\n", 3);
-
-   #ifdef GRAPH_TRACING
-      PTFI("print_trace(\"Start Graph: \\n\");\n", 3);
-      PTFI("printGraph(host, trace_file);\n\n", 3);
-   #endif
- 
-   /* Print the calls to allocate memory for each morphism. */
-   generateMorphismCode(declarations, 'm', true);
-
-   /* Find the main declaration and generate code from its command sequence. */
-   List *iterator = declarations;
-   while(iterator != NULL)
-   {
-      GPDeclaration *decl = iterator->declaration;
-      if(decl->type == MAIN_DECLARATION)
-      {
-         CommandData initialData = {MAIN_BODY, 0, false, -1, 3}; 
-         generateProgramCode(decl->main_program, initialData);
-      }
-      iterator = iterator->next;
-   }
-   PTF("   printGraph(host, output_file);\n");
-   PTF("   printf(\"Output graph saved to file gp2.output\\n\");\n");
-   PTF("   garbageCollect();\n");
+   PTFI("makeMorphisms();\n", 3);
+   PTFI("if(runProgram(output_file))\n", 3);
+   PTFI("{\n", 3);
+   PTFI("GP2_PROBE2(output_write_start, host->number_of_nodes, host->number_of_edges);\n", 6);
+   PTFI("printGraph(host, output_file);\n", 6);
+   PTFI("GP2_PROBE(output_write_end);\n", 6);
+   PTFI("printf(\"Output graph saved to file gp2.output\\n\");\n", 6);
+   PTFI("}\n", 3);
+   PTFI("else printf(\"Output information saved to file gp2.output\\n\");\n", 3);
+   PTFI("if(profile) writeProfile();\n", 3);
+   PTFI("garbageCollect();\n", 3);
    //PTF("   printf(\"Graph changes recorded: %%d\\n\", graph_change_count);\n");
-   PTF("   fclose(output_file);\n");
-   PTF("   return 0;\n");
+   PTFI("fclose(output_file);\n", 3);
+   PTFI("return 0;\n", 3);
    PTF("}\n\n");
    fclose(file);
 }
@@ -267,10 +379,64 @@ static void generateMorphismCode(List *declarations, char type, bool first_call)
       }
       declarations = declarations->next;
    }
-   if(type == 'd' || type == 'm') PTF("\n");
-   else if(first_call) PTF("}\n\n");
+   if(type == 'd') PTF("\n");
+   else if(type == 'f' && first_call) PTF("}\n\n");
 }
 
+/* Appends the names of the declared rules to rule_names. */
+static void collectRuleNames(List *declarations)
+{
+   while(declarations != NULL)
+   {
+      GPDeclaration *decl = declarations->declaration;
+      if(decl->type == PROCEDURE_DECLARATION && decl->procedure->local_decls != NULL)
+         collectRuleNames(decl->procedure->local_decls);
+      if(decl->type == RULE_DECLARATION)
+      {
+         rule_names = realloc(rule_names, (rule_count + 1) * sizeof(string));
+         if(rule_names == NULL)
+         {
+            print_to_log("Error (collectRuleNames): malloc failure.\n");
+            exit(1);
+         }
+         rule_names[rule_count++] = decl->rule->name;
+      }
+      declarations = declarations->next;
+   }
+}
+
+/* Returns the identifier of the rule in the event trace. */
+static int ruleIdentifier(string rule_name)
+{
+   int rule;
+   for(rule = 0; rule < rule_count; rule++)
+      if(!strcmp(rule_names[rule], rule_name)) return rule;
+   print_to_log("Error (ruleIdentifier): rule %s not found.\n", rule_name);
+   return -1;
+}
+
+/* Emits the record of a restore point, undo or discard to the event trace. The
+ * record holds the restore point and its position on the graph change stack. */
+static void generateTraceEvent(string event, int restore_point, int indent)
+{
+   if(!event_tracing) return;
+   PTFI("traceEvent(%s, %d, restore_point%d);\n", indent, event, restore_point,
+        restore_point);
+}
+
+/* Prints a call to the profile function of each rule with a non-empty LHS. */
+static void generateProfileCode(List *declarations)
+{
+   while(declarations != NULL)
+   {
+      GPDeclaration *decl = declarations->declaration;
+      if(decl->type == PROCEDURE_DECLARATION && decl->procedure->local_decls != NULL)
+         generateProfileCode(decl->procedure->local_decls);
+      if(decl->type == RULE_DECLARATION && !decl->rule->empty_lhs)
+         PTFI("profile%s(profile_file);\n", 3, decl->rule->name);
+      declarations = declarations->next;
+   }
+}
 
 static void generateProgramCode(GPCommand *command, CommandData data)
 {
@@ -284,7 +450,8 @@ static void generateProgramCode(GPCommand *command, CommandData data)
            {
               GPCommand *command = commands->command;
               generateProgramCode(command, new_data);
-              if(data.context == LOOP_BODY && commands->next != NULL)
+              if((data.context == LOOP_BODY || data.context == SPECULATIVE_BODY)
+                 && commands->next != NULL)
                  PTFI("if(!success) break;\n\n", data.indent);             
               commands = commands->next;
            }           
@@ -293,7 +460,7 @@ static void generateProgramCode(GPCommand *command, CommandData data)
       case RULE_CALL:
            PTFI("/* Rule Call */\n", data.indent);
            generateRuleCall(command->rule_call.rule_name, command->rule_call.rule->empty_lhs,
-                            command->rule_call.rule->is_predicate, true, data);
+                            command->rule_call.rule->is_predicate, true, NULL, -1, data);
            break;
 
       case RULE_SET_CALL:
@@ -303,14 +470,20 @@ static void generateProgramCode(GPCommand *command, CommandData data)
            PTFI("{\n", data.indent);
            CommandData new_data = data;
            new_data.indent = data.indent + 3;
+           bool parallel = parallelRuleSet(command);
+           if(parallel) generateParallelMatch(command->rule_set, new_data.indent);
            List *rules = command->rule_set;
+           int set_index = 0;
            while(rules != NULL)
            {  
               string rule_name = rules->rule_call.rule_name;
               bool empty_lhs = rules->rule_call.rule->empty_lhs;
               bool predicate = rules->rule_call.rule->is_predicate;
-              generateRuleCall(rule_name, empty_lhs, predicate, rules->next == NULL, new_data);
+              generateRuleCall(rule_name, empty_lhs, predicate, rules->next == NULL,
+                               command == data.rule_set_call ? command->rule_set : NULL,
+                               parallel ? set_index : -1, new_data);
               rules = rules->next;
+              set_index++;
            }
            PTFI("} while(false);\n", data.indent);
            break;
@@ -366,14 +539,9 @@ static void generateProgramCode(GPCommand *command, CommandData data)
 	      if(command->inner_loop)
 	      {
 	         PTFI("/* Update restore point for next iteration of inner loop. */\n", data.indent);
-		 #ifdef BACKTRACK_TRACING
-		    PTFI("print_trace(\"Updating restore point %d.\\n\");\n", 
-                         data.indent, data.restore_point);
-		    PTFI("print_trace(\"Old: %%d. New: %%d.\\n\\n\", restore_point%d, "
-                         "topOfGraphChangeStack());\n", data.indent, data.restore_point);
-		 #endif
 		 PTFI("if(success) restore_point%d = topOfGraphChangeStack();\n", data.indent, 
 		      data.restore_point);
+                 generateTraceEvent("TRACE_RESTORE_POINT", data.restore_point, data.indent);
 	      }
               else
 	      {
@@ -388,11 +556,7 @@ static void generateProgramCode(GPCommand *command, CommandData data)
 		 else 
                  {
                     PTFI("discardChanges(restore_point%d);\n", data.indent, data.restore_point);
-		    #ifdef BACKTRACK_TRACING
-		       PTFI("print_trace(\"Discarding graph changes.\\n\");\n", data.indent);
-		       PTFI("print_trace(\"New restore point %d: %%d.\\n\\n\", restore_point%d);\n",
-		            data.indent, data.restore_point, data.restore_point);
-		    #endif
+                    generateTraceEvent("TRACE_DISCARD", data.restore_point, data.indent);
 		 }
 	      }
            }
@@ -415,37 +579,35 @@ static void generateProgramCode(GPCommand *command, CommandData data)
  * predicate: If this flag is set, code to apply the rule is not generated.
  * last_rule: Set if this is the last rule in a rule set call. Controls the
  *            generation of failure code. 
+ * rule_set:  The rules of the rule set call if the rule is skipped while it is
+ *            known to be inapplicable, and NULL otherwise. The flags of the
+ *            rules are named with data.rule_set.
  * data:      CommandData passed from the calling command. */
 static void generateRuleCall(string rule_name, bool empty_lhs, bool predicate,
-                             bool last_rule, CommandData data)
+                             bool last_rule, List *rule_set, int set_index,
+                             CommandData data)
 {
    if(empty_lhs)
    {
-      #ifdef RULE_TRACING
-         PTFI("print_trace(\"Matched %s. (empty rule)\\n\\n\");\n", 
-              data.indent, rule_name);
-      #endif
       if(predicate) return;
       if(data.restore_point >= 0 && !graph_copying) 
          PTFI("apply%s(true);\n", data.indent, rule_name);
       else PTFI("apply%s(false);\n", data.indent, rule_name);
-      #ifdef GRAPH_TRACING
-         PTFI("print_trace(\"Graph after applying rule %s:\\n\");\n",
-              data.indent, rule_name);
-         PTFI("printGraph(host, trace_file);\n\n", data.indent);
-      #endif
+      if(event_tracing)
+         PTFI("traceEvent(TRACE_APPLY, %d, 0);\n", data.indent, ruleIdentifier(rule_name));
       PTFI("success = true;\n\n", data.indent);
    }
    else
    {
-      #ifdef RULE_TRACING
-         PTFI("print_trace(\"Matching %s...\\n\");\n", data.indent, rule_name);
-      #endif
-      PTFI("if(match%s(M_%s))\n", data.indent, rule_name, rule_name);
+      /* The rules of a parallel rule set call have already been matched. */
+      if(set_index >= 0) PTFI("if(matched_rule == %d)\n", data.indent, set_index);
+      else if(rule_set != NULL)
+         PTFI("if(possible%d_%s && match%s(M_%s))\n", data.indent, data.rule_set,
+              rule_name, rule_name, rule_name);
+      else PTFI("if(match%s(M_%s))\n", data.indent, rule_name, rule_name);
       PTFI("{\n", data.indent);
-      #ifdef RULE_TRACING
-         PTFI("print_trace(\"Matched %s.\\n\\n\");\n", data.indent + 3, rule_name);
-      #endif
+      if(event_tracing) PTFI("traceMatch(%d, M_%s);\n", data.indent + 3,
+                             ruleIdentifier(rule_name), rule_name);
       if(!predicate)
       {
          /* It is incorrect to apply the rule in a program such as "if r1 then P else Q",
@@ -458,14 +620,17 @@ static void generateRuleCall(string rule_name, bool empty_lhs, bool predicate,
             if(data.record_changes && !graph_copying) 
                  PTFI("apply%s(M_%s, true);\n", data.indent + 3, rule_name, rule_name);
             else PTFI("apply%s(M_%s, false);\n", data.indent + 3, rule_name, rule_name);
-            #ifdef GRAPH_TRACING
-               PTFI("print_trace(\"Graph after applying rule %s:\\n\");\n",
-                    data.indent + 3, rule_name);
-               PTFI("printGraph(host, trace_file);\n\n", data.indent + 3);
-            #endif
+            if(event_tracing) PTFI("traceEvent(TRACE_APPLY, %d, 0);\n", data.indent + 3,
+                                   ruleIdentifier(rule_name));
          }
          else PTFI("initialiseMorphism(M_%s, host);\n", data.indent + 3, rule_name);
       }
+      /* The matching function leaves the match of a predicate rule for traceMatch
+       * (see generateMatchingCode in genRule.c). */
+      else if(event_tracing)
+         PTFI("initialiseMorphism(M_%s, %s);\n", data.indent + 3, rule_name,
+              parallel_rule_sets ? "NULL" : "host");
+      if(rule_set != NULL) generateEnablingCode(rule_name, rule_set, data);
       PTFI("success = true;\n", data.indent + 3);
       /* If this rule call is within a rule set, and it is not the last rule in that
        * set, print a break statement to exit the containing do-while loop of the rule
@@ -477,23 +642,231 @@ static void generateRuleCall(string rule_name, bool empty_lhs, bool predicate,
       {
          PTFI("else\n", data.indent);
          PTFI("{\n", data.indent);
-         #ifdef RULE_TRACING
-            PTFI("print_trace(\"Failed to match %s.\\n\\n\");\n",
-                 data.indent + 3, rule_name);
-         #endif
+         if(event_tracing) PTFI("traceEvent(TRACE_FAIL, %d, 0);\n", data.indent + 3,
+                                ruleIdentifier(rule_name));
          CommandData new_data = data;
          new_data.indent = data.indent + 3;
          generateFailureCode(rule_name, new_data);
          PTFI("}\n", data.indent);  
       }
-      else 
+      else if(rule_set != NULL)
+      {
+         PTFI("else\n", data.indent);
+         PTFI("{\n", data.indent);
+         PTFI("possible%d_%s = false;\n", data.indent + 3, data.rule_set, rule_name);
+         if(event_tracing) PTFI("traceEvent(TRACE_FAIL, %d, 0);\n", data.indent + 3,
+                                ruleIdentifier(rule_name));
+         PTFI("}\n", data.indent);
+      }
+      else if(event_tracing)
+         PTFI("else traceEvent(TRACE_FAIL, %d, 0);\n", data.indent, ruleIdentifier(rule_name));
+   }
+}
+
+static bool ruleMayEnable(GPRule *applied, GPRule *failed)
+{
+   if(applied->transformed_rule == NULL || failed->transformed_rule == NULL) 
+      return true;
+   return mayEnable(applied->transformed_rule, failed->transformed_rule);
+}
+
+/* Emits code to set the flags of the rules in the looped rule set that the
+ * application of the rule <rule_name> may have made applicable. */
+/* A rule set call is matched in parallel if gp2 -t is given, unless it has
+ * only one rule, a rule occurs twice in the set, or a rule has an empty LHS. */
+static bool parallelRuleSet(GPCommand *command)
+{
+   if(!parallel_rule_sets || command->type != RULE_SET_CALL) return false;
+   List *rules, *others;
+   if(command->rule_set == NULL || command->rule_set->next == NULL) return false;
+   for(rules = command->rule_set; rules != NULL; rules = rules->next)
+   {
+      if(rules->rule_call.rule->empty_lhs) return false;
+      for(others = rules->next; others != NULL; others = others->next)
+         if(!strcmp(others->rule_call.rule_name, rules->rule_call.rule_name))
+            return false;
+   }
+   return true;
+}
+
+/* Generates the call that matches the rules of a parallel rule set call (see
+ * ruleSet.h in the library). The rule calls that follow test matched_rule. */
+static void generateParallelMatch(List *rule_set, int indent)
+{
+   int count = 0;
+   List *rules;
+   PTFI("MatchFunction matchers[] = {", indent);
+   for(rules = rule_set; rules != NULL; rules = rules->next)
+      PTF("%smatch%s", count++ == 0 ? "" : ", ", rules->rule_call.rule_name);
+   PTF("};\n");
+   count = 0;
+   PTFI("Morphism *morphisms[] = {", indent);
+   for(rules = rule_set; rules != NULL; rules = rules->next)
+      PTF("%sM_%s", count++ == 0 ? "" : ", ", rules->rule_call.rule_name);
+   PTF("};\n");
+   PTFI("int matched_rule = matchRuleSet(%d, matchers, morphisms);\n", indent, count);
+}
+
+static void generateEnablingCode(string rule_name, List *rule_set, CommandData data)
+{
+   GPRule *applied = NULL;
+   List *rules = rule_set;
+   while(rules != NULL)
+   {
+      if(!strcmp(rules->rule_call.rule_name, rule_name)) applied = rules->rule_call.rule;
+      rules = rules->next;
+   }
+   for(rules = rule_set; rules != NULL; rules = rules->next)
+   {
+      if(!strcmp(rules->rule_call.rule_name, rule_name)) continue;
+      if(applied == NULL || ruleMayEnable(applied, rules->rule_call.rule))
+         PTFI("possible%d_%s = true;\n", data.indent + 3, data.rule_set,
+              rules->rule_call.rule_name);
+   }
+}
+
+/* Returns the rule set call that makes up the loop body if it is
+ * worth keeping a flag for each rule at runtime. The body is examined as in
+ * singleRule, so leading commands that do not change the host graph are
+ * allowed. The flags pay off only if some rule in the set cannot enable some
+ * other rule, and they are not used if a rule occurs twice in the set or if
+ * a rule has an empty LHS. Otherwise NULL is returned. */
+static GPCommand *loopedRuleSet(GPCommand *command)
+{
+   switch(command->type)
+   {
+      case COMMAND_SEQUENCE:
+      {
+           List *commands = command->commands;
+           while(commands != NULL && nullCommand(commands->command))
+              commands = commands->next;
+           if(commands == NULL || commands->next != NULL) return NULL;
+           return loopedRuleSet(commands->command);
+      }
+      case PROCEDURE_CALL:
+           return loopedRuleSet(command->proc_call.procedure->commands);
+
+      case RULE_SET_CALL:
+      {
+           /* Parallel rule set calls match every rule of the set. */
+           if(parallelRuleSet(command)) return NULL;
+           bool pruning = false;
+           List *rules, *others;
+           for(rules = command->rule_set; rules != NULL; rules = rules->next)
+           {
+              GPRule *rule = rules->rule_call.rule;
+              if(rule->empty_lhs) return NULL;
+              for(others = command->rule_set; others != NULL; others = others->next)
+              {
+                 if(others == rules) continue;
+                 if(!strcmp(others->rule_call.rule_name, rules->rule_call.rule_name))
+                    return NULL;
+                 if(!ruleMayEnable(rule, others->rule_call.rule)) pruning = true;
+              }
+           }
+           return pruning ? command : NULL;
+      }
+      default:
+           return NULL;
+   }
+}
+
+/* Returns true if the command contains a break statement that is not inside
+ * a loop of the command. */
+static bool breaksLoop(GPCommand *command)
+{
+   switch(command->type)
+   {
+      case COMMAND_SEQUENCE:
       {
-         #ifdef RULE_TRACING
-            PTFI("else print_trace(\"Failed to match %s.\\n\\n\");\n",
-                 data.indent, rule_name);
-         #endif
+           List *commands;
+           for(commands = command->commands; commands != NULL; commands = commands->next)
+              if(breaksLoop(commands->command)) return true;
+           return false;
       }
+      case PROCEDURE_CALL:
+           return breaksLoop(command->proc_call.procedure->commands);
+
+      case IF_STATEMENT:
+      case TRY_STATEMENT:
+           return breaksLoop(command->cond_branch.condition) ||
+                  breaksLoop(command->cond_branch.then_command) ||
+                  breaksLoop(command->cond_branch.else_command);
+
+      case PROGRAM_OR:
+           return breaksLoop(command->or_stmt.left_command) ||
+                  breaksLoop(command->or_stmt.right_command);
+
+      case BREAK_STATEMENT:
+           return true;
+
+      default:
+           return false;
+   }
+}
+
+/* The then branch of an if statement is run speculatively if gp2 -s is given,
+ * unless the condition is sufficiently simple, the then branch does not change
+ * the host graph, or the then branch breaks out of the enclosing loop. Only the
+ * outermost of nested then branches is speculated. The then branch of a try
+ * statement is not speculated because it starts from the graph produced by the
+ * condition. */
+static bool speculativeBranch(GPCommand *command, CommandData data)
+{
+   if(!speculative_branches || graph_copying || data.speculative) return false;
+   if(command->type != IF_STATEMENT) return false;
+   if(singleRule(command->cond_branch.condition)) return false;
+   if(nullCommand(command->cond_branch.then_command)) return false;
+   return !breaksLoop(command->cond_branch.then_command);
+}
+
+/* Generates the speculative then branch of an if statement, which runs while
+ * the condition is evaluated by a child process (see speculation.h in the
+ * library). The then branch records its changes so that they can be undone if
+ * the speculation is aborted. Its loops are generated as inner loops so that
+ * the changes of their iterations are kept. The code that evaluates the
+ * condition follows in the else block emitted by the caller. */
+static void generateSpeculativeBranch(GPCommand *command, CommandData data, int speculation)
+{
+   CommandData then_data = data;
+   then_data.context = SPECULATIVE_BODY;
+   then_data.loop_depth++;
+   then_data.record_changes = true;
+   then_data.restore_point = restore_point_count++;
+   then_data.indent = data.indent + 6;
+   then_data.speculative = true;
+
+   PTFI("bool committed%d = false;\n", data.indent, speculation);
+   PTFI("int speculation%d = startSpeculation(%d);\n", data.indent, speculation, speculation);
+   PTFI("if(speculation%d > 0)\n", data.indent, speculation);
+   PTFI("{\n", data.indent);
+   PTFI("/* Speculative Then Branch */\n", data.indent + 3);
+   PTFI("int restore_point%d = graph_change_stack == NULL ? 0 : topOfGraphChangeStack();\n",
+        data.indent + 3, then_data.restore_point);
+   PTFI("success = true;\n", data.indent + 3);
+   PTFI("do\n", data.indent + 3);
+   PTFI("{\n", data.indent + 3);
+   generateProgramCode(command->cond_branch.then_command, then_data);
+   PTFI("} while(false);\n", data.indent + 3);
+   PTFI("bool condition%d = false;\n", data.indent + 3, speculation);
+   PTFI("committed%d = finishSpeculation(%d, success, &condition%d);\n", data.indent + 3,
+        speculation, speculation, speculation);
+   /* Committed changes are kept if an enclosing command may undo them. */
+   if(data.record_changes)
+      PTFI("if(!committed%d) undoChanges(host, restore_point%d);\n", data.indent + 3,
+           speculation, then_data.restore_point);
+   else
+   {
+      PTFI("if(committed%d) discardChanges(restore_point%d);\n", data.indent + 3,
+           speculation, then_data.restore_point);
+      PTFI("else undoChanges(host, restore_point%d);\n", data.indent + 3,
+           then_data.restore_point);
    }
+   if(event_tracing)
+      PTFI("if(!committed%d) traceEvent(TRACE_UNDO, %d, restore_point%d);\n", data.indent + 3,
+           speculation, then_data.restore_point, then_data.restore_point);
+   PTFI("success = condition%d;\n", data.indent + 3, speculation);
+   PTFI("}\n", data.indent);
 }
 
 /* generateBranchStatement passes on the second argument 'data' to the calls to
@@ -541,67 +914,67 @@ static void generateBranchStatement(GPCommand *command, CommandData data)
 
    if(condition_data.context == IF_BODY) PTFI("/* If Statement */\n", data.indent);
    else PTFI("/* Try Statement */\n", data.indent);
-   PTFI("/* Condition */\n", data.indent);
+   /* The condition code is indented further if it follows the speculative
+    * then branch. */
+   int indent = data.indent;
+   int speculation = speculativeBranch(command, data) ? speculation_count++ : -1;
+   if(speculation >= 0)
+   {
+      generateSpeculativeBranch(command, data, speculation);
+      PTFI("else\n", data.indent);
+      PTFI("{\n", data.indent);
+      indent += 3;
+      condition_data.indent += 3;
+   }
+   PTFI("/* Condition */\n", indent);
    if(condition_data.restore_point >= 0)
    {
-      #ifdef BACKTRACK_TRACING
-         PTFI("print_trace(\"Recording graph changes.\\n\");\n", data.indent);
-      #endif
-      if(graph_copying) PTFI("copyGraph(host);\n", data.indent);
+      if(graph_copying) PTFI("copyGraph(host);\n", indent);
       else 
       {
          PTFI("int restore_point%d = graph_change_stack == NULL ? 0 : topOfGraphChangeStack();\n",
-              data.indent, condition_data.restore_point);
-         #ifdef BACKTRACK_TRACING
-	    PTFI("print_trace(\"Restore point %d: %%d.\\n\\n\", restore_point%d);\n",
-	         data.indent, condition_data.restore_point, condition_data.restore_point);
-         #endif
+              indent, condition_data.restore_point);
+         generateTraceEvent("TRACE_RESTORE_POINT", condition_data.restore_point, indent);
       }
    }
-   PTFI("do\n", data.indent);
-   PTFI("{\n", data.indent);
+   PTFI("do\n", indent);
+   PTFI("{\n", indent);
    generateProgramCode(command->cond_branch.condition, condition_data);
-   PTFI("} while(false);\n\n", data.indent);
+   PTFI("} while(false);\n", indent);
+   if(speculation >= 0) PTFI("if(speculation%d == 0) exitCondition(success);\n", indent,
+                             speculation);
+   PTF("\n");
 
    if(condition_data.context == IF_BODY)
    {
       if(condition_data.restore_point >= 0)
       {
-         if(graph_copying) PTFI("host = popGraphs(%d);\n", data.indent, 
+         if(graph_copying) PTFI("host = popGraphs(%d);\n", indent, 
                                 condition_data.restore_point);
-         else PTFI("undoChanges(host, restore_point%d);\n", data.indent, 
+         else PTFI("undoChanges(host, restore_point%d);\n", indent, 
                    condition_data.restore_point);
-         #ifdef BACKTRACK_TRACING
-            PTFI("print_trace(\"Undoing graph changes from restore point %d: %%d.\\n\\n\", "
-		 "restore_point%d);\n", 
-		 data.indent, condition_data.restore_point, condition_data.restore_point);
-         #endif
-         #ifdef GRAPH_TRACING
-            PTFI("print_trace(\"Restored graph:\\n\");\n", data.indent);
-            PTFI("printGraph(host, trace_file);\n", data.indent);
-         #endif
+         generateTraceEvent("TRACE_UNDO", condition_data.restore_point, indent);
       }
    }
+   if(speculation >= 0) PTFI("}\n", data.indent);
    /* Update the indentation of the passed command data for the calls to generate the
     * then-branch and else-branch code. */
    CommandData new_data = data;
    new_data.indent = data.indent + 3;
    PTFI("/* Then Branch */\n", data.indent);
-   PTFI("if(success)\n", data.indent);
+   if(speculation >= 0) PTFI("if(success && !committed%d)\n", data.indent, speculation);
+   else PTFI("if(success)\n", data.indent);
    PTFI("{\n", data.indent);
    if(condition_data.context == TRY_BODY && condition_data.restore_point >= 0)
    {
       PTFI("discardChanges(restore_point%d);\n", new_data.indent, condition_data.restore_point);
-      #ifdef BACKTRACK_TRACING
-         PTFI("print_trace(\"Discarding graph changes.\\n\");\n", new_data.indent);
-         PTFI("print_trace(\"New restore point %d: %%d.\\n\\n\", restore_point%d);\n",
-              new_data.indent, condition_data.restore_point, condition_data.restore_point);
-      #endif
+      generateTraceEvent("TRACE_DISCARD", condition_data.restore_point, new_data.indent);
    }
    generateProgramCode(command->cond_branch.then_command, new_data);
    PTFI("}\n", data.indent);
    PTFI("/* Else Branch */\n", data.indent);
-   PTFI("else\n", data.indent);
+   if(speculation >= 0) PTFI("else if(!committed%d)\n", data.indent, speculation);
+   else PTFI("else\n", data.indent);
    PTFI("{\n", data.indent);
    if(condition_data.context == TRY_BODY)
    {
@@ -611,15 +984,7 @@ static void generateBranchStatement(GPCommand *command, CommandData data)
                                 condition_data.restore_point);
          else PTFI("undoChanges(host, restore_point%d);\n", new_data.indent, 
                    condition_data.restore_point);
-         #ifdef BACKTRACK_TRACING
-            PTFI("print_trace(\"Undoing graph changes from restore point %d: %%d.\\n\\n\", "
-		 "restore_point%d);\n", 
-		 new_data.indent, condition_data.restore_point, condition_data.restore_point);
-         #endif
-         #ifdef GRAPH_TRACING
-            PTFI("print_trace(\"Restored graph:\\n\");\n", new_data.indent);
-            PTFI("printGraph(host, trace_file);\n", new_data.indent);
-         #endif
+         generateTraceEvent("TRACE_UNDO", condition_data.restore_point, new_data.indent);
       }
    }
    PTFI("success = true;\n", new_data.indent); /* Reset success flag before executing else branch. */
@@ -645,6 +1010,12 @@ void generateLoopStatement(GPCommand *command, CommandData data)
    loop_data.loop_depth++;
    loop_data.indent = data.indent + 3;
 
+   /* If the loop body is a rule set call, a rule that fails to match stays
+    * inapplicable until some rule that may enable it is applied. Such rules are
+    * skipped by the rule set call. */
+   loop_data.rule_set_call = loopedRuleSet(command->loop_stmt.loop_body);
+   loop_data.rule_set = loop_data.rule_set_call == NULL ? -1 : rule_set_count++;
+
    /* If the loop body requires recording, assign it the next restore point. */
    if(singleRule(command->loop_stmt.loop_body)) 
       loop_data.restore_point = -1;
@@ -657,21 +1028,27 @@ void generateLoopStatement(GPCommand *command, CommandData data)
    PTFI("/* Loop Statement */\n", data.indent);
    if(loop_data.restore_point >= 0)
    {
-      #ifdef BACKTRACK_TRACING
-         PTFI("print_trace(\"Recording graph changes.\\n\\n\");\n", data.indent);
-      #endif
       if(graph_copying) PTFI("copyGraph(host);\n", data.indent);
       else 
       { 
          PTFI("int restore_point%d = graph_change_stack == NULL ? 0 : topOfGraphChangeStack();\n",
               data.indent, loop_data.restore_point);
-         #ifdef BACKTRACK_TRACING
-	    PTFI("print_trace(\"Restore point %d: %%d.\\n\\n\", restore_point%d);\n",
-	         data.indent, loop_data.restore_point, loop_data.restore_point);
-         #endif
+         generateTraceEvent("TRACE_RESTORE_POINT", loop_data.restore_point, data.indent);
       }
    }
-   PTFI("while(success)\n", data.indent);
+   if(loop_data.rule_set_call != NULL)
+   {
+      PTFI("/* Rules of the looped rule set that may be applicable. */\n", data.indent);
+      List *rule_set;
+      for(rule_set = loop_data.rule_set_call->rule_set; rule_set != NULL; 
+          rule_set = rule_set->next)
+         PTFI("bool possible%d_%s = true;\n", data.indent, loop_data.rule_set,
+              rule_set->rule_call.rule_name);
+   }
+   /* A loop in a speculative then branch stops once the condition is known to
+    * have failed. */
+   if(data.speculative) PTFI("while(success && !speculation_failed)\n", data.indent);
+   else PTFI("while(success)\n", data.indent);
    PTFI("{\n", data.indent);
    generateProgramCode(command->loop_stmt.loop_body, loop_data);
    if(loop_data.restore_point >= 0)
@@ -679,14 +1056,9 @@ void generateLoopStatement(GPCommand *command, CommandData data)
       if(loop_data.loop_depth > 1)
       {
          PTFI("/* Update restore point for next iteration of inner loop. */\n", data.indent + 3);
-	 #ifdef BACKTRACK_TRACING
-	    PTFI("print_trace(\"Updating restore point %d.\\n\");\n",
-		 data.indent + 3, loop_data.restore_point);
-            PTFI("print_trace(\"Old: %%d. New: %%d.\\n\\n\", restore_point%d, "
-                 "topOfGraphChangeStack());\n", data.indent + 3, loop_data.restore_point);
-	 #endif
 	 PTFI("if(success) restore_point%d = topOfGraphChangeStack();\n", data.indent + 3, 
               loop_data.restore_point);
+         generateTraceEvent("TRACE_RESTORE_POINT", loop_data.restore_point, data.indent + 3);
       }
       else
       {
@@ -705,11 +1077,7 @@ void generateLoopStatement(GPCommand *command, CommandData data)
          {
 	    PTFI("if(success) discardChanges(restore_point%d);\n", 
 	         data.indent + 3, loop_data.restore_point);
-            #ifdef BACKTRACK_TRACING
-	         PTFI("print_trace(\"Discarding graph changes.\\n\");\n", data.indent + 3);
-	         PTFI("print_trace(\"New restore point %d: %%d.\\n\\n\", restore_point%d);\n",
-	              data.indent + 3, loop_data.restore_point, loop_data.restore_point);
-	    #endif
+            generateTraceEvent("TRACE_DISCARD", loop_data.restore_point, data.indent + 3);
          }
       }
    }
@@ -725,43 +1093,31 @@ void generateLoopStatement(GPCommand *command, CommandData data)
 
 static void generateFailureCode(string rule_name, CommandData data)
 {
+   if(event_tracing && rule_name == NULL) PTFI("traceEvent(TRACE_FAIL, -1, 0);\n", data.indent);
    /* A failure in the main body ends the execution. Emit code to report the 
-    * failure, garbage collect and return 0. */
+    * failure and return false from runProgram. */
    if(data.context == MAIN_BODY)
    {
-      #ifdef GRAPH_TRACING
-         PTFI("print_trace(\"Program failed. Final graph:\\n\");\n", data.indent);
-         PTFI("printGraph(host, trace_file);\n", data.indent);
-      #endif
+      if(event_tracing) PTFI("traceEvent(TRACE_END, 0, 0);\n", data.indent);
       if(rule_name != NULL)
          PTFI("fprintf(output_file, \"No output graph: rule %s not applicable.\\n\");\n",
               data.indent, rule_name);
       else PTFI("fprintf(output_file, \"No output graph: Fail statement invoked\\n\");\n",
                 data.indent);
-      PTFI("printf(\"Output information saved to file gp2.output\\n\");\n", data.indent);
-      PTFI("garbageCollect();\n", data.indent);
-      //PTFI("printf(\"Graph changes recorded: %%d\\n\", graph_change_count);\n", data.indent);
-      PTFI("fclose(output_file);\n", data.indent);
-      PTFI("return 0;\n", data.indent);
+      PTFI("return false;\n", data.indent);
    }
    /* In other contexts, set the runtime success flag to false. */
    else PTFI("success = false;\n", data.indent);
 
-   if(data.context == IF_BODY || data.context == TRY_BODY) PTFI("break;\n", data.indent);
+   if(data.context == IF_BODY || data.context == TRY_BODY || data.context == SPECULATIVE_BODY)
+      PTFI("break;\n", data.indent);
    if(data.context == LOOP_BODY) 
    {
       if(data.restore_point >= 0) 
       {
          if(graph_copying) PTFI("host = popGraphs(%d);\n", data.indent, data.restore_point);
          else PTFI("undoChanges(host, restore_point%d);\n", data.indent, data.restore_point);
-         #ifdef BACKTRACK_TRACING
-            PTFI("print_trace(\"Undoing graph changes from restore point %d: %%d\\n\\n\", "
-		 "restore_point%d);\n", data.indent, data.restore_point, data.restore_point);
-         #endif
-         #ifdef GRAPH_TRACING
-            PTFI("print_trace(\"Restored graph:\\n\");\n", data.indent);
-            PTFI("printGraph(host, trace_file);\n", data.indent);
-         #endif
+         generateTraceEvent("TRACE_UNDO", data.restore_point, data.indent);
       }
    }
 }
@@ -774,7 +1130,7 @@ static void generateFailureCode(string rule_name, CommandData data)
  * The analysis skips leading null commands in a command sequence, and it also
  * returns true if both operands of an OR statement fit the criteria. */
 
-static bool singleRule(GPCommand *command)
+bool singleRule(GPCommand *command)
 {
    switch(command->type)
    {
@@ -839,7 +1195,7 @@ static bool singleRule(GPCommand *command)
 /* The function neverFails returns true if the passed GP 2 command is non-failing.
  * Used to test conditions and loop bodies: if these always succeed, then backtracking
  * is not necessary for try statements and loops. */
-static bool neverFails(GPCommand *command)
+bool neverFails(GPCommand *command)
 {
    switch(command->type)
    {
@@ -904,7 +1260,7 @@ static bool neverFails(GPCommand *command)
 }
 
 /* Returns true if the passed GP 2 command does not change the host graph. */
-static bool nullCommand(GPCommand *command)
+bool nullCommand(GPCommand *command)
 {
    switch(command->type)
    {
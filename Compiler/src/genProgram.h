@@ -30,6 +30,7 @@
 
 #include "ast.h"
 #include "common.h"
+#include "rule.h"
 
 #include <assert.h>
 #include <stdarg.h>
@@ -41,6 +42,15 @@
 void generateRuntimeMain(List *declarations, string output_dir,
                          long max_nodes, long max_edges);
 
+/* Static analyses of GP 2 commands used to decide where host graph changes
+ * need to be recorded. They are shared with the bytecode generator.
+ * singleRule - The command amounts to a single rule call or something simpler.
+ * neverFails - The command cannot fail.
+ * nullCommand - The command does not change the host graph. */
+bool singleRule(GPCommand *command);
+bool neverFails(GPCommand *command);
+bool nullCommand(GPCommand *command);
+
 /* Arguments passed to the newGraph function at runtime. */
 #define HOST_NODE_SIZE 128
 #define HOST_EDGE_SIZE 128
@@ -100,12 +110,13 @@ void generateRuntimeMain(List *declarations, string output_dir,
  * The code generated for a failure to match a rule depends on the context of
  * the rule call.
  *
+ * The main program is generated as the function runProgram, which main calls
+ * once, or once per host graph in batch mode (see driver.h in the library).
  * Failure code for rules at the 'top level' is:
  * fprintf(output_file, "No output graph: rule <rule_name> not applicable.\n");
  * OR
  * fprintf(outout_file, "No output graph: Fail statement invoked.\n");
- * garbageCollect();
- * return 0;
+ * return false;
  *
  * Failure code for rules within a loop body is:
  * success = false;
@@ -137,6 +148,23 @@ void generateRuntimeMain(List *declarations, string output_dir,
  *    else <context-dependent failure code>
  * } while(false);
  *
+ * With gp2 -t, the rules of the set are first matched in parallel (see
+ * ruleSet.h in the library) and the rule calls test the index of the rule
+ * whose match was found first:
+ *
+ * do
+ * {
+ *    MatchFunction matchers[] = {matchR1, matchR2};
+ *    Morphism *morphisms[] = {M_R1, M_R2};
+ *    int matched_rule = matchRuleSet(2, matchers, morphisms);
+ *    if(matched_rule == 0)
+ *    {
+ *       <matching success code>
+ *       break;
+ *    }
+ *    if(matched_rule == 1) ...
+ * } while(false);
+ *
  *
  * Conditional Branch if/try C then P else Q
  * ===========================================
@@ -173,6 +201,28 @@ void generateRuntimeMain(List *declarations, string output_dir,
  * The program code will set the success flag to false when a rule application
  * fails (in some contexts) which will break the loop.
  *
+ * If P is a rule set call {R1, R2} and the rule-enabling analysis (mayEnable
+ * in rule.h) finds that some rule of the set cannot make another applicable,
+ * each rule gets a flag that is cleared when its match fails. The rule is not
+ * matched again until a rule that may enable it is applied:
+ * bool possible0_R1 = true;
+ * bool possible0_R2 = true;
+ * while(success)
+ * {
+ *    do
+ *    {
+ *       if(possible0_R1 && matchR1(M_R1))
+ *       {
+ *          applyR1(M_R1);
+ *          possible0_R2 = true; (if R1 may enable R2)
+ *          success = true;
+ *          break;
+ *       }
+ *       else possible0_R1 = false;
+ *       ...
+ *    } while(false);
+ * }
+ *
  * Or Statement P or Q
  * ===================
  * C's rand function is used to nondeterministically choose between the two programs.
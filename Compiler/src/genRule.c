@@ -14,9 +14,10 @@
   along with the GP 2 Compiler. If not, see <http://www.gnu.org/licenses/>. */
 
 #include "genRule.h"
+#include "signature.h"
 
 static void generateMatchingCode(Rule *rule, bool predicate);
-static void emitDegreeCheck(RuleNode *left_node, int indent);
+static void emitDegreeCheck(Rule *rule, RuleNode *left_node, int indent);
 static void emitRootNodeMatcher(Rule *rule, RuleNode *left_node, SearchOp *next_op);
 static void emitNodeMatcher(Rule *rule, RuleNode *left_node, SearchOp *next_op);
 static void emitNodeFromEdgeMatcher(Rule *rule, RuleNode *left_node, char type, SearchOp *next_op);
@@ -31,6 +32,31 @@ static void emitNextMatcherCall(SearchOp *next_operation);
 FILE *header = NULL;
 FILE *file = NULL;
 Searchplan *searchplan = NULL;
+int matching_op = -1;
+/* The name prefix of the matching functions of the searchplan being emitted:
+ * "match" for the static searchplan and "match<n>" for alternative n. */
+static char matcher_prefix[16] = "match";
+
+static void setMatcherPrefix(int plan)
+{
+   if(plan == 0) strcpy(matcher_prefix, "match");
+   else sprintf(matcher_prefix, "match%d", plan);
+}
+
+/* Returns the expression that tests whether the host item (a Node or Edge
+ * pointer in the generated code) is already matched. With parallel rule sets,
+ * several rules are matched at once, so the test is made against the morphism
+ * and the matched flags of the host graph are neither read nor written. */
+static char matched_test[64];
+
+static string matchedTest(string item, bool node)
+{
+   if(parallel_rule_sets)
+      sprintf(matched_test, "%s(morphism, %s->index)",
+              node ? "nodeMatched" : "edgeMatched", item);
+   else sprintf(matched_test, "%s->matched", item);
+   return matched_test;
+}
 
 void generateRules(List *declarations, string output_dir)
 {
@@ -56,7 +82,7 @@ void generateRules(List *declarations, string output_dir)
               decl->rule->empty_lhs = rule->lhs == NULL;
               decl->rule->is_predicate = isPredicate(rule);
               generateRuleCode(rule, decl->rule->is_predicate, output_dir);
-              freeRule(rule);
+              decl->rule->transformed_rule = rule;
               break;
          }
          default: 
@@ -102,7 +128,8 @@ void generateRuleCode(Rule *rule, bool predicate, string output_dir)
                    "#include \"label.h\"\n"
                    "#include \"graphStacks.h\"\n"
                    "#include \"parser.h\"\n"
-                   "#include \"morphism.h\"\n\n");
+                   "#include \"morphism.h\"\n"
+                   "#include \"probes.h\"\n\n");
    PTF("#include \"%s.h\"\n\n", rule->name);
 
    if(rule->condition != NULL)
@@ -114,7 +141,8 @@ void generateRuleCode(Rule *rule, bool predicate, string output_dir)
        * The third iteration writes the functions to evaluate the predicates. */
       generateConditionVariables(rule->condition);
       PTF("\n");
-      generateConditionEvaluator(rule->condition, false);
+      if(hasEvaluatedPredicate(rule, rule->condition))
+         generateConditionEvaluator(rule->condition, false);
       generatePredicateEvaluators(rule, rule->condition);
    }
    if(rule->lhs != NULL) 
@@ -135,142 +163,361 @@ void generateRuleCode(Rule *rule, bool predicate, string output_dir)
    return;
 }
 
+/* Chooses the start nodes of the searchplans of a rule, returning the number
+ * of searchplans. The first searchplan is the static one. Alternatives start
+ * from an LHS node whose mark differs from those of the nodes already chosen,
+ * so that their candidate estimates at runtime can differ. Rules with a root
+ * node only get the static searchplan, which starts from the host graph's
+ * root nodes. */
+static int chooseStartNodes(RuleGraph *lhs, int *start_nodes)
+{
+   int index, plans = 1;
+   for(index = 0; index < lhs->node_index; index++)
+   {
+      if(getRuleNode(lhs, index)->root)
+      {
+         start_nodes[0] = -1;
+         return 1;
+      }
+   }
+   start_nodes[0] = 0;
+   for(index = 1; index < lhs->node_index && plans < MAX_SEARCHPLANS; index++)
+   {
+      MarkType mark = getRuleNode(lhs, index)->label.mark;
+      int plan;
+      for(plan = 0; plan < plans; plan++)
+         if(getRuleNode(lhs, start_nodes[plan])->label.mark == mark) break;
+      if(plan == plans) start_nodes[plans++] = index;
+   }
+   return plans;
+}
+
+/* Prints a constant-time estimate of the number of host nodes that the LHS
+ * node can match. */
+static void emitCandidateEstimate(RuleNode *node)
+{
+   if(node->label.mark == ANY) PTF("host->number_of_nodes - host->nodes_by_mark[0]");
+   else PTF("host->nodes_by_mark[%d]", node->label.mark);
+}
+
+/* The LHS cannot match if the host graph has fewer items with some mark or
+ * fewer root nodes than the LHS. */
+static void emitCardinalityCheck(RuleGraph *lhs)
+{
+   int node_marks[ANY] = {0}, edge_marks[ANY] = {0};
+   int index, roots = 0;
+   for(index = 0; index < lhs->node_index; index++)
+   {
+      RuleNode *node = getRuleNode(lhs, index);
+      if(node->label.mark != ANY) node_marks[node->label.mark]++;
+      if(node->root) roots++;
+   }
+   for(index = 0; index < lhs->edge_index; index++)
+   {
+      RuleEdge *edge = getRuleEdge(lhs, index);
+      if(edge->label.mark != ANY) edge_marks[edge->label.mark]++;
+   }
+   if(roots > 0) PTFI("if(host->number_of_roots < %d) return false;\n", 3, roots);
+   for(index = 0; index < ANY; index++)
+   {
+      if(node_marks[index] > 0)
+         PTFI("if(host->nodes_by_mark[%d] < %d) return false;\n", 3, index, node_marks[index]);
+      if(edge_marks[index] > 0)
+         PTFI("if(host->edges_by_mark[%d] < %d) return false;\n", 3, index, edge_marks[index]);
+   }
+}
+
+static void emitProfileFunction(string rule_name, int plans)
+{
+   fprintf(header, "void profile%s(FILE *profile_file);\n\n", rule_name);
+   PTF("void profile%s(FILE *profile_file)\n", rule_name);
+   PTF("{\n");
+   PTFI("fprintf(profile_file, \"%s: %%ld match calls\", profile_calls_%s);\n",
+        3, rule_name, rule_name);
+   if(plans > 1)
+   {
+      PTFI("fprintf(profile_file, \", searchplan selections\");\n", 3);
+      int plan;
+      for(plan = 0; plan < plans; plan++)
+         PTFI("fprintf(profile_file, \" %%ld\", profile_selections_%s[%d]);\n",
+              3, rule_name, plan);
+      PTFI("fprintf(profile_file, \", %%ld switches\", profile_switches_%s);\n",
+           3, rule_name);
+   }
+   PTFI("fprintf(profile_file, \"\\n\");\n", 3);
+   PTF("}\n\n");
+}
+
 static void generateMatchingCode(Rule *rule, bool predicate)
 {
-   searchplan = generateSearchplan(rule->lhs); 
-   if(searchplan->first == NULL)
+   int start_nodes[MAX_SEARCHPLANS];
+   int plans = chooseStartNodes(rule->lhs, start_nodes);
+   Searchplan *searchplans[MAX_SEARCHPLANS];
+   int plan;
+   for(plan = 0; plan < plans; plan++)
    {
-      print_to_log("Error: empty searchplan. Aborting.\n");
-      freeSearchplan(searchplan);
-      return;
+      if(plan == 0) searchplans[plan] = generateSearchplan(rule->lhs);
+      else searchplans[plan] = generateSearchplanFrom(rule->lhs, start_nodes[plan]);
+      if(searchplans[plan]->first == NULL)
+      {
+         print_to_log("Error: empty searchplan. Aborting.\n");
+         for(; plan >= 0; plan--) freeSearchplan(searchplans[plan]);
+         return;
+      }
    }
-   SearchOp *operation = searchplan->first;
-   /* Iterator over the searchplan to print the prototypes of the matching functions. */
-   while(operation != NULL)
+   /* Iterator over the searchplans to print the prototypes of the matching functions. */
+   for(plan = 0; plan < plans; plan++)
    {
-      char type = operation->type;
-      switch(type)
+      SearchOp *operation = searchplans[plan]->first;
+      setMatcherPrefix(plan);
+      while(operation != NULL)
       {
-         case 'n':
-         case 'r':
-              PTF("static bool match_n%d(Morphism *morphism);\n", operation->index);
-              break;
+         char type = operation->type;
+         switch(type)
+         {
+            case 'n':
+            case 'r':
+                 PTF("static bool %s_n%d(Morphism *morphism);\n", matcher_prefix,
+                     operation->index);
+                 break;
 
-         case 'i': 
-         case 'o': 
-         case 'b':
-              PTF("static bool match_n%d(Morphism *morphism, Edge *host_edge);\n",
-                  operation->index);
-              break;
+            case 'i': 
+            case 'o': 
+            case 'b':
+                 PTF("static bool %s_n%d(Morphism *morphism, Edge *host_edge);\n",
+                     matcher_prefix, operation->index);
+                 break;
 
-         case 'e': 
-         case 's': 
-         case 't':
-         case 'l':
-              PTF("static bool match_e%d(Morphism *morphism);\n", operation->index);
-              break;
+            case 'e': 
+            case 's': 
+            case 't':
+            case 'l':
+                 PTF("static bool %s_e%d(Morphism *morphism);\n", matcher_prefix,
+                     operation->index);
+                 break;
 
-         default:
-              print_to_log("Error (generateMatchingCode): Unexpected "
-                           "operation type %c.\n", operation->type);
-              break;
+            default:
+                 print_to_log("Error (generateMatchingCode): Unexpected "
+                              "operation type %c.\n", operation->type);
+                 break;
+         }
+         operation = operation->next;
       }
-      operation = operation->next;
+   }
+   /* Counters reported by the profile function. */
+   PTF("\nstatic long profile_calls_%s = 0;\n", rule->name);
+   if(plans > 1)
+   {
+      PTF("static long profile_selections_%s[%d];\n", rule->name, plans);
+      PTF("static long profile_switches_%s = 0;\n", rule->name);
+      PTF("static int last_searchplan_%s = -1;\n", rule->name);
    }
    /* Generate the main matching function which sets up the runtime matching 
-    * environment and calls the first matching function. */
+    * environment and calls the first matching function of the chosen
+    * searchplan. It is called by match<rule>, which fires the match probes
+    * around it. */
    fprintf(header, "bool match%s(Morphism *morphism);\n\n", rule->name);
-   PTF("\nbool match%s(Morphism *morphism)\n", rule->name);
+   PTF("\nstatic bool findMatch%s(Morphism *morphism)\n", rule->name);
    PTF("{\n");
+   PTFI("profile_calls_%s++;\n", 3, rule->name);
    PTFI("if(%d > host->number_of_nodes || %d > host->number_of_edges) return false;\n",
         3, rule->lhs->node_index, rule->lhs->edge_index);
-   char item = searchplan->first->is_node ? 'n' : 'e';
+   emitCardinalityCheck(rule->lhs);
+   if(plans > 1)
+   {
+      PTFI("/* Choose the searchplan whose first node has the fewest candidates. */\n", 3);
+      PTFI("int searchplan = 0;\n", 3);
+      PTFI("int candidates = ", 3);
+      emitCandidateEstimate(getRuleNode(rule->lhs, start_nodes[0]));
+      PTF(";\n");
+      for(plan = 1; plan < plans; plan++)
+      {
+         RuleNode *node = getRuleNode(rule->lhs, start_nodes[plan]);
+         PTFI("if(", 3);
+         emitCandidateEstimate(node);
+         PTF(" < candidates)\n");
+         PTFI("{\n", 3);
+         PTFI("searchplan = %d;\n", 6, plan);
+         PTFI("candidates = ", 6);
+         emitCandidateEstimate(node);
+         PTF(";\n");
+         PTFI("}\n", 3);
+      }
+      PTFI("profile_selections_%s[searchplan]++;\n", 3, rule->name);
+      PTFI("if(searchplan != last_searchplan_%s)\n", 3, rule->name);
+      PTFI("{\n", 3);
+      PTFI("if(last_searchplan_%s >= 0) profile_switches_%s++;\n", 6, rule->name,
+           rule->name);
+      PTFI("last_searchplan_%s = searchplan;\n", 6, rule->name);
+      PTFI("}\n", 3);
+      PTFI("bool match;\n", 3);
+      for(plan = 0; plan < plans; plan++)
+      {
+         setMatcherPrefix(plan);
+         if(plan == 0) PTFI("if(searchplan == 0) ", 3);
+         else if(plan < plans - 1) PTFI("else if(searchplan == %d) ", 3, plan);
+         else PTFI("else ", 3);
+         PTF("match = %s_n%d(morphism);\n", matcher_prefix, searchplans[plan]->first->index);
+      }
+   }
+   else 
+   {
+      setMatcherPrefix(0);
+      char item = searchplans[0]->first->is_node ? 'n' : 'e';
+      PTFI("bool match = %s_%c%d(morphism);\n", 3, matcher_prefix, item,
+           searchplans[0]->first->index);
+   }
    
+   /* Without matched flags in the host graph there are none to reset. */
+   string graph = parallel_rule_sets ? "NULL" : "host";
    if(predicate)
    {
-      PTFI("bool match = match_%c%d(morphism);\n", 3, item, searchplan->first->index);
       /* Reset the matched flags in the host graph. This is normally done after
-       * rule application, but predicate rules are not applied. */
-      PTFI("initialiseMorphism(morphism, host);\n", 3);
+       * rule application, but predicate rules are not applied. With event
+       * tracing, a match is reset by the rule call once it has been traced. */
+      if(event_tracing) PTFI("if(!match) initialiseMorphism(morphism, %s);\n", 3, graph);
+      else PTFI("initialiseMorphism(morphism, %s);\n", 3, graph);
       PTFI("return match;\n", 3);
    }
    else 
    {
-      PTFI("if(match_%c%d(morphism)) return true;\n", 3, item, searchplan->first->index);
+      PTFI("if(match) return true;\n", 3);
       PTFI("else\n", 3);
       PTFI("{\n", 3);
-      PTFI("initialiseMorphism(morphism, host);\n", 6);
+      PTFI("initialiseMorphism(morphism, %s);\n", 6, graph);
       PTFI("return false;\n", 6);
       PTFI("}\n", 3);
    }
    PTF("}\n\n");
+   PTF("bool match%s(Morphism *morphism)\n", rule->name);
+   PTF("{\n");
+   PTFI("GP2_PROBE1(match_start, \"%s\");\n", 3, rule->name);
+   PTFI("bool match = findMatch%s(morphism);\n", 3, rule->name);
+   PTFI("GP2_PROBE2(match_end, \"%s\", match);\n", 3, rule->name);
+   PTFI("return match;\n", 3);
+   PTF("}\n\n");
+   emitProfileFunction(rule->name, plans);
 
-   /* Iterator over the searchplan to print the definitions of the matching functions. */
-   operation = searchplan->first;
-   RuleNode *node = NULL;
-   RuleEdge *edge = NULL;
-   while(operation != NULL)
+   /* Iterator over each searchplan to print the definitions of its matching
+    * functions. The predicates of the condition are scheduled for each
+    * searchplan, as their binding operations depend on the order. */
+   for(plan = 0; plan < plans; plan++)
    {
-      switch(operation->type)
-      {        
-         case 'r': 
-              node = getRuleNode(rule->lhs, operation->index);
-              emitRootNodeMatcher(rule, node, operation->next);
-              break;
+      searchplan = searchplans[plan];
+      setMatcherPrefix(plan);
+      if(rule->condition != NULL) schedulePredicates(rule, searchplan);
+      SearchOp *operation = searchplan->first;
+      matching_op = 0;
+      RuleNode *node = NULL;
+      RuleEdge *edge = NULL;
+      while(operation != NULL)
+      {
+         switch(operation->type)
+         {        
+            case 'r': 
+                 node = getRuleNode(rule->lhs, operation->index);
+                 emitRootNodeMatcher(rule, node, operation->next);
+                 break;
 
-         case 'n': 
-              node = getRuleNode(rule->lhs, operation->index);
-              emitNodeMatcher(rule, node, operation->next);
-              break;
+            case 'n': 
+                 node = getRuleNode(rule->lhs, operation->index);
+                 emitNodeMatcher(rule, node, operation->next);
+                 break;
 
-         case 'i': 
-         case 'o': 
-         case 'b':
-              node = getRuleNode(rule->lhs, operation->index);
-              emitNodeFromEdgeMatcher(rule, node, operation->type, operation->next);
-              break;
+            case 'i': 
+            case 'o': 
+            case 'b':
+                 node = getRuleNode(rule->lhs, operation->index);
+                 emitNodeFromEdgeMatcher(rule, node, operation->type, operation->next);
+                 break;
 
-         case 'e': 
-              edge = getRuleEdge(rule->lhs, operation->index);
-              emitEdgeMatcher(rule, edge, operation->next);
-              break;
+            case 'e': 
+                 edge = getRuleEdge(rule->lhs, operation->index);
+                 emitEdgeMatcher(rule, edge, operation->next);
+                 break;
 
-         case 'l':
-              edge = getRuleEdge(rule->lhs, operation->index);
-              emitLoopEdgeMatcher(rule, edge, operation->next);
-              break;
+            case 'l':
+                 edge = getRuleEdge(rule->lhs, operation->index);
+                 emitLoopEdgeMatcher(rule, edge, operation->next);
+                 break;
 
-         case 's': 
-              edge = getRuleEdge(rule->lhs, operation->index);
-              if(edge->bidirectional) 
-              {
-                 emitEdgeFromNodeMatcher(rule, edge, true, true, false, operation->next);
-                 emitEdgeFromNodeMatcher(rule, edge, false, false, true, operation->next);
-              }
-              else emitEdgeFromNodeMatcher(rule, edge, true, true, true, operation->next);
-              break;
+            case 's': 
+                 edge = getRuleEdge(rule->lhs, operation->index);
+                 if(edge->bidirectional) 
+                 {
+                    emitEdgeFromNodeMatcher(rule, edge, true, true, false, operation->next);
+                    emitEdgeFromNodeMatcher(rule, edge, false, false, true, operation->next);
+                 }
+                 else emitEdgeFromNodeMatcher(rule, edge, true, true, true, operation->next);
+                 break;
 
-         case 't':
-              edge = getRuleEdge(rule->lhs, operation->index);
-              if(edge->bidirectional) 
-              {
-                 emitEdgeFromNodeMatcher(rule, edge, false, true, false, operation->next);
-                 emitEdgeFromNodeMatcher(rule, edge, true, false, true, operation->next);
-              }
-              else emitEdgeFromNodeMatcher(rule, edge, false, true, true, operation->next);
-              break;
-         
-         default:
-              print_to_log("Error (generateMatchingCode): Unexpected "
-                           "operation type %c.\n", operation->type);
-              break;
+            case 't':
+                 edge = getRuleEdge(rule->lhs, operation->index);
+                 if(edge->bidirectional) 
+                 {
+                    emitEdgeFromNodeMatcher(rule, edge, false, true, false, operation->next);
+                    emitEdgeFromNodeMatcher(rule, edge, true, false, true, operation->next);
+                 }
+                 else emitEdgeFromNodeMatcher(rule, edge, false, true, true, operation->next);
+                 break;
+            
+            default:
+                 print_to_log("Error (generateMatchingCode): Unexpected "
+                              "operation type %c.\n", operation->type);
+                 break;
+         }
+         operation = operation->next;
+         matching_op++;
       }
-      operation = operation->next;
+      matching_op = -1;
+      freeSearchplan(searchplan);
    }
-   freeSearchplan(searchplan);
+   searchplan = NULL;
+   setMatcherPrefix(0);
 }
 
 
+static void addSignatureField(uint64_t *signature, int field)
+{
+   int shift = 4 * field;
+   if(((*signature >> shift) & 7) < 7) *signature += (uint64_t)1 << shift;
+}
+
+static void addNeighbourFields(uint64_t *signature, RuleNode *neighbour)
+{
+   if(neighbour->label.mark < DASHED)
+      addSignatureField(signature, SIGNATURE_NEIGHBOUR(neighbour->label.mark));
+   if(neighbour->root) addSignatureField(signature, SIGNATURE_ROOT_NEIGHBOUR);
+}
+
+/* Returns the minimum signature of a host node matching the LHS node: the
+ * counts of the items incident to the LHS node whose images in the host graph
+ * are known to have a given mark or root status. Unmarked edges, edges marked
+ * any and bidirectional edges are not counted by mark, and neighbours marked
+ * any are not counted by mark. */
+static uint64_t requiredSignature(RuleNode *node)
+{
+   uint64_t signature = 0;
+   RuleEdges *iterator;
+   for(iterator = node->outedges; iterator != NULL; iterator = iterator->next)
+   {
+      RuleEdge *edge = iterator->edge;
+      MarkType mark = edge->label.mark;
+      if(!edge->bidirectional && mark != NONE && mark != ANY)
+         addSignatureField(&signature, SIGNATURE_OUT_EDGE(mark));
+      addNeighbourFields(&signature, edge->target);
+   }
+   for(iterator = node->inedges; iterator != NULL; iterator = iterator->next)
+   {
+      RuleEdge *edge = iterator->edge;
+      MarkType mark = edge->label.mark;
+      if(!edge->bidirectional && mark != NONE && mark != ANY)
+         addSignatureField(&signature, SIGNATURE_IN_EDGE(mark));
+      addNeighbourFields(&signature, edge->source);
+   }
+   return signature;
+}
+
 /* The host node does not match the rule node if:
  * (1) The host node's indegree is strictly less than the rule node's indegree.
  * (2) The host node's outdegree is strictly less than the rule node's outdegree.
@@ -282,9 +529,15 @@ static void generateMatchingCode(Rule *rule, bool predicate)
  * (3) The number of edges incident to the host node is not equal to the 
  *     number of edges incident to the rule node. Indeed, if it is less,
  *     then standard matching is violated (above). If it is greater,
- *     then the dangling condition is violated. */
+ *     then the dangling condition is violated. 
+ * (4) The host node's neighbourhood signature (see signature.h)
+ *     has fewer incident items of some kind than the rule node requires.
+ *
+ * Degree filters of the rule condition on this node are appended to the check
+ * (see genCondition.h), so that their candidates are also rejected before
+ * label matching. */
 
-static void emitDegreeCheck(RuleNode *left_node, int indent)
+static void emitDegreeCheck(Rule *rule, RuleNode *left_node, int indent)
 {
    /* For condition (3) above, the number of edges incident to the host node
     * is given by the sum of the outdegree and the indegree. The edges
@@ -297,7 +550,7 @@ static void emitDegreeCheck(RuleNode *left_node, int indent)
        * then the node is not a valid match. */
       PTFI("if(host_node->indegree < %d || host_node->outdegree < %d ||\n",
            indent, left_node->indegree, left_node->outdegree);
-      PTFI("   ((host_node->outdegree + host_node->indegree - %d - %d - %d) != 0)) ", 
+      PTFI("   ((host_node->outdegree + host_node->indegree - %d - %d - %d) != 0)", 
            indent, left_node->outdegree, left_node->indegree, left_node->bidegree);
    }
    else
@@ -305,9 +558,26 @@ static void emitDegreeCheck(RuleNode *left_node, int indent)
       /* Standard node degree check. */
       PTFI("if(host_node->indegree < %d || host_node->outdegree < %d ||\n",
            indent, left_node->indegree, left_node->outdegree);
-      PTFI("   ((host_node->outdegree + host_node->indegree - %d - %d - %d) < 0)) ", 
+      PTFI("   ((host_node->outdegree + host_node->indegree - %d - %d - %d) < 0)", 
            indent, left_node->outdegree, left_node->indegree, left_node->bidegree);
    }
+   uint64_t signature = requiredSignature(left_node);
+   if(signature != 0)
+   {
+      PTF(" ||\n");
+      PTFI("   (((host_node->signature | SIGNATURE_GUARD) - 0x%016llxULL) & SIGNATURE_GUARD)"
+           " != SIGNATURE_GUARD", indent, (unsigned long long)signature);
+   }
+   int index;
+   for(index = 0; index < left_node->predicate_count; index++)
+   {
+      Predicate *predicate = left_node->predicates[index];
+      if(!isDegreeFilter(rule, predicate)) continue;
+      PTF(" ||\n");
+      PTFI("   ", indent);
+      generateDegreeFilter(predicate);
+   }
+   PTF(") ");
 }
 
  
@@ -334,18 +604,18 @@ static void emitDegreeCheck(RuleNode *left_node, int indent)
  * left, code is generated to return true. */
 static void emitRootNodeMatcher(Rule *rule, RuleNode *left_node, SearchOp *next_op)
 {
-   PTF("static bool match_n%d(Morphism *morphism)\n", left_node->index);
+   PTF("static bool %s_n%d(Morphism *morphism)\n", matcher_prefix, left_node->index);
    PTF("{\n");
    PTFI("RootNodes *nodes;\n", 3);   
    PTFI("for(nodes = getRootNodeList(host); nodes != NULL; nodes = nodes->next)\n", 3);
    PTFI("{\n", 3);
    PTFI("Node *host_node = getNode(host, nodes->index);\n", 6);
    PTFI("if(host_node == NULL) continue;\n", 6);
-   PTFI("if(host_node->matched) continue;\n", 6);
+   PTFI("if(%s) continue;\n", 6, matchedTest("host_node", true));
    if(left_node->label.mark == ANY)
       PTFI("if(host_node->label.mark == 0) continue;\n", 6);
    else PTFI("if(host_node->label.mark != %d) continue;\n", 6, left_node->label.mark);
-   emitDegreeCheck(left_node, 6);  
+   emitDegreeCheck(rule, left_node, 6);  
    PTF("continue;\n\n");
 
    PTFI("HostLabel label = host_node->label;\n", 6);
@@ -361,21 +631,22 @@ static void emitRootNodeMatcher(Rule *rule, RuleNode *left_node, SearchOp *next_
 
 /* The rule node is matched "in isolation", in that it is not the source or
  * target of a previously-matched edge. In this case, the candidate host
- * graph nodes are obtained from the appropriate label class tables. */
+ * graph nodes are obtained from a node scan (see graph.h in the library),
+ * which filters the host graph's node columns by mark, root status and
+ * minimum degrees before the node records themselves are read. */
 static void emitNodeMatcher(Rule *rule, RuleNode *left_node, SearchOp *next_op)
 {
-   PTF("static bool match_n%d(Morphism *morphism)\n", left_node->index);
+   PTF("static bool %s_n%d(Morphism *morphism)\n", matcher_prefix, left_node->index);
    PTF("{\n");
+   PTFI("NodeScan scan;\n", 3);
+   PTFI("startNodeScan(&scan, %d, %s, %d, %d);\n", 3, left_node->label.mark,
+        left_node->root ? "true" : "false", left_node->indegree, left_node->outdegree);
    PTFI("int host_index;\n", 3);
-   PTFI("for(host_index = 0; host_index < host->nodes.size; host_index++)\n", 3);
+   PTFI("while((host_index = nextNodeCandidate(host, &scan)) >= 0)\n", 3);
    PTFI("{\n", 3);
    PTFI("Node *host_node = getNode(host, host_index);\n", 6);
-   PTFI("if(host_node == NULL || host_node->index == -1) continue;\n", 6);
-   PTFI("if(host_node->matched) continue;\n", 6);
-   if(left_node->label.mark == ANY)
-      PTFI("if(host_node->label.mark == 0) continue;\n", 6);
-   else PTFI("if(host_node->label.mark != %d) continue;\n", 6, left_node->label.mark);
-   emitDegreeCheck(left_node, 6);  
+   PTFI("if(%s) continue;\n", 6, matchedTest("host_node", true));
+   emitDegreeCheck(rule, left_node, 6);  
    PTF("continue;\n\n");
 
    PTFI("HostLabel label = host_node->label;\n", 6);
@@ -398,8 +669,8 @@ static void emitNodeMatcher(Rule *rule, RuleNode *left_node, SearchOp *next_op)
 static void emitNodeFromEdgeMatcher(Rule *rule, RuleNode *left_node, char type,
                                     SearchOp *next_op)
 {
-   PTF("static bool match_n%d(Morphism *morphism, Edge *host_edge)\n",
-       left_node->index);
+   PTF("static bool %s_n%d(Morphism *morphism, Edge *host_edge)\n",
+       matcher_prefix, left_node->index);
    PTF("{\n");
    if(type == 'i' || type == 'b') 
         PTFI("Node *host_node = getTarget(host, host_edge);\n\n", 3);
@@ -407,12 +678,12 @@ static void emitNodeFromEdgeMatcher(Rule *rule, RuleNode *left_node, char type,
 
    string fail_code = (type == 'b') ? "candidate_node = false;" : "return false;";
    if(type == 'b') PTFI("bool candidate_node = true;\n", 3);
-   PTFI("if(host_node->matched) %s\n", 3, fail_code);
+   PTFI("if(%s) %s\n", 3, matchedTest("host_node", true), fail_code);
    if(left_node->root) PTFI("if(!(host_node->root)) %s\n", 3, fail_code);
    if(left_node->label.mark == ANY)
       PTFI("if(host_node->label.mark == 0) %s\n", 3, fail_code);
    else PTFI("if(host_node->label.mark != %d) %s\n", 3, left_node->label.mark, fail_code);
-   emitDegreeCheck(left_node, 6);  
+   emitDegreeCheck(rule, left_node, 6);  
    PTF("%s;\n\n", fail_code);
 
    /* If the above check fails and the edge is bidirectional, check the other 
@@ -425,12 +696,12 @@ static void emitNodeFromEdgeMatcher(Rule *rule, RuleNode *left_node, char type,
       if(type == 'i' || type == 'b') 
            PTFI("host_node = getSource(host, host_edge);\n", 6);
       else PTFI("host_node = getTarget(host, host_edge);\n", 6);
-      PTFI("if(host_node->matched) return false;\n", 6);
+      PTFI("if(%s) return false;\n", 6, matchedTest("host_node", true));
       if(left_node->root) PTFI("if(!(host_node->root)) return false;\n", 6);
       if(left_node->label.mark == ANY)
 	 PTFI("if(host_node->label.mark == 0) return false;\n", 6);
       else PTFI("if(host_node->label.mark != %d) return false;\n", 6, left_node->label.mark);
-      emitDegreeCheck(left_node, 6);  
+      emitDegreeCheck(rule, left_node, 6);  
       PTF("return false;\n\n");
       PTFI("}\n", 3);
    }
@@ -447,7 +718,7 @@ static void emitNodeFromEdgeMatcher(Rule *rule, RuleNode *left_node, char type,
 }
 
 /* Generates code to test the result of label matching a node. If the label
- * matching succeeds, any predicates in which the node participates are evaluated
+ * matching succeeds, the predicates whose last argument is the node are evaluated
  * and the condition checked. If everything succeeds, the morphism and matched_nodes
  * array are updated, and matching continues. If not, any runtime boolean variables
  * modified by predicate evaluation are reset, and any assignments made during label
@@ -458,14 +729,18 @@ static void emitNodeMatchResultCode(RuleNode *node, SearchOp *next_op, int inden
    PTFI("{\n", indent);
    PTFI("addNodeMap(morphism, %d, host_node->index, new_assignments);\n",
         indent + 3, node->index);
-   PTFI("host_node->matched = true;\n", indent + 3);
-   if(node->predicates != NULL)
+   if(!parallel_rule_sets) PTFI("host_node->matched = true;\n", indent + 3);
+   /* Only the predicates whose last argument is this node are evaluated here. */
+   int index, evaluated = 0;
+   for(index = 0; index < node->predicate_count; index++)
+      if(node->predicates[index]->binding_op == matching_op) evaluated++;
+   if(evaluated > 0)
    {
       PTFI("/* Update global booleans representing the node's predicates. */\n", indent + 3);
-      int index;
       for(index = 0; index < node->predicate_count; index++)
-         PTFI("evaluatePredicate%d(morphism);\n", indent + 3, 
-              node->predicates[index]->bool_id);
+         if(node->predicates[index]->binding_op == matching_op)
+            PTFI("evaluatePredicate%d(morphism);\n", indent + 3, 
+                 node->predicates[index]->bool_id);
       if(next_op != NULL) PTFI("bool next_match_result = false;\n", indent + 3);
       PTFI("if(evaluateCondition())", indent + 3);
       if(next_op == NULL)
@@ -490,11 +765,12 @@ static void emitNodeMatchResultCode(RuleNode *node, SearchOp *next_op, int inden
       for(index = 0; index < node->predicate_count; index++)
       { 
          Predicate *predicate = node->predicates[index];
+         if(predicate->binding_op != matching_op) continue;
          if(predicate->negated) PTFI("b%d = false;\n", indent + 6, predicate->bool_id);
          else PTFI("b%d = true;\n", indent + 6, predicate->bool_id);
       }
       PTFI("removeNodeMap(morphism, %d);\n", indent + 6, node->index);
-      PTFI("host_node->matched = false;\n", indent + 6);  
+      if(!parallel_rule_sets) PTFI("host_node->matched = false;\n", indent + 6);
       PTFI("}\n", indent + 3);
    }
    else
@@ -512,7 +788,7 @@ static void emitNodeMatchResultCode(RuleNode *node, SearchOp *next_op, int inden
          PTFI("else\n", indent + 3);
          PTFI("{\n", indent + 3);  
          PTFI("removeNodeMap(morphism, %d);\n", indent + 6, node->index);
-         PTFI("host_node->matched = false;\n", indent + 6);  
+         if(!parallel_rule_sets) PTFI("host_node->matched = false;\n", indent + 6);
          PTFI("}\n", indent + 3);
       }
    }
@@ -526,14 +802,14 @@ static void emitNodeMatchResultCode(RuleNode *node, SearchOp *next_op, int inden
  * are obtained from the appropriate label class tables. */
 static void emitEdgeMatcher(Rule *rule, RuleEdge *left_edge, SearchOp *next_op)
 {
-   PTF("static bool match_e%d(Morphism *morphism)\n", left_edge->index);
+   PTF("static bool %s_e%d(Morphism *morphism)\n", matcher_prefix, left_edge->index);
    PTF("{\n");
    PTFI("int host_index;\n", 3);
    PTFI("for(host_index = 0; host_index < host->edges.size; host_index++)\n", 3);
    PTFI("{\n", 3);
    PTFI("Edge *host_edge = getEdge(host, host_index);\n", 6);
    PTFI("if(host_edge == NULL || host_edge->index == -1) continue;\n", 6);
-   PTFI("if(host_edge->matched) continue;\n", 6);
+   PTFI("if(%s) continue;\n", 6, matchedTest("host_edge", false));
    if(left_edge->label.mark == ANY) 
       PTFI("if(host_edge->label.mark == 0) continue;\n\n", 6);
    else PTFI("if(host_edge->label.mark != %d) continue;\n\n", 6, left_edge->label.mark);
@@ -550,7 +826,7 @@ static void emitEdgeMatcher(Rule *rule, RuleEdge *left_edge, SearchOp *next_op)
 
 static void emitLoopEdgeMatcher(Rule *rule, RuleEdge *left_edge, SearchOp *next_op)
 {
-   PTF("static bool match_e%d(Morphism *morphism)\n", left_edge->index);
+   PTF("static bool %s_e%d(Morphism *morphism)\n", matcher_prefix, left_edge->index);
    PTF("{\n");
    PTFI("/* Matching a loop. */\n", 3);
    PTFI("int node_index = lookupNode(morphism, %d);\n", 3, left_edge->source->index);
@@ -562,7 +838,7 @@ static void emitLoopEdgeMatcher(Rule *rule, RuleEdge *left_edge, SearchOp *next_
    PTFI("{\n", 3);
    PTFI("Edge *host_edge = getNthOutEdge(host, host_node, counter);\n", 6);
    PTFI("if(host_edge == NULL) continue;\n", 6);
-   PTFI("if(host_edge->matched) continue;\n", 6);
+   PTFI("if(%s) continue;\n", 6, matchedTest("host_edge", false));
    PTFI("if(host_edge->source != host_edge->target) continue;\n", 6);
    if(left_edge->label.mark == ANY)
       PTFI("if(host_edge->label.mark == 0) continue;\n\n", 6);
@@ -608,7 +884,7 @@ static void emitEdgeFromNodeMatcher(Rule *rule, RuleEdge *left_edge, bool source
 
    if(initialise)
    {
-      PTF("static bool match_e%d(Morphism *morphism)\n", left_edge->index);
+      PTF("static bool %s_e%d(Morphism *morphism)\n", matcher_prefix, left_edge->index);
       PTF("{\n");
       PTFI("/* Start node is the already-matched node from which the candidate\n", 3);
       PTFI("   edges are drawn. End node may or may not have been matched already. */\n", 3);
@@ -632,7 +908,7 @@ static void emitEdgeFromNodeMatcher(Rule *rule, RuleEdge *left_edge, bool source
    }
 
    PTFI("if(host_edge == NULL) continue;\n", 6);
-   PTFI("if(host_edge->matched) continue;\n", 6);
+   PTFI("if(%s) continue;\n", 6, matchedTest("host_edge", false));
    PTFI("if(host_edge->source == host_edge->target) continue;\n", 6);
    if(left_edge->label.mark == ANY)
       PTFI("if(host_edge->label.mark == 0) continue;\n\n", 6);
@@ -648,7 +924,7 @@ static void emitEdgeFromNodeMatcher(Rule *rule, RuleEdge *left_edge, bool source
    PTFI("else\n", 6);
    PTFI("{\n", 6);
    PTFI("Node *end_node = getNode(host, host_edge->%s);\n", 9, end_node_type);
-   PTFI("if(end_node->matched) continue;\n", 9);
+   PTFI("if(%s) continue;\n", 9, matchedTest("end_node", true));
    PTFI("}\n\n", 6);
 
    PTFI("HostLabel label = host_edge->label;\n", 6);
@@ -670,7 +946,7 @@ static void emitEdgeMatchResultCode(int index, SearchOp *next_op, int indent)
    PTFI("if(match)\n", indent);
    PTFI("{\n", indent);
    PTFI("addEdgeMap(morphism, %d, host_edge->index, new_assignments);\n", indent + 3, index);
-   PTFI("host_edge->matched = true;\n", indent + 3);
+   if(!parallel_rule_sets) PTFI("host_edge->matched = true;\n", indent + 3);
    if(next_op == NULL)
    {
       PTFI("/* All items matched! */\n", indent);
@@ -684,7 +960,7 @@ static void emitEdgeMatchResultCode(int index, SearchOp *next_op, int indent)
       PTFI("else\n", indent + 3);
       PTFI("{\n", indent + 3);                              
       PTFI("removeEdgeMap(morphism, %d);\n", indent + 6, index);
-      PTFI("host_edge->matched = false;\n", indent + 6); 
+      if(!parallel_rule_sets) PTFI("host_edge->matched = false;\n", indent + 6);
       PTFI("}\n", indent + 3);
    } 
    PTFI("}\n", indent);
@@ -697,20 +973,20 @@ static void emitNextMatcherCall(SearchOp *next_operation)
    {
       case 'n':
       case 'r':
-           PTF("match_n%d(morphism)", next_operation->index);
+           PTF("%s_n%d(morphism)", matcher_prefix, next_operation->index);
            break;
 
       case 'i':
       case 'o':
       case 'b':
-           PTF("match_n%d(morphism, host_edge)", next_operation->index);
+           PTF("%s_n%d(morphism, host_edge)", matcher_prefix, next_operation->index);
            break;
   
       case 'e':
       case 's':
       case 't':
       case 'l':
-           PTF("match_e%d(morphism)", next_operation->index);
+           PTF("%s_e%d(morphism)", matcher_prefix, next_operation->index);
            break;
 
       default:
@@ -725,7 +1001,7 @@ void generateRemoveLHSCode(string rule_name)
    fprintf(header, "void apply%s(Morphism *morphism, bool record_changes);\n", rule_name);
    PTF("void apply%s(Morphism *morphism, bool record_changes)\n", rule_name);
    PTF("{\n");
-
+   PTFI("GP2_PROBE1(apply_start, \"%s\");\n", 3, rule_name);
    PTFI("int count;\n", 3);
    PTFI("for(count = 0; count < morphism->edges; count++)\n", 3);
    PTFI("{\n", 3);                        
@@ -751,6 +1027,7 @@ void generateRemoveLHSCode(string rule_name)
    PTFI("removeNode(host, morphism->node_map[count].host_index);\n", 6);
    PTFI("}\n", 3);
    PTFI("initialiseMorphism(morphism, NULL);\n", 3);
+   PTFI("GP2_PROBE1(apply_end, \"%s\");\n", 3, rule_name);
    PTFI("}\n\n", 3);
 }
 
@@ -759,6 +1036,7 @@ void generateAddRHSCode(Rule *rule)
    fprintf(header, "void apply%s(bool record_changes);\n", rule->name);
    PTF("void apply%s(bool record_changes)\n", rule->name);
    PTF("{\n");
+   PTFI("GP2_PROBE1(apply_start, \"%s\");\n", 3, rule->name);
    PTFI("int index;\n", 3);
    PTFI("HostLabel label;\n\n", 3);
    /* Generate code to retrieve the values assigned to the variables in the
@@ -825,6 +1103,7 @@ void generateAddRHSCode(Rule *rule)
       PTFI("if(record_changes)\n", 3);
       PTFI("pushAddedEdge(index, edge_array_size%d == host->edges.size);\n", 6, index);
    }     
+   PTFI("GP2_PROBE1(apply_end, \"%s\");\n", 3, rule->name);
    PTF("}\n");
    return;
 }
@@ -834,6 +1113,7 @@ void generateApplicationCode(Rule *rule)
    fprintf(header, "void apply%s(Morphism *morphism, bool record_changes);\n", rule->name);
    PTF("void apply%s(Morphism *morphism, bool record_changes)\n", rule->name);
    PTF("{\n");
+   PTFI("GP2_PROBE1(apply_start, \"%s\");\n", 3, rule->name);
    /* Generate code to retrieve the values assigned to the variables in the
     * matching phase. */
    int index;
@@ -1123,6 +1403,8 @@ void generateApplicationCode(Rule *rule)
       PTFI("pushAddedEdge(host_edge_index, edge_array_size%d == host->edges.size);\n", 6, index);
    }
    PTFI("/* Reset the morphism. */\n", 3);
-   PTFI("initialiseMorphism(morphism, host);\n}\n\n", 3);
+   PTFI("initialiseMorphism(morphism, host);\n", 3);
+   PTFI("GP2_PROBE1(apply_end, \"%s\");\n", 3, rule->name);
+   PTF("}\n\n");
 }
 
@@ -39,6 +39,7 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h> 
 #include <stdio.h> 
 #include <string.h> 
@@ -57,7 +58,25 @@
  * function f_1 returns false, then match_R returns false, signalling that the 
  * rule matching failed. If the last matching function f_n finds a match, then
  * it returns true. This propagates back through all the matching functions to 
- * match_R, which returns true, signalling that the rule match is a success. */
+ * match_R, which returns true, signalling that the rule match is a success.
+ *
+ * Adaptive searchplans
+ * ====================
+ * The static searchplan starts from the LHS's root nodes, or else from its
+ * first node. A rule without root nodes also gets up to MAX_SEARCHPLANS - 1
+ * alternative searchplans, each starting from an LHS node with a different
+ * mark. Their matching functions are called match<n>_n<i> and match<n>_e<i>
+ * for alternative n. On each call, match_R estimates the number of candidates
+ * for each searchplan's first node from the host graph's per-mark node counts
+ * (see graph.h) and calls the searchplan with the fewest. Before that, match_R
+ * fails at once if the host graph has fewer nodes or edges of some mark, or
+ * fewer root nodes, than the LHS.
+ *
+ * The rule module also defines profile_R, which writes to a file the number
+ * of calls to match_R, how often each searchplan was chosen and how often the
+ * choice changed between consecutive calls. gp2run --profile writes this for
+ * every rule to gp2.profile. */
+#define MAX_SEARCHPLANS 3
  
 /* Takes the root of the AST of a GP 2 program and generates C modules for
  * each rule in the program. */
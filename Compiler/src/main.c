@@ -31,6 +31,7 @@
 
 #include "error.h"
 #include "common.h"
+#include "genBytecode.h"
 #include "genProgram.h"
 #include "genRule.h"
 #include "parser.h"
@@ -123,6 +124,112 @@ static bool validateHostGraph(string host_file)
 
 /* Controls the CFLAGS in the generated makefile. */
 bool debug_flags = false;
+/* If true, the generated code is compiled as a single translation unit, and
+ * the makefile has a pgo target. */
+bool unity_build = false;
+
+/* Writes the rule modules' local names that clash between rule files. Each is
+ * mapped to a name suffixed with the rule name while the rule file is included
+ * in the unity file, or unmapped afterwards if undefine is true. */
+static void printRuleNames(FILE *unity_file, GPRule *rule, bool undefine)
+{
+   int index;
+   if(undefine) fprintf(unity_file, "#undef evaluateCondition\n");
+   else fprintf(unity_file, "#define evaluateCondition evaluateCondition_%s\n",
+                rule->name);
+   /* The matching functions of each searchplan (see genRule.h). */
+   int plan;
+   for(plan = 0; plan < MAX_SEARCHPLANS; plan++)
+   {
+      char prefix[16] = "match";
+      if(plan > 0) sprintf(prefix, "match%d", plan);
+      for(index = 0; index < rule->left_nodes; index++)
+      {
+         if(undefine) fprintf(unity_file, "#undef %s_n%d\n", prefix, index);
+         else fprintf(unity_file, "#define %s_n%d %s_n%d_%s\n", prefix, index,
+                      prefix, index, rule->name);
+      }
+      for(index = 0; index < rule->left_edges; index++)
+      {
+         if(undefine) fprintf(unity_file, "#undef %s_e%d\n", prefix, index);
+         else fprintf(unity_file, "#define %s_e%d %s_e%d_%s\n", prefix, index,
+                      prefix, index, rule->name);
+      }
+   }
+}
+
+static void printUnityRules(FILE *unity_file, List *declarations)
+{
+   while(declarations != NULL)
+   {
+      GPDeclaration *decl = declarations->declaration;
+      if(decl->type == PROCEDURE_DECLARATION && decl->procedure->local_decls != NULL)
+         printUnityRules(unity_file, decl->procedure->local_decls);
+      if(decl->type == RULE_DECLARATION)
+      {
+         printRuleNames(unity_file, decl->rule, false);
+         fprintf(unity_file, "#include \"%s.c\"\n", decl->rule->name);
+         printRuleNames(unity_file, decl->rule, true);
+         fprintf(unity_file, "\n");
+      }
+      declarations = declarations->next;
+   }
+}
+
+/* Writes gp2run_unity.c, which includes the runtime main module and every rule
+ * module so that the whole program is compiled as one translation unit. */
+void printUnityFile(List *declarations, string output_dir)
+{
+   int length = strlen(output_dir) + strlen("/gp2run_unity.c") + 1;
+   char unity_name[length];
+   strcpy(unity_name, output_dir);
+   strcat(unity_name, "/gp2run_unity.c");
+   FILE *unity_file = fopen(unity_name, "w");
+   if(unity_file == NULL)
+   { 
+      perror(unity_name);
+      exit(1);
+   }
+   fprintf(unity_file, "/* Unity build of the generated GP 2 program. */\n");
+   fprintf(unity_file, "#include \"main.c\"\n\n");
+   printUnityRules(unity_file, declarations);
+   fclose(unity_file);
+}
+
+/* The unity makefile builds gp2run from gp2run_unity.c. Its pgo target runs
+ * the profile-guided build cycle on a training host graph: a baseline build,
+ * an instrumented build, a training run, and a rebuild with the profile and
+ * link-time optimisation. Both final binaries are then timed on the training
+ * graph and the speedup is reported. Usage: make pgo HOST=<host_file>. */
+static void printUnityMakeRules(FILE *makefile)
+{
+   fprintf(makefile, "CC=gcc\n\n");
+   if(debug_flags) fprintf(makefile, "CFLAGS = -g -I$(INCDIR) -L$(LIBDIR) "
+                                     "-Wall -Wextra\n");
+   else fprintf(makefile, "CFLAGS = -I$(INCDIR) -L$(LIBDIR) -fomit-frame-pointer "
+                          "-O2 -Wall -Wextra\n");
+   fprintf(makefile, "LIBS = -lgp2 -lpthread\n\n");
+   fprintf(makefile, "default:\tgp2run_unity.c\n"
+                     "\t\t$(CC) gp2run_unity.c $(CFLAGS) -o gp2run $(LIBS)\n\n");
+   fprintf(makefile, "pgo:\t\tgp2run_unity.c\n");
+   fprintf(makefile, "\t\t@if [ -z \"$(HOST)\" ]; then "
+                     "echo \"Usage: make pgo HOST=<host_file>\"; exit 1; fi\n");
+   fprintf(makefile, "\t\trm -f *.gcda\n");
+   fprintf(makefile, "\t\t$(CC) gp2run_unity.c $(CFLAGS) -o gp2run-base $(LIBS)\n");
+   fprintf(makefile, "\t\t$(CC) gp2run_unity.c $(CFLAGS) -flto -fprofile-generate "
+                     "-o gp2run $(LIBS)\n");
+   fprintf(makefile, "\t\t./gp2run $(HOST) > /dev/null\n");
+   fprintf(makefile, "\t\t$(CC) gp2run_unity.c $(CFLAGS) -flto -fprofile-use "
+                     "-fprofile-correction -o gp2run $(LIBS)\n");
+   fprintf(makefile, "\t\t@t0=`date +%%s%%N`; ./gp2run-base $(HOST) > /dev/null; "
+                     "t1=`date +%%s%%N`; \\\n"
+                     "\t\t./gp2run $(HOST) > /dev/null; t2=`date +%%s%%N`; \\\n"
+                     "\t\techo \"Baseline: $$(( (t1 - t0) / 1000 )) us, "
+                     "PGO: $$(( (t2 - t1) / 1000 )) us\"; \\\n"
+                     "\t\tawk \"BEGIN { printf \\\"Speedup: %%.2fx\\\\n\\\", "
+                     "($$t1 - $$t0) / ($$t2 - $$t1) }\"\n\n");
+   fprintf(makefile, "clean:\t\n\t\trm *\n");
+}
 
 void printMakeFile(string output_dir, string install_dir)
 {
@@ -143,12 +250,22 @@ void printMakeFile(string output_dir, string install_dir)
       fprintf(makefile, "INCDIR=%s/include\n", install_dir);
       fprintf(makefile, "LIBDIR=%s/lib\n", install_dir);
    }
+   if(unity_build)
+   {
+      printUnityMakeRules(makefile);
+      fclose(makefile);
+      return;
+   }
    fprintf(makefile, "OBJECTS := $(patsubst %%.c, %%.o, $(wildcard *.c))\n");  
    fprintf(makefile, "CC=gcc\n\n");
 
-   if(debug_flags) fprintf(makefile, "CFLAGS = -g -L$(LIB) -Wall -Wextra -lgp2\n\n");
+   /* The library always needs -lpthread: the graph functions call the event
+    * trace hooks, which live in the module that starts the trace writer, and
+    * printGraph formats large graphs on several threads (see graphWriter.h). */
+   if(debug_flags) fprintf(makefile, "CFLAGS = -g -L$(LIB) -Wall -Wextra "
+                                     "-lgp2 -lpthread\n\n");
    else fprintf(makefile, "CFLAGS = -I$(INCDIR) -L$(LIBDIR) -fomit-frame-pointer "
-                          "-O2 -Wall -Wextra -lgp2\n\n");
+                          "-O2 -Wall -Wextra -lgp2 -lpthread\n\n");
    fprintf(makefile, "default:\t$(OBJECTS)\n\t\t$(CC) $(OBJECTS) $(CFLAGS) -o gp2run\n\n");
    fprintf(makefile, "%%.o:\t\t%%.c\n\t\t$(CC) -c $(CFLAGS) -o $@ $<\n\n");
    fprintf(makefile, "clean:\t\n\t\trm *\n");
@@ -157,17 +274,25 @@ void printMakeFile(string output_dir, string install_dir)
 
    
 bool graph_copying = false;
+bool parallel_rule_sets = false;
+bool speculative_branches = false;
+bool event_tracing = false;
 
 int main(int argc, char **argv)
 {
    string const usage = "Usage:\n"
-                        "gp2 [-c] [-d] [-l <rootdir>] [-o <outdir>] <program_file>\n"
+                        "gp2 [-b] [-c] [-d] [-e] [-s] [-t] [-u] [-l <rootdir>] [-o <outdir>] <program_file>\n"
                         "gp2 -p <program_file>\n"
                         "gp2 -r <rule_file>\n"
                         "gp2 -h <host_file>\n\n"
                         "Flags:\n"
+                        "-b - Generate bytecode for the gp2vm interpreter instead of C code.\n"
                         "-c - Enable graph copying.\n"
                         "-d - Compile program with GCC debugging flags.\n"
+                        "-e - Record a binary event trace of the program run in gp2.trace.\n"
+                        "-s - Run the then branch of if statements while the condition is evaluated.\n"
+                        "-t - Match the rules of rule set calls in parallel threads.\n"
+                        "-u - Compile program as a single unit with a profile-guided build target.\n"
                         "-p - Validate a GP 2 program.\n"
                         "-r - Validate a GP 2 rule.\n"
                         "-h - Validate a GP 2 host graph.\n"
@@ -178,6 +303,8 @@ int main(int argc, char **argv)
 
    /* If true, only parsing and semantic analysis executed on the GP2 source files. */
    bool validate = false;
+   /* If true, the program is written as bytecode (gp2.gpb) instead of C code. */
+   bool bytecode = false;
    string program_file = NULL, host_file = NULL, rule_file = NULL, 
           install_dir = NULL, output_dir = NULL;
 
@@ -228,6 +355,10 @@ int main(int argc, char **argv)
          if(parameter[0] != '-') break;
          switch(parameter[1])
          {
+            case 'b':
+                 bytecode = true;
+                 break;
+
             case 'c':
                  graph_copying = true;
                  break;
@@ -235,6 +366,22 @@ int main(int argc, char **argv)
             case 'd':
                  debug_flags = true;
                  break;
+
+            case 'e':
+                 event_tracing = true;
+                 break;
+
+            case 's':
+                 speculative_branches = true;
+                 break;
+
+            case 't':
+                 parallel_rule_sets = true;
+                 break;
+
+            case 'u':
+                 unity_build = true;
+                 break;
             
             case 'l':
                  argv_index++;
@@ -349,11 +496,29 @@ int main(int argc, char **argv)
          closeLogFile();
          return 0;
       }
+      else if(bytecode)
+      {
+         /* The interpreter backtracks with the graph change stack only. */
+         if(graph_copying)
+            print_to_console("Warning: graph copying is not supported by the "
+                             "bytecode interpreter.\n");
+         print_to_console("Generating program bytecode...\n");
+         generateBytecode(gp_program, output_dir, max_nodes, max_edges);
+      }
       else
       {
+         /* Graph copying replaces the host graph when it backtracks, so its
+          * changes cannot be followed by the trace. */
+         if(event_tracing && graph_copying)
+         {
+            print_to_console("Warning: the event trace is not recorded with graph "
+                             "copying.\n");
+            event_tracing = false;
+         }
          print_to_console("Generating program code...\n");
          generateRules(gp_program, output_dir);
          generateRuntimeMain(gp_program, output_dir, max_nodes, max_edges);
+         if(unity_build) printUnityFile(gp_program, output_dir);
          printMakeFile(output_dir, install_dir);
       }
    }
@@ -73,7 +73,8 @@ void addVariable(Rule *rule, int index, string name, GPType type)
    rule->variable_list[index].type = type;  
    rule->variable_list[index].predicates = NULL;
    rule->variable_list[index].predicate_count = 0;
-   rule->variable_list[index].used_by_rule = false;   
+   rule->variable_list[index].used_by_rule = false;
+   rule->variable_list[index].binding_op = -1;   
 }
          
 int addRuleNode(RuleGraph *graph, bool root, RuleLabel label)
@@ -158,6 +159,7 @@ Predicate *makeTypeCheck(int bool_id, bool negated, ConditionType type, int vari
       exit(1);
    }
    predicate->bool_id = bool_id;
+   predicate->binding_op = -1;
    predicate->negated = negated;
    predicate->type = type;
    predicate->variable_id = variable_id;
@@ -173,6 +175,7 @@ Predicate *makeEdgePred(int bool_id, bool negated, int source, int target, RuleL
       exit(1);
    }
    predicate->bool_id = bool_id;
+   predicate->binding_op = -1;
    predicate->negated = negated;
    predicate->type = EDGE_PRED;
    predicate->edge_pred.source = source;
@@ -191,6 +194,7 @@ Predicate *makeListComp(int bool_id, bool negated, ConditionType type,
       exit(1);
    }
    predicate->bool_id = bool_id;
+   predicate->binding_op = -1;
    predicate->negated = negated;
    predicate->type = type;
    predicate->list_comp.left_label = left_label;
@@ -208,6 +212,7 @@ Predicate *makeAtomComp(int bool_id, bool negated, ConditionType type,
       exit(1);
    }
    predicate->bool_id = bool_id;
+   predicate->binding_op = -1;
    predicate->negated = negated;
    predicate->type = type;
    predicate->atom_comp.left_atom = left_atom;
@@ -440,6 +445,225 @@ bool hasListVariable(RuleLabel label)
    return false;
 }
 
+/* Returns 'i' if the atom always evaluates to an integer, 's' if it always
+ * evaluates to a string, and 0 if its type is not known at compile time. */
+static char atomKind(RuleAtom *atom)
+{
+   switch(atom->type)
+   {
+      case INTEGER_CONSTANT:
+      case LENGTH:
+      case INDEGREE:
+      case OUTDEGREE:
+      case NEG:
+      case ADD:
+      case SUBTRACT:
+      case MULTIPLY:
+      case DIVIDE:
+           return 'i';
+
+      case STRING_CONSTANT:
+      case CONCAT:
+           return 's';
+
+      case VARIABLE:
+           if(atom->variable.type == INTEGER_VAR) return 'i';
+           if(atom->variable.type == CHARACTER_VAR ||
+              atom->variable.type == STRING_VAR) return 's';
+           return 0;
+
+      default:
+           return 0;
+   }
+}
+
+/* An LHS atom is compatible with an RHS atom if some host atom created by the
+ * RHS atom can be matched by the LHS atom. Only types and constants are
+ * compared. */
+static bool compatibleAtoms(RuleAtom *left_atom, RuleAtom *right_atom)
+{
+   char left_kind = atomKind(left_atom), right_kind = atomKind(right_atom);
+   if(left_kind != 0 && right_kind != 0 && left_kind != right_kind) return false;
+   if(left_atom->type == INTEGER_CONSTANT && right_atom->type == INTEGER_CONSTANT)
+      return left_atom->number == right_atom->number;
+   if(left_atom->type == STRING_CONSTANT && right_atom->type == STRING_CONSTANT)
+      return strcmp(left_atom->string, right_atom->string) == 0;
+   return true;
+}
+
+/* The host mark written by an RHS mark can be matched by an LHS mark if the
+ * marks are equal or if either is 'any': an RHS 'any' preserves the host mark
+ * matched by the LHS 'any', which is never the empty mark. */
+static bool compatibleMarks(MarkType left_mark, MarkType right_mark)
+{
+   if(left_mark == ANY) return right_mark != NONE;
+   if(right_mark == ANY) return left_mark != NONE;
+   return left_mark == right_mark;
+}
+
+/* Checks if a host label created by the RHS label <right_label> can be matched
+ * by the LHS label <left_label>. A list variable in an LHS label matches any
+ * number of atoms, so the LHS matches lists of at least length - 1 atoms. */
+static bool compatibleLabels(RuleLabel left_label, RuleLabel right_label)
+{
+   if(!compatibleMarks(left_label.mark, right_label.mark)) return false;
+   bool left_list_var = hasListVariable(left_label);
+   bool right_list_var = hasListVariable(right_label);
+   if(left_list_var && right_list_var) return true;
+   if(left_list_var) return right_label.length >= left_label.length - 1;
+   if(right_list_var) return right_label.length - 1 <= left_label.length;
+   if(left_label.length != right_label.length) return false;
+   if(left_label.length == 0) return true;
+   RuleListItem *left_item = left_label.list->first;
+   RuleListItem *right_item = right_label.list->first;
+   while(left_item != NULL && right_item != NULL)
+   {
+      if(!compatibleAtoms(left_item->atom, right_item->atom)) return false;
+      left_item = left_item->next;
+      right_item = right_item->next;
+   }
+   return true;
+}
+
+static bool atomQueriesDegree(RuleAtom *atom)
+{
+   switch(atom->type)
+   {
+      case INDEGREE:
+      case OUTDEGREE:
+           return true;
+
+      case NEG:
+           return atomQueriesDegree(atom->neg_exp);
+
+      case ADD:
+      case SUBTRACT:
+      case MULTIPLY:
+      case DIVIDE:
+      case CONCAT:
+           return atomQueriesDegree(atom->bin_op.left_exp) ||
+                  atomQueriesDegree(atom->bin_op.right_exp);
+
+      default:
+           return false;
+   }
+}
+
+static bool labelQueriesDegree(RuleLabel label)
+{
+   if(label.list == NULL) return false;
+   RuleListItem *item = label.list->first;
+   while(item != NULL)
+   {
+      if(atomQueriesDegree(item->atom)) return true;
+      item = item->next;
+   }
+   return false;
+}
+
+/* Checks if the value of the condition can depend on host graph structure
+ * outside the images of the LHS items, namely through an edge predicate or a
+ * degree operator. Otherwise the condition depends only on the labels of the
+ * matched items. */
+static bool conditionQueriesStructure(Condition *condition)
+{
+   switch(condition->type)
+   {
+      case 'e':
+      {
+           Predicate *predicate = condition->predicate;
+           switch(predicate->type)
+           {
+              case EDGE_PRED:
+                   return true;
+
+              case EQUAL:
+              case NOT_EQUAL:
+                   return labelQueriesDegree(predicate->list_comp.left_label) ||
+                          labelQueriesDegree(predicate->list_comp.right_label);
+
+              case GREATER:
+              case GREATER_EQUAL:
+              case LESS:
+              case LESS_EQUAL:
+                   return atomQueriesDegree(predicate->atom_comp.left_atom) ||
+                          atomQueriesDegree(predicate->atom_comp.right_atom);
+
+              default:
+                   return false;
+           }
+      }
+      case 'n':
+           return conditionQueriesStructure(condition->neg_condition);
+
+      case 'o':
+      case 'a':
+           return conditionQueriesStructure(condition->left_condition) ||
+                  conditionQueriesStructure(condition->right_condition);
+
+      default:
+           return true;
+   }
+}
+
+/* A match of <failed> created by an application of <applied> must use a host
+ * item that the application added, relabelled, remarked or (for nodes) made
+ * a root. Items whose labels and incidences are unchanged give the same
+ * matches as before, with one exception: the dangling condition and a
+ * condition querying degrees or edges can be satisfied by deleting or changing
+ * host edges outside the match. */
+bool mayEnable(Rule *applied, Rule *failed)
+{
+   if(failed->lhs == NULL) return true;
+   if(isPredicate(applied)) return false;
+
+   bool deletes_items = false, changes_edges = false;
+   int index, failed_index;
+   if(applied->lhs != NULL)
+   {
+      for(index = 0; index < applied->lhs->node_index; index++)
+         if(getRuleNode(applied->lhs, index)->interface == NULL) deletes_items = true;
+      for(index = 0; index < applied->lhs->edge_index; index++)
+         if(getRuleEdge(applied->lhs, index)->interface == NULL) deletes_items = true;
+   }
+   if(applied->rhs != NULL)
+   {
+      for(index = 0; index < applied->rhs->node_index; index++)
+      {
+         RuleNode *node = getRuleNode(applied->rhs, index);
+         if(node->interface != NULL && !node->relabelled && !node->remarked &&
+            !node->root_changed) continue;
+         for(failed_index = 0; failed_index < failed->lhs->node_index; failed_index++)
+         {
+            RuleNode *failed_node = getRuleNode(failed->lhs, failed_index);
+            if(failed_node->root && !node->root) continue;
+            if(compatibleLabels(failed_node->label, node->label)) return true;
+         }
+      }
+      for(index = 0; index < applied->rhs->edge_index; index++)
+      {
+         RuleEdge *edge = getRuleEdge(applied->rhs, index);
+         if(edge->interface != NULL && !edge->relabelled && !edge->remarked) continue;
+         changes_edges = true;
+         for(failed_index = 0; failed_index < failed->lhs->edge_index; failed_index++)
+         {
+            RuleEdge *failed_edge = getRuleEdge(failed->lhs, failed_index);
+            if(compatibleLabels(failed_edge->label, edge->label)) return true;
+         }
+      }
+   }
+   if(!deletes_items && !changes_edges) return false;
+   /* The dangling condition of a rule deleting a node is satisfied after the
+    * other edges incident to the host node are deleted. */
+   if(deletes_items)
+   {
+      for(failed_index = 0; failed_index < failed->lhs->node_index; failed_index++)
+         if(getRuleNode(failed->lhs, failed_index)->interface == NULL) return true;
+   }
+   if(failed->condition != NULL) return conditionQueriesStructure(failed->condition);
+   return false;
+}
+
 static void printOperation(RuleAtom *left_exp, RuleAtom *right_exp, 
                            string const operation, bool nested, FILE *file);
 
@@ -61,13 +61,16 @@ typedef struct Rule {
  * - Pointers to the predicate in which it participates. If the variable does not
  *   occur in any predicates, this pointer is NULL, otherwise it is a pointer array
  *   with <predicate_count> elements.
- * - A flag set to true if the variable's value is needed for rule application. */ 
+ * - A flag set to true if the variable's value is needed for rule application.
+ * - The position in the searchplan of the matching operation that first assigns
+ *   the variable, or -1. Set by schedulePredicates (genCondition.h). */ 
 typedef struct Variable {
    string name;
    GPType type;
    struct Predicate **predicates;
    int predicate_count;
    bool used_by_rule;
+   int binding_op;
 } Variable;
 
 
@@ -177,9 +180,14 @@ typedef struct Condition {
  * These are the leaves of the condition tree. Each predicate has a unique
  * integer identifier, used to generate unique boolean variables to store
  * the results of each predicate at runtime. Nodes and variables contain
- * pointers to any predicates taking that node or variable as an argument. */
+ * pointers to any predicates taking that node or variable as an argument.
+ * binding_op is the position in the searchplan of the matching operation that
+ * binds the last argument of the predicate: the predicate is evaluated by that
+ * operation's matcher only. It is -1 if the predicate is not evaluated during
+ * matching (see schedulePredicates in genCondition.h). */
 typedef struct Predicate {
    int bool_id;
+   int binding_op;
    bool negated;
    ConditionType type;
    union {
@@ -258,6 +266,12 @@ bool equalRuleLists(RuleLabel left_label, RuleLabel right_label);
 /* Used to determine the appropriate function call to generate label matching code. */
 bool hasListVariable(RuleLabel label);
 
+/* Rule-enabling analysis. Returns false if applying the rule <applied> to a
+ * host graph to which the rule <failed> is not applicable can never make
+ * <failed> applicable, and true if it may. The test is conservative: labels
+ * are compared by mark, length and constant atoms only. */
+bool mayEnable(Rule *applied, Rule *failed);
+
 void printRule(Rule *rule, FILE *file);
 void freeRule(Rule *rule);
 
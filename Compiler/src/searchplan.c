@@ -62,6 +62,11 @@ static void appendSearchOp(Searchplan *plan, char type, int index)
 }  
 
 Searchplan *generateSearchplan(RuleGraph *lhs)
+{
+   return generateSearchplanFrom(lhs, -1);
+}
+
+Searchplan *generateSearchplanFrom(RuleGraph *lhs, int start)
 {
    Searchplan *searchplan = makeSearchplan();
    bool tagged_nodes[lhs->node_index]; 
@@ -70,6 +75,12 @@ Searchplan *generateSearchplan(RuleGraph *lhs)
    for(index = 0; index < lhs->node_index; index++) tagged_nodes[index] = false;
    for(index = 0; index < lhs->edge_index; index++) tagged_edges[index] = false;
 
+   if(start >= 0)
+   {
+      RuleNode *node = getRuleNode(lhs, start);
+      traverseNode(searchplan, node, node->root ? 'r' : 'n', tagged_nodes, tagged_edges);
+   }
+
    /* Perform a depth-first traversal of the graph from its root nodes. */
    for(index = 0; index < lhs->node_index; index++)
    {
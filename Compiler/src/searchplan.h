@@ -80,6 +80,11 @@ typedef struct Searchplan {
 
 Searchplan *generateSearchplan(RuleGraph *lhs);
 
+/* As generateSearchplan, except that the traversal starts at the LHS node with
+ * index start, before the root nodes. A start of -1 gives the plan of
+ * generateSearchplan. Used to generate alternative searchplans for a rule. */
+Searchplan *generateSearchplanFrom(RuleGraph *lhs, int start);
+
 void printSearchplan(Searchplan *searchplan);
 void freeSearchplan(Searchplan *searchplan);
 #endif /* INC_SEARCHPLAN_H */
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Compare cache behaviour of the OILR4 element layouts. Each benchmark is
+# compiled with gp2c twice, once with the default array-of-structs layout and
+# once with --soa, and each executable is run under perf stat.
+
+EVENTS=cache-references,cache-misses,L1-dcache-loads,L1-dcache-load-misses
+GP2C="../../gp2c"
+OUT="$PWD/layout_results.csv"
+
+BMS="$@"
+
+if [ -z "$@" ] ; then BMS="*/" ; fi
+
+if ! which perf > /dev/null 2>&1 ; then
+	echo "perf is required to count cache misses" >&2
+	exit 1
+fi
+
+echo "benchmark,host,layout,seconds,`echo $EVENTS`" > "$OUT"
+
+for b in $BMS ; do
+	pushd "$b" > /dev/null
+	prog=`ls *.gp2`
+	exe=`basename "$prog" .gp2`
+	echo -- $prog -----------------
+	for host in `ls *.host` ; do
+		for layout in aos soa ; do
+			opt=""
+			[ "$layout" = "soa" ] && opt="--soa"
+			$GP2C $opt "$prog" "$host" > /dev/null || continue
+			stats=`perf stat -x, -e $EVENTS ./"$exe" 2>&1 >/dev/null | \
+				awk -F, '/^[0-9]/ { printf ",%s", $1 }'`
+			secs=`{ TIMEFORMAT=%R ; time ./"$exe" > /dev/null 2>&1 ; } 2>&1`
+			echo "   $host $layout: $secs s$stats"
+			echo "`basename $b`,$host,$layout,$secs$stats" >> "$OUT"
+			rm -f "$exe" "$exe.c"
+		done
+	done
+	popd > /dev/null
+done
@@ -8,6 +8,7 @@ import System.Exit
 
 import Text.Parsec
 import Data.List
+import Data.Maybe (listToMaybe)
 
 import OILR4.Instructions
 import OILR4.HostCompile
@@ -36,7 +37,7 @@ options = [ Option ['O'] ["no-oilr"] (NoArg NoOILR)
                     "Disable recursive strategy for looped rules.",
 
             Option ['D'] ["dump"] (ReqArg Dump "TYPE")
-                    "Don't compile; dump code to stdout. Valid options: c, oilr, ir",
+                    "Don't compile; dump code to stdout. Valid options: c, oilr, ir, jit",
 
             Option ['3'] ["32-bit"]  (NoArg Compile32Bit)
                     "Compile a 32-bit executable" ,
@@ -45,13 +46,21 @@ options = [ Option ['O'] ["no-oilr"] (NoArg NoOILR)
                     "Append index with modified nodes instead of prepending.",
             Option ['c'] ["compact-index"] (NoArg UseCompactIndex)
                     "Enable abstraction layer over OILR indices",
+            Option ['o'] ["oracle"] (NoArg UseOracle)
+                    "Skip rules whose search spaces hold too few nodes to match",
+            Option ['H'] ["huge-pages"] (NoArg UseHugePages)
+                    "Back the element pool with transparent huge pages where available",
+            Option ['S'] ["soa"] (NoArg UseSoALayout)
+                    "Store graph elements as parallel arrays of fields instead of padded structs",
 
             Option ['d'] ["debug"]   (NoArg EnableDebugging)
                     "Enable verbose debugging output on compiled program's stderr" ,
             Option ['e'] ["extra-debug"]   (NoArg EnableParanoidDebugging)
                     "Enable paranoid graph structure checks (implies -d)",
             Option ['t'] ["trace"]   (NoArg EnableExecutionTrace)
-                    "Enable execution trace" ]
+                    "Enable execution trace" ,
+            Option ['s'] ["pool-stats"] (NoArg EnablePoolStats)
+                    "Report element pool usage on the compiled program's stderr" ]
 
 
 debugCompiler = "gcc -g "
@@ -93,25 +102,27 @@ main = do
     hSetBuffering stdout NoBuffering
     args <- getArgs
     case getOpt Permute options args of
-        (flags, [progFile, hostFile], []) -> do
+        (flags, progFile:hostFiles, []) | length hostFiles <= 1 -> do
             let stem = getStem progFile
             let targ = stem ++ ".c"
             let exe  = stem
             -- p <- readFile progFile
             pAST <- parseProgram progFile
-            hAST <- parseHostGraph hostFile
+            -- Without a host file, the executable loads its host at runtime
+            hAST <- mapM parseHostGraph hostFiles
             let ir = makeIR pAST
             let cf = configureOilrMachine flags ir
             let (cf', prog) = compileProg cf $ optimise cf ir
             let cf'' = makePackedSpaces cf'
-            let host = compileHostGraph hAST
-            let c = compileC cf'' prog $ Just host
+            let host = fmap compileHostGraph $ listToMaybe hAST
+            let c = compileC cf'' prog host
             let compiler = getCompilerFor flags
             -- putStrLn $ show $ packIndices cf'
             case find (\f -> case f of { Dump _ -> True; _ -> False }) flags of
                 Just (Dump "ir")   -> putStrLn $ prettyIR ir
                 Just (Dump "oilr") -> putStrLn $ prettyProg prog
                 Just (Dump "c")    -> putStrLn c
+                Just (Dump "jit")  -> putStr $ jitProg cf'' prog
                 Just (Dump s)      -> error $ s ++ " is not a valid option to --dump."
                 Nothing            -> do writeFile targ $ c
                                          putStrLn $ intercalate " " [compiler,exe,targ]
@@ -1,38 +1,115 @@
 -- labelled graph isomorphism test
 -- Colin Runciman, July 2014; faster version December 2014
+-- October 2026: bucket results by a refinement invariant, and replace the
+-- brute-force bijection search by colour refinement plus backtracking.
 
 module GraphIsomorphism (isomorphismCount, isomorphic) where
 
-import List (representBy, choices, nonEmpty, bijectionsWith)
-import Data.Maybe (maybe)
+import List (addRepresentative)
+import Data.List (foldl', sort, sortBy)
+import Data.Ord (comparing)
+import qualified Data.Map.Strict as Map
+import qualified Data.Set as Set
 import Graph
-import Mapping
 
 -- Given a list of graphs, isomorphismCount returns a list of pairs.
--- Each pair contains a single representative of a set of isomorphic graphs in 
+-- Each pair contains a single representative of a set of isomorphic graphs in
 -- the list and a count of how many isomorphic copies of that graph were in the
 -- input list.
+-- Graphs are first bucketed by their invariantKey. Isomorphic graphs always
+-- share a key, so the full isomorphic test only runs within a bucket.
 isomorphismCount :: (Ord a, Ord b) => [Graph a b] -> [(Graph a b, Int)]
-isomorphismCount graphs = representBy isomorphic graphs
+isomorphismCount graphs = concat $ Map.elems $ foldl' add Map.empty graphs
+  where
+  add buckets g = Map.alter (Just . addRepresentative isomorphic g . maybe [] id)
+                            (invariantKey g) buckets
 
-isomorphic :: (Ord a, Ord b) => Graph a b -> Graph a b -> Bool
-isomorphic g1 g2 =
-  length ns1 == length ns2 &&
-  any (edgesIso g1 g2) (bijectionsWith (nodeAttribs g1) ns1 (nodeAttribs g2) ns2)
-  where ns1 = allNodeKeys g1 ; ns2 = allNodeKeys g2
+-- Node attributes that any isomorphism must preserve. The node label of a
+-- host graph carries its root flag and its mark as well as its list.
+type Attribs a = (a, Int, Int)
+
+-- Out- or in-adjacency of every node: edge label and the node at the other end.
+type Adjacency b = Map.Map NodeKey [(b, NodeKey)]
+
+adjacency :: Graph a b -> (Adjacency b, Adjacency b)
+adjacency g = (build [ (source ek, (l, target ek)) | (ek, l) <- allEdges g ],
+               build [ (target ek, (l, source ek)) | (ek, l) <- allEdges g ])
+  where
+  build kvs = foldl' (\m (k, v) -> Map.adjust (v:) k m) noEdges kvs
+  noEdges   = Map.fromList [ (n, []) | n <- allNodeKeys g ]
 
-nodeAttribs :: Graph a b -> NodeKey -> (a, Int, Int)
-nodeAttribs g n  =  (nLabel g n, outdegree g n, indegree g n)
+neighbours :: Adjacency b -> NodeKey -> [(b, NodeKey)]
+neighbours adj n = Map.findWithDefault [] n adj
 
-edgesIso :: Ord b => Graph a b -> Graph a b -> Mapping NodeKey NodeKey -> Bool
-edgesIso g1 g2 s = all (outEdgesIso g1 g2 s) (allNodeKeys g1)
+attribs :: Graph a b -> (Adjacency b, Adjacency b) -> NodeKey -> Attribs a
+attribs g (outs, ins) n = (nLabel g n, length $ neighbours outs n, length $ neighbours ins n)
 
-outEdgesIso :: Ord b => Graph a b -> Graph a b -> Mapping NodeKey NodeKey -> NodeKey -> Bool
-outEdgesIso g1 g2 s n1 =
-  nonEmpty (bijectionsWith (edgeAttribs $ Just s) es1 (edgeAttribs Nothing) es2) 
-  where es1 = outEdges g1 n1 ; es2 = outEdges g2 $ definiteLookup n1 s
+-- One round of Weisfeiler-Lehman refinement, kept in Ord-comparable form
+-- rather than hashed so that it works for any labelled graph: the node and
+-- edge counts, and the sorted multiset of each node's attributes paired with
+-- the attributes of its out- and in-neighbours.
+invariantKey :: (Ord a, Ord b) =>
+                Graph a b -> (Int, Int, [(Attribs a, [(b, Attribs a)], [(b, Attribs a)])])
+invariantKey g = (length ns, length $ allEdgeKeys g, sort $ map signature ns)
+  where
+  ns  = allNodeKeys g
+  adj@(outs, ins) = adjacency g
+  signature n = (attribs g adj n, around outs n, around ins n)
+  around a n  = sort [ (l, attribs g adj m) | (l, m) <- neighbours a n ]
+
+-- A node of either graph under comparison, tagged with the graph it belongs to.
+type Item = (Int, NodeKey)
+
+isomorphic :: (Ord a, Ord b) => Graph a b -> Graph a b -> Bool
+isomorphic g1 g2 =
+  length ns1 == length ns2 &&
+  length (allEdgeKeys g1) == length (allEdgeKeys g2) &&
+  histogram 1 ns1 == histogram 2 ns2 &&
+  extend (sortBy (comparing classSize) ns1) Map.empty Set.empty
+  where
+  ns1 = allNodeKeys g1 ; ns2 = allNodeKeys g2
+  adj1@(outs1, ins1) = adjacency g1
+  adj2@(outs2, ins2) = adjacency g2
+  outsOf (1, n) = [ (l, (1, m)) | (l, m) <- neighbours outs1 n ]
+  outsOf (_, n) = [ (l, (2, m)) | (l, m) <- neighbours outs2 n ]
+  insOf  (1, n) = [ (l, (1, m)) | (l, m) <- neighbours ins1 n ]
+  insOf  (_, n) = [ (l, (2, m)) | (l, m) <- neighbours ins2 n ]
+  colour = refine (items1 ++ items2) outsOf insOf $ rank $
+             [ (i, attribs g1 adj1 n) | i@(_, n) <- items1 ] ++
+             [ (i, attribs g2 adj2 n) | i@(_, n) <- items2 ]
+  items1 = [ (1, n) | n <- ns1 ] ; items2 = [ (2, n) | n <- ns2 ]
+  colourOf i = colour Map.! i
+  histogram k ns = sort [ colourOf (k, n) | n <- ns ]
+  candidates = Map.fromListWith (++) [ (colourOf (2, n), [n]) | n <- ns2 ]
+  sameColour n1 = Map.findWithDefault [] (colourOf (1, n1)) candidates
+  classSize n1 = length $ sameColour n1
+  -- Map g1 nodes in order of increasing class size, trying only g2 nodes of
+  -- the same colour and checking edges to the nodes mapped so far.
+  extend []        _ _    = True
+  extend (n1:rest) m used = any try [ n2 | n2 <- sameColour n1, not $ Set.member n2 used ]
+    where
+    try n2 = consistent n1 n2 m used &&
+             extend rest (Map.insert n1 n2 m) (Set.insert n2 used)
+  consistent n1 n2 m used =
+    mapped outs1 == kept outs2 && mapped ins1 == kept ins2
+    where
+    image t = if t == n1 then Just n2 else Map.lookup t m
+    mapped a = sort [ (l, t') | (l, t) <- neighbours a n1, Just t' <- [image t] ]
+    kept a   = sort [ (l, t) | (l, t) <- neighbours a n2, t == n2 || Set.member t used ]
 
-edgeAttribs:: Maybe (Mapping NodeKey NodeKey) -> (EdgeKey,b) -> (b, NodeKey)
-edgeAttribs ms (ek,elab)  =  (elab, maybe t (definiteLookup t) ms)
-  where t = target ek
+-- Colour refinement over the disjoint union of two graphs, so that colours
+-- are comparable between them. Each round recolours a node by its current
+-- colour and the sorted labels and colours of its out- and in-neighbours,
+-- until the number of colour classes stops growing.
+refine :: Ord b => [Item] -> (Item -> [(b, Item)]) -> (Item -> [(b, Item)]) ->
+          (Map.Map Item Int, Int) -> Map.Map Item Int
+refine items outsOf insOf (colour, classes) =
+  if classes' == classes then colour else refine items outsOf insOf (colour', classes')
+  where
+  (colour', classes') = rank [ (i, (colour Map.! i, around outsOf i, around insOf i)) | i <- items ]
+  around f i = sort [ (l, colour Map.! j) | (l, j) <- f i ]
 
+-- Number the distinct values of c, returning the numbering and its size.
+rank :: Ord c => [(Item, c)] -> (Map.Map Item Int, Int)
+rank ics = (Map.fromList [ (i, ids Map.! c) | (i, c) <- ics ], Map.size ids)
+  where ids = Map.fromList $ zip (Set.toAscList $ Set.fromList $ map snd ics) [0..]
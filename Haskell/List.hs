@@ -15,15 +15,18 @@ isSet :: Eq a => [a] -> Bool
 isSet []      =  True
 isSet (x:xs)  =  x `notElem` xs && isSet xs
 
--- NB. As the graph-isomorphism module applies representBy to potentially
--- large lists of graphs, computation is forced to ease memory pressure.
+-- NB. The graph-isomorphism module applies addRepresentative to each bucket
+-- of graphs with equal invariants. As the buckets can be large, computation
+-- is forced to ease memory pressure.
 representBy :: (a->a->Bool) -> [a] -> [(a,Int)]
-representBy equiv xs  =  foldl' add [] xs
-  where
-  add []             y  =  [(y,1)]
-  add (xn@(x,n):xns) y  =  if x `equiv` y
-                           then let n' = n+1 in n' `seq` (x,n'):xns
-                           else let a' = add xns y in a' `seq` (xn : a')
+representBy equiv xs  =  foldl' (flip $ addRepresentative equiv) [] xs
+
+addRepresentative :: (a->a->Bool) -> a -> [(a,Int)] -> [(a,Int)]
+addRepresentative equiv y []              =  [(y,1)]
+addRepresentative equiv y (xn@(x,n):xns)  =
+  if x `equiv` y
+  then let n' = n+1 in n' `seq` (x,n'):xns
+  else let a' = addRepresentative equiv y xns in a' `seq` (xn : a')
 
 nonEmpty :: [a] -> Bool
 nonEmpty []     =  False
@@ -23,7 +23,7 @@ compileC cf prog host = concat [preamble, cRuntime, spaces, chost, decls, defs]
           preamble = makePreamble cf
           chost  = case host of
                       Just h  -> compileHost h
-                      Nothing -> ""
+                      Nothing -> concat [ "\n\n", decl "_HOST", " {\n", compileIns RET, "\n\n" ]
 
 makePreamble :: OilrConfig -> String
 makePreamble cf = concat [ trace (show flags) $ concatMap globalOpts flags, "\n",
@@ -40,6 +40,9 @@ makePreamble cf = concat [ trace (show flags) $ concatMap globalOpts flags, "\n"
           globalOpts NoRecursion             = "#define MAX_RECURSE 0\n"
           globalOpts EnableExecutionTrace    = "#define OILR_EXECUTION_TRACE\n"
           globalOpts UseAppendToIndex        = "#define OILR_INDEX_APPEND\n"
+          globalOpts UseHugePages            = "#define OILR_HUGE_PAGES\n"
+          globalOpts UseSoALayout            = "#define OILR_SOA_LAYOUT\n"
+          globalOpts EnablePoolStats         = "#define OILR_POOL_STATS\n"
           globalOpts UseCompactIndex         = concat [ "#define OILR_COMPACT_INDEX\n"
                                                       , "#define OILR_PHYS_INDEX_SIZE ", show $ physIndCount cf, "\n"]
           globalOpts _ = ""
@@ -61,8 +64,20 @@ compileDecl (name, _) = decl name ++ ";\n"
 
 compileDefn :: Definition -> String
 compileDefn (name, (pre, RuleBody lhs rhs, post)) = concat $
-    ('\n':'\n':(decl name ++ " {\n\tsetCurrentRule(" ++ show name ++ ");\n")):[ compileIns i
-                        | i <- concat [pre, lhs, rhs, post] ]
+    oracleTable:('\n':(decl name ++ " {\n\tsetCurrentRule(" ++ show name ++ ");\n")):oracleCheck:[ compileRuleIns i
+                        | i <- concat [pre', lhs, rhs, post] ]
+    where (asserts, pre') = partition isAssert pre
+          isAssert (ASRT _ _) = True
+          isAssert _          = False
+          oracleName  = "oracle_" ++ name
+          oracleTable = if null asserts then "\n" else concat
+              [ "\nOracleSpc ", oracleName, "[] = { "
+              , concat [ concat ["{ ", spcName ss, ", ", show n, " }, "] | ASRT ss n <- asserts ]
+              , "{ NULL, 0 } };\n" ]
+          oracleCheck = if null asserts then "" else build ["ORACLE", oracleName]
+          -- a rule may have matches saved on the resume stack to apply
+          compileRuleIns RET = "l_exit:\n\tRES();\n\treturn;\n}"
+          compileRuleIns i   = compileIns i
 compileDefn (name, (pre, ProcBody is, post)) = concat $
     ('\n':'\n':(decl name ++ " {\n")):[ compileIns i
                         | i <- concat [pre, is, post] ]
@@ -116,8 +131,6 @@ compileIns (RET)             = "l_exit:\n\treturn;\n}"
 -- compileIns (BAK) = error "Compilation not implemented"
 -- compileIns (EBT) = error "Compilation not implemented"
 
-compileIns (ASRT ss n) = build ["ASRT", spcName ss]
-
 compileIns (BLI dst) = error "Compilation not implemented"
 compileIns (BLL dst) = error "Compilation not implemented"
 compileIns (BLR dst) = error "Compilation not implemented"
@@ -139,7 +152,6 @@ compileIns i     = build [show i]
 compileSS (id, inds) = concat [ "\nDList *", name, "[] = { "
                               , intercalate ", " (map indName inds), ", NULL };\n"
                               , "DList *", name, "_dl;\n"
-                              , "long oracle_", name, ";\n"
                               , "long ",   name, "_pos;\n"]
     where name = spcName id
 
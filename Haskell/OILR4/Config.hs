@@ -30,10 +30,13 @@ data Flag = NoOILR               -- switch off OILR indexing entirely
           | UseOracle            -- Use the graph oracle
           | UseCompactIndex      -- Use a minimal set of OILR indices
           | UseAppendToIndex     -- Append to index instead of prepending
+          | UseHugePages         -- Ask for transparent huge pages for the element pool
+          | UseSoALayout         -- Split elements into parallel arrays of fields
           -- OILR Runtime options
           | EnableDebugging
           | EnableParanoidDebugging
           | EnableExecutionTrace
+          | EnablePoolStats      -- Report element pool usage on exit
     deriving (Eq, Show)
 
 data OilrIndexBits = OilrIndexBits { bBits::Int
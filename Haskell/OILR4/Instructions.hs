@@ -113,10 +113,23 @@ data Instr =
 
 prettyProg :: Prog -> String
 prettyProg prog = intercalate "\n" $ map prettyDefn prog
-    where prettyDefn (id, (pre, body, post)) = '\n':id ++ (intercalate "\n\t" $ ":":(map show $ concat [pre, smoosh body, post]))
-          smoosh (ProcBody is) = is
+    where prettyDefn (id, defn) = '\n':id ++ (intercalate "\n\t" $ ":":(map show $ defnInstrs defn))
+
+defnInstrs :: ([Instr], DefBody, [Instr]) -> [Instr]
+defnInstrs (pre, body, post) = concat [pre, smoosh body, post]
+    where smoosh (ProcBody is) = is
           smoosh (RuleBody lhs rhs) = concat [lhs, rhs]
 
+-- The program as loaded by oilrjit: the index count, one line per search
+-- space, then each definition's instructions one per line until "end".
+jitProg :: OilrConfig -> Prog -> String
+jitProg cf prog = unlines $ concat [ [ "OILR " ++ show (indexCount cf) ]
+                                   , [ unwords $ "spc":map show (id:inds) | (id, inds) <- searchSpaces cf ]
+                                   , concatMap jitDefn prog ]
+    where jitDefn (id, defn@(_, body, _)) = unwords [kind body, id] : map show (defnInstrs defn) ++ ["end"]
+          kind (ProcBody _)   = "proc"
+          kind (RuleBody _ _) = "rule"
+
 compileProg :: OilrConfig -> [OilrIR] -> (OilrConfig, Prog)
 compileProg cfg ir = foldr compile (cfg, []) ir
 
@@ -192,11 +205,10 @@ yama acc seen (i@(BND r _):is) =
 yama acc seen (i:is) = yama (i:acc) seen is
 yama acc _ [] = reverse acc
     
+-- A rule can only match if each search space it binds nodes from holds at
+-- least as many nodes as it binds from there.
 makeOracle :: [Instr] -> [Instr]
-makeOracle is = ors
-    where ors = concatMap makeOra is
-          makeOra (BND _ s) = [ASRT s 1]
-          makeOra _         = []
+makeOracle is = [ ASRT s (length ss) | ss@(s:_) <- group $ sort [ s | BND _ s <- is ] ]
 
 
 sortInstr :: [Reg] -> [Instr] -> [Instr] -> [Instr]
@@ -278,14 +290,16 @@ nec regs s t = NEC (definiteLookup s regs) (definiteLookup t regs)
 
 -- compileExpr :: (Int, [Instr]) -> OilrExpr -> (Int, [Instr])
 compileExpr i (IRRuleSet rs)       = compileSet (i+1) rs
-compileExpr i (IRIf  cn th el) = concat [ compileExpr (i+1) cn
-                                        , [ brz i "elseI", BAK ]
+-- The condition of an if is always rolled back; that of a try is kept if it
+-- succeeded. BAK and EBT leave the bool flag alone for the following branch.
+compileExpr i (IRIf  cn th el) = concat [ [ BBT ] , compileExpr (i+1) cn
+                                        , [ BAK, brz i "elseI" ]
                                         , compileExpr (i+1) th
                                         , [ brn i "endI" , tar i "elseI" ]
                                         , compileExpr (i+1) el
                                         , [ tar i "endI" ] ]
-compileExpr i (IRTry cn th el) = concat [ compileExpr (i+1) cn 
-                                        , [ brz i "elseT" ]
+compileExpr i (IRTry cn th el) = concat [ [ BBT ] , compileExpr (i+1) cn
+                                        , [ EBT, brz i "elseT" ]
                                         , compileExpr (i+1) th
                                         , [ brn i "endT" , tar i "elseT" ]
                                         , compileExpr (i+1) el
@@ -0,0 +1,685 @@
+// oilrjit: load an OILR instruction stream and run it as native x86-64 code,
+// without a C compiler.
+//
+//     gp2c -D jit prog.gp2 > prog.oilr
+//     oilrjit prog.oilr host-file
+//
+// Each definition is translated into one native function. Instructions are
+// fixed templates: the match registers and the local fail stack live in the
+// function's frame, addressed from rbx and r14, with the fail stack index in
+// r12 and the rule's resume stack base in r13. Graph operations call the same
+// runtime functions the C backend's macros use, so a jitted program behaves
+// exactly like the compiled one built with the same runtime options.
+
+#define OILR_B_BITS 1
+#define OILR_C_BITS 3
+#define OILR_O_BITS 2
+#define OILR_I_BITS 2
+#define OILR_L_BITS 2
+#define OILR_R_BITS 1
+
+#define main oilrMain
+#include "oilrrt.c"
+#undef main
+
+#ifndef __x86_64__
+#error "oilrjit only generates x86-64 code"
+#endif
+
+#ifdef OILR_COMPACT_INDEX
+#error "oilrjit addresses the logical OILR indices directly"
+#endif
+
+/////////////////////////////////////////////////////////
+// loaded program
+
+enum JIT_OP { JREGS, JRST, JSUC, JUBN, JABN, JABE, JABL, JDBN, JDBE, JDBL,
+	JRBN, JCBL, JBND, JBOE, JBED, JBON, JBIN, JBLO, JNEC, JALAP, JONCE,
+	JTAR, JBRZ, JBNZ, JBRA, JBRN, JRET, JBBT, JBAK, JEBT, JASRT, JNOP,
+	JTRU, JFLS, JOPS };
+
+char *opNames[JOPS] = { "REGS", "RST", "SUC", "UBN", "ABN", "ABE", "ABL",
+	"DBN", "DBE", "DBL", "RBN", "CBL", "BND", "BOE", "BED", "BON", "BIN",
+	"BLO", "NEC", "ALAP", "ONCE", "TAR", "BRZ", "BNZ", "BRA", "BRN", "RET",
+	"BBT", "BAK", "EBT", "ASRT", "NOP", "TRU", "FLS" };
+
+typedef struct JitSpc {
+	DList **inds;   // NULL-terminated, like the C backend's ss_N arrays
+	DList *dl;
+	long pos;
+} JitSpc;
+
+typedef struct JitIns {
+	long op;
+	long args[3];
+	char *name;     // branch target, label or callee
+} JitIns;
+
+typedef struct JitDef {
+	char *name;
+	int isRule;
+	JitIns *ins;
+	long nIns, insSpace;
+	void (*code)();
+} JitDef;
+
+JitSpc *spaces;
+long nSpaces;
+JitDef *defs;
+long nDefs, defSpace;
+
+JitDef *findDef(char *name) {
+	long i;
+	for (i=0; i<nDefs; i++) {
+		if (strcmp(defs[i].name, name) == 0)
+			return &defs[i];
+	}
+	failwith("No definition of %s in the OILR program\n", name);
+}
+
+JitSpc *findSpc(long id) {
+	if (id < 0 || id >= nSpaces || !spaces[id].inds)
+		failwith("No search space %ld in the OILR program\n", id);
+	return &spaces[id];
+}
+
+void addSpc(long id, long *inds, long n) {
+	long i;
+	if (id >= nSpaces) {
+		spaces = realloc(spaces, (id+1) * sizeof(JitSpc));
+		if (!spaces)
+			failwith("Out of memory for search spaces\n");
+		memset(&spaces[nSpaces], 0, (id+1-nSpaces) * sizeof(JitSpc));
+		nSpaces = id+1;
+	}
+	spaces[id].inds = malloc((n+1) * sizeof(DList *));
+	if (!spaces[id].inds)
+		failwith("Out of memory for search spaces\n");
+	for (i=0; i<n; i++) {
+		if (inds[i] < 0 || inds[i] >= OILR_INDEX_SIZE)
+			failwith("Search space %ld uses index %ld, out of range\n", id, inds[i]);
+		spaces[id].inds[i] = &g.idx[inds[i]];
+	}
+	spaces[id].inds[n] = NULL;
+}
+
+JitDef *addDef(char *name, int isRule) {
+	JitDef *d;
+	if (nDefs == defSpace) {
+		defSpace = max(2*defSpace, 16);
+		defs = realloc(defs, defSpace * sizeof(JitDef));
+		if (!defs)
+			failwith("Out of memory for definitions\n");
+	}
+	d = &defs[nDefs++];
+	memset(d, 0, sizeof(JitDef));
+	d->name   = strdup(name);
+	d->isRule = isRule;
+	return d;
+}
+
+JitIns *addIns(JitDef *d) {
+	if (d->nIns == d->insSpace) {
+		d->insSpace = max(2*d->insSpace, 64);
+		d->ins = realloc(d->ins, d->insSpace * sizeof(JitIns));
+		if (!d->ins)
+			failwith("Out of memory for instructions\n");
+	}
+	memset(&d->ins[d->nIns], 0, sizeof(JitIns));
+	return &d->ins[d->nIns++];
+}
+
+/////////////////////////////////////////////////////////
+// parser for the output of gp2c -D jit
+//
+// One instruction per line, as shown by the Haskell compiler: an opcode
+// followed by integers, True/False or a quoted name.
+
+#define JIT_MAX_TOKENS 4096
+
+long splitLine(char *line, char **toks) {
+	long n = 0;
+	char *t = strtok(line, " \t\r");
+	while (t && n < JIT_MAX_TOKENS) {
+		toks[n++] = t;
+		t = strtok(NULL, " \t\r");
+	}
+	return n;
+}
+
+long parseArg(char *tok, char *file, long lineNo) {
+	char *end;
+	long v;
+	if (strcmp(tok, "True") == 0)
+		return 1;
+	if (strcmp(tok, "False") == 0)
+		return 0;
+	v = strtol(tok, &end, 10);
+	if (*end)
+		failwith("%s:%ld: bad operand '%s'\n", file, lineNo, tok);
+	return v;
+}
+
+void parseIns(JitDef *d, char **toks, long n, char *file, long lineNo) {
+	JitIns *ins;
+	long op, i, len;
+
+	for (op=0; op<JOPS && strcmp(toks[0], opNames[op]) != 0; op++)
+		;
+	if (op == JOPS)
+		failwith("%s:%ld: unsupported instruction %s\n", file, lineNo, toks[0]);
+	ins = addIns(d);
+	ins->op = op;
+	for (i=1; i<n; i++) {
+		len = strlen(toks[i]);
+		if (toks[i][0] == '"' && len >= 2 && toks[i][len-1] == '"') {
+			toks[i][len-1] = '\0';
+			ins->name = strdup(toks[i]+1);
+		} else if (i <= 3) {
+			ins->args[i-1] = parseArg(toks[i], file, lineNo);
+		} else {
+			failwith("%s:%ld: too many operands\n", file, lineNo);
+		}
+	}
+}
+
+void loadProgram(char *file) {
+	static char *toks[JIT_MAX_TOKENS];
+	static long inds[JIT_MAX_TOKENS];
+	char *line = NULL;
+	size_t lineSpace = 0;
+	long lineNo = 0, n, i;
+	JitDef *d = NULL;
+	FILE *f = fopen(file, "r");
+
+	if (!f)
+		failwith("Can't open OILR program %s\n", file);
+	while (getline(&line, &lineSpace, f) > 0) {
+		lineNo++;
+		line[strcspn(line, "\n")] = '\0';
+		n = splitLine(line, toks);
+		if (n == 0)
+			continue;
+		if (strcmp(toks[0], "OILR") == 0 && n == 2) {
+			if (parseArg(toks[1], file, lineNo) != 1<<OILR_INDEX_BITS)
+				failwith("%s was compiled for %s OILR indices, not %d\n", file, toks[1], 1<<OILR_INDEX_BITS);
+		} else if (strcmp(toks[0], "spc") == 0 && n >= 2) {
+			for (i=2; i<n; i++)
+				inds[i-2] = parseArg(toks[i], file, lineNo);
+			addSpc(parseArg(toks[1], file, lineNo), inds, n-2);
+		} else if ((strcmp(toks[0], "rule") == 0 || strcmp(toks[0], "proc") == 0) && n == 2) {
+			if (d)
+				failwith("%s:%ld: %s begins inside %s\n", file, lineNo, toks[1], d->name);
+			d = addDef(toks[1], toks[0][0] == 'r');
+		} else if (strcmp(toks[0], "end") == 0 && n == 1) {
+			if (!d)
+				failwith("%s:%ld: end outside a definition\n", file, lineNo);
+			d = NULL;
+		} else if (d) {
+			parseIns(d, toks, n, file, lineNo);
+		} else {
+			failwith("%s:%ld: instruction outside a definition\n", file, lineNo);
+		}
+	}
+	if (d)
+		failwith("%s: %s is missing its end\n", file, d->name);
+	free(line);
+	fclose(f);
+}
+
+/////////////////////////////////////////////////////////
+// runtime helpers called from jitted code
+//
+// Each takes the rule's register file and up to three operands, and returns
+// boolFlag so that the binding templates can test it in rax.
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+
+long jitBND(Element **regs, long dst, long spc, long c) {
+	JitSpc *s = (JitSpc *) spc;
+	bnd(&reg(dst), s->inds, &s->dl, &s->pos);
+	return boolFlag;
+}
+long jitBON(Element **regs, long dstE, long dstN, long src) {
+	followOutEdges(&reg(dstE), &reg(dstN), reg(src));
+	return boolFlag;
+}
+long jitBIN(Element **regs, long dstE, long dstN, long tgt) {
+	followInEdges(&reg(dstE), &reg(dstN), reg(tgt));
+	return boolFlag;
+}
+long jitBOE(Element **regs, long dst, long src, long tgt) {
+	edgeBetween(&reg(dst), reg(src), reg(tgt));
+	return boolFlag;
+}
+long jitBED(Element **regs, long dst, long r1, long r2) {
+	edgeBetween(&reg(dst), reg(r1), reg(r2));
+	if (!boolFlag) {
+		boolFlag=1;
+		edgeBetween(&reg(dst), reg(r2), reg(r1));
+	}
+	return boolFlag;
+}
+long jitBLO(Element **regs, long dst, long r, long c) {
+	loopOnNode(&reg(dst), reg(r));
+	return boolFlag;
+}
+long jitNEC(Element **regs, long src, long tgt, long c) {
+	Element *antiEdge = NULL;
+	edgeBetween(&antiEdge, reg(src), reg(tgt));
+	unbind(antiEdge);
+	boolFlag = !boolFlag;
+	return boolFlag;
+}
+
+long jitABN(Element **regs, long dst, long b, long c)     { ABN(dst); return 0; }
+long jitABE(Element **regs, long dst, long src, long tgt) { ABE(dst, src, tgt); return 0; }
+long jitABL(Element **regs, long dst, long src, long c)   { ABL(dst, src); return 0; }
+long jitDBN(Element **regs, long r, long b, long c)       { DBN(r); return 0; }
+long jitDBE(Element **regs, long r, long b, long c)       { DBE(r); return 0; }
+long jitDBL(Element **regs, long r, long b, long c)       { DBL(r); return 0; }
+long jitRBN(Element **regs, long r, long b, long c)       { RBN(r, b); return 0; }
+long jitCBL(Element **regs, long r, long col, long c)     { CBN(r, col); return 0; }
+long jitUBN(Element **regs, long n, long b, long c)       { UBN(n); return 0; }
+long jitBBT(Element **regs, long a, long b, long c)       { BBT(); return 0; }
+long jitBAK(Element **regs, long a, long b, long c)       { BAK(); return 0; }
+long jitEBT(Element **regs, long a, long b, long c)       { EBT(); return 0; }
+long jitBRA(Element **regs, long a, long b, long c)       { return rand() & 1; }
+
+long jitRST(Element **regs, long spc, long b, long c) {
+	JitSpc *s = (JitSpc *) spc;
+	s->dl  = s->inds[0];
+	s->pos = 0;
+	return 0;
+}
+
+// Returns 1 if the match was saved and the rule should look for another
+long jitSUC(Element **regs, long n, long b, long c) {
+	if (recursionDepth > 0) {
+		trace('S'); oilrTrace(NULL); nextTraceId();
+		recursionDepth--;
+		pushResume(regs, n);
+		return 1;
+	}
+	return 0;
+}
+
+// Returns 1 if a saved match was restored and its rhs should be applied
+long jitRES(Element **regs, long n, long resumeBase, long c) {
+	if (rsp > resumeBase) {
+		popResume(regs, n);
+		boolFlag=1;
+		return 1;
+	}
+	return 0;
+}
+
+long jitORACLE(Element **regs, long table, long b, long c) {
+	if (!oracle((OracleSpc *) table)) {
+		boolFlag=0;
+		return 0;
+	}
+	return 1;
+}
+
+long jitONCE(Element **regs, long def, long b, long c) {
+	ONCE(((JitDef *) def)->code);
+	return 0;
+}
+long jitALAP(Element **regs, long def, long b, long c) {
+	ALAP(((JitDef *) def)->code);
+	return 0;
+}
+
+#pragma GCC diagnostic pop
+
+/////////////////////////////////////////////////////////
+// code generation
+
+enum X86_REG { RAX=0, RCX=1, RDX=2, RSI=6, RDI=7 };
+
+unsigned char *code, *cp;
+long codeSize;
+
+typedef struct JitLabel {
+	char *name;
+	long at;
+} JitLabel;
+
+JitLabel *labels, *fixups;
+long nLabels, nFixups;
+
+#define codeOffset() (cp - code)
+
+// The code buffer is sized in advance by compileProgram.
+void reserve(long n) {
+	if (cp + n > code + codeSize)
+		failwith("Jitted code overflows its %ld byte buffer\n", codeSize);
+}
+void emit(int n, ...) {
+	va_list ap;
+	reserve(n);
+	va_start(ap, n);
+	while (n--)
+		*cp++ = (unsigned char) va_arg(ap, int);
+	va_end(ap);
+}
+void emit32(long v) {
+	int v32 = (int) v;
+	reserve(4);
+	memcpy(cp, &v32, 4);
+	cp += 4;
+}
+void emit64(long v) {
+	reserve(8);
+	memcpy(cp, &v, 8);
+	cp += 8;
+}
+
+void defineLabel(char *name) {
+	labels[nLabels].name = name;
+	labels[nLabels++].at = codeOffset();
+}
+int hasLabel(char *name) {
+	long i;
+	for (i=0; i<nLabels; i++) {
+		if (strcmp(labels[i].name, name) == 0)
+			return 1;
+	}
+	return 0;
+}
+// rel32 to a label of the current definition, patched by resolveLabels
+void emitRel(char *name) {
+	fixups[nFixups].name = name;
+	fixups[nFixups++].at = codeOffset();
+	emit32(0);
+}
+// rel32 to code already emitted
+void emitRelTo(long at) {
+	emit32(at - codeOffset() - 4);
+}
+
+void resolveLabels(JitDef *d) {
+	long i, j;
+	int rel;
+	for (i=0; i<nFixups; i++) {
+		for (j=0; j<nLabels && strcmp(labels[j].name, fixups[i].name) != 0; j++)
+			;
+		if (j == nLabels)
+			failwith("%s: no label %s\n", d->name, fixups[i].name);
+		rel = (int) (labels[j].at - fixups[i].at - 4);
+		memcpy(code + fixups[i].at, &rel, 4);
+	}
+}
+
+void emitLoad(int r, long v) {
+	emit(2, 0x48, 0xB8+r);            // movabs r, v
+	emit64(v);
+}
+
+void emitCall(void *fn, long a, long b, long c) {
+	emit(3, 0x48, 0x89, 0xDF);        // mov rdi, rbx
+	emitLoad(RSI, a);
+	emitLoad(RDX, b);
+	emitLoad(RCX, c);
+	emitLoad(RAX, (long) fn);
+	emit(2, 0xFF, 0xD0);              // call rax
+}
+
+// cc is 0 for an unconditional jump, or 0x84 (jz) or 0x85 (jnz)
+void emitJump(int cc, char *name) {
+	if (cc)
+		emit(2, 0x0F, cc);
+	else
+		emit(1, 0xE9);
+	emitRel(name);
+}
+
+void emitTestResult() {
+	emit(3, 0x48, 0x85, 0xC0);        // test rax, rax
+}
+
+void emitTestFlag() {
+	emitLoad(RAX, (long) &boolFlag);
+	emit(4, 0x48, 0x83, 0x38, 0x00);  // cmp qword [rax], 0
+}
+
+void emitSetFlag(long v) {
+	emitLoad(RAX, (long) &boolFlag);
+	emit(3, 0x48, 0xC7, 0x00);        // mov qword [rax], v
+	emit32(v);
+}
+
+// fail() unless the helper returned true
+void emitFailUnless() {
+	emitTestResult();
+	emit(2, 0x75, 9);                 // jnz past the fail sequence
+	emit(4, 0x4B, 0x8B, 0x04, 0xE6);  // mov rax, [r14+r12*8]
+	emit(3, 0x49, 0xFF, 0xCC);        // dec r12
+	emit(2, 0xFF, 0xE0);              // jmp rax
+}
+
+// A binding instruction: on success push its own start as the retry point,
+// as setFailTo(&&l_dst) does; on failure take the latest retry point.
+void emitBind(void *fn, long a, long b, long c) {
+	long start = codeOffset();
+	emitCall(fn, a, b, c);
+	emitFailUnless();
+	emit(3, 0x49, 0xFF, 0xC4);        // inc r12
+	emit(3, 0x48, 0x8D, 0x05);        // lea rax, [rip+start]
+	emitRelTo(start);
+	emit(4, 0x4B, 0x89, 0x04, 0xE6);  // mov [r14+r12*8], rax
+}
+
+void emitPrologue(long frame, long nRegs) {
+	emit(1, 0x55);                    // push rbp
+	emit(3, 0x48, 0x89, 0xE5);        // mov rbp, rsp
+	emit(1, 0x53);                    // push rbx
+	emit(2, 0x41, 0x54);              // push r12
+	emit(2, 0x41, 0x55);              // push r13
+	emit(2, 0x41, 0x56);              // push r14
+	emit(3, 0x48, 0x81, 0xEC);        // sub rsp, frame
+	emit32(frame);
+	emit(3, 0x48, 0x89, 0xE3);        // mov rbx, rsp
+	emit(3, 0x4C, 0x8D, 0xB3);        // lea r14, [rbx+8*nRegs]
+	emit32(8*nRegs);
+}
+
+void emitEpilogue() {
+	defineLabel("l_return");
+	emit(4, 0x48, 0x8D, 0x65, 0xE0);  // lea rsp, [rbp-32]
+	emit(2, 0x41, 0x5E);              // pop r14
+	emit(2, 0x41, 0x5D);              // pop r13
+	emit(2, 0x41, 0x5C);              // pop r12
+	emit(1, 0x5B);                    // pop rbx
+	emit(1, 0x5D);                    // pop rbp
+	emit(1, 0xC3);                    // ret
+}
+
+#define isBind(op) ((op) == JBND || (op) == JBOE || (op) == JBED || (op) == JBON || (op) == JBIN || (op) == JBLO)
+
+long regCount(JitDef *d) {
+	long i, nRegs = 0;
+	for (i=0; i<d->nIns; i++)
+		if (d->ins[i].op == JREGS)
+			nRegs = d->ins[i].args[0];
+	return nRegs;
+}
+
+void compileDef(JitDef *d) {
+	long i, r, nRegs = regCount(d), nFails = 1, nAsserts = 0, frame;
+	OracleSpc *table;
+	JitIns *ins;
+
+	for (i=0; i<d->nIns; i++) {
+		ins = &d->ins[i];
+		if (isBind(ins->op))
+			nFails++;
+		else if (ins->op == JASRT)
+			nAsserts++;
+	}
+	frame = (8*nRegs + 8*nFails + 15) & ~15L;
+	nLabels = nFixups = 0;
+
+	d->code = (void (*)()) cp;
+	emitPrologue(frame, nRegs);
+	if (nAsserts) {
+		table = malloc((nAsserts+1) * sizeof(OracleSpc));
+		if (!table)
+			failwith("Out of memory for oracle tables\n");
+		for (i=0, r=0; i<d->nIns; i++) {
+			ins = &d->ins[i];
+			if (ins->op != JASRT)
+				continue;
+			table[r].spc   = findSpc(ins->args[0])->inds;
+			table[r++].min = ins->args[1];
+		}
+		table[r].spc = NULL;
+		table[r].min = 0;
+		emitCall(jitORACLE, (long) table, 0, 0);
+		emitTestResult();
+		emitJump(0x84, "l_return");
+	}
+
+	for (i=0; i<d->nIns; i++) {
+		ins = &d->ins[i];
+		long a = ins->args[0], b = ins->args[1], c = ins->args[2];
+		switch (ins->op) {
+			case JREGS:
+				emitLoad(RAX, (long) &rsp);
+				emit(3, 0x4C, 0x8B, 0x28);        // mov r13, [rax]
+				emit(3, 0x48, 0x8D, 0x05);        // lea rax, [rip+l_exit]
+				emitRel("l_exit");
+				emit(3, 0x49, 0x89, 0x06);        // mov [r14], rax
+				defineLabel("l_match");
+				emit(2, 0x31, 0xC0);              // xor eax, eax
+				for (r=0; r<nRegs; r++) {
+					emit(3, 0x48, 0x89, 0x83);    // mov [rbx+8*r], rax
+					emit32(8*r);
+				}
+				emit(3, 0x45, 0x31, 0xE4);        // xor r12d, r12d
+				break;
+			case JSUC:
+				emitCall(jitSUC, nRegs, 0, 0);
+				emitTestResult();
+				emitJump(0x85, "l_match");
+				defineLabel("l_resume");
+				break;
+			case JRET:
+				defineLabel("l_exit");
+				if (d->isRule && hasLabel("l_resume")) {
+					emit(3, 0x48, 0x89, 0xDF);    // mov rdi, rbx
+					emitLoad(RSI, nRegs);
+					emit(3, 0x4C, 0x89, 0xEA);    // mov rdx, r13
+					emitLoad(RAX, (long) jitRES);
+					emit(2, 0xFF, 0xD0);          // call rax
+					emitTestResult();
+					emitJump(0x85, "l_resume");
+				}
+				emitEpilogue();
+				break;
+
+			case JBND: emitBind(jitBND, a, (long) findSpc(b), 0); break;
+			case JBOE: emitBind(jitBOE, a, b, c); break;
+			case JBED: emitBind(jitBED, a, b, c); break;
+			case JBON: emitBind(jitBON, a, b, c); break;
+			case JBIN: emitBind(jitBIN, a, b, c); break;
+			case JBLO: emitBind(jitBLO, a, b, 0); break;
+			case JNEC:
+				emitCall(jitNEC, a, b, 0);
+				emitFailUnless();
+				break;
+
+			case JRST: emitCall(jitRST, (long) findSpc(a), 0, 0); break;
+			case JUBN: emitCall(jitUBN, a, 0, 0); break;
+			case JABN: emitCall(jitABN, a, 0, 0); break;
+			case JABE: emitCall(jitABE, a, b, c); break;
+			case JABL: emitCall(jitABL, a, b, 0); break;
+			case JDBN: emitCall(jitDBN, a, 0, 0); break;
+			case JDBE: emitCall(jitDBE, a, 0, 0); break;
+			case JDBL: emitCall(jitDBL, a, 0, 0); break;
+			case JRBN: emitCall(jitRBN, a, b, 0); break;
+			case JCBL: emitCall(jitCBL, a, b, 0); break;
+			case JBBT: emitCall(jitBBT, 0, 0, 0); break;
+			case JBAK: emitCall(jitBAK, 0, 0, 0); break;
+			case JEBT: emitCall(jitEBT, 0, 0, 0); break;
+
+			case JONCE: emitCall(jitONCE, (long) findDef(ins->name), 0, 0); break;
+			case JALAP: emitCall(jitALAP, (long) findDef(ins->name), 0, 0); break;
+
+			case JTAR: defineLabel(ins->name); break;
+			case JBRN: emitJump(0, ins->name); break;
+			case JBRZ: emitTestFlag(); emitJump(0x84, ins->name); break;
+			case JBNZ: emitTestFlag(); emitJump(0x85, ins->name); break;
+			case JBRA:
+				emitCall(jitBRA, 0, 0, 0);
+				emitTestResult();
+				emitJump(0x85, ins->name);
+				break;
+			case JTRU: emitSetFlag(1); break;
+			case JFLS: emitSetFlag(0); break;
+
+			case JASRT:
+			case JNOP:
+				break;
+		}
+	}
+	if (!hasLabel("l_return"))
+		failwith("%s has no RET\n", d->name);
+	resolveLabels(d);
+}
+
+// Upper bound on the code for a definition: the largest template is a
+// binding instruction, a little over 80 bytes, except that REGS clears
+// each register with a 7 byte instruction.
+#define JIT_INS_BYTES 128
+#define JIT_REG_BYTES 7
+
+void compileProgram() {
+	long i, maxIns = 0;
+
+	codeSize = 0;
+	for (i=0; i<nDefs; i++) {
+		codeSize += JIT_INS_BYTES * (defs[i].nIns + 4) + JIT_REG_BYTES * regCount(&defs[i]);
+		maxIns = max(maxIns, defs[i].nIns);
+	}
+	codeSize = (codeSize + getpagesize() - 1) & ~((long) getpagesize() - 1);
+	code = mmap(NULL, codeSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED)
+		failwith("Can't map %ld bytes for jitted code\n", codeSize);
+	labels = malloc((maxIns+8) * sizeof(JitLabel));
+	fixups = malloc((maxIns+8) * sizeof(JitLabel));
+	if (!labels || !fixups)
+		failwith("Out of memory for labels\n");
+
+	cp = code;
+	for (i=0; i<nDefs; i++) {
+		compileDef(&defs[i]);
+		debug("Jitted %s: %ld instructions\n", defs[i].name, defs[i].nIns);
+	}
+	if (mprotect(code, codeSize, PROT_READ|PROT_EXEC) != 0)
+		failwith("Can't make jitted code executable\n");
+	free(labels);
+	free(fixups);
+}
+
+/////////////////////////////////////////////////////////
+// entry points expected by the runtime
+
+void _HOST() {
+	return;
+}
+
+void OILR_Main() {
+	findDef("OILR_Main")->code();
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2)
+		failwith("Usage: %s program.oilr [host-file]\n", argv[0]);
+	loadProgram(argv[1]);
+	compileProgram();
+	argv[1] = argv[0];
+	return oilrMain(argc-1, argv+1);
+}
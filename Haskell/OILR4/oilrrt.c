@@ -7,7 +7,9 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #define OILR_BIND_BITS 1
 #define OILR_T_BITS 2
@@ -17,6 +19,17 @@
 #define DONE return
 #define MIN_ALLOC_INCREMENT (1024*1024*4)  // 4 meg
 
+// Address space reserved for the element pool at startup. Pages are only
+// committed as the pool grows, so this can be far larger than the host.
+#ifndef OILR_POOL_RESERVE
+#if __x86_64__
+#	define OILR_POOL_RESERVE (1L<<40)  // 1 TB
+#else
+#	define OILR_POOL_RESERVE (1L<<30)  // 1 GB
+#endif
+#endif
+#define HUGE_PAGE_SIZE (1024*1024*2)
+
 #if __x86_64__
 #	define OILR_ELEM_ALIGN 128
 #else
@@ -24,12 +37,10 @@
 #endif
 #define OILR_ELEM_MASK  (~(OILR_ELEM_ALIGN-1))
 
+// Number of matches a looped rule may collect before applying them. They are
+// kept on the heap, so this is no longer bounded by the C stack.
 #ifndef MAX_RECURSE
-#if __x86_64__
-#   define MAX_RECURSE 40000
-#else
-#	define MAX_RECURSE 50000
-#endif
+#	define MAX_RECURSE LONG_MAX
 #endif
 
 
@@ -37,10 +48,7 @@ void OILR_Main();
 void _HOST();
 long bindCount   = 0;
 long unbindCount = 0;
-void *currentBrk;
-long lastAlloc = 0;
 long recursionDepth = 0;
-void (*self)();
 
 char *colourNames[]   = { "", " # red", " # blue", " # green", " # grey" };
 char *edgeMarkNames[] = { "", " # dashed" };
@@ -51,8 +59,16 @@ char *edgeMarkNames[] = { "", " # dashed" };
 /////////////////////////////////////////////////////////
 // Doubly-linked list structure
 
+#ifdef OILR_SOA_LAYOUT
+// List items live in the chains column, list heads in the adjacency column.
+#define columnIndex(p, col) (((char *)(p) - (char *)g.col) / (long) sizeof(*g.col))
+#define elementOfListItem(dl) (&g.pool[columnIndex(dl, chains)])
+#define elementOfListHead(dl) (&g.pool[columnIndex(dl, adj)])
+#else
 // TODO: introduce a union to prevent this casting evil
 #define elementOfListItem(dl) ((Element *)((long)(dl)&(OILR_ELEM_MASK)))
+#define elementOfListHead(dl) elementOfListItem(dl)
+#endif
 
 #define listLength(dl) ((dl)->count)
 #define incListLength(dl) ((dl)->count++)
@@ -60,6 +76,10 @@ char *edgeMarkNames[] = { "", " # dashed" };
 
 // #define OILR_COMPACT_LISTS
 
+#if defined(OILR_COMPACT_LISTS) && defined(OILR_SOA_LAYOUT)
+#error "OILR_COMPACT_LISTS relies on lists being embedded in Elements"
+#endif
+
 #ifdef OILR_COMPACT_LISTS
 #define offs(dl, n) ((DList*)((Element*)(dl)+(n)))
 #define nextElem(dl) (offs(dl, (dl)->next))
@@ -106,6 +126,19 @@ typedef struct DList {
 } DList;
 #endif
 
+#ifdef OILR_SOA_LAYOUT
+#define column(col, el) (g.col[elementId(el)])
+#define source(e)   (column(ends, e).src)
+#define target(e)   (column(ends, e).tgt)
+#define outChain(e) (&column(chains, e).outList)
+#define inChain(e)  (&column(chains, e).inList)
+
+#define chainFor(n)        (&column(chains, n).index)
+#define outListFor(n)      (&column(adj, n).outEdges)
+#define inListFor(n)       (&column(adj, n).inEdges)
+#define loopListFor(n)     (&column(adj, n).loops)
+#define nextFree(el)       (column(chains, el).free)
+#else
 #define source(e)   ((e)->src)
 #define target(e)   ((e)->tgt)
 #define outChain(e) (&(e)->outList)
@@ -115,6 +148,8 @@ typedef struct DList {
 #define outListFor(n)      (&(n)->outEdges)
 #define inListFor(n)       (&(n)->inEdges)
 #define loopListFor(n)     (&(n)->loops)
+#define nextFree(el)       ((el)->free)
+#endif
 
 #define outdeg(n)   (listLength(outListFor(n)))
 #define indeg(n)    (listLength(inListFor(n)))
@@ -176,7 +211,12 @@ DList *indexMap[];
 #define LABL_MASK mask(OILR_B_BITS, LABL_OFFS)
 #define bBits(el) (flags(el) & LABL_MASK)
 #define isLabelled(el) (bBits(el))
+#ifdef OILR_SOA_LAYOUT
+#define getLabel(el) (column(labels, el))
+#else
 #define getLabel(el) ((el)->label)
+#endif
+#define setLabel(el, l) do { getLabel(el) = (l); } while (0)
 
 // bound
 #define BIND_OFFS (LABL_OFFS+OILR_B_BITS)
@@ -200,6 +240,40 @@ DList *indexMap[];
 #define EDGE_TYPE (2 << TYPE_OFFS)
 
 
+#ifdef OILR_SOA_LAYOUT
+// Structure-of-arrays layout: an element is split across parallel columns
+// indexed by element id. g.pool is the flags column itself, so that index
+// scans and bind checks read a dense array of ints; links, adjacency heads,
+// edge endpoints and labels are only touched when they are needed.
+typedef struct Element {
+	unsigned int flags;
+} Element;
+
+typedef struct Chains {
+	union {
+		DList index;  // nodes: membership of an OILR index
+		struct {      // edges: membership of the source's out-list and target's in-list
+			DList outList;
+			DList inList;
+		};
+		struct Element *free;
+		// power of two size, so list items map to ids with a shift
+		char pad[OILR_ELEM_ALIGN/2];
+	};
+} Chains;
+
+typedef struct Adjacency {
+	DList outEdges;
+	DList inEdges;
+	DList loops;
+} Adjacency;
+
+typedef struct Ends {
+	struct Element *src;
+	struct Element *tgt;
+} Ends;
+
+#else
 typedef struct Element {
 	unsigned int flags;
 	int label;
@@ -222,14 +296,31 @@ typedef struct Element {
 		char pad[OILR_ELEM_ALIGN-2*sizeof(int)];
 	};
 } Element;
+#endif
+
+typedef struct PoolStats {
+	long reserved;   // bytes of address space
+	long committed;  // bytes readable and writable
+	long growths;
+	long highWater;  // largest freeId seen
+	long prefaulted; // pages touched ahead of use
+} PoolStats;
 
 typedef struct Graph {
 	long freeId;
-	long poolSize;
+	long poolSize;   // elements in committed memory
+	long poolReserve;  // elements in reserved address space
 	long nodeCount;
 	long edgeCount;
 	Element *pool;
+#ifdef OILR_SOA_LAYOUT
+	Chains *chains;
+	Adjacency *adj;
+	Ends *ends;
+	int *labels;
+#endif
 	Element *freeList;
+	PoolStats stats;
 #ifdef OILR_COMPACT_INDEX
 	DList idx[OILR_PHYS_INDEX_SIZE];
 #else
@@ -281,10 +372,13 @@ long boolFlag = 1;
 #ifndef NDEBUG
 long identList(DList *dl, char **str) {
 	// dl must point to a list-head!
-	Element *e = elementOfListItem(dl);
+	Element *e = elementOfListHead(dl);
 	long elemId  = elementId( e );
 	long indexId = indexIdFor(dl);
-	if (elemId > 0 && elemId < g.freeId) {
+	if (indexId >= 0 && indexId < OILR_INDEX_SIZE) {
+		*str = "index";
+		return indexId;
+	} else if (elemId > 0 && elemId < g.freeId) {
 		switch ( elType(getElementById(elemId)) ) {
 			case (NODE_TYPE):
 				if ( dl == outListFor(e) )
@@ -300,9 +394,6 @@ long identList(DList *dl, char **str) {
 				failwith("dl is not part of a node!");
 		}
 		return elemId;
-	} else if (indexId >= 0 && indexId < OILR_INDEX_SIZE) {
-		*str = "index";
-		return indexId;
 	}
 	failwith("This should never happen.");
 	return -1;  // suppress compiler warning. Unreachable
@@ -313,7 +404,7 @@ long identList(DList *dl, char **str) {
 
 #if defined(OILR_PARANOID_CHECKS) && !defined(NDEBUG)
 long walkChain(DList *dl) {
-	DList *p, *l = dl;
+	DList *p = NULL, *l = dl;
 	long len=0, blen=0;
 	while ( (l = nextElem(l)) ) {
 		len++;
@@ -443,6 +534,39 @@ void checkGraph() {
 #define checkGraph()
 #endif
 
+/////////////////////////////////////////////////////////
+// undo journal
+//
+// While a backtracking section is open (btDepth > 0) every graph mutation
+// pushes an undo record onto the b-stack: its operands followed by a BT_INSTR
+// opcode, so that rollBack() reads the opcode first. Each section starts
+// with a two-word header (the enclosing section's bfp, then BEnd) and bfp
+// points at the header of the innermost open section.
+
+#define B_STACK_SIZE (1024*1024*1)
+long bStack[B_STACK_SIZE];
+long *bsp = bStack+B_STACK_SIZE;
+long *bfp = NULL;
+long btDepth=0;
+
+#define pushB(v) do { if (bsp == bStack) failwith("b-stack overflow\n"); *(--bsp)=(long)(v); } while (0)
+#define popB()   (*(bsp++))
+#define journalling() (btDepth > 0)
+
+enum BT_INSTR {
+	BEnd=0,        // i.e. b-stack sections are null terminated
+	BCommitted,    // header of a committed inner section: saved bfp
+	BUnAddNode,    // id, fresh
+	BUnAddEdge,    // id, fresh
+	BUnAddLoop,    // id, fresh
+	BUnDeleteNode, // id, flags, label
+	BUnDeleteEdge, // id, src id, tgt id, flags, label
+	BUnDeleteLoop, // id, node id, flags, label
+	BUnColour,     // id, previous colour
+	BUnSetRoot,    // id
+	BUnUnsetRoot,  // id
+};
+
 /////////////////////////////////////////////////////////
 // graph manipulation
 
@@ -475,19 +599,34 @@ void reindexNode(Element *n) {
 void setRoot(Element *n) {
 	setFlags(n, flags(n) | ROOT_MASK);
 	reindexNode(n);
+	if (journalling()) {
+		pushB(elementId(n));
+		pushB(BUnSetRoot);
+	}
 	debug("(R) Set root on node %ld\n", elementId(n));
 	oilrStatus(n);
 }
 void unsetRoot(Element *n) {
 	setFlags(n, flags(n) & ~ROOT_MASK);	
 	reindexNode(n);
+	if (journalling()) {
+		pushB(elementId(n));
+		pushB(BUnUnsetRoot);
+	}
 	debug("(-) Unset root on node %ld\n", elementId(n));
 	oilrStatus(n);
 }
 void setColour(Element *n, long c) {
 	long flags = (flags(n) & ~COLR_MASK) | (c<<COLR_OFFS);
+	if (journalling()) {
+		pushB(colour(n));
+		pushB(elementId(n));
+		pushB(BUnColour);
+	}
 	setFlags(n, flags);
-	reindexNode(n);
+	// Edges are not indexed, and their DLists overlay the node's index chain.
+	if (isNode(n))
+		reindexNode(n);
 	debug("(#) Set colour on element %ld to %ld\n", elementId(n), c);
 	oilrStatus(n);
 }
@@ -495,37 +634,153 @@ void setColour(Element *n, long c) {
 #define setColourById(n, c) setColour( getElementById(n), (c) )
 
 void freeElement(Element *ne) {
-	ne->free = g.freeList;
+	nextFree(ne) = g.freeList;
 	setFlags(ne, FREE_TYPE);  // clobbering flags is fine here.
 	g.freeList = ne;
 }
 
 
+/////////////////////////////////////////////////////////
+// element pool
+//
+// Elements are addressed by their offset from g.pool, so the pool must never
+// move. We reserve one large region of address space up front and commit it
+// piecemeal with mprotect(), which leaves the C heap free for libc. In the
+// SoA layout every column gets its own region, grown in step with the others.
+
+typedef struct Column {
+	void **base;
+	long width;  // bytes per element
+} Column;
+
+Column columns[] = {
+	{ (void **) &g.pool,   sizeof(Element) },
+#ifdef OILR_SOA_LAYOUT
+	{ (void **) &g.chains, sizeof(Chains) },
+	{ (void **) &g.adj,    sizeof(Adjacency) },
+	{ (void **) &g.ends,   sizeof(Ends) },
+	{ (void **) &g.labels, sizeof(int) },
+#endif
+};
+#define POOL_COLUMNS ((long) (sizeof(columns)/sizeof(Column)))
+
+void *reserveColumn(long size) {
+	char *p, *base = mmap(NULL, size+HUGE_PAGE_SIZE, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+	// Align to a huge page boundary so that the kernel can back it with
+	// huge pages from the first element on.
+	p = (char *) (((long)base + HUGE_PAGE_SIZE-1) & ~(long)(HUGE_PAGE_SIZE-1));
+#if defined(OILR_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+	if (madvise(p, size, MADV_HUGEPAGE) < 0) {
+		debug("madvise(MADV_HUGEPAGE) failed; continuing with normal pages\n");
+	}
+#endif
+	return p;
+}
+
+void reservePool() {
+	// Reserve room for as many elements as OILR_POOL_RESERVE bytes of
+	// OILR_ELEM_ALIGN-sized elements, whatever the layout.
+	long elems = OILR_POOL_RESERVE / OILR_ELEM_ALIGN;
+	long i, j;
+	// Fall back to smaller reservations under a tight address-space limit
+	for (; elems * OILR_ELEM_ALIGN >= MIN_ALLOC_INCREMENT; elems /= 2) {
+		for (i=0; i<POOL_COLUMNS; i++) {
+			if ( !(*columns[i].base = reserveColumn(elems * columns[i].width)) )
+				break;
+		}
+		if (i == POOL_COLUMNS)
+			break;
+		for (j=0; j<i; j++)
+			munmap(*columns[j].base, elems * columns[j].width);
+	}
+	if (elems * OILR_ELEM_ALIGN < MIN_ALLOC_INCREMENT)
+		failwith("Couldn't reserve address space for the element pool\n");
+	g.poolSize    = 0;
+	g.poolReserve = elems;
+	for (i=0; i<POOL_COLUMNS; i++)
+		g.stats.reserved += elems * columns[i].width;
+	g.stats.committed = 0;
+	debug("Reserved %ld bytes for %ld elements\n", g.stats.reserved, elems);
+}
+
 void checkSpace(long n) {
 	// Ensure there is space to allocate n elements
-	if (g.freeId + n >= g.poolSize) {
-		assert( sbrk(0) == currentBrk );  // check malloc hasn't moved the brk!
-		if (lastAlloc)
-			lastAlloc += lastAlloc;
-		else  // our first allocation.
-			lastAlloc = max(MIN_ALLOC_INCREMENT, sizeof(Element) * n * 3);
-		currentBrk += lastAlloc;
-		if ( brk( currentBrk ) < 0 )
-			failwith("Couldn't move brk address to %p\n", currentBrk);
-		debug("Allocated space for %d Elements\n", lastAlloc/sizeof(Element));
-		g.poolSize = lastAlloc/sizeof(Element);
+	long i, need = g.freeId + n + 1;
+	long size = max(g.poolSize * 2, MIN_ALLOC_INCREMENT / OILR_ELEM_ALIGN);
+	if (need <= g.poolSize)
+		return;
+	while (size < need)
+		size *= 2;
+	size = min(size, g.poolReserve);
+	if (size < need)
+		failwith("Element pool exhausted: %ld elements reserved\n", g.poolReserve);
+	// Sizes are powers of two of at least MIN_ALLOC_INCREMENT/OILR_ELEM_ALIGN
+	// elements, so every column grows by whole pages.
+	for (i=0; i<POOL_COLUMNS; i++) {
+		long w = columns[i].width;
+		if ( mprotect( (char *)*columns[i].base + g.poolSize*w, (size - g.poolSize)*w,
+					PROT_READ | PROT_WRITE ) < 0 )
+			failwith("Couldn't commit %ld bytes of the element pool\n", size*w);
+		g.stats.committed += (size - g.poolSize)*w;
 	}
+	g.stats.growths++;
+	g.poolSize = size;
+	debug("Allocated space for %ld Elements\n", g.poolSize);
+}
+
+void prefaultPool(long n) {
+	// Touch the pages the next n fresh elements will occupy, so that bulk
+	// host loading doesn't take its page faults one at a time.
+	long i, page = sysconf(_SC_PAGESIZE);
+	for (i=0; i<POOL_COLUMNS; i++) {
+		long w = columns[i].width;
+		char *p   = (char *)*columns[i].base + g.freeId * w;
+		char *end = (char *)*columns[i].base + min(g.freeId+n, g.poolSize) * w;
+		p = (char *) ((long)p & ~(page-1));
+		for (; p < end; p += page) {
+			*(volatile char *)p = 0;
+			g.stats.prefaulted++;
+		}
+	}
+}
+
+void clearElement(Element *el) {
+	long i, id = elementId(el);
+	for (i=0; i<POOL_COLUMNS; i++)
+		memset((char *)*columns[i].base + id * columns[i].width, '\0', columns[i].width);
 }
 
+void poolStats(FILE *file) {
+	long freeCount = 0;
+	Element *e;
+	for (e = g.freeList; e; e = nextFree(e))
+		freeCount++;
+	fprintf(file, "Element pool: %ld bytes reserved, %ld committed in %ld growths\n",
+			g.stats.reserved, g.stats.committed, g.stats.growths);
+	fprintf(file, "              %ld of %ld elements used (peak %ld), %ld on free list, %ld pages prefaulted\n",
+			g.freeId-1-freeCount, g.poolSize, g.stats.highWater-1, freeCount, g.stats.prefaulted);
+}
+
+// Set by allocElement(): 1 if the element came from the unused end of the
+// pool rather than the free list. Undoing the allocation must return it to
+// the same place, so that the free list is restored exactly.
+long freshAlloc = 0;
+
 Element *allocElement() {
 	Element *ne = g.freeList;
 	if (ne == NULL) {
 		assert(g.freeId < g.poolSize);
 		ne = &(g.pool[g.freeId++]);
+		g.stats.highWater = max(g.stats.highWater, g.freeId);
+		freshAlloc = 1;
 	} else {
-		g.freeList = ne->free;
+		g.freeList = nextFree(ne);
+		freshAlloc = 0;
 	}
-	memset(ne, '\0', sizeof(Element));
+	clearElement(ne);
 	// setElType(type);
 	return ne;
 }
@@ -533,6 +788,31 @@ Element *safeAllocElement() {
 	checkSpace(1);
 	return allocElement();
 }
+void releaseElement(Element *el, long fresh) {
+	// undo allocElement()
+	if (fresh) {
+		assert(elementId(el) == g.freeId-1);
+		clearElement(el);
+		g.freeId--;
+	} else {
+		freeElement(el);
+	}
+}
+Element *reclaimElement(long id) {
+	// undo freeElement(). Rollback is LIFO, so the element is on top of the free list.
+	Element *el = getElementById(id);
+	assert(g.freeList == el);
+	g.freeList = nextFree(el);
+	clearElement(el);
+	return el;
+}
+void journalAlloc(Element *el, long instr) {
+	if (journalling()) {
+		pushB(freshAlloc);
+		pushB(elementId(el));
+		pushB(instr);
+	}
+}
 
 Element *unsafeAddNode() {
 	Element *el = allocElement();
@@ -540,6 +820,7 @@ Element *unsafeAddNode() {
 	setElType(n, NODE_TYPE);
 	indexNode(n);
 	g.nodeCount++;
+	journalAlloc(n, BUnAddNode);
 	assert(indeg(n) == 0 && outdeg(n) == 0 && loopdeg(n) == 0);
 	debug("( ) Created node %ld\n", elementId(n));
 	oilrStatus(n);
@@ -552,9 +833,19 @@ Element *addNode() {
 void addNodes(long n) {
 	long i;
 	checkSpace(n);
+#ifndef OILR_NO_PREFAULT
+	prefaultPool(n);
+#endif
 	for (i=0; i<n; i++)
 		unsafeAddNode();
 }
+void linkLoop(Element *e, Element *n) {
+	prependElem(loopListFor(n), outChain(e) );
+	source(e) = n;
+	target(e) = n;
+	reindexNode(n);
+	g.edgeCount++;
+}
 Element *addLoop(Element *node) {
 	Element *e = safeAllocElement();
 	Element *n     = node;
@@ -562,17 +853,23 @@ Element *addLoop(Element *node) {
 #ifndef NDEBUG
 	long lcLen=loopdeg(n);
 #endif
-	prependElem(loopListFor(n), outChain(e) );
-	e->src = node;
-	e->tgt = node;
-	reindexNode(n);
-	g.edgeCount++;
+	linkLoop(e, n);
+	journalAlloc(e, BUnAddLoop);
 	assert( lcLen+1 == listLength(loopListFor(n)) );
 	assert( listLength(loopListFor(n)) >= 0 );
 	debug("C₇O Created loop %ld on node %ld\n", elementId(e), elementId(node) );
 	oilrStatus(n);
 	return e;
 }
+void linkEdge(Element *e, Element *s, Element *t) {
+	prependElem( outListFor(s), outChain(e) );
+	prependElem( inListFor(t), inChain(e) );
+	source(e) = s;
+	target(e) = t;
+	reindexNode(s);
+	reindexNode(t);
+	g.edgeCount++;
+}
 Element *addEdge(Element *s, Element *t) {
 	Element *e = safeAllocElement();
 	setElType(e, EDGE_TYPE);
@@ -580,13 +877,8 @@ Element *addEdge(Element *s, Element *t) {
 #ifndef NDEBUG
 	long icLen=listLength(inListFor(t)), ocLen=listLength(outListFor(s));
 #endif
-	prependElem( outListFor(s), outChain(e) );
-	prependElem( inListFor(t), inChain(e) );
-	e->src = s;
-	e->tgt = t;
-	reindexNode(s);
-	reindexNode(t);
-	g.edgeCount++;
+	linkEdge(e, s, t);
+	journalAlloc(e, BUnAddEdge);
 	assert( icLen+1 == listLength(inListFor(t)) && ocLen+1 == listLength(outListFor(s)) );
 	assert( listLength(inListFor(t)) >= 0 && listLength(outListFor(s)) >= 0 );
 	debug("--> Created edge %ld as %ld-->%ld\n", elementId(e), elementId(s), elementId(t) );
@@ -609,105 +901,406 @@ void deleteNode(Element *n) {
 		exit(1);
 	}
 #endif
+	if (journalling()) {
+		pushB(getLabel(n));
+		pushB(flags(n) & ~BIND_MASK);
+		pushB(elementId(n));
+		pushB(BUnDeleteNode);
+	}
 	unindexNode(n);
 	freeElement(n);
 	g.nodeCount--;
 }
-void deleteLoop(Element *e) {
+void unlinkLoop(Element *e) {
 	Element *n = source(e);
-	debug("CxO deleted loop %ld\n", elementId(e));
 	removeElem(outChain(e));
-	freeElement(e);
 	reindexNode(n);
 	oilrStatus(n);
 	g.edgeCount--;
 }
-void deleteEdge(Element *e) {
+void deleteLoop(Element *e) {
+	debug("CxO deleted loop %ld\n", elementId(e));
+	if (journalling()) {
+		pushB(getLabel(e));
+		pushB(flags(e) & ~BIND_MASK);
+		pushB(elementId(source(e)));
+		pushB(elementId(e));
+		pushB(BUnDeleteLoop);
+	}
+	unlinkLoop(e);
+	freeElement(e);
+}
+void unlinkEdge(Element *e) {
 	Element *src = source(e), *tgt = target(e);
-	debug("-X> deleted edge %ld\n", elementId(e));
 	removeElem(outChain(e));
 	removeElem(inChain(e));
-	freeElement(e);
 	reindexNode(src);
 	reindexNode(tgt);
 	oilrStatus(src); oilrStatus(tgt);
 	g.edgeCount--;
 }
+void deleteEdge(Element *e) {
+	debug("-X> deleted edge %ld\n", elementId(e));
+	if (journalling()) {
+		pushB(getLabel(e));
+		pushB(flags(e) & ~BIND_MASK);
+		pushB(elementId(target(e)));
+		pushB(elementId(source(e)));
+		pushB(elementId(e));
+		pushB(BUnDeleteEdge);
+	}
+	unlinkEdge(e);
+	freeElement(e);
+}
 
 /////////////////////////////////////////////////////////
-// Host-graph DSL support
-
-// host  => <nodes> <spc> <labl>* <spc> <path>*
-// nodes => <int> <spc> ( "nodes" | "node" )
-// labl  => <nod> <spc> "labelled" <spc> <int>
-// path  => <nod> <spc> <edge>+ <spc> "path"
-// edge  => <ed> | <led>
-// ed    => "-->" <spc> <nod>
-// led   => "--(" <spc> <int> <spc> ")-->" <spc> <nod>
-// nod   => <int>
-
-#define DS_SIZE 16
-long ds[DS_SIZE];
-long *dsp=(ds-1);
-#define push(n) do { *(++dsp) = n; } while (0)
-#define peek()  (*dsp)
-#define pop()   (*(dsp--))
-
-#define MAX_TOK       16
-#define TOK_MATCH   "%15s"
-
-#define KW_NODES     537
-#define KW_NODE      422
-#define KW_EDGE      152
-#define KW_LABELLED  821
-#define KW_PATH      429
-#define KW_LEDGE_A   130
-#define KW_LEDGE_B   193
-
-long hash(char *str) {
-	char c;
-	long h=0;
-	while ( (c=*str) )
-		h += c;
+// Host graph loading
+//
+// Hosts can be read at startup instead of being compiled into _HOST(), either
+// in GP 2 text syntax or as a compact binary edge list:
+//
+//   "GP2E" <nodes:u32> <edges:u32> <node:u8>{nodes} (<src:u32> <tgt:u32>){edges}
+//
+// A node byte holds the root flag in bit 0 and the colour id above it. Edges
+// refer to nodes by their position in the file, counting from 0, and the top
+// bit of src marks a dashed edge. All integers are little-endian.
+//
+// Nodes are allocated in one block once the node list has been read, edges
+// are linked in without touching the OILR indices, and every node is signed
+// and indexed once at the end.
+
+#define BINARY_HOST_MAGIC "GP2E"
+#define DASHED_EDGE_BIT   (1U<<31)
+#define NODE_ROOT_BIT     1
+#define NODE_COLOUR_OFFS  1
+
+typedef struct HostScanner {
+	char *p;
+	char *end;
+	char *file;
+	long line;
+} HostScanner;
+
+typedef struct HostNode {
+	char *name;
+	long len;
+	unsigned char attrs;
+} HostNode;
+
+HostNode *hostNodes;
+long hostNodeCount, hostNodeSpace;
+long *hostNames;  // open-addressed table of hostNodes indices, -1 for free
+long hostNameMask;
+
+#define hostFail(s, ...) do { \
+	fprintf(stderr, "%s:%ld: ", (s)->file, (s)->line); \
+	failwith(__VA_ARGS__); } while (0)
+
+unsigned long hashName(char *name, long len) {
+	// FNV-1a
+	unsigned long h = 14695981039346656037UL;
+	while (len--)
+		h = (h ^ (unsigned char) *name++) * 1099511628211UL;
 	return h;
 }
-
-int nextTok(FILE *f, char *tok) {
-	return fscanf(f, TOK_MATCH, tok);
+long *nameSlot(char *name, long len) {
+	long i = hashName(name, len) & hostNameMask;
+	while (hostNames[i] >= 0) {
+		HostNode *hn = &hostNodes[hostNames[i]];
+		if (hn->len == len && memcmp(hn->name, name, len) == 0)
+			break;
+		i = (i+1) & hostNameMask;
+	}
+	return &hostNames[i];
 }
-void parseHost(FILE *host) {
-	char tok[MAX_TOK];
-	char *rem;
-	long n, h;
-	
-	while ( nextTok(host, tok) > 0 ) {
-		n = strtol(tok, &rem, 10);
-		h = hash(tok);
-		if (*rem == '\0') {
-			// numeric value
-			push(n);
+void growNames() {
+	long i, *old = hostNames, oldSize = hostNameMask+1;
+	hostNameMask = oldSize ? 2*oldSize-1 : 1023;
+	hostNames = malloc((hostNameMask+1) * sizeof(long));
+	if (!hostNames)
+		failwith("Out of memory for host node names\n");
+	memset(hostNames, -1, (hostNameMask+1) * sizeof(long));
+	for (i=0; i<oldSize; i++) {
+		if (old[i] >= 0)
+			*nameSlot(hostNodes[old[i]].name, hostNodes[old[i]].len) = old[i];
+	}
+	free(old);
+}
+
+void hostSkipSpace(HostScanner *s) {
+	while (s->p < s->end) {
+		if (*s->p == '\n') {
+			s->line++;
+			s->p++;
+		} else if (*s->p == ' ' || *s->p == '\t' || *s->p == '\r') {
+			s->p++;
+		} else if (*s->p == '/' && s->p+1 < s->end && s->p[1] == '/') {
+			while (s->p < s->end && *s->p != '\n')
+				s->p++;
 		} else {
-			switch (h) {
-				case KW_NODES:
-				case KW_NODE:
-					checkSpace(peek());
-
-					break;
-				case KW_EDGE:  // n -- n'
-
-					break;
-				case KW_LEDGE_A:
-					break;
-				case KW_LEDGE_B:  // n l -- n'
-					break;
-				default:
-					failwith("Couldn't parse host graph. Problem token is '%s'\n", tok);
-			}
+			return;
 		}
 	}
-	
+}
+int hostAccept(HostScanner *s, char c) {
+	hostSkipSpace(s);
+	if (s->p < s->end && *s->p == c) {
+		s->p++;
+		return 1;
+	}
+	return 0;
+}
+void hostExpect(HostScanner *s, char c) {
+	if (!hostAccept(s, c))
+		hostFail(s, "Expected '%c' in host graph\n", c);
+}
+#define isIdentChar(c) ( ((c)>='a' && (c)<='z') || ((c)>='A' && (c)<='Z') \
+                      || ((c)>='0' && (c)<='9') || (c)=='_' )
+long hostIdentifier(HostScanner *s, char **start) {
+	hostSkipSpace(s);
+	*start = s->p;
+	while (s->p < s->end && isIdentChar(*s->p))
+		s->p++;
+	if (s->p == *start)
+		hostFail(s, "Expected an identifier in host graph\n");
+	return s->p - *start;
+}
+#define isWord(str, len, w) ((len) == (long) strlen(w) && memcmp((str), (w), (len)) == 0)
+
+long hostColour(HostScanner *s, int isEdge) {
+	// OILR4 only handles unlabelled graphs, so the list must be "empty"
+	char *word;
+	long len = hostIdentifier(s, &word);
+	if (!isWord(word, len, "empty"))
+		hostFail(s, "OILR4 only supports unlabelled host graphs\n");
+	if (!hostAccept(s, '#'))
+		return 0;
+	len = hostIdentifier(s, &word);
+	if (isEdge && isWord(word, len, "dashed"))
+		return 1;
+	if (!isEdge && isWord(word, len, "red"))
+		return 1;
+	if (!isEdge && isWord(word, len, "blue"))
+		return 2;
+	if (!isEdge && isWord(word, len, "green"))
+		return 3;
+	if (!isEdge && isWord(word, len, "grey"))
+		return 4;
+	if (!isWord(word, len, "uncoloured"))
+		hostFail(s, "Unknown %s colour '%.*s'\n", isEdge ? "edge" : "node", (int) len, word);
+	return 0;
+}
+
+#define setHostColour(el, c) setFlags((el), flags(el) | ((c)<<COLR_OFFS))
+
+Element *loadNodes(long n) {
+	// Allocate n contiguous nodes without indexing them
+	Element *first, *el;
+	long i;
+	assert(g.freeList == NULL);
+	checkSpace(n);
+#ifndef OILR_NO_PREFAULT
+	prefaultPool(n);
+#endif
+	first = getElementById(g.freeId);
+	for (i=0; i<n; i++) {
+		el = allocElement();
+		setElType(el, NODE_TYPE);
+	}
+	g.nodeCount += n;
+	return first;
+}
+Element *loadEdge(Element *s, Element *t) {
+	// Link an edge without reindexing its end points
+	Element *e = safeAllocElement();
+	setElType(e, EDGE_TYPE);
+	if (s == t) {
+		prependElem(loopListFor(s), outChain(e));
+	} else {
+		prependElem(outListFor(s), outChain(e));
+		prependElem(inListFor(t), inChain(e));
+	}
+	source(e) = s;
+	target(e) = t;
+	g.edgeCount++;
+	return e;
+}
+void indexHost(Element *first, long n) {
+	long i;
+	for (i=0; i<n; i++)
+		indexNode(first+i);
+}
+
+Element *hostNode(HostScanner *s, Element *first) {
+	char *name;
+	long len = hostIdentifier(s, &name);
+	// The name table is only allocated by the first node.
+	long i = hostNames ? *nameSlot(name, len) : -1;
+	if (i < 0)
+		hostFail(s, "Edge refers to unknown node '%.*s'\n", (int) len, name);
+	return first+i;
+}
+
+void parseHost(HostScanner *s) {
+	Element *first, *src, *tgt, *e;
+	HostNode *hn;
+	char *name;
+	long i, *slot;
+	hostExpect(s, '[');
+	while (hostAccept(s, '(')) {
+		if (hostNodeCount*2 >= hostNameMask)
+			growNames();
+		if (hostNodeCount == hostNodeSpace) {
+			hostNodeSpace = hostNodeSpace ? 2*hostNodeSpace : 1024;
+			hostNodes = realloc(hostNodes, hostNodeSpace * sizeof(HostNode));
+			if (!hostNodes)
+				failwith("Out of memory for host nodes\n");
+		}
+		hn = &hostNodes[hostNodeCount];
+		hn->len  = hostIdentifier(s, &hn->name);
+		hn->attrs = 0;
+		if (hostAccept(s, '(')) {
+			hostSkipSpace(s);
+			if (s->p == s->end || *s->p++ != 'R' || !hostAccept(s, ')'))
+				hostFail(s, "Expected (R) in host graph\n");
+			hn->attrs |= NODE_ROOT_BIT;
+		}
+		hostExpect(s, ',');
+		hn->attrs |= hostColour(s, 0) << NODE_COLOUR_OFFS;
+		hostExpect(s, ')');
+		slot = nameSlot(hn->name, hn->len);
+		if (*slot >= 0)
+			hostFail(s, "Duplicate node '%.*s'\n", (int) hn->len, hn->name);
+		*slot = hostNodeCount++;
+	}
+	hostExpect(s, '|');
+
+	first = loadNodes(hostNodeCount);
+	for (i=0; i<hostNodeCount; i++) {
+		hn = &hostNodes[i];
+		if (hn->attrs & NODE_ROOT_BIT)
+			setFlags(first+i, flags(first+i) | ROOT_MASK);
+		setHostColour(first+i, hn->attrs >> NODE_COLOUR_OFFS);
+	}
+
+	while (hostAccept(s, '(')) {
+		hostIdentifier(s, &name);  // edge names aren't kept
+		hostExpect(s, ',');
+		src = hostNode(s, first);
+		hostExpect(s, ',');
+		tgt = hostNode(s, first);
+		hostExpect(s, ',');
+		e = loadEdge(src, tgt);
+		setHostColour(e, hostColour(s, 1));
+		hostExpect(s, ')');
+	}
+	hostExpect(s, ']');
+	indexHost(first, hostNodeCount);
+
+	free(hostNames);
+	free(hostNodes);
+	hostNames = NULL;
+	hostNodes = NULL;
+	hostNameMask = -1;
+	hostNodeCount = hostNodeSpace = 0;
+}
+
+unsigned long readU32(unsigned char *p) {
+	return p[0] | (p[1]<<8) | (p[2]<<16) | ((unsigned long) p[3]<<24);
+}
+void parseBinaryHost(unsigned char *p, long size, char *file) {
+	Element *first, *e;
+	long i, nodes, edges;
+	unsigned long src, tgt;
+	if (size < 12)
+		failwith("%s: truncated binary host graph\n", file);
+	nodes = readU32(p+4);
+	edges = readU32(p+8);
+	if (size != 12 + nodes + 8*edges)
+		failwith("%s: expected %ld bytes of binary host graph but found %ld\n",
+				file, 12 + nodes + 8*edges, size);
+	p += 12;
+	first = loadNodes(nodes);
+	for (i=0; i<nodes; i++) {
+		if (p[i] & NODE_ROOT_BIT)
+			setFlags(first+i, flags(first+i) | ROOT_MASK);
+		setHostColour(first+i, p[i] >> NODE_COLOUR_OFFS);
+	}
+	p += nodes;
+	checkSpace(edges);
+	for (i=0; i<edges; i++, p+=8) {
+		src = readU32(p);
+		tgt = readU32(p+4);
+		if ((long) (src & ~DASHED_EDGE_BIT) >= nodes || (long) tgt >= nodes)
+			failwith("%s: edge %ld refers to a nonexistent node\n", file, i);
+		e = loadEdge(first + (src & ~DASHED_EDGE_BIT), first+tgt);
+		if (src & DASHED_EDGE_BIT)
+			setHostColour(e, 1);
+	}
+	indexHost(first, nodes);
 }
 
+void loadHost(char *file) {
+	FILE *f = fopen(file, "rb");
+	HostScanner s;
+	char *buf;
+	long size;
+	if (!f)
+		failwith("Couldn't open host graph '%s'\n", file);
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0)
+		failwith("Couldn't read host graph '%s'\n", file);
+	rewind(f);
+	buf = malloc(size+1);
+	if (!buf || (long) fread(buf, 1, size, f) != size)
+		failwith("Couldn't read host graph '%s'\n", file);
+	fclose(f);
+	if (size >= 4 && memcmp(buf, BINARY_HOST_MAGIC, 4) == 0) {
+		parseBinaryHost((unsigned char *) buf, size, file);
+	} else {
+		s.p = buf;
+		s.end = buf+size;
+		s.file = file;
+		s.line = 1;
+		hostNameMask = -1;
+		parseHost(&s);
+	}
+	free(buf);
+	debug("Loaded %ld nodes and %ld edges from %s\n", g.nodeCount, g.edgeCount, file);
+}
+
+void writeU32(FILE *f, unsigned long v) {
+	fputc(v & 0xff, f);
+	fputc((v>>8) & 0xff, f);
+	fputc((v>>16) & 0xff, f);
+	fputc((v>>24) & 0xff, f);
+}
+void saveBinaryHost(char *file) {
+	FILE *f = fopen(file, "wb");
+	long i, n=0, *pos = malloc(g.freeId * sizeof(long));
+	Element *el;
+	if (!f || !pos)
+		failwith("Couldn't write binary host graph '%s'\n", file);
+	fputs(BINARY_HOST_MAGIC, f);
+	writeU32(f, g.nodeCount);
+	writeU32(f, g.edgeCount);
+	for (i=1; i<g.freeId; i++) {
+		el = getElementById(i);
+		if (elType(el) == NODE_TYPE) {
+			pos[i] = n++;
+			fputc((isRoot(el) ? NODE_ROOT_BIT : 0) | (colour(el) << NODE_COLOUR_OFFS), f);
+		}
+	}
+	for (i=1; i<g.freeId; i++) {
+		el = getElementById(i);
+		if (elType(el) == EDGE_TYPE) {
+			writeU32(f, pos[elementId(source(el))] | (colour(el) ? DASHED_EDGE_BIT : 0));
+			writeU32(f, pos[elementId(target(el))]);
+		}
+	}
+	free(pos);
+	if (fclose(f) != 0)
+		failwith("Couldn't write binary host graph '%s'\n", file);
+}
 
 
 /////////////////////////////////////////////////////////
@@ -897,35 +1490,98 @@ void loopOnNode(Element **edge, Element *node) {
 
 
 // Backtracking instructions...
-#define B_STACK_SIZE (1024*1024*1)
-long bStack[B_STACK_SIZE];
-long *bsp = bStack+B_STACK_SIZE;
-long btDepth=0;
-
-#define pushB(v) do { *(--bsp)=(v); } while (0)
-
-enum BT_INSTR {
-	BEnd=0,  // i.e. b-stack sections are null terminated
-	BUnAdd,
-};
 
 void commit() {
-	while (*(bsp++));
+	if (btDepth == 0) {
+		// outermost section: the whole journal can go
+		bsp = bfp+1;
+		bfp = (long *) popB();
+	} else {
+		// keep the records: the enclosing section may still roll them back
+		*bfp = BCommitted;
+		bfp = (long *) bfp[1];
+	}
 }
 void rollBack() {
-	long instr;
-	while ((instr = *bsp++)) {
+	long instr, fresh, flags, label, src, tgt;
+	long depth = btDepth;
+	Element *el;
+	btDepth = 0;  // inverse mutations must not be journalled themselves
+	while ((instr = popB()) != BEnd) {
 		switch (instr) {
+			case BCommitted:
+				(void) popB();
+				break;
+			case BUnAddNode:
+				el = getElementById(popB());
+				fresh = popB();
+				unindexNode(el);
+				g.nodeCount--;
+				releaseElement(el, fresh);
+				break;
+			case BUnAddEdge:
+				el = getElementById(popB());
+				fresh = popB();
+				unlinkEdge(el);
+				releaseElement(el, fresh);
+				break;
+			case BUnAddLoop:
+				el = getElementById(popB());
+				fresh = popB();
+				unlinkLoop(el);
+				releaseElement(el, fresh);
+				break;
+			case BUnDeleteNode:
+				el = reclaimElement(popB());
+				setFlags(el, popB());
+				setLabel(el, popB());
+				indexNode(el);
+				g.nodeCount++;
+				break;
+			case BUnDeleteEdge:
+				el = reclaimElement(popB());
+				src = popB();
+				tgt = popB();
+				flags = popB();
+				label = popB();
+				setFlags(el, flags);
+				setLabel(el, label);
+				linkEdge(el, getElementById(src), getElementById(tgt));
+				break;
+			case BUnDeleteLoop:
+				el = reclaimElement(popB());
+				src = popB();
+				flags = popB();
+				label = popB();
+				setFlags(el, flags);
+				setLabel(el, label);
+				linkLoop(el, getElementById(src));
+				break;
+			case BUnColour:
+				el = getElementById(popB());
+				setColour(el, popB());
+				break;
+			case BUnSetRoot:
+				unsetRoot(getElementById(popB()));
+				break;
+			case BUnUnsetRoot:
+				setRoot(getElementById(popB()));
+				break;
 			default:
-				failwith("Unknown b-stack instruction: %d\n", instr);
+				failwith("Unknown b-stack instruction: %ld\n", instr);
 		}
 	}
+	bfp = (long *) popB();
+	btDepth = depth;
+	checkGraph();
 }
 
 void BBT() {
 	// TODO: shouldn't be managing this at runtime!
 	btDepth++;
+	pushB(bfp);
 	pushB(BEnd);
+	bfp = bsp;
 }
 void EBT() {
 	btDepth--;
@@ -940,6 +1596,30 @@ void BAK() {
 }
 
 
+// Resume stack for looped rules. Rather than calling itself again when it
+// finds a match, a rule saves its registers here and goes back to matching,
+// with the search spaces left where they were. Once matching fails the saved
+// matches are popped and their right-hand sides applied, innermost first.
+Element **resumeStack = NULL;
+long rsp = 0, resumeSize = 0;
+
+void pushResume(Element **regs, long n) {
+	if (rsp + n > resumeSize) {
+		resumeSize = max(2*resumeSize, 1024);
+		while (rsp + n > resumeSize)
+			resumeSize *= 2;
+		resumeStack = realloc(resumeStack, resumeSize * sizeof(Element *));
+		if (!resumeStack)
+			failwith("Out of memory for the resume stack\n");
+	}
+	memcpy(&resumeStack[rsp], regs, n * sizeof(Element *));
+	rsp += n;
+}
+void popResume(Element **regs, long n) {
+	rsp -= n;
+	memcpy(regs, &resumeStack[rsp], n * sizeof(Element *));
+}
+
 #define reg(r) (regs[(r)])
 
 // The local jump-stack code uses 
@@ -953,28 +1633,44 @@ void BAK() {
 	static void *failStack[(n)]; \
 	static long fsi; \
 	Element *regs[n]; \
+	long nRegs = (n), resumeBase = rsp; \
 	failStack[0] = &&l_exit; \
+	l_match: \
 	memset(regs, 0, sizeof(Element *)*(n)); \
 	fsi=0
-	// fprintf(stderr, "%d: %p %p\n", MAX_RECURSE-recursionDepth, __builtin_frame_address(0), __builtin_frame_address(1))
-	
-#define ASRT(spc) \
-	do { \
-		int i=0; \
-		while ((spc)[i] != NULL) \
-			if (listLength((spc)[i++])>0) \
-				goto pass_ ## spc; \
-		fail(); \
-	} while (0) ; \
-	pass_ ## spc :
 	
+// Graph oracle: each rule compiled with the oracle enabled gets a table of
+// search spaces and the number of nodes it binds from each. If any space
+// holds too few nodes the rule can't match, and is skipped without searching.
+typedef struct OracleSpc {
+	DList **spc;
+	long min;
+} OracleSpc;
+
+int oracle(OracleSpc *o) {
+	DList **ind;
+	long n;
+	for (; o->spc; o++) {
+		for (n=0, ind=o->spc; *ind && n < o->min; ind++)
+			n += listLength(*ind);
+		if (n < o->min)
+			return 0;
+	}
+	return 1;
+}
+
+#define ORACLE(table) do { if (!oracle(table)) { boolFlag=0; return; } } while (0)
 
-#define ABN(dst)            do { reg(dst) = addNode(); if (btDepth) { pushB(reg(dst); pushB(UnAdd) ) } } while (0)
+
+#define ABN(dst)            do { reg(dst) = addNode(); } while (0)
 #define ABE(dst, src, tgt)  do { reg(dst) = addEdge(reg(src), reg(tgt)); } while (0)
 #define ABL(dst, src)       do { reg(dst) = addLoop(reg(src)); } while (0)
+#define DBN(r) deleteNode(reg(r))
 #define DBE(r) deleteEdge(reg(r))
 #define DBL(r) deleteLoop(reg(r))
 
+#define RBN(r, b) do { if (b) setRoot(reg(r)); else unsetRoot(reg(r)); } while (0)
+
 #define CBN(r, c) setColour(reg(r), c)
 
 void bnd(Element **dst, DList **spc, DList **dl, long *pos) {
@@ -1071,10 +1767,30 @@ void bnd(Element **dst, DList **spc, DList **dl, long *pos) {
 		if (!boolFlag) fail(); \
 	} while (0)
 
-#define SUC() if (recursionDepth>0) do { trace('S'); oilrTrace(NULL); nextTraceId(); recursionDepth--; (*self)(); boolFlag=1; } while (0)
+#define SUC() \
+	if (recursionDepth>0) do { \
+		trace('S'); oilrTrace(NULL); nextTraceId(); \
+		recursionDepth--; \
+		pushResume(regs, nRegs); \
+		goto l_match; \
+	} while (0); \
+	l_resume:
+
+// End of a rule: apply any matches saved by SUC before returning
+#define RES() \
+	do { \
+		if (rsp > resumeBase) { \
+			popResume(regs, nRegs); \
+			boolFlag=1; \
+			goto l_resume; \
+		} \
+	} while (0)
 
 #define BNZ(tgt) if (boolFlag) goto tgt
 #define BRZ(tgt) if (!boolFlag) goto tgt
+#define BRN(tgt) goto tgt
+#define BRA(tgt) if (rand() & 1) goto tgt
+#define NOP()
 
 #define TRU() do { boolFlag = 1; } while (0)
 #define FLS() do { boolFlag = 0; } while (0)
@@ -1195,19 +1911,13 @@ void dumpGraph(FILE *file) {
 // main
 
 int main(int argc, char **argv) {
-	// C doesn't provide a way to get an extensible memory area
-	// that is guaranteed not to move, so we have to do it ourselves with brk().
-	// Screw C. Added bonus: brk always starts out aligned to a memory page, so we
-	// get aligned memory for free.
-	currentBrk = sbrk(0);  // get current brk address -- C doesn't give us a way to 
-	debug("Brk: 0x%x, sizeof(Element): %d, num inds: %d\n", currentBrk, sizeof(Element), OILR_INDEX_SIZE);
-	g.pool = currentBrk;
-	g.poolSize  = 0;
+	debug("sizeof(Element): %d, num inds: %d\n", sizeof(Element), OILR_INDEX_SIZE);
+	reservePool();
 	g.nodeCount = 0;
 	g.edgeCount = 0;
 	g.freeId    = 1;  // we don't use g.pool->[0]
+	g.stats.highWater = g.freeId;
 
-	(void)argc; (void)argv;  // silence unused param warning for this function only
 #ifdef OILR_EXECUTION_TRACE
 	oilrTraceFile = stderr;
 #endif
@@ -1221,7 +1931,18 @@ int main(int argc, char **argv) {
 	} */
 
 	// checkGraph();
-	_HOST();
+	if (argc == 1) {
+		_HOST();
+	} else if (argc == 2) {
+		loadHost(argv[1]);
+	} else if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+		// convert a host graph to the binary format and stop
+		loadHost(argv[2]);
+		saveBinaryHost(argv[3]);
+		return 0;
+	} else {
+		failwith("Usage: %s [host-file]\n       %s -c host-file binary-host-file\n", argv[0], argv[0]);
+	}
 
 	// setRootById(1);
 	checkGraph();
@@ -1234,6 +1955,9 @@ int main(int argc, char **argv) {
 	fprintf(stderr, "Program completed in %ld bind operations.\n", bindCount);
 #endif
 	//assert(bindCount == unbindCount);
+#if defined(OILR_POOL_STATS) || !defined(NDEBUG)
+	poolStats(stderr);
+#endif
 
 	if (!boolFlag) {
 		debug("* GP2 program failed.\n");
@@ -1244,12 +1968,9 @@ int main(int argc, char **argv) {
 	return 0;
 }
 
-#define ALAP(id) do { nextTraceId(); self=(id); do { recursionDepth=MAX_RECURSE; (id)(); } while (boolFlag); trace(boolFlag?'S':'F'); boolFlag=1; oilrTrace(NULL); } while (0)
+#define ALAP(id) do { nextTraceId(); do { recursionDepth=MAX_RECURSE; (id)(); } while (boolFlag); trace(boolFlag?'S':'F'); boolFlag=1; oilrTrace(NULL); } while (0)
 #define ONCE(id) do { nextTraceId(); recursionDepth=0; (id)(); trace(boolFlag?'S':'F'); oilrTrace(NULL); } while (0)
 
-/* #define ALAP_ORACLE(id, ...) if (oracle(__VA_ARGS__)) ALAP(id)
-#define ONCE_ORACLE(id, ...) if (oracle(__VA_ARGS__)) ONCE(id) */
-
 /* #define ALAP(rule, recursive, ...) do { \
 	DList *state[] = { __VA_ARGS__ }; \
 	oilrReport(); \
@@ -13,7 +13,7 @@ if [ -z "$OILR_DIR" ]; then
 	exit 1
 fi
 
-OILR="$OILR_DIR/oilr_machine"
+OILR="${OILR_MACHINE:-$OILR_DIR/oilr_machine}"
 OILR_LIB="$OILR_DIR/lib/*"
 
 exec $OILR $OILR_LIB $@
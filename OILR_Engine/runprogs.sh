@@ -10,5 +10,5 @@ fail () {
 for p in Progs/*.oilr ; do
 	echo -ne "$p\n  "
 	./oilr.sh $p > /tmp/oilr.out  || fail
-	../Haskell/IsoChecker $p.out /tmp/oilr.out || exit 1
+	../Compiler/lib/gp2iso $p.out /tmp/oilr.out || exit 1
 done